@@ -43,6 +43,11 @@ String getVersionString();
     #define ORACON_COMPILER_MSVC
 #endif
 
+// SIMD detection (SSE2 is part of the x86-64 baseline)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define ORACON_SIMD_SSE2
+#endif
+
 // Debug macros
 #ifdef NDEBUG
     #define ORACON_DEBUG 0
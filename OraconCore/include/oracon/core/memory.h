@@ -2,8 +2,12 @@
 #define ORACON_CORE_MEMORY_H
 
 #include "types.h"
+#include <atomic>
 #include <memory>
+#include <new>
 #include <cstdlib>
+#include <type_traits>
+#include <vector>
 
 namespace oracon {
 namespace core {
@@ -13,7 +17,9 @@ void* allocate(usize size);
 void* reallocate(void* ptr, usize newSize);
 void deallocate(void* ptr);
 
-// Arena allocator for fast temporary allocations
+// Arena allocator for fast temporary allocations.
+// Grows by chaining a new, larger block when the current one is full;
+// earlier allocations never move.
 class Arena {
 public:
     explicit Arena(usize capacity = 1024 * 1024); // 1MB default
@@ -25,14 +31,31 @@ public:
     Arena& operator=(Arena&&) noexcept;
 
     void* allocate(usize size, usize alignment = alignof(std::max_align_t));
+
+    // Construct a T in the arena. Its destructor is not run by the arena.
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Frees all but the newest block and rewinds it
     void reset();
-    usize getUsed() const { return m_used; }
-    usize getCapacity() const { return m_capacity; }
+
+    usize getUsed() const { return m_retiredUsed + m_used; }
+    usize getCapacity() const { return m_retiredCapacity + m_capacity; }
 
 private:
     u8* m_buffer;
     usize m_capacity;
     usize m_used;
+
+    // Full blocks kept alive until reset or destruction
+    std::vector<u8*> m_retired;
+    usize m_retiredUsed;
+    usize m_retiredCapacity;
+
+    void grow(usize minSize);
+    void releaseRetired();
 };
 
 // Memory pool for fixed-size allocations
@@ -88,6 +111,131 @@ SharedPtr<T> makeShared(Args&&... args) {
     return std::make_shared<T>(std::forward<Args>(args)...);
 }
 
+template<typename T, bool Intrusive>
+struct RefBox;
+
+// Base for objects whose count must be readable from the object alone, such
+// as those a collector reaches by address. A Ref to one keeps the count here
+// instead of beside the object. Copies start uncounted.
+class RefCounted {
+public:
+    // Refs sharing this object; 0 if it was not made by makeRef
+    u32 getRefCount() const { return m_refs.load(std::memory_order_relaxed); }
+
+protected:
+    RefCounted() noexcept : m_refs(0) {}
+    RefCounted(const RefCounted&) noexcept : m_refs(0) {}
+    RefCounted& operator=(const RefCounted&) noexcept { return *this; }
+    ~RefCounted() = default;
+
+private:
+    template<typename T, bool Intrusive>
+    friend struct RefBox;
+
+    std::atomic<u32> m_refs;
+};
+
+// Intrusively reference-counted pointer. The count lives next to the object in
+// one allocation, or in the object for RefCounted types, and the handle is a
+// single pointer (std::shared_ptr is two), so types that embed it, like
+// lang::Value, stay small.
+template<typename T>
+class Ref {
+public:
+    Ref() noexcept : m_box(nullptr) {}
+    Ref(std::nullptr_t) noexcept : m_box(nullptr) {}
+    Ref(const Ref& other) noexcept : m_box(other.m_box) { retain(); }
+    Ref(Ref&& other) noexcept : m_box(other.m_box) { other.m_box = nullptr; }
+    ~Ref() { release(); }
+
+    Ref& operator=(const Ref& other) noexcept {
+        if (m_box != other.m_box) {
+            release();
+            m_box = other.m_box;
+            retain();
+        }
+        return *this;
+    }
+
+    Ref& operator=(Ref&& other) noexcept {
+        if (this != &other) {
+            release();
+            m_box = other.m_box;
+            other.m_box = nullptr;
+        }
+        return *this;
+    }
+
+    template<typename... Args>
+    static Ref make(Args&&... args) {
+        Ref ref;
+        ref.m_box = new Box(std::forward<Args>(args)...);
+        return ref;
+    }
+
+    T* get() const { return m_box ? &m_box->value : nullptr; }
+    T& operator*() const { return m_box->value; }
+    T* operator->() const { return &m_box->value; }
+    explicit operator bool() const { return m_box != nullptr; }
+
+    u32 useCount() const { return m_box ? m_box->counter().load(std::memory_order_relaxed) : 0; }
+
+    void reset() { release(); m_box = nullptr; }
+
+    friend bool operator==(const Ref& a, const Ref& b) { return a.m_box == b.m_box; }
+    friend bool operator!=(const Ref& a, const Ref& b) { return a.m_box != b.m_box; }
+
+private:
+    struct Box;   // defined below, once T is complete
+
+    Box* m_box;
+
+    void retain() {
+        if (m_box) m_box->counter().fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() {
+        if (m_box && m_box->counter().fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete m_box;
+        }
+    }
+};
+
+// A Ref's allocation: the object with its count beside it...
+template<typename T, bool Intrusive = std::is_base_of<RefCounted, T>::value>
+struct RefBox {
+    template<typename... Args>
+    explicit RefBox(Args&&... args) : value(std::forward<Args>(args)...), refs(1) {}
+
+    std::atomic<u32>& counter() { return refs; }
+
+    T value;
+    std::atomic<u32> refs;
+};
+
+// ...or the object alone, counting itself
+template<typename T>
+struct RefBox<T, true> {
+    template<typename... Args>
+    explicit RefBox(Args&&... args) : value(std::forward<Args>(args)...) {
+        counter().store(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<u32>& counter() { return value.RefCounted::m_refs; }
+
+    T value;
+};
+
+template<typename T>
+struct Ref<T>::Box : RefBox<T> {
+    using RefBox<T>::RefBox;
+};
+
+template<typename T, typename... Args>
+Ref<T> makeRef(Args&&... args) {
+    return Ref<T>::make(std::forward<Args>(args)...);
+}
+
 } // namespace core
 } // namespace oracon
 
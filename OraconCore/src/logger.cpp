@@ -2,6 +2,7 @@
 #include <iostream>
 #include <ctime>
 #include <iomanip>
+#include <mutex>
 
 namespace oracon {
 namespace core {
@@ -20,6 +21,10 @@ void Logger::log(LogLevel level, const String& message, const char* file, int li
         return;
     }
 
+    // Scripts may log from worker threads; keep lines whole (localtime is shared too)
+    static std::mutex s_mutex;
+    std::lock_guard<std::mutex> lock(s_mutex);
+
     // Get current time
     auto now = std::time(nullptr);
     auto tm = *std::localtime(&now);
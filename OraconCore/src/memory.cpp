@@ -30,11 +30,14 @@ Arena::Arena(usize capacity)
     : m_buffer(nullptr)
     , m_capacity(capacity)
     , m_used(0)
+    , m_retiredUsed(0)
+    , m_retiredCapacity(0)
 {
-    m_buffer = static_cast<u8*>(allocate(capacity));
+    m_buffer = static_cast<u8*>(core::allocate(capacity));
 }
 
 Arena::~Arena() {
+    releaseRetired();
     if (m_buffer) {
         deallocate(m_buffer);
     }
@@ -44,14 +47,21 @@ Arena::Arena(Arena&& other) noexcept
     : m_buffer(other.m_buffer)
     , m_capacity(other.m_capacity)
     , m_used(other.m_used)
+    , m_retired(std::move(other.m_retired))
+    , m_retiredUsed(other.m_retiredUsed)
+    , m_retiredCapacity(other.m_retiredCapacity)
 {
     other.m_buffer = nullptr;
     other.m_capacity = 0;
     other.m_used = 0;
+    other.m_retired.clear();
+    other.m_retiredUsed = 0;
+    other.m_retiredCapacity = 0;
 }
 
 Arena& Arena::operator=(Arena&& other) noexcept {
     if (this != &other) {
+        releaseRetired();
         if (m_buffer) {
             deallocate(m_buffer);
         }
@@ -59,10 +69,16 @@ Arena& Arena::operator=(Arena&& other) noexcept {
         m_buffer = other.m_buffer;
         m_capacity = other.m_capacity;
         m_used = other.m_used;
+        m_retired = std::move(other.m_retired);
+        m_retiredUsed = other.m_retiredUsed;
+        m_retiredCapacity = other.m_retiredCapacity;
 
         other.m_buffer = nullptr;
         other.m_capacity = 0;
         other.m_used = 0;
+        other.m_retired.clear();
+        other.m_retiredUsed = 0;
+        other.m_retiredCapacity = 0;
     }
     return *this;
 }
@@ -71,8 +87,9 @@ void* Arena::allocate(usize size, usize alignment) {
     // Align the current position
     usize alignedUsed = (m_used + alignment - 1) & ~(alignment - 1);
 
-    if (alignedUsed + size > m_capacity) {
-        return nullptr; // Out of memory
+    if (!m_buffer || alignedUsed + size > m_capacity) {
+        grow(size + alignment);
+        alignedUsed = (m_used + alignment - 1) & ~(alignment - 1);
     }
 
     void* ptr = m_buffer + alignedUsed;
@@ -80,7 +97,35 @@ void* Arena::allocate(usize size, usize alignment) {
     return ptr;
 }
 
+void Arena::grow(usize minSize) {
+    if (m_buffer) {
+        m_retired.push_back(m_buffer);
+        m_retiredUsed += m_used;
+        m_retiredCapacity += m_capacity;
+    }
+
+    // Double each time so a large arena needs few blocks
+    usize capacity = m_capacity * 2;
+    if (capacity < minSize) {
+        capacity = minSize;
+    }
+
+    m_buffer = static_cast<u8*>(core::allocate(capacity));
+    m_capacity = capacity;
+    m_used = 0;
+}
+
+void Arena::releaseRetired() {
+    for (u8* block : m_retired) {
+        deallocate(block);
+    }
+    m_retired.clear();
+    m_retiredUsed = 0;
+    m_retiredCapacity = 0;
+}
+
 void Arena::reset() {
+    releaseRetired();
     m_used = 0;
 }
 
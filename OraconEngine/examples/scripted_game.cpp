@@ -96,15 +96,8 @@ public:
     }
 
     void onUpdate(f32 deltaTime) override {
-        // Update all script components
-        for (auto& entity : getScene()->getWorld()->getEntities()) {
-            if (!entity->isActive()) continue;
-
-            auto* script = entity->getComponent<ScriptComponent>();
-            if (script) {
-                script->onUpdate(entity.get(), getScene()->getWorld(), deltaTime);
-            }
-        }
+        // Update all script components, in parallel across entities
+        m_scripts.update(getScene()->getWorld(), deltaTime);
     }
 
     void onRender(Renderer& renderer) override {
@@ -138,6 +131,9 @@ public:
     void onShutdown() override {
         std::cout << "Shutting down. Total frames: " << getTime()->frameCount() << "\n";
     }
+
+private:
+    ScriptScheduler m_scripts;
 };
 
 int main() {
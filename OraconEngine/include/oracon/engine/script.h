@@ -6,61 +6,295 @@
 #include "oracon/lang/interpreter/interpreter.h"
 #include "oracon/lang/parser/parser.h"
 #include "oracon/lang/lexer/lexer.h"
+#include "oracon/lang/vm/vm.h"
+#include "oracon/lang/compiler/optimizer.h"
+#include "oracon/lang/compiler/bundle.h"
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace oracon {
 namespace engine {
 
 using core::String;
 using core::f32;
+using core::usize;
 
 // Forward declarations
 class Entity;
 class World;
 class Input;
 
+// Parsed form of one script source, plus its bytecode once requested.
+// Immutable after construction and shared by every ScriptComponent running
+// the same code, so only per-entity Interpreter/VM state is duplicated.
+class CompiledScript {
+public:
+    explicit CompiledScript(const String& source);
+
+    // A program precompiled into a bundle; it has bytecode but no AST, and
+    // keeps the bundle mapped while in use
+    CompiledScript(std::shared_ptr<const lang::ScriptBundle> bundle, const lang::CompiledProgram* program);
+
+    // Empty for bundled scripts
+    const String& getSource() const { return m_source; }
+
+    // nullptr for bundled scripts
+    const lang::Program* getProgram() const { return m_program.get(); }
+    bool hasParseErrors() const { return !m_parseErrors.empty(); }
+    const std::vector<String>& getParseErrors() const { return m_parseErrors; }
+
+    // Bytecode is compiled on first request; nullptr if the compiler rejected the program
+    const lang::CompiledProgram* getBytecode() const;
+    const std::vector<String>& getCompileErrors() const;
+
+private:
+    String m_source;   // the AST's tokens view it
+    std::unique_ptr<lang::Program> m_program;
+    std::vector<String> m_parseErrors;
+
+    mutable std::once_flag m_bytecodeOnce;
+    mutable std::unique_ptr<lang::CompiledProgram> m_bytecode;
+    mutable std::vector<String> m_compileErrors;
+
+    std::shared_ptr<const lang::ScriptBundle> m_bundle;
+    const lang::CompiledProgram* m_precompiled = nullptr;
+
+    void compileBytecode() const;
+};
+
+// Process-wide cache of CompiledScripts keyed by source text.
+// Entries are held weakly: a script is freed once no component uses it.
+// The text itself is kept only by the script; entries are found by its hash.
+class ScriptCache {
+public:
+    static std::shared_ptr<const CompiledScript> acquire(const String& source);
+
+    // Number of distinct sources currently cached
+    static usize size();
+
+private:
+    static std::mutex s_mutex;
+    static std::unordered_multimap<usize, std::weak_ptr<const CompiledScript>> s_entries;
+};
+
+// Writes a script makes to entities other than its own. They are recorded
+// while scripts run, possibly in parallel, and applied at a sync point.
+// Targets are entity names, resolved when the commands are applied.
+class ScriptCommandBuffer {
+public:
+    void setPosition(const String& entityName, f32 x, f32 y);
+    void setVelocity(const String& entityName, f32 vx, f32 vy);
+    void destroy(const String& entityName);
+
+    // Moves other's commands to the end of this buffer
+    void append(ScriptCommandBuffer& other);
+
+    // Applies the commands in the order they were recorded and clears them.
+    // Entities are destroyed last, so no command sees a dangling target.
+    void apply(World* world);
+
+    bool empty() const { return m_commands.empty(); }
+    usize size() const { return m_commands.size(); }
+
+private:
+    enum class CommandType : core::u8 {
+        SetPosition,
+        SetVelocity,
+        Destroy
+    };
+
+    struct Command {
+        CommandType type;
+        String target;
+        f32 x;
+        f32 y;
+    };
+
+    std::vector<Command> m_commands;
+};
+
+// Entity and world a script is currently running for.
+// Owned by each ScriptComponent; API natives read it on every call.
+struct ScriptContext {
+    Entity* entity = nullptr;
+    World* world = nullptr;
+    ScriptCommandBuffer* commands = nullptr;
+};
+
 // Script component that executes OraconLang code
 class ScriptComponent : public Component {
 public:
     ScriptComponent() = default;
     explicit ScriptComponent(const String& code);
 
+    // Bound API functions point at m_context, so the component must stay put
+    ScriptComponent(const ScriptComponent&) = delete;
+    ScriptComponent& operator=(const ScriptComponent&) = delete;
+
     // Load script from file
     static ScriptComponent* fromFile(const String& filepath);
 
-    // Set script code
+    // Set script code. The script starts over: its state is discarded and
+    // it runs from the top at the next onStart.
     void setCode(const String& code);
     const String& getCode() const { return m_code; }
 
-    // Script lifecycle callbacks
+    // Swaps in an edited version of a running script, keeping its state (see
+    // lang::VM::reload). Only the new top level's declarations run: existing
+    // globals keep their values unless their new initializer is a literal,
+    // array or map of another type, new ones are initialized, top-level
+    // functions take their new bodies, other top-level statements are
+    // skipped, and coroutines keep running. Components with the same code
+    // share one parse of the new version. Code that fails to parse or
+    // compile is rejected and the old version keeps running. Hot reload needs
+    // the bytecode VM: scripts that have not started, are bundled, or run on
+    // the tree-walking interpreter are reset as by setCode. False if rejected.
+    bool reloadCode(const String& code);
+
+    // Use a script precompiled into a bundle by compile_scripts instead of
+    // source code; nothing is parsed or compiled at load time. Bundled
+    // scripts always run on the VM. False if the bundle has no such script.
+    bool setBundledScript(const std::shared_ptr<const lang::ScriptBundle>& bundle, const String& name);
+
+    // Select bytecode or tree-walking execution; takes effect on next compile.
+    // Scripts run on the VM unless set to TreeWalk, or unless the compiler
+    // rejects them.
+    void setExecutionMode(lang::ExecutionMode mode);
+    lang::ExecutionMode getExecutionMode() const { return m_mode; }
+
+    // Fuel and time limits for each onStart/onUpdate/onFixedUpdate call,
+    // and a cap on the script's heap. A script that overruns is aborted and
+    // the overrun shows in getErrors(). Enforced by the bytecode VM, which
+    // scripts run on by default; a script set to TreeWalk, or falling back
+    // to it, runs unbounded and logs a warning.
+    void setExecutionBudget(const lang::ExecutionBudget& budget);
+    const lang::ExecutionBudget& getExecutionBudget() const { return m_budget; }
+
+    // Size and collector activity of the script's heap; all zero in
+    // tree-walking mode
+    lang::HeapStats getHeapStats() const;
+
+    // Samples where the script spends its time; can be switched on and off
+    // between updates. Results accumulate until the profiler is reset.
+    // Profiled by the bytecode VM, the default; a script set to TreeWalk, or
+    // falling back to it, is not sampled and logs a warning.
+    void setProfiling(bool enabled, core::f64 sampleIntervalMs = 1.0);
+    bool isProfiling() const { return m_profiling; }
+    lang::Profiler* getProfiler() const { return m_profiler.get(); }
+
+    // Script lifecycle callbacks. onUpdate calls the script's update(dt), if
+    // any, then resumes its due coroutines. Coroutines need the VM; a
+    // script set to TreeWalk has no startCoroutine. Each one
+    // applies the script's deferred cross-entity writes before returning.
     void onStart(Entity* entity, World* world);
     void onUpdate(Entity* entity, World* world, f32 deltaTime);
     void onFixedUpdate(Entity* entity, World* world, f32 fixedDeltaTime);
 
+    // onUpdate without applying deferred writes. Components of different
+    // entities running on the VM may run this concurrently; ScriptScheduler
+    // does.
+    void runUpdate(Entity* entity, World* world, f32 deltaTime);
+
+    // The tree-walking interpreter is not safe to run alongside other
+    // scripts; such components update on the scheduler's calling thread
+    bool runsOnInterpreter() const { return m_interpreter != nullptr; }
+
+    // Applies cross-entity writes recorded since the last call
+    void applyCommands(World* world);
+    ScriptCommandBuffer& getCommands() { return m_commands; }
+
     // Check if script has errors
     bool hasErrors() const;
     String getErrors() const;
 
 private:
     String m_code;
-    std::unique_ptr<lang::Lexer> m_lexer;
-    std::unique_ptr<lang::Parser> m_parser;
+    std::shared_ptr<const CompiledScript> m_script; // must outlive the interpreter/VM below
+    std::shared_ptr<const CompiledScript> m_precompiled; // set instead of m_code for bundled scripts
+    // Versions replaced by reloadCode; the VM may still run or call into them
+    std::vector<std::shared_ptr<const CompiledScript>> m_retiredScripts;
     std::unique_ptr<lang::Interpreter> m_interpreter;
-    std::unique_ptr<lang::Program> m_program;
+    std::unique_ptr<lang::VM> m_vm;
+    ScriptContext m_context;
+    ScriptCommandBuffer m_commands;
+    std::vector<lang::Value> m_arguments;   // reused by every callback, so calls do not allocate
+    lang::ExecutionMode m_mode = lang::ExecutionMode::Bytecode;
+    lang::ExecutionBudget m_budget;
+    std::unique_ptr<lang::Profiler> m_profiler;
+    bool m_profiling = false;
     bool m_initialized = false;
 
     void compile();
-    void setupAPI(Entity* entity, World* world);
+    void reset();
+    void bindAPI();
+    void setContext(Entity* entity, World* world);
+    lang::Environment& globalEnv();
+    void callScriptFunction(lang::Symbol name, f32 arg, const char* context);
+    void logRuntimeErrors(const char* context);
 };
 
-// Scripting API - exposes engine functionality to scripts
-class ScriptingAPI {
+// Runs the scripts of every active entity in a World across a pool of worker
+// threads. A script may touch its own entity directly; writes to other
+// entities go through its command buffer and are applied after all scripts
+// have run, on the calling thread and in entity order, so the outcome does
+// not depend on scheduling. Scripts set to, or falling back to, the
+// tree-walking interpreter run one after another on the calling thread once
+// the workers are done. Entities
+// must not be added or removed while update() runs, other than through the
+// command buffers.
+class ScriptScheduler {
 public:
-    static void registerBuiltins(lang::Interpreter* interpreter, Entity* entity, World* world);
+    // One worker per hardware thread, less the calling thread
+    static constexpr usize AUTO_WORKERS = static_cast<usize>(-1);
+
+    // Threads besides the calling one; with 0 every script runs on the caller
+    explicit ScriptScheduler(usize workerCount = AUTO_WORKERS);
+    ~ScriptScheduler();
+
+    ScriptScheduler(const ScriptScheduler&) = delete;
+    ScriptScheduler& operator=(const ScriptScheduler&) = delete;
+
+    void update(World* world, f32 deltaTime);
+
+    usize getWorkerCount() const { return m_workers.size(); }
 
 private:
-    static Entity* s_currentEntity;
-    static World* s_currentWorld;
+    struct Job {
+        Entity* entity;
+        ScriptComponent* script;
+        bool serial;   // runs on the calling thread only
+    };
+
+    std::vector<std::thread> m_workers;
+    std::vector<Job> m_jobs;             // every script, in entity order
+    std::vector<usize> m_parallelJobs;   // indices into m_jobs the workers take
+    ScriptCommandBuffer m_commands;
+    World* m_world;
+    f32 m_deltaTime;
+    std::atomic<usize> m_nextJob;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;      // workers wait for a new generation
+    std::condition_variable m_finished;  // update() waits for the workers
+    core::u64 m_generation;
+    usize m_busyWorkers;
+    bool m_stopping;
+
+    void workerLoop();
+    void runJobs();
+};
+
+// Scripting API - exposes engine functionality to scripts
+class ScriptingAPI {
+public:
+    // Defines the API functions once per interpreter; they resolve the
+    // entity and world through context at call time
+    static void registerBuiltins(lang::Environment& env, ScriptContext* context);
 };
 
 } // namespace engine
@@ -1,4 +1,5 @@
 #include "oracon/engine/world.h"
+#include <algorithm>
 
 namespace oracon {
 namespace engine {
@@ -3,15 +3,163 @@
 #include "oracon/engine/world.h"
 #include "oracon/engine/input.h"
 #include "oracon/core/logger.h"
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 namespace oracon {
 namespace engine {
 
-// Static members for ScriptingAPI
-Entity* ScriptingAPI::s_currentEntity = nullptr;
-World* ScriptingAPI::s_currentWorld = nullptr;
+// Static members for ScriptCache
+std::mutex ScriptCache::s_mutex;
+std::unordered_multimap<usize, std::weak_ptr<const CompiledScript>> ScriptCache::s_entries;
+
+// ===== ScriptCommandBuffer =====
+
+void ScriptCommandBuffer::setPosition(const String& entityName, f32 x, f32 y) {
+    m_commands.push_back({CommandType::SetPosition, entityName, x, y});
+}
+
+void ScriptCommandBuffer::setVelocity(const String& entityName, f32 vx, f32 vy) {
+    m_commands.push_back({CommandType::SetVelocity, entityName, vx, vy});
+}
+
+void ScriptCommandBuffer::destroy(const String& entityName) {
+    m_commands.push_back({CommandType::Destroy, entityName, 0.0f, 0.0f});
+}
+
+void ScriptCommandBuffer::append(ScriptCommandBuffer& other) {
+    if (m_commands.empty()) {
+        m_commands.swap(other.m_commands);
+        return;
+    }
+    m_commands.insert(m_commands.end(),
+        std::make_move_iterator(other.m_commands.begin()),
+        std::make_move_iterator(other.m_commands.end()));
+    other.m_commands.clear();
+}
+
+void ScriptCommandBuffer::apply(World* world) {
+    if (m_commands.empty()) return;
+
+    // Destroying an entity may destroy the component that owns this buffer
+    std::vector<Command> commands;
+    commands.swap(m_commands);
+
+    std::vector<Entity*> destroyed;
+    for (const auto& command : commands) {
+        Entity* target = world->findEntityByName(command.target);
+        if (!target) {
+            ORACON_LOG_WARNING("Script command targets unknown entity: " + command.target);
+            continue;
+        }
+
+        switch (command.type) {
+            case CommandType::SetPosition:
+                if (auto* transform = target->getComponent<Transform>()) {
+                    transform->position.x = command.x;
+                    transform->position.y = command.y;
+                }
+                break;
+            case CommandType::SetVelocity:
+                if (auto* rb = target->getComponent<Rigidbody>()) {
+                    rb->velocity.x = command.x;
+                    rb->velocity.y = command.y;
+                }
+                break;
+            case CommandType::Destroy:
+                if (std::find(destroyed.begin(), destroyed.end(), target) == destroyed.end()) {
+                    destroyed.push_back(target);
+                }
+                break;
+        }
+    }
+
+    for (Entity* entity : destroyed) {
+        world->destroyEntity(entity);
+    }
+}
+
+// ===== CompiledScript =====
+
+CompiledScript::CompiledScript(const String& source)
+    : m_source(source) {
+    lang::Lexer lexer(m_source);
+    auto tokens = lexer.tokenize();
+
+    lang::Parser parser(tokens);
+    m_program = parser.parse();
+    if (parser.hasError()) {
+        m_parseErrors = parser.getErrors();
+        return;
+    }
+
+    // Fold constants once here rather than on every evaluation, for both tiers
+    lang::Optimizer optimizer;
+    optimizer.optimize(m_program.get());
+}
+
+CompiledScript::CompiledScript(std::shared_ptr<const lang::ScriptBundle> bundle, const lang::CompiledProgram* program)
+    : m_bundle(std::move(bundle))
+    , m_precompiled(program)
+{}
+
+const lang::CompiledProgram* CompiledScript::getBytecode() const {
+    if (m_precompiled) return m_precompiled;
+    std::call_once(m_bytecodeOnce, [this]() { compileBytecode(); });
+    return m_bytecode.get();
+}
+
+const std::vector<String>& CompiledScript::getCompileErrors() const {
+    std::call_once(m_bytecodeOnce, [this]() { compileBytecode(); });
+    return m_compileErrors;
+}
+
+void CompiledScript::compileBytecode() const {
+    if (!m_program || hasParseErrors()) {
+        return;
+    }
+
+    lang::Compiler compiler;
+    auto compiled = compiler.compile(m_program.get());
+    if (compiler.hasError()) {
+        m_compileErrors = compiler.getErrors();
+        return;
+    }
+    m_bytecode = std::move(compiled);
+}
+
+// ===== ScriptCache =====
+
+std::shared_ptr<const CompiledScript> ScriptCache::acquire(const String& source) {
+    usize hash = std::hash<String>()(source);
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    auto range = s_entries.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto script = it->second.lock();
+        if (script && script->getSource() == source) {
+            return script;
+        }
+    }
+
+    // New source: drop entries whose scripts are no longer used by anyone
+    for (auto entry = s_entries.begin(); entry != s_entries.end();) {
+        entry = entry->second.expired() ? s_entries.erase(entry) : std::next(entry);
+    }
+
+    auto script = std::make_shared<const CompiledScript>(source);
+    s_entries.emplace(hash, script);
+    return script;
+}
+
+usize ScriptCache::size() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_entries.size();
+}
+
+// ===== ScriptComponent =====
 
 ScriptComponent::ScriptComponent(const String& code)
     : m_code(code)
@@ -32,40 +180,191 @@ ScriptComponent* ScriptComponent::fromFile(const String& filepath) {
 
 void ScriptComponent::setCode(const String& code) {
     m_code = code;
+    m_precompiled.reset();
+    reset();
+}
+
+bool ScriptComponent::reloadCode(const String& code) {
+    if (!m_vm || m_precompiled) {
+        setCode(code);
+        return true;
+    }
+    if (code == m_code) {
+        return true;
+    }
+
+    std::shared_ptr<const CompiledScript> script = ScriptCache::acquire(code);
+    if (script->hasParseErrors()) {
+        for (const auto& error : script->getParseErrors()) {
+            ORACON_LOG_ERROR("Script reload rejected, parse error: " + error);
+        }
+        return false;
+    }
+    if (!script->getBytecode()) {
+        for (const auto& error : script->getCompileErrors()) {
+            ORACON_LOG_ERROR("Script reload rejected, compile error: " + error);
+        }
+        return false;
+    }
+
+    m_code = code;
+    m_retiredScripts.push_back(std::move(m_script));
+    m_script = std::move(script);
+
+    // Runs the new top level; errors there leave the script partly updated,
+    // as they would on a first start
+    if (!m_vm->reload(m_script->getBytecode())) {
+        logRuntimeErrors("reload");
+    }
+    if (m_context.world) {
+        applyCommands(m_context.world);
+    }
+    return true;
+}
+
+bool ScriptComponent::setBundledScript(const std::shared_ptr<const lang::ScriptBundle>& bundle, const String& name) {
+    const lang::CompiledProgram* program = bundle ? bundle->find(name) : nullptr;
+    if (!program) {
+        ORACON_LOG_ERROR("Script not found in bundle: " + name);
+        return false;
+    }
+
+    m_code.clear();
+    m_precompiled = std::make_shared<const CompiledScript>(bundle, program);
+    m_mode = lang::ExecutionMode::Bytecode;
+    reset();
+    return true;
+}
+
+void ScriptComponent::reset() {
     m_initialized = false;
-    m_program.reset();
+    m_vm.reset();
+    m_interpreter.reset();
+    m_script.reset();
+    m_retiredScripts.clear();
+    if (m_profiler) {
+        m_profiler->forgetPrograms();
+    }
+}
+
+void ScriptComponent::setExecutionMode(lang::ExecutionMode mode) {
+    if (m_mode == mode) return;
+    m_mode = mode;
+    reset();
+}
+
+void ScriptComponent::setExecutionBudget(const lang::ExecutionBudget& budget) {
+    m_budget = budget;
+    if (m_vm) {
+        m_vm->setBudget(budget);
+    }
+}
+
+lang::HeapStats ScriptComponent::getHeapStats() const {
+    return m_vm ? m_vm->getHeapStats() : lang::HeapStats();
+}
+
+void ScriptComponent::setProfiling(bool enabled, core::f64 sampleIntervalMs) {
+    if (enabled && (!m_profiler || m_profiler->getSampleIntervalMs() != sampleIntervalMs)) {
+        // A new interval starts a new profile
+        m_profiler = std::make_unique<lang::Profiler>(sampleIntervalMs);
+    }
+    m_profiling = enabled;
+
+    if (m_vm) {
+        m_vm->setProfiler(m_profiling ? m_profiler.get() : nullptr);
+    } else if (m_profiling && m_interpreter) {
+        ORACON_LOG_WARNING("Script profiling is not supported by the tree-walking interpreter");
+    }
 }
 
 void ScriptComponent::compile() {
-    if (m_code.empty()) {
+    if (m_code.empty() && !m_precompiled) {
         return;
     }
 
-    // Tokenize
-    m_lexer = std::make_unique<lang::Lexer>(m_code);
-    auto tokens = m_lexer->tokenize();
-
-    // Parse
-    m_parser = std::make_unique<lang::Parser>(tokens);
-    m_program = m_parser->parse();
+    // Lex and parse, or reuse the result from another component with the same code
+    m_script = m_precompiled ? m_precompiled : ScriptCache::acquire(m_code);
 
     // Check for parse errors
-    if (m_parser->hasError()) {
-        for (const auto& error : m_parser->getErrors()) {
+    if (m_script->hasParseErrors()) {
+        for (const auto& error : m_script->getParseErrors()) {
             ORACON_LOG_ERROR("Script parse error: " + error);
         }
         return;
     }
 
+    // Lower to bytecode, falling back to the tree-walker for unsupported constructs.
+    // Bundled scripts have no AST to walk.
+    if (m_mode == lang::ExecutionMode::Bytecode || !m_script->getProgram()) {
+        if (m_script->getBytecode()) {
+            m_vm = std::make_unique<lang::VM>();
+            m_vm->setBudget(m_budget);
+            if (m_profiling) {
+                m_vm->setProfiler(m_profiler.get());
+            }
+            bindAPI();
+            m_initialized = true;
+            return;
+        }
+
+        for (const auto& error : m_script->getCompileErrors()) {
+            ORACON_LOG_WARNING("Script falls back to tree-walking: " + error);
+        }
+    }
+
+    if (m_budget.fuel > 0 || m_budget.timeLimitMs > 0.0 || m_budget.heapLimitBytes > 0) {
+        ORACON_LOG_WARNING("Script execution budget is not enforced by the tree-walking interpreter");
+    }
+    if (m_profiling) {
+        ORACON_LOG_WARNING("Script profiling is not supported by the tree-walking interpreter");
+    }
+
     // Create interpreter
     m_interpreter = std::make_unique<lang::Interpreter>();
+    bindAPI();
     m_initialized = true;
 }
 
-void ScriptComponent::setupAPI(Entity* entity, World* world) {
-    if (!m_interpreter) return;
+lang::Environment& ScriptComponent::globalEnv() {
+    return m_vm ? m_vm->getGlobalEnv() : m_interpreter->getGlobalEnv();
+}
+
+void ScriptComponent::bindAPI() {
+    ScriptingAPI::registerBuiltins(globalEnv(), &m_context);
+}
+
+void ScriptComponent::setContext(Entity* entity, World* world) {
+    m_context.entity = entity;
+    m_context.world = world;
+    m_context.commands = &m_commands;
+}
+
+void ScriptComponent::logRuntimeErrors(const char* context) {
+    const auto& errors = m_vm ? m_vm->getErrors() : m_interpreter->getErrors();
+    for (const auto& error : errors) {
+        ORACON_LOG_ERROR(String("Script ") + context + " error: " + error);
+    }
+}
+
+void ScriptComponent::callScriptFunction(lang::Symbol name, f32 arg, const char* context) {
+    // Function not defined by the script, silently skip
+    if (!globalEnv().lookup(name)) {
+        return;
+    }
+
+    m_arguments.assign(1, lang::Value(static_cast<lang::f64>(arg)));
 
-    ScriptingAPI::registerBuiltins(m_interpreter.get(), entity, world);
+    if (m_vm) {
+        m_vm->callFunction(name, m_arguments);
+    } else {
+        m_interpreter->callFunction(name.str(), m_arguments);
+    }
+
+    // Check for errors after calling
+    if (m_vm ? m_vm->hasError() : m_interpreter->hasError()) {
+        logRuntimeErrors(context);
+    }
 }
 
 void ScriptComponent::onStart(Entity* entity, World* world) {
@@ -73,81 +372,72 @@ void ScriptComponent::onStart(Entity* entity, World* world) {
         compile();
     }
 
-    if (!m_initialized || !m_program) {
+    if (!m_initialized || !m_script) {
         return;
     }
 
-    setupAPI(entity, world);
+    setContext(entity, world);
 
     // Execute the script
-    m_interpreter->execute(m_program.get());
+    if (m_vm) {
+        m_vm->execute(m_script->getBytecode());
+    } else {
+        m_interpreter->execute(m_script->getProgram());
+    }
 
     // Check for runtime errors
-    if (m_interpreter->hasError()) {
-        for (const auto& error : m_interpreter->getErrors()) {
-            ORACON_LOG_ERROR("Script runtime error: " + error);
-        }
+    if (m_vm ? m_vm->hasError() : m_interpreter->hasError()) {
+        logRuntimeErrors("runtime");
     }
+
+    applyCommands(world);
 }
 
 void ScriptComponent::onUpdate(Entity* entity, World* world, f32 deltaTime) {
-    if (!m_initialized || !m_interpreter) return;
-
-    setupAPI(entity, world);
-
-    // Call update function if it exists
-    if (!m_interpreter->getGlobalEnv().has("update")) {
-        return; // No update function defined, silently skip
-    }
+    runUpdate(entity, world, deltaTime);
+    applyCommands(world);
+}
 
-    // Call update function through interpreter
-    std::vector<lang::Value> args;
-    args.push_back(lang::Value(static_cast<lang::f64>(deltaTime)));
+void ScriptComponent::runUpdate(Entity* entity, World* world, f32 deltaTime) {
+    if (!m_initialized || (!m_interpreter && !m_vm)) return;
 
-    m_interpreter->callFunction("update", args);
+    static const lang::Symbol s_update = lang::Symbol::intern("update");
+    setContext(entity, world);
+    callScriptFunction(s_update, deltaTime, "update");
 
-    // Check for errors after calling
-    if (m_interpreter->hasError()) {
-        for (const auto& error : m_interpreter->getErrors()) {
-            ORACON_LOG_ERROR("Script update error: " + error);
+    // Resume coroutines that are due; while all of them wait this is one comparison
+    if (m_vm && m_vm->hasCoroutines()) {
+        m_vm->updateCoroutines(deltaTime);
+        if (m_vm->hasError()) {
+            logRuntimeErrors("coroutine");
         }
     }
 }
 
 void ScriptComponent::onFixedUpdate(Entity* entity, World* world, f32 fixedDeltaTime) {
-    if (!m_initialized || !m_interpreter) return;
-
-    setupAPI(entity, world);
-
-    // Call fixedUpdate function if it exists
-    if (!m_interpreter->getGlobalEnv().has("fixedUpdate")) {
-        return; // No fixedUpdate function defined, silently skip
-    }
-
-    // Call fixedUpdate function through interpreter
-    std::vector<lang::Value> args;
-    args.push_back(lang::Value(static_cast<lang::f64>(fixedDeltaTime)));
+    if (!m_initialized || (!m_interpreter && !m_vm)) return;
 
-    m_interpreter->callFunction("fixedUpdate", args);
+    static const lang::Symbol s_fixedUpdate = lang::Symbol::intern("fixedUpdate");
+    setContext(entity, world);
+    callScriptFunction(s_fixedUpdate, fixedDeltaTime, "fixedUpdate");
+    applyCommands(world);
+}
 
-    // Check for errors after calling
-    if (m_interpreter->hasError()) {
-        for (const auto& error : m_interpreter->getErrors()) {
-            ORACON_LOG_ERROR("Script fixedUpdate error: " + error);
-        }
-    }
+void ScriptComponent::applyCommands(World* world) {
+    m_commands.apply(world);
 }
 
 bool ScriptComponent::hasErrors() const {
-    if (m_parser && m_parser->hasError()) return true;
+    if (m_script && m_script->hasParseErrors()) return true;
     if (m_interpreter && m_interpreter->hasError()) return true;
+    if (m_vm && m_vm->hasError()) return true;
     return false;
 }
 
 String ScriptComponent::getErrors() const {
     String errors;
-    if (m_parser && m_parser->hasError()) {
-        for (const auto& err : m_parser->getErrors()) {
+    if (m_script && m_script->hasParseErrors()) {
+        for (const auto& err : m_script->getParseErrors()) {
             errors += "Parse: " + err + "\n";
         }
     }
@@ -156,86 +446,266 @@ String ScriptComponent::getErrors() const {
             errors += "Runtime: " + err + "\n";
         }
     }
+    if (m_vm && m_vm->hasError()) {
+        for (const auto& err : m_vm->getErrors()) {
+            errors += "Runtime: " + err + "\n";
+        }
+    }
     return errors;
 }
 
-// ===== Scripting API Implementation =====
+// ===== ScriptScheduler =====
+
+ScriptScheduler::ScriptScheduler(usize workerCount)
+    : m_world(nullptr)
+    , m_deltaTime(0.0f)
+    , m_nextJob(0)
+    , m_generation(0)
+    , m_busyWorkers(0)
+    , m_stopping(false) {
+    if (workerCount == AUTO_WORKERS) {
+        usize hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
 
-void ScriptingAPI::registerBuiltins(lang::Interpreter* interpreter, Entity* entity, World* world) {
-    s_currentEntity = entity;
-    s_currentWorld = world;
-
-    auto& env = interpreter->getGlobalEnv();
-
-    // getPosition() - returns entity position as array [x, y]
-    auto getPosFn = std::make_shared<lang::Function>("getPosition", 0,
-        [](const std::vector<lang::Value>& args) -> lang::Value {
-            (void)args;
-            if (!s_currentEntity) return lang::Value();
-
-            auto* transform = s_currentEntity->getComponent<Transform>();
-            if (!transform) return lang::Value();
-
-            std::vector<lang::Value> pos;
-            pos.push_back(lang::Value(static_cast<lang::f64>(transform->position.x)));
-            pos.push_back(lang::Value(static_cast<lang::f64>(transform->position.y)));
-            return lang::Value::createArray(pos);
-        });
-    env.define("getPosition", lang::Value(getPosFn));
-
-    // setPosition(x, y) - sets entity position
-    auto setPosFn = std::make_shared<lang::Function>("setPosition", 2,
-        [](const std::vector<lang::Value>& args) -> lang::Value {
-            if (args.size() != 2 || !s_currentEntity) return lang::Value();
-
-            auto* transform = s_currentEntity->getComponent<Transform>();
-            if (!transform) return lang::Value();
-
-            transform->position.x = static_cast<f32>(args[0].asFloat());
-            transform->position.y = static_cast<f32>(args[1].asFloat());
-            return lang::Value();
-        });
-    env.define("setPosition", lang::Value(setPosFn));
-
-    // getVelocity() - returns velocity as array [vx, vy]
-    auto getVelFn = std::make_shared<lang::Function>("getVelocity", 0,
-        [](const std::vector<lang::Value>& args) -> lang::Value {
-            (void)args;
-            if (!s_currentEntity) return lang::Value();
-
-            auto* rb = s_currentEntity->getComponent<Rigidbody>();
-            if (!rb) return lang::Value();
-
-            std::vector<lang::Value> vel;
-            vel.push_back(lang::Value(static_cast<lang::f64>(rb->velocity.x)));
-            vel.push_back(lang::Value(static_cast<lang::f64>(rb->velocity.y)));
-            return lang::Value::createArray(vel);
-        });
-    env.define("getVelocity", lang::Value(getVelFn));
-
-    // setVelocity(vx, vy) - sets velocity
-    auto setVelFn = std::make_shared<lang::Function>("setVelocity", 2,
-        [](const std::vector<lang::Value>& args) -> lang::Value {
-            if (args.size() != 2 || !s_currentEntity) return lang::Value();
-
-            auto* rb = s_currentEntity->getComponent<Rigidbody>();
-            if (!rb) return lang::Value();
-
-            rb->velocity.x = static_cast<f32>(args[0].asFloat());
-            rb->velocity.y = static_cast<f32>(args[1].asFloat());
-            return lang::Value();
-        });
-    env.define("setVelocity", lang::Value(setVelFn));
-
-    // log(message) - logs to console
-    auto logFn = std::make_shared<lang::Function>("log", 1,
-        [](const std::vector<lang::Value>& args) -> lang::Value {
-            if (!args.empty()) {
-                ORACON_LOG_INFO("Script: " + args[0].toString());
+    m_workers.reserve(workerCount);
+    for (usize i = 0; i < workerCount; ++i) {
+        m_workers.emplace_back(&ScriptScheduler::workerLoop, this);
+    }
+}
+
+ScriptScheduler::~ScriptScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ScriptScheduler::update(World* world, f32 deltaTime) {
+    m_jobs.clear();
+    m_parallelJobs.clear();
+    for (const auto& entity : world->getEntities()) {
+        if (!entity->isActive()) continue;
+        if (auto* script = entity->getComponent<ScriptComponent>()) {
+            bool serial = script->runsOnInterpreter();
+            if (!serial) {
+                m_parallelJobs.push_back(m_jobs.size());
             }
-            return lang::Value();
-        });
-    env.define("log", lang::Value(logFn));
+            m_jobs.push_back({entity.get(), script, serial});
+        }
+    }
+
+    if (m_jobs.empty()) return;
+
+    m_world = world;
+    m_deltaTime = deltaTime;
+    m_nextJob.store(0);
+
+    if (m_workers.empty() || m_parallelJobs.size() <= 1) {
+        runJobs();
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers = m_workers.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        // The calling thread takes jobs too, then waits for the stragglers
+        runJobs();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [this]() { return m_busyWorkers == 0; });
+    }
+
+    for (const auto& job : m_jobs) {
+        if (job.serial) {
+            job.script->runUpdate(job.entity, world, deltaTime);
+        }
+    }
+
+    // Sync point: gather in entity order so the result is deterministic
+    for (const auto& job : m_jobs) {
+        m_commands.append(job.script->getCommands());
+    }
+    m_jobs.clear();
+    m_parallelJobs.clear();
+    m_commands.apply(world);
+}
+
+void ScriptScheduler::workerLoop() {
+    core::u64 seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this, seen]() { return m_stopping || m_generation != seen; });
+        if (m_stopping) return;
+        seen = m_generation;
+
+        lock.unlock();
+        runJobs();
+        lock.lock();
+
+        if (--m_busyWorkers == 0) {
+            m_finished.notify_one();
+        }
+    }
+}
+
+void ScriptScheduler::runJobs() {
+    for (;;) {
+        usize index = m_nextJob.fetch_add(1);
+        if (index >= m_parallelJobs.size()) return;
+        const Job& job = m_jobs[m_parallelJobs[index]];
+        job.script->runUpdate(job.entity, m_world, m_deltaTime);
+    }
+}
+
+// ===== Scripting API Implementation =====
+
+namespace {
+
+Entity* contextEntity(void* userData) {
+    return static_cast<ScriptContext*>(userData)->entity;
+}
+
+// A position or velocity component passed by a script
+f32 coordinate(const lang::Value& value) {
+    if (!value.isNumber()) {
+        throw std::runtime_error("Coordinates must be numbers");
+    }
+    return static_cast<f32>(value.asFloat());
+}
+
+// [x, y] as a script array. When the script passes an array as an
+// out-parameter its storage is reused, so polling allocates nothing.
+lang::Value makeVec2(lang::NativeArgs args, f32 x, f32 y) {
+    lang::Value result = (!args.empty() && args[0].isArray()) ? args[0] : lang::Value::createArray();
+    while (result.arraySize() < 2) {
+        result.arrayPush(lang::Value());
+    }
+    result.arraySet(0, lang::Value(static_cast<lang::f64>(x)));
+    result.arraySet(1, lang::Value(static_cast<lang::f64>(y)));
+    return result;
+}
+
+// getPosition([out]) - returns entity position as array [x, y]
+lang::Value apiGetPosition(void* userData, lang::NativeArgs args) {
+    Entity* entity = contextEntity(userData);
+    if (!entity) return lang::Value();
+
+    auto* transform = entity->getComponent<Transform>();
+    if (!transform) return lang::Value();
+
+    return makeVec2(args, transform->position.x, transform->position.y);
+}
+
+// setPosition(x, y) - sets entity position
+lang::Value apiSetPosition(void* userData, lang::NativeArgs args) {
+    Entity* entity = contextEntity(userData);
+    if (!entity || args.size() != 2) return lang::Value();
+
+    auto* transform = entity->getComponent<Transform>();
+    if (!transform) return lang::Value();
+
+    f32 x = coordinate(args[0]);
+    f32 y = coordinate(args[1]);
+    transform->position.x = x;
+    transform->position.y = y;
+    return lang::Value();
+}
+
+// getVelocity([out]) - returns velocity as array [vx, vy]
+lang::Value apiGetVelocity(void* userData, lang::NativeArgs args) {
+    Entity* entity = contextEntity(userData);
+    if (!entity) return lang::Value();
+
+    auto* rb = entity->getComponent<Rigidbody>();
+    if (!rb) return lang::Value();
+
+    return makeVec2(args, rb->velocity.x, rb->velocity.y);
+}
+
+// setVelocity(vx, vy) - sets velocity
+lang::Value apiSetVelocity(void* userData, lang::NativeArgs args) {
+    Entity* entity = contextEntity(userData);
+    if (!entity || args.size() != 2) return lang::Value();
+
+    auto* rb = entity->getComponent<Rigidbody>();
+    if (!rb) return lang::Value();
+
+    f32 x = coordinate(args[0]);
+    f32 y = coordinate(args[1]);
+    rb->velocity.x = x;
+    rb->velocity.y = y;
+    return lang::Value();
+}
+
+// Name of the entity a cross-entity native targets
+String targetName(const lang::Value& value) {
+    if (!value.isString()) {
+        throw std::runtime_error("Entity name must be a string");
+    }
+    return value.asString();
+}
+
+ScriptCommandBuffer* contextCommands(void* userData) {
+    return static_cast<ScriptContext*>(userData)->commands;
+}
+
+// setEntityPosition(name, x, y) - moves another entity once all scripts have run
+lang::Value apiSetEntityPosition(void* userData, lang::NativeArgs args) {
+    ScriptCommandBuffer* commands = contextCommands(userData);
+    if (!commands || args.size() != 3) return lang::Value();
+
+    commands->setPosition(targetName(args[0]), coordinate(args[1]), coordinate(args[2]));
+    return lang::Value();
+}
+
+// setEntityVelocity(name, vx, vy) - sets another entity's velocity once all scripts have run
+lang::Value apiSetEntityVelocity(void* userData, lang::NativeArgs args) {
+    ScriptCommandBuffer* commands = contextCommands(userData);
+    if (!commands || args.size() != 3) return lang::Value();
+
+    commands->setVelocity(targetName(args[0]), coordinate(args[1]), coordinate(args[2]));
+    return lang::Value();
+}
+
+// destroyEntity(name) - destroys an entity once all scripts have run
+lang::Value apiDestroyEntity(void* userData, lang::NativeArgs args) {
+    ScriptCommandBuffer* commands = contextCommands(userData);
+    if (!commands || args.size() != 1) return lang::Value();
+
+    commands->destroy(targetName(args[0]));
+    return lang::Value();
+}
+
+// log(message) - logs to console
+lang::Value apiLog(void* userData, lang::NativeArgs args) {
+    (void)userData;
+    if (args.empty()) return lang::Value();
+    ORACON_LOG_INFO("Script: " + args[0].toString());
+    return lang::Value();
+}
+
+} // namespace
+
+void ScriptingAPI::registerBuiltins(lang::Environment& env, ScriptContext* context) {
+    auto define = [&env, context](const char* name, lang::usize minArity, lang::usize maxArity, lang::NativeFn fn) {
+        env.define(name, lang::Value(core::makeRef<lang::Function>(name, minArity, maxArity, fn, context)));
+    };
+
+    define("getPosition", 0, 1, apiGetPosition);
+    define("setPosition", 2, 2, apiSetPosition);
+    define("getVelocity", 0, 1, apiGetVelocity);
+    define("setVelocity", 2, 2, apiSetVelocity);
+    define("setEntityPosition", 3, 3, apiSetEntityPosition);
+    define("setEntityVelocity", 3, 3, apiSetEntityVelocity);
+    define("destroyEntity", 1, 1, apiDestroyEntity);
+    define("log", 1, 1, apiLog);
 }
 
 } // namespace engine
@@ -0,0 +1,167 @@
+#include "test_util.h"
+#include <vector>
+
+using namespace oracon;
+using namespace oracon::engine;
+using namespace oracon::engine::test;
+
+namespace {
+
+// Each mover steps its own entity and drags the shared target behind it;
+// every mover writes the target, so the last one in entity order wins
+const char* MOVER = R"(
+    let pos = [0, 0];
+    func update(dt) {
+        getPosition(pos);
+        setPosition(pos[0] + dt, pos[1] + 1);
+        setEntityPosition("target", pos[0], pos[1]);
+        setEntityVelocity("target", pos[1], pos[0]);
+    }
+)";
+
+const usize MOVERS = 12;
+const int FRAMES = 5;
+
+// Positions of every entity after FRAMES updates with the given scheduler.
+// Every other mover runs on the tree-walking interpreter if treeWalk is set.
+std::vector<f32> simulate(usize workerCount, bool treeWalk) {
+    World world;
+    addEntity(world, "target");
+    for (usize i = 0; i < MOVERS; ++i) {
+        Entity* mover = addEntity(world, "mover" + std::to_string(i), static_cast<f32>(i), 0.0f, MOVER);
+        if (treeWalk && i % 2 == 0) {
+            mover->getComponent<ScriptComponent>()->setExecutionMode(lang::ExecutionMode::TreeWalk);
+        }
+    }
+    startScripts(world);
+
+    ScriptScheduler scheduler(workerCount);
+    CHECK(scheduler.getWorkerCount() == workerCount);
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        scheduler.update(&world, 0.5f);
+    }
+    CHECK(!hasScriptErrors(world));
+
+    std::vector<f32> state;
+    for (const auto& entity : world.getEntities()) {
+        const Transform* transform = entity->getComponent<Transform>();
+        const Rigidbody* rb = entity->getComponent<Rigidbody>();
+        state.push_back(transform->position.x);
+        state.push_back(transform->position.y);
+        state.push_back(rb->velocity.x);
+        state.push_back(rb->velocity.y);
+    }
+    return state;
+}
+
+void testResultIndependentOfWorkers() {
+    std::vector<f32> serial = simulate(0, false);
+    CHECK(serial.size() == (MOVERS + 1) * 4);
+    CHECK(simulate(1, false) == serial);
+    CHECK(simulate(3, false) == serial);
+    CHECK(simulate(8, false) == serial);
+
+    // The target follows the last mover: it starts at x = MOVERS - 1 and
+    // moves 0.5 per frame, one frame behind
+    f32 lastX = static_cast<f32>(MOVERS - 1) + 0.5f * (FRAMES - 1);
+    CHECK(serial[0] == lastX);
+    CHECK(serial[1] == static_cast<f32>(FRAMES - 1));
+    CHECK(serial[2] == static_cast<f32>(FRAMES - 1));
+    CHECK(serial[3] == lastX);
+}
+
+void testTreeWalkRunsSerially() {
+    World world;
+    Entity* vm = addEntity(world, "vm", 0.0f, 0.0f, MOVER);
+    Entity* walker = addEntity(world, "walker", 0.0f, 0.0f, MOVER);
+    walker->getComponent<ScriptComponent>()->setExecutionMode(lang::ExecutionMode::TreeWalk);
+    startScripts(world);
+    CHECK(!vm->getComponent<ScriptComponent>()->runsOnInterpreter());
+    CHECK(walker->getComponent<ScriptComponent>()->runsOnInterpreter());
+
+    // Mixing tiers changes nothing about the outcome, however many workers
+    std::vector<f32> serial = simulate(0, false);
+    CHECK(simulate(0, true) == serial);
+    CHECK(simulate(3, true) == serial);
+}
+
+void testCommandsApplyInRecordedOrder() {
+    World world;
+    Entity* a = addEntity(world, "a");
+    Entity* b = addEntity(world, "b");
+
+    ScriptCommandBuffer first;
+    first.setPosition("a", 1.0f, 1.0f);
+    first.setPosition("b", 5.0f, 5.0f);
+    ScriptCommandBuffer second;
+    second.setPosition("a", 2.0f, 3.0f);
+    second.setPosition("missing", 9.0f, 9.0f);
+
+    first.append(second);
+    CHECK(second.empty());
+    CHECK(first.size() == 4);
+    first.apply(&world);
+    CHECK(first.empty());
+    CHECK(isAt(a, 2.0f, 3.0f));
+    CHECK(isAt(b, 5.0f, 5.0f));
+
+    // Scripts later in entity order overwrite earlier ones' writes
+    World scripted;
+    Entity* target = addEntity(scripted, "target");
+    addEntity(scripted, "first", 0.0f, 0.0f, R"(func update(dt) { setEntityPosition("target", 1, 1); })");
+    addEntity(scripted, "second", 0.0f, 0.0f, R"(func update(dt) { setEntityPosition("target", 2, 2); })");
+    startScripts(scripted);
+    ScriptScheduler scheduler(2);
+    scheduler.update(&scripted, 0.1f);
+    CHECK(!hasScriptErrors(scripted));
+    CHECK(isAt(target, 2.0f, 2.0f));
+}
+
+void testDestroyAppliesLast() {
+    // Both entities are named "twin", so a name resolves to the first one
+    // until it is gone. Destroying it at once would move the second.
+    World world;
+    addEntity(world, "twin");
+    Entity* survivor = addEntity(world, "twin");
+    ScriptCommandBuffer commands;
+    commands.destroy("twin");
+    commands.setPosition("twin", 5.0f, 6.0f);
+    commands.destroy("twin");
+    commands.apply(&world);
+    CHECK(world.getEntities().size() == 1);
+    CHECK(world.findEntityByName("twin") == survivor);
+    CHECK(isAt(survivor, 0.0f, 0.0f));
+
+    // A script destroying its own entity, and with it the component that
+    // recorded the commands, still has its later writes applied
+    World scripted;
+    Entity* target = addEntity(scripted, "target");
+    addEntity(scripted, "doomed", 0.0f, 0.0f, R"(
+        func update(dt) {
+            destroyEntity("doomed");
+            destroyEntity("victim");
+            setEntityPosition("target", 4, 4);
+        }
+    )");
+    addEntity(scripted, "victim", 0.0f, 0.0f, R"(func update(dt) { setEntityVelocity("target", 7, 7); })");
+    startScripts(scripted);
+    ScriptScheduler scheduler(2);
+    scheduler.update(&scripted, 0.1f);
+    CHECK(scripted.getEntities().size() == 1);
+    CHECK(isAt(target, 4.0f, 4.0f));
+    CHECK(target->getComponent<Rigidbody>()->velocity.x == 7.0f);
+
+    // Nothing is left referring to the destroyed entities
+    scheduler.update(&scripted, 0.1f);
+    CHECK(isAt(target, 4.0f, 4.0f));
+}
+
+} // namespace
+
+int main() {
+    testResultIndependentOfWorkers();
+    testTreeWalkRunsSerially();
+    testCommandsApplyInRecordedOrder();
+    testDestroyAppliesLast();
+    return finish("scheduler");
+}
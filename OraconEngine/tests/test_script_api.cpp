@@ -0,0 +1,225 @@
+#include "test_util.h"
+#include <vector>
+
+using namespace oracon;
+using namespace oracon::engine;
+using namespace oracon::engine::test;
+
+namespace {
+
+// Calls the native registered as name the way the VM does: through a view
+// of the caller's arguments
+lang::Value callNative(const lang::Environment& env, const char* name, const std::vector<lang::Value>& args) {
+    lang::Value function = env.get(name);
+    if (!function.isFunction()) {
+        std::cout << "  no native " << name << "\n";
+        ++failures;
+        return lang::Value();
+    }
+    return function.asFunction()->callNative(lang::NativeArgs(args.data(), args.size()));
+}
+
+lang::Value number(f32 value) {
+    return lang::Value(static_cast<lang::f64>(value));
+}
+
+bool accepts(const lang::Environment& env, const char* name, lang::usize count) {
+    return env.get(name).asFunction()->acceptsArgCount(count);
+}
+
+// True if the native rejects its arguments with an error the VM reports
+bool throwsError(const lang::Environment& env, const char* name, const std::vector<lang::Value>& args) {
+    try {
+        callNative(env, name, args);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+bool arrayIs(const lang::Value& value, f32 x, f32 y) {
+    return value.isArray() && value.arraySize() == 2 &&
+           value.arrayGet(0).asFloat() == x && value.arrayGet(1).asFloat() == y;
+}
+
+void testNativesFollowContext() {
+    World world;
+    Entity* a = addEntity(world, "a", 1.0f, 2.0f);
+    Entity* b = addEntity(world, "b", 3.0f, 4.0f);
+
+    // Bound once; every call reads whichever entity the context holds then
+    lang::Environment env;
+    ScriptContext context;
+    ScriptingAPI::registerBuiltins(env, &context);
+
+    context.entity = a;
+    callNative(env, "setPosition", {number(5.0f), number(6.0f)});
+    context.entity = b;
+    callNative(env, "setPosition", {number(7.0f), number(8.0f)});
+    CHECK(isAt(a, 5.0f, 6.0f));
+    CHECK(isAt(b, 7.0f, 8.0f));
+
+    // Without an entity the natives do nothing
+    context.entity = nullptr;
+    CHECK(callNative(env, "getPosition", {}).isNil());
+    callNative(env, "setPosition", {number(0.0f), number(0.0f)});
+    CHECK(isAt(a, 5.0f, 6.0f));
+    CHECK(isAt(b, 7.0f, 8.0f));
+}
+
+void testComponentsHaveTheirOwnContext() {
+    // Same source, so one shared CompiledScript, but each component's
+    // natives act on its own entity
+    const char* code = R"(
+        let pos = [0, 0];
+        func update(dt) {
+            getPosition(pos);
+            setPosition(pos[0] * 2, pos[1] + dt);
+        }
+    )";
+    World world;
+    Entity* a = addEntity(world, "a", 1.0f, 0.0f, code);
+    Entity* b = addEntity(world, "b", 10.0f, 0.0f, code);
+    startScripts(world);
+    for (int frame = 0; frame < 3; ++frame) {
+        for (Entity* entity : {a, b}) {
+            entity->getComponent<ScriptComponent>()->onUpdate(entity, &world, 0.5f);
+        }
+    }
+    CHECK(!hasScriptErrors(world));
+    CHECK(isAt(a, 8.0f, 1.5f));
+    CHECK(isAt(b, 80.0f, 1.5f));
+}
+
+void testGetPosition() {
+    World world;
+    Entity* entity = addEntity(world, "e", 1.5f, -2.0f);
+    lang::Environment env;
+    ScriptContext context;
+    context.entity = entity;
+    ScriptingAPI::registerBuiltins(env, &context);
+
+    CHECK(accepts(env, "getPosition", 0));
+    CHECK(accepts(env, "getPosition", 1));
+    CHECK(!accepts(env, "getPosition", 2));
+
+    CHECK(arrayIs(callNative(env, "getPosition", {}), 1.5f, -2.0f));
+
+    // An array argument is filled in and returned, not reallocated
+    lang::Value out = lang::Value::createArray();
+    lang::Value result = callNative(env, "getPosition", {out});
+    CHECK(arrayIs(out, 1.5f, -2.0f));
+    CHECK(result.get<lang::ArrayType>() == out.get<lang::ArrayType>());
+
+    // Anything else is ignored and a new array returned
+    CHECK(arrayIs(callNative(env, "getPosition", {number(3.0f)}), 1.5f, -2.0f));
+}
+
+void testSetPosition() {
+    World world;
+    Entity* entity = addEntity(world, "e", 1.0f, 1.0f);
+    lang::Environment env;
+    ScriptContext context;
+    context.entity = entity;
+    ScriptingAPI::registerBuiltins(env, &context);
+
+    CHECK(accepts(env, "setPosition", 2));
+    CHECK(!accepts(env, "setPosition", 1));
+    CHECK(!accepts(env, "setPosition", 3));
+
+    CHECK(callNative(env, "setPosition", {number(4.0f), lang::Value(static_cast<lang::i64>(5))}).isNil());
+    CHECK(isAt(entity, 4.0f, 5.0f));
+
+    // Wrong counts change nothing; non-numbers are errors and change nothing
+    callNative(env, "setPosition", {number(9.0f)});
+    callNative(env, "setPosition", {number(9.0f), number(9.0f), number(9.0f)});
+    CHECK(throwsError(env, "setPosition", {number(9.0f), lang::Value(String("9"))}));
+    CHECK(throwsError(env, "setPosition", {lang::Value(), number(9.0f)}));
+    CHECK(isAt(entity, 4.0f, 5.0f));
+}
+
+void testSetEntityVelocity() {
+    World world;
+    Entity* target = addEntity(world, "target");
+    lang::Environment env;
+    ScriptContext context;
+    ScriptCommandBuffer commands;
+    context.commands = &commands;
+    ScriptingAPI::registerBuiltins(env, &context);
+
+    CHECK(accepts(env, "setEntityVelocity", 3));
+    CHECK(!accepts(env, "setEntityVelocity", 2));
+    CHECK(!accepts(env, "setEntityVelocity", 4));
+
+    // Recorded, then applied at the sync point
+    lang::Value name(String("target"));
+    callNative(env, "setEntityVelocity", {name, number(2.0f), number(-3.0f)});
+    CHECK(commands.size() == 1);
+    CHECK(target->getComponent<Rigidbody>()->velocity.x == 0.0f);
+    commands.apply(&world);
+    CHECK(target->getComponent<Rigidbody>()->velocity.x == 2.0f);
+    CHECK(target->getComponent<Rigidbody>()->velocity.y == -3.0f);
+
+    callNative(env, "setEntityVelocity", {name, number(1.0f)});
+    CHECK(throwsError(env, "setEntityVelocity", {number(1.0f), number(1.0f), number(1.0f)}));
+    CHECK(throwsError(env, "setEntityVelocity", {name, lang::Value(true), number(1.0f)}));
+    CHECK(commands.empty());
+
+    // Without a command buffer there is nowhere to record to
+    context.commands = nullptr;
+    callNative(env, "setEntityVelocity", {name, number(5.0f), number(5.0f)});
+    CHECK(commands.empty());
+}
+
+void testDestroyEntity() {
+    World world;
+    addEntity(world, "target");
+    lang::Environment env;
+    ScriptContext context;
+    ScriptCommandBuffer commands;
+    context.commands = &commands;
+    ScriptingAPI::registerBuiltins(env, &context);
+
+    CHECK(accepts(env, "destroyEntity", 1));
+    CHECK(!accepts(env, "destroyEntity", 0));
+    CHECK(!accepts(env, "destroyEntity", 2));
+
+    callNative(env, "destroyEntity", {});
+    CHECK(throwsError(env, "destroyEntity", {number(1.0f)}));
+    CHECK(commands.empty());
+
+    callNative(env, "destroyEntity", {lang::Value(String("target"))});
+    CHECK(commands.size() == 1);
+    CHECK(world.getEntities().size() == 1);
+    commands.apply(&world);
+    CHECK(world.getEntities().empty());
+}
+
+void testScriptsSeeArgumentErrors() {
+    World world;
+    Entity* counted = addEntity(world, "counted", 0.0f, 0.0f, "func update(dt) { setPosition(1); }");
+    Entity* typed = addEntity(world, "typed", 0.0f, 0.0f, "func update(dt) { destroyEntity(42); }");
+    Entity* valid = addEntity(world, "valid", 0.0f, 0.0f, "func update(dt) { setPosition(dt, 2); }");
+    startScripts(world);
+    for (Entity* entity : {counted, typed, valid}) {
+        entity->getComponent<ScriptComponent>()->onUpdate(entity, &world, 0.5f);
+    }
+    CHECK(counted->getComponent<ScriptComponent>()->hasErrors());
+    CHECK(typed->getComponent<ScriptComponent>()->getErrors().find("Entity name must be a string") != String::npos);
+    CHECK(!valid->getComponent<ScriptComponent>()->hasErrors());
+    CHECK(isAt(valid, 0.5f, 2.0f));
+    CHECK(world.getEntities().size() == 3);
+}
+
+} // namespace
+
+int main() {
+    testNativesFollowContext();
+    testComponentsHaveTheirOwnContext();
+    testGetPosition();
+    testSetPosition();
+    testSetEntityVelocity();
+    testDestroyEntity();
+    testScriptsSeeArgumentErrors();
+    return finish("script_api");
+}
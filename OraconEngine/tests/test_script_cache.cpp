@@ -0,0 +1,68 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::engine;
+using namespace oracon::engine::test;
+
+namespace {
+
+const char* SCRIPT_A = "let a = 1; func update(dt) { a = a + 1; }";
+const char* SCRIPT_B = "let b = 2; func update(dt) { b = b + 1; }";
+const char* SCRIPT_C = "let c = 3;";
+
+void testSameSourceIsShared() {
+    CHECK(ScriptCache::size() == 0);
+
+    World world;
+    addEntity(world, "one", 0.0f, 0.0f, SCRIPT_A);
+    addEntity(world, "two", 0.0f, 0.0f, SCRIPT_A);
+    addEntity(world, "three", 0.0f, 0.0f, SCRIPT_B);
+    startScripts(world);
+    CHECK(!hasScriptErrors(world));
+    CHECK(ScriptCache::size() == 2);
+
+    // Both components with SCRIPT_A hold the one CompiledScript, parsed and
+    // compiled once
+    auto shared = ScriptCache::acquire(SCRIPT_A);
+    CHECK(shared.use_count() == 3);
+    CHECK(shared->getSource() == SCRIPT_A);
+    CHECK(shared->getBytecode() != nullptr);
+    CHECK(ScriptCache::acquire(SCRIPT_A) == shared);
+    CHECK(ScriptCache::acquire(SCRIPT_B) != shared);
+    CHECK(ScriptCache::acquire(SCRIPT_B).use_count() == 2);
+    CHECK(ScriptCache::size() == 2);
+
+    // Each still has its own state
+    Entity* one = world.findEntityByName("one");
+    one->getComponent<ScriptComponent>()->onUpdate(one, &world, 0.1f);
+    CHECK(!hasScriptErrors(world));
+}
+
+void testDroppedScriptIsEvicted() {
+    World world;
+    Entity* entity = addEntity(world, "one", 0.0f, 0.0f, SCRIPT_A);
+    addEntity(world, "two", 0.0f, 0.0f, SCRIPT_B);
+    startScripts(world);
+    CHECK(ScriptCache::size() == 2);
+
+    // setCode releases the old script; its entry goes once another source
+    // is cached
+    std::weak_ptr<const CompiledScript> old = ScriptCache::acquire(SCRIPT_A);
+    entity->getComponent<ScriptComponent>()->setCode(SCRIPT_C);
+    CHECK(old.expired());
+    entity->getComponent<ScriptComponent>()->onStart(entity, &world);
+    CHECK(ScriptCache::size() == 2);
+
+    // Destroying entities releases their scripts too
+    world.clear();
+    CHECK(ScriptCache::acquire(SCRIPT_A).use_count() == 1);
+    CHECK(ScriptCache::size() == 1);
+}
+
+} // namespace
+
+int main() {
+    testSameSourceIsShared();
+    testDroppedScriptIsEvicted();
+    return finish("script_cache");
+}
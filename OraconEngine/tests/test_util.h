@@ -0,0 +1,75 @@
+#ifndef ORACON_ENGINE_TESTS_TEST_UTIL_H
+#define ORACON_ENGINE_TESTS_TEST_UTIL_H
+
+#include "oracon/engine/entity.h"
+#include "oracon/engine/script.h"
+#include "oracon/engine/world.h"
+#include <cmath>
+#include <iostream>
+
+namespace oracon {
+namespace engine {
+namespace test {
+
+inline int failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++::oracon::engine::test::failures;                                             \
+        }                                                                                   \
+    } while (false)
+
+// An entity with a transform, a rigidbody and, if code is given, a script
+inline Entity* addEntity(World& world, const String& name, f32 x = 0.0f, f32 y = 0.0f,
+                         const String& code = String()) {
+    Entity* entity = world.createEntity(name);
+    entity->addComponent<Transform>(x, y);
+    entity->addComponent<Rigidbody>();
+    if (!code.empty()) {
+        entity->addComponent<ScriptComponent>(code);
+    }
+    return entity;
+}
+
+// Runs the top level of every script in the world, in entity order
+inline void startScripts(World& world) {
+    for (const auto& entity : world.getEntities()) {
+        if (auto* script = entity->getComponent<ScriptComponent>()) {
+            script->onStart(entity.get(), &world);
+        }
+    }
+}
+
+inline bool isAt(Entity* entity, f32 x, f32 y) {
+    const Transform* transform = entity ? entity->getComponent<Transform>() : nullptr;
+    return transform && std::fabs(transform->position.x - x) < 1e-4f &&
+           std::fabs(transform->position.y - y) < 1e-4f;
+}
+
+inline bool hasScriptErrors(World& world) {
+    for (const auto& entity : world.getEntities()) {
+        auto* script = entity->getComponent<ScriptComponent>();
+        if (script && script->hasErrors()) {
+            std::cout << "  " << entity->getName() << ": " << script->getErrors();
+            return true;
+        }
+    }
+    return false;
+}
+
+inline int finish(const char* name) {
+    if (failures > 0) {
+        std::cout << name << ": " << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << name << ": ok\n";
+    return 0;
+}
+
+} // namespace test
+} // namespace engine
+} // namespace oracon
+
+#endif // ORACON_ENGINE_TESTS_TEST_UTIL_H
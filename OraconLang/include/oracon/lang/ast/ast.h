@@ -2,7 +2,9 @@
 #define ORACON_LANG_AST_AST_H
 
 #include "oracon/core/types.h"
+#include "oracon/core/memory.h"
 #include "oracon/lang/lexer/token.h"
+#include "oracon/lang/interpreter/value.h"
 #include <vector>
 #include <memory>
 
@@ -10,10 +12,21 @@ namespace oracon {
 namespace lang {
 
 using core::String;
-using core::UniquePtr;
+using core::usize;
 
 // Forward declarations
 class Visitor;
+class Optimizer; // rewrites child links in place
+
+// Nodes are placed in their Program's arena. Releasing a NodePtr runs the
+// node's destructor; the memory itself goes away with the arena.
+struct NodeDeleter {
+    template<typename T>
+    void operator()(T* node) const { node->~T(); }
+};
+
+template<typename T>
+using NodePtr = std::unique_ptr<T, NodeDeleter>;
 
 // Base AST node
 class ASTNode {
@@ -22,36 +35,86 @@ public:
     virtual String toString() const = 0;
 };
 
+// Concrete type of an expression node; the backends switch on it rather
+// than trying one dynamic_cast after another
+enum class ExprKind : core::u8 {
+    Literal,
+    Variable,
+    Unary,
+    Binary,
+    Grouping,
+    Assignment,
+    Logical,
+    Call,
+    Array,
+    Index,
+    Member,
+    Map
+};
+
+// Concrete type of a statement node
+enum class StmtKind : core::u8 {
+    Expr,
+    VarDecl,
+    Block,
+    If,
+    While,
+    For,
+    Return,
+    Break,
+    Continue,
+    Function,
+    Class
+};
+
 // Expression base class
 class Expr : public ASTNode {
 public:
     virtual ~Expr() = default;
+    ExprKind getKind() const { return m_kind; }
+
+protected:
+    explicit Expr(ExprKind kind) : m_kind(kind) {}
+
+private:
+    ExprKind m_kind;
 };
 
 // Statement base class
 class Stmt : public ASTNode {
 public:
     virtual ~Stmt() = default;
+    StmtKind getKind() const { return m_kind; }
+
+protected:
+    explicit Stmt(StmtKind kind) : m_kind(kind) {}
+
+private:
+    StmtKind m_kind;
 };
 
 // ===== EXPRESSION NODES =====
 
-// Literal expression (numbers, strings, booleans, nil)
+// Literal expression (numbers, strings, booleans, nil). The value is
+// parsed from the token once, when the node is built.
 class LiteralExpr : public Expr {
 public:
-    explicit LiteralExpr(const Token& token) : m_token(token) {}
-    String toString() const override { return m_token.getLexeme(); }
+    LiteralExpr(const Token& token, const Value& value)
+        : Expr(ExprKind::Literal), m_token(token), m_value(value) {}
+    String toString() const override;
     const Token& getToken() const { return m_token; }
+    const Value& getValue() const { return m_value; }
 
 private:
     Token m_token;
+    Value m_value;
 };
 
 // Variable reference
 class VariableExpr : public Expr {
 public:
-    explicit VariableExpr(const Token& name) : m_name(name) {}
-    String toString() const override { return m_name.getLexeme(); }
+    explicit VariableExpr(const Token& name) : Expr(ExprKind::Variable), m_name(name) {}
+    String toString() const override { return String(m_name.getLexeme()); }
     const Token& getName() const { return m_name; }
 
 private:
@@ -61,8 +124,8 @@ private:
 // Unary expression (!, -, +)
 class UnaryExpr : public Expr {
 public:
-    UnaryExpr(const Token& op, UniquePtr<Expr> operand)
-        : m_operator(op), m_operand(std::move(operand)) {}
+    UnaryExpr(const Token& op, NodePtr<Expr> operand)
+        : Expr(ExprKind::Unary), m_operator(op), m_operand(std::move(operand)) {}
 
     String toString() const override;
 
@@ -70,15 +133,17 @@ public:
     const Expr* getOperand() const { return m_operand.get(); }
 
 private:
+    friend class Optimizer;
+
     Token m_operator;
-    UniquePtr<Expr> m_operand;
+    NodePtr<Expr> m_operand;
 };
 
 // Binary expression (+, -, *, /, %, ==, !=, <, >, <=, >=, and, or, etc.)
 class BinaryExpr : public Expr {
 public:
-    BinaryExpr(UniquePtr<Expr> left, const Token& op, UniquePtr<Expr> right)
-        : m_left(std::move(left)), m_operator(op), m_right(std::move(right)) {}
+    BinaryExpr(NodePtr<Expr> left, const Token& op, NodePtr<Expr> right)
+        : Expr(ExprKind::Binary), m_left(std::move(left)), m_operator(op), m_right(std::move(right)) {}
 
     String toString() const override;
 
@@ -87,27 +152,31 @@ public:
     const Expr* getRight() const { return m_right.get(); }
 
 private:
-    UniquePtr<Expr> m_left;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_left;
     Token m_operator;
-    UniquePtr<Expr> m_right;
+    NodePtr<Expr> m_right;
 };
 
 // Grouping expression (parentheses)
 class GroupingExpr : public Expr {
 public:
-    explicit GroupingExpr(UniquePtr<Expr> expr) : m_expr(std::move(expr)) {}
+    explicit GroupingExpr(NodePtr<Expr> expr) : Expr(ExprKind::Grouping), m_expr(std::move(expr)) {}
     String toString() const override;
     const Expr* getExpression() const { return m_expr.get(); }
 
 private:
-    UniquePtr<Expr> m_expr;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_expr;
 };
 
 // Assignment expression (x = value)
 class AssignmentExpr : public Expr {
 public:
-    AssignmentExpr(const Token& name, UniquePtr<Expr> value)
-        : m_name(name), m_value(std::move(value)) {}
+    AssignmentExpr(const Token& name, NodePtr<Expr> value)
+        : Expr(ExprKind::Assignment), m_name(name), m_value(std::move(value)) {}
 
     String toString() const override;
 
@@ -115,15 +184,17 @@ public:
     const Expr* getValue() const { return m_value.get(); }
 
 private:
+    friend class Optimizer;
+
     Token m_name;
-    UniquePtr<Expr> m_value;
+    NodePtr<Expr> m_value;
 };
 
 // Logical expression (and, or)
 class LogicalExpr : public Expr {
 public:
-    LogicalExpr(UniquePtr<Expr> left, const Token& op, UniquePtr<Expr> right)
-        : m_left(std::move(left)), m_operator(op), m_right(std::move(right)) {}
+    LogicalExpr(NodePtr<Expr> left, const Token& op, NodePtr<Expr> right)
+        : Expr(ExprKind::Logical), m_left(std::move(left)), m_operator(op), m_right(std::move(right)) {}
 
     String toString() const override;
 
@@ -132,48 +203,54 @@ public:
     const Expr* getRight() const { return m_right.get(); }
 
 private:
-    UniquePtr<Expr> m_left;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_left;
     Token m_operator;
-    UniquePtr<Expr> m_right;
+    NodePtr<Expr> m_right;
 };
 
 // Call expression (func(args))
 class CallExpr : public Expr {
 public:
-    CallExpr(UniquePtr<Expr> callee, const Token& paren, std::vector<UniquePtr<Expr>> args)
-        : m_callee(std::move(callee)), m_paren(paren), m_arguments(std::move(args)) {}
+    CallExpr(NodePtr<Expr> callee, const Token& paren, std::vector<NodePtr<Expr>> args)
+        : Expr(ExprKind::Call), m_callee(std::move(callee)), m_paren(paren), m_arguments(std::move(args)) {}
 
     String toString() const override;
 
     const Expr* getCallee() const { return m_callee.get(); }
     const Token& getParen() const { return m_paren; }
-    const std::vector<UniquePtr<Expr>>& getArguments() const { return m_arguments; }
+    const std::vector<NodePtr<Expr>>& getArguments() const { return m_arguments; }
 
 private:
-    UniquePtr<Expr> m_callee;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_callee;
     Token m_paren;
-    std::vector<UniquePtr<Expr>> m_arguments;
+    std::vector<NodePtr<Expr>> m_arguments;
 };
 
 // Array literal expression ([1, 2, 3])
 class ArrayExpr : public Expr {
 public:
-    explicit ArrayExpr(std::vector<UniquePtr<Expr>> elements)
-        : m_elements(std::move(elements)) {}
+    explicit ArrayExpr(std::vector<NodePtr<Expr>> elements)
+        : Expr(ExprKind::Array), m_elements(std::move(elements)) {}
 
     String toString() const override;
 
-    const std::vector<UniquePtr<Expr>>& getElements() const { return m_elements; }
+    const std::vector<NodePtr<Expr>>& getElements() const { return m_elements; }
 
 private:
-    std::vector<UniquePtr<Expr>> m_elements;
+    friend class Optimizer;
+
+    std::vector<NodePtr<Expr>> m_elements;
 };
 
 // Index expression (array[index])
 class IndexExpr : public Expr {
 public:
-    IndexExpr(UniquePtr<Expr> object, UniquePtr<Expr> index)
-        : m_object(std::move(object)), m_index(std::move(index)) {}
+    IndexExpr(NodePtr<Expr> object, NodePtr<Expr> index)
+        : Expr(ExprKind::Index), m_object(std::move(object)), m_index(std::move(index)) {}
 
     String toString() const override;
 
@@ -181,15 +258,17 @@ public:
     const Expr* getIndex() const { return m_index.get(); }
 
 private:
-    UniquePtr<Expr> m_object;
-    UniquePtr<Expr> m_index;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_object;
+    NodePtr<Expr> m_index;
 };
 
 // Member access expression (object.member)
 class MemberExpr : public Expr {
 public:
-    MemberExpr(UniquePtr<Expr> object, const Token& member)
-        : m_object(std::move(object)), m_member(member) {}
+    MemberExpr(NodePtr<Expr> object, const Token& member)
+        : Expr(ExprKind::Member), m_object(std::move(object)), m_member(member) {}
 
     String toString() const override;
 
@@ -197,23 +276,27 @@ public:
     const Token& getMember() const { return m_member; }
 
 private:
-    UniquePtr<Expr> m_object;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_object;
     Token m_member;
 };
 
 // Map/dictionary expression ({key: value, ...})
 class MapExpr : public Expr {
 public:
-    using KeyValuePair = std::pair<String, UniquePtr<Expr>>;
+    using KeyValuePair = std::pair<String, NodePtr<Expr>>;
 
     explicit MapExpr(std::vector<KeyValuePair> pairs)
-        : m_pairs(std::move(pairs)) {}
+        : Expr(ExprKind::Map), m_pairs(std::move(pairs)) {}
 
     String toString() const override;
 
     const std::vector<KeyValuePair>& getPairs() const { return m_pairs; }
 
 private:
+    friend class Optimizer;
+
     std::vector<KeyValuePair> m_pairs;
 };
 
@@ -222,19 +305,21 @@ private:
 // Expression statement
 class ExprStmt : public Stmt {
 public:
-    explicit ExprStmt(UniquePtr<Expr> expr) : m_expr(std::move(expr)) {}
+    explicit ExprStmt(NodePtr<Expr> expr) : Stmt(StmtKind::Expr), m_expr(std::move(expr)) {}
     String toString() const override;
     const Expr* getExpression() const { return m_expr.get(); }
 
 private:
-    UniquePtr<Expr> m_expr;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_expr;
 };
 
 // Variable declaration (let x = value)
 class VarDeclStmt : public Stmt {
 public:
-    VarDeclStmt(const Token& name, UniquePtr<Expr> initializer, bool isConst)
-        : m_name(name), m_initializer(std::move(initializer)), m_isConst(isConst) {}
+    VarDeclStmt(const Token& name, NodePtr<Expr> initializer, bool isConst)
+        : Stmt(StmtKind::VarDecl), m_name(name), m_initializer(std::move(initializer)), m_isConst(isConst) {}
 
     String toString() const override;
 
@@ -243,29 +328,33 @@ public:
     bool isConst() const { return m_isConst; }
 
 private:
+    friend class Optimizer;
+
     Token m_name;
-    UniquePtr<Expr> m_initializer;
+    NodePtr<Expr> m_initializer;
     bool m_isConst;
 };
 
 // Block statement ({ statements })
 class BlockStmt : public Stmt {
 public:
-    explicit BlockStmt(std::vector<UniquePtr<Stmt>> statements)
-        : m_statements(std::move(statements)) {}
+    explicit BlockStmt(std::vector<NodePtr<Stmt>> statements)
+        : Stmt(StmtKind::Block), m_statements(std::move(statements)) {}
 
     String toString() const override { return "Block"; }
-    const std::vector<UniquePtr<Stmt>>& getStatements() const { return m_statements; }
+    const std::vector<NodePtr<Stmt>>& getStatements() const { return m_statements; }
 
 private:
-    std::vector<UniquePtr<Stmt>> m_statements;
+    friend class Optimizer;
+
+    std::vector<NodePtr<Stmt>> m_statements;
 };
 
 // If statement
 class IfStmt : public Stmt {
 public:
-    IfStmt(UniquePtr<Expr> condition, UniquePtr<Stmt> thenBranch, UniquePtr<Stmt> elseBranch)
-        : m_condition(std::move(condition))
+    IfStmt(NodePtr<Expr> condition, NodePtr<Stmt> thenBranch, NodePtr<Stmt> elseBranch)
+        : Stmt(StmtKind::If), m_condition(std::move(condition))
         , m_thenBranch(std::move(thenBranch))
         , m_elseBranch(std::move(elseBranch)) {}
 
@@ -276,16 +365,18 @@ public:
     const Stmt* getElseBranch() const { return m_elseBranch.get(); }
 
 private:
-    UniquePtr<Expr> m_condition;
-    UniquePtr<Stmt> m_thenBranch;
-    UniquePtr<Stmt> m_elseBranch;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_condition;
+    NodePtr<Stmt> m_thenBranch;
+    NodePtr<Stmt> m_elseBranch;
 };
 
 // While statement
 class WhileStmt : public Stmt {
 public:
-    WhileStmt(UniquePtr<Expr> condition, UniquePtr<Stmt> body)
-        : m_condition(std::move(condition)), m_body(std::move(body)) {}
+    WhileStmt(NodePtr<Expr> condition, NodePtr<Stmt> body)
+        : Stmt(StmtKind::While), m_condition(std::move(condition)), m_body(std::move(body)) {}
 
     String toString() const override { return "While"; }
 
@@ -293,16 +384,18 @@ public:
     const Stmt* getBody() const { return m_body.get(); }
 
 private:
-    UniquePtr<Expr> m_condition;
-    UniquePtr<Stmt> m_body;
+    friend class Optimizer;
+
+    NodePtr<Expr> m_condition;
+    NodePtr<Stmt> m_body;
 };
 
 // For statement
 class ForStmt : public Stmt {
 public:
-    ForStmt(UniquePtr<Stmt> initializer, UniquePtr<Expr> condition,
-            UniquePtr<Expr> increment, UniquePtr<Stmt> body)
-        : m_initializer(std::move(initializer))
+    ForStmt(NodePtr<Stmt> initializer, NodePtr<Expr> condition,
+            NodePtr<Expr> increment, NodePtr<Stmt> body)
+        : Stmt(StmtKind::For), m_initializer(std::move(initializer))
         , m_condition(std::move(condition))
         , m_increment(std::move(increment))
         , m_body(std::move(body)) {}
@@ -315,17 +408,19 @@ public:
     const Stmt* getBody() const { return m_body.get(); }
 
 private:
-    UniquePtr<Stmt> m_initializer;
-    UniquePtr<Expr> m_condition;
-    UniquePtr<Expr> m_increment;
-    UniquePtr<Stmt> m_body;
+    friend class Optimizer;
+
+    NodePtr<Stmt> m_initializer;
+    NodePtr<Expr> m_condition;
+    NodePtr<Expr> m_increment;
+    NodePtr<Stmt> m_body;
 };
 
 // Return statement
 class ReturnStmt : public Stmt {
 public:
-    explicit ReturnStmt(const Token& keyword, UniquePtr<Expr> value)
-        : m_keyword(keyword), m_value(std::move(value)) {}
+    explicit ReturnStmt(const Token& keyword, NodePtr<Expr> value)
+        : Stmt(StmtKind::Return), m_keyword(keyword), m_value(std::move(value)) {}
 
     String toString() const override { return "Return"; }
 
@@ -333,14 +428,16 @@ public:
     const Expr* getValue() const { return m_value.get(); }
 
 private:
+    friend class Optimizer;
+
     Token m_keyword;
-    UniquePtr<Expr> m_value;
+    NodePtr<Expr> m_value;
 };
 
 // Break statement
 class BreakStmt : public Stmt {
 public:
-    explicit BreakStmt(const Token& keyword) : m_keyword(keyword) {}
+    explicit BreakStmt(const Token& keyword) : Stmt(StmtKind::Break), m_keyword(keyword) {}
     String toString() const override { return "Break"; }
     const Token& getKeyword() const { return m_keyword; }
 
@@ -351,7 +448,7 @@ private:
 // Continue statement
 class ContinueStmt : public Stmt {
 public:
-    explicit ContinueStmt(const Token& keyword) : m_keyword(keyword) {}
+    explicit ContinueStmt(const Token& keyword) : Stmt(StmtKind::Continue), m_keyword(keyword) {}
     String toString() const override { return "Continue"; }
     const Token& getKeyword() const { return m_keyword; }
 
@@ -362,8 +459,8 @@ private:
 // Function declaration
 class FunctionStmt : public Stmt {
 public:
-    FunctionStmt(const Token& name, std::vector<Token> params, UniquePtr<BlockStmt> body)
-        : m_name(name), m_parameters(std::move(params)), m_body(std::move(body)) {}
+    FunctionStmt(const Token& name, std::vector<Token> params, NodePtr<BlockStmt> body)
+        : Stmt(StmtKind::Function), m_name(name), m_parameters(std::move(params)), m_body(std::move(body)) {}
 
     String toString() const override;
 
@@ -372,39 +469,75 @@ public:
     const BlockStmt* getBody() const { return m_body.get(); }
 
 private:
+    friend class Optimizer;
+
     Token m_name;
     std::vector<Token> m_parameters;
-    UniquePtr<BlockStmt> m_body;
+    NodePtr<BlockStmt> m_body;
 };
 
 // Class declaration
 class ClassStmt : public Stmt {
 public:
-    ClassStmt(const Token& name, std::vector<UniquePtr<FunctionStmt>> methods)
-        : m_name(name), m_methods(std::move(methods)) {}
+    ClassStmt(const Token& name, std::vector<NodePtr<FunctionStmt>> methods)
+        : Stmt(StmtKind::Class), m_name(name), m_methods(std::move(methods)) {}
 
     String toString() const override;
 
     const Token& getName() const { return m_name; }
-    const std::vector<UniquePtr<FunctionStmt>>& getMethods() const { return m_methods; }
+    const std::vector<NodePtr<FunctionStmt>>& getMethods() const { return m_methods; }
 
 private:
+    friend class Optimizer;
+
     Token m_name;
-    std::vector<UniquePtr<FunctionStmt>> m_methods;
+    std::vector<NodePtr<FunctionStmt>> m_methods;
 };
 
-// Program (top-level)
+// Program (top-level). Owns the arena every node of the tree lives in,
+// so a whole script is a few large blocks instead of one allocation per node.
+// Tokens in the tree view the source text, which must outlive the Program,
+// or text the Program stores itself (see makeText).
 class Program : public ASTNode {
 public:
-    void addStatement(UniquePtr<Stmt> stmt) {
+    Program() : m_arena(INITIAL_ARENA_SIZE) {}
+
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    // Allocate a node of this program's tree
+    template<typename T, typename... Args>
+    NodePtr<T> make(Args&&... args) {
+        return NodePtr<T>(m_arena.create<T>(std::forward<Args>(args)...));
+    }
+
+    // A copy of text that lives as long as the tree, for tokens of nodes
+    // made after parsing
+    std::string_view makeText(std::string_view text) {
+        char* copy = static_cast<char*>(m_arena.allocate(text.size() + 1, 1));
+        text.copy(copy, text.size());
+        copy[text.size()] = '\0';
+        return std::string_view(copy, text.size());
+    }
+
+    void addStatement(NodePtr<Stmt> stmt) {
         m_statements.push_back(std::move(stmt));
     }
 
     String toString() const override { return "Program"; }
-    const std::vector<UniquePtr<Stmt>>& getStatements() const { return m_statements; }
+    const std::vector<NodePtr<Stmt>>& getStatements() const { return m_statements; }
+
+    // Bytes of node storage in use
+    usize getNodeBytes() const { return m_arena.getUsed(); }
 
 private:
-    std::vector<UniquePtr<Stmt>> m_statements;
+    friend class Optimizer;
+
+    static constexpr usize INITIAL_ARENA_SIZE = 16 * 1024;
+
+    // Declared first so it is destroyed after the nodes it holds
+    core::Arena m_arena;
+    std::vector<NodePtr<Stmt>> m_statements;
 };
 
 } // namespace lang
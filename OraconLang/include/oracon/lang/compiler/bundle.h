@@ -0,0 +1,107 @@
+#ifndef ORACON_LANG_COMPILER_BUNDLE_H
+#define ORACON_LANG_COMPILER_BUNDLE_H
+
+#include "oracon/lang/compiler/compiler.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+using core::u64;
+
+// A bundle is a single file of named, already compiled programs, written
+// offline by BundleWriter and memory-mapped at runtime by ScriptBundle, so
+// loading a script costs no lexing, parsing, resolving or compiling.
+//
+// Layout, all integers little-endian:
+//   header     "ORCB", u32 version, u32 program count
+//   directory  per program: string name, u64 offset, u64 size
+//   programs   u32 inline cache count, u32 function count, then per
+//              function: string name, u32 line, u32 parameter count and
+//              their names, the code bytes, run-length encoded lines,
+//              tagged constants and interned names; then u32 global
+//              declaration count, and per declaration: string name, u32
+//              start and end in the script code, u8 1 for a function
+// Strings are a u32 length followed by the bytes.
+//
+// Bundles are build artifacts, but a decoded program is still checked before
+// it reaches the VM: every read is bounds-checked, the bytecode is walked for
+// its stack depth, and every constant, name, slot, cache and function operand
+// must be in range.
+class BundleWriter {
+public:
+    static constexpr u32 VERSION = 3;
+
+    // False if the program holds a constant a bundle cannot store
+    bool add(const String& name, const CompiledProgram& program);
+
+    std::vector<u8> serialize() const;
+    bool write(const String& path);
+
+    usize size() const { return m_programs.size(); }
+
+    bool hasError() const { return !m_errors.empty(); }
+    const std::vector<String>& getErrors() const { return m_errors; }
+
+private:
+    struct Entry {
+        String name;
+        std::vector<u8> data;
+    };
+
+    std::vector<Entry> m_programs;
+    std::vector<String> m_errors;
+};
+
+// A bundle file mapped into memory. Programs are decoded on first lookup and
+// live as long as the bundle; their bytecode is run in place from the mapping.
+// Lookups may come from several threads.
+class ScriptBundle {
+public:
+    ScriptBundle();
+    ~ScriptBundle();
+
+    ScriptBundle(const ScriptBundle&) = delete;
+    ScriptBundle& operator=(const ScriptBundle&) = delete;
+
+    // Maps the file and reads its directory; false on failure, see getErrors()
+    bool open(const String& path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    // nullptr if the bundle has no such program or it cannot be decoded
+    const CompiledProgram* find(const String& name) const;
+    bool contains(const String& name) const { return m_directory.count(name) != 0; }
+    std::vector<String> getNames() const;
+
+    bool hasError() const;
+    std::vector<String> getErrors() const;
+
+private:
+    struct Entry {
+        usize offset;
+        usize size;
+        mutable UniquePtr<CompiledProgram> program;
+        mutable bool decoded = false;
+    };
+
+    const u8* m_data;
+    usize m_size;
+    void* m_mapping;   // platform handle for the mapping
+
+    std::unordered_map<String, Entry> m_directory;
+
+    mutable std::mutex m_mutex;   // guards decoding and m_errors
+    mutable std::vector<String> m_errors;
+
+    bool readDirectory();
+    UniquePtr<CompiledProgram> decode(const String& name, const Entry& entry) const;
+    void addError(const String& message) const;
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_COMPILER_BUNDLE_H
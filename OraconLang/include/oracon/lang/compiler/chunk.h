@@ -0,0 +1,133 @@
+#ifndef ORACON_LANG_COMPILER_CHUNK_H
+#define ORACON_LANG_COMPILER_CHUNK_H
+
+#include "oracon/core/types.h"
+#include "oracon/lang/interpreter/value.h"
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+using core::u8;
+using core::u16;
+using core::u32;
+
+// Bytecode instruction set for the stack VM.
+// Operand widths are noted next to each opcode; multi-byte operands are big-endian.
+enum class OpCode : u8 {
+    CONSTANT,       // u16 constant index
+    NIL,
+    TRUE,
+    FALSE,
+    POP,
+
+    GET_LOCAL,      // u16 stack slot
+    SET_LOCAL,      // u16 stack slot
+    GET_GLOBAL,     // u16 name index
+    SET_GLOBAL,     // u16 name index
+    DEFINE_GLOBAL,  // u16 name index
+    GET_SCOPED,     // u16 depth, u16 slot in an enclosing Environment
+    SET_SCOPED,     // u16 depth, u16 slot
+    DEFINE_SCOPED,  // u16 slot in the current Environment, pops the value
+    PUSH_SCOPE,     // u16 slot count for a new Environment
+    POP_SCOPE,
+
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    MODULO,
+    POWER,
+    NEGATE,
+    POSITIVE,
+    NOT,
+
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+
+    JUMP,           // u16 forward offset
+    JUMP_IF_FALSE,  // u16 forward offset, condition left on the stack
+    LOOP,           // u16 backward offset
+
+    CALL,           // u8 argument count, u16 inline cache
+    RETURN,
+
+    BUILD_ARRAY,    // u16 element count
+    BUILD_MAP,      // u16 pair count, u16 inline cache, then one u16 key name index per pair; values on the stack
+    INDEX_GET,      // u16 inline cache
+    MEMBER_GET,     // u16 name index, u16 inline cache
+
+    FUNCTION        // u16 function index in the compiled program
+};
+
+const char* opCodeToString(OpCode op);
+
+// Inline cache operand of a site that has none; programs with more sites than
+// fit in a u16 leave the rest uncached
+constexpr u16 NO_INLINE_CACHE = 0xFFFF;
+
+// A flat sequence of instructions with its constant and name pools.
+// Names are interned Symbols kept apart from constants, so global and member
+// lookups never unwrap a Value or hash an identifier at runtime.
+// Chunks loaded from a bundle point at code in the bundle's mapping rather
+// than owning a copy; compiled chunks own theirs.
+class Chunk {
+public:
+    // Source line of the offsets up to end, after the previous run's end
+    struct LineRun {
+        u32 end;
+        u32 line;
+    };
+
+    void write(u8 byte, u32 line);
+    void write(OpCode op, u32 line) { write(static_cast<u8>(op), line); }
+
+    // Drops the code and line table but keeps the pools, so code copied out
+    // of this chunk can be written back without renumbering its operands
+    void clearCode();
+
+    usize addConstant(const Value& value);
+    usize addName(Symbol name);
+
+    const u8* getCode() const { return m_mappedCode ? m_mappedCode : m_code.data(); }
+    void patch(usize offset, u8 byte) { m_code[offset] = byte; }
+    const std::vector<Value>& getConstants() const { return m_constants; }
+    const std::vector<Symbol>& getNames() const { return m_names; }
+
+    usize size() const { return m_mappedCode ? m_mappedSize : m_code.size(); }
+    u32 getLine(usize offset) const;
+    const std::vector<LineRun>& getLineRuns() const { return m_lines; }
+
+    // Length of the instruction at offset, 0 if it is not one the VM knows
+    usize instructionLength(usize offset) const;
+
+    // Deepest the value stack gets on any path through the code, for a frame
+    // that starts with entryDepth values (the callee and its arguments).
+    // 0 if the code is malformed: a bad instruction or jump, a pop from an
+    // empty frame, or an offset reached at two different depths.
+    usize computeMaxStack(usize entryDepth) const;
+
+    // Human-readable listing, one instruction per line
+    String disassemble(const String& name) const;
+
+private:
+    friend class ScriptBundle; // fills the pools directly when loading
+
+    std::vector<u8> m_code;
+    const u8* m_mappedCode = nullptr;
+    usize m_mappedSize = 0;
+    std::vector<LineRun> m_lines;
+    std::vector<Value> m_constants;
+    std::vector<Symbol> m_names;
+
+    usize disassembleInstruction(usize offset, String& out) const;
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_COMPILER_CHUNK_H
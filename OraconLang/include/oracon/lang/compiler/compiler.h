@@ -0,0 +1,170 @@
+#ifndef ORACON_LANG_COMPILER_COMPILER_H
+#define ORACON_LANG_COMPILER_COMPILER_H
+
+#include "oracon/lang/ast/ast.h"
+#include "oracon/lang/compiler/chunk.h"
+#include "oracon/lang/compiler/resolver.h"
+#include <unordered_map>
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+using core::UniquePtr;
+
+class CompiledProgram;
+
+// Compiled form of one function body, or of the top-level script
+struct FunctionProto {
+    String name;
+    usize arity = 0;
+    usize maxStack = 0;  // deepest the frame's value stack gets, callee and arguments included
+    const FunctionStmt* declaration = nullptr; // nullptr for the script itself
+    const CompiledProgram* program = nullptr;  // owner; FUNCTION indices refer to it
+    Chunk chunk;
+};
+
+// A top-level let, const or func: the script code in [start, end) evaluates
+// it and binds the global
+struct GlobalDeclaration {
+    Symbol name;
+    u32 start;
+    u32 end;
+    bool isFunction;
+    // Type of a let or const's value when its initializer is a literal,
+    // array or map; Nil when only running it would tell
+    ValueType type = ValueType::Nil;
+};
+
+// Result of compiling a Program: the script body plus every function it declares.
+// Function values created by the VM refer back to their FunctionStmt, so the
+// source Program must outlive the CompiledProgram. Programs loaded from a
+// ScriptBundle own stand-in declarations instead.
+class CompiledProgram {
+public:
+    const FunctionProto* getScript() const { return m_functions.front().get(); }
+    const FunctionProto* getFunction(usize index) const { return m_functions[index].get(); }
+    usize getFunctionCount() const { return m_functions.size(); }
+    const std::vector<GlobalDeclaration>& getGlobalDeclarations() const { return m_globals; }
+
+    // Number of inline cache sites; each VM keeps its own caches, since a
+    // CompiledProgram may be shared between VMs
+    usize getInlineCacheCount() const { return m_inlineCacheCount; }
+
+    // Map a FunctionStmt back to its compiled body; nullptr if it is not ours
+    const FunctionProto* findFunction(const FunctionStmt* declaration) const;
+
+    String disassemble() const;
+
+private:
+    friend class Compiler;
+    friend class ScriptBundle;
+
+    std::vector<UniquePtr<FunctionProto>> m_functions;
+    std::unordered_map<const FunctionStmt*, const FunctionProto*> m_byDeclaration;
+    std::vector<GlobalDeclaration> m_globals;
+    usize m_inlineCacheCount = 0;
+
+    // Bodiless FunctionStmts standing in for the source of a loaded program
+    UniquePtr<Program> m_declarations;
+};
+
+// Lowers a parsed Program to bytecode for the VM.
+// Variable storage comes from a Resolver pass, so no name lookups are emitted
+// for locals. Constructs the bytecode backend cannot express yet (classes) are
+// reported as errors so callers can fall back to the tree-walking Interpreter.
+class Compiler {
+public:
+    Compiler();
+
+    UniquePtr<CompiledProgram> compile(const Program* program);
+
+    bool hasError() const { return m_hasError; }
+    const std::vector<String>& getErrors() const { return m_errors; }
+
+private:
+    struct Scope {
+        u16 stackLocals;  // values this scope leaves on the stack
+        bool hasEnv;      // whether a PUSH_SCOPE was emitted for it
+    };
+
+    struct Loop {
+        usize start;
+        usize scopeIndex;  // scopes at or above this index are exited by break/continue
+        bool isFor;
+        std::vector<usize> breakJumps;
+        std::vector<usize> continueJumps;
+    };
+
+    struct FunctionState {
+        FunctionProto* proto;
+        FunctionState* enclosing;
+        std::vector<Scope> scopes;
+        std::vector<Loop> loops;
+    };
+
+    Resolver m_resolver;
+    UniquePtr<CompiledProgram> m_program;
+    FunctionState* m_current;
+    u32 m_line;
+    bool m_hasError;
+    std::vector<String> m_errors;
+
+    // Statement compilation
+    void compileStmt(const Stmt* stmt);
+    void compileVarDecl(const VarDeclStmt* stmt);
+    void compileBlock(const BlockStmt* stmt);
+    void compileIf(const IfStmt* stmt);
+    void compileWhile(const WhileStmt* stmt);
+    void compileFor(const ForStmt* stmt);
+    void compileReturn(const ReturnStmt* stmt);
+    void compileBreak(const BreakStmt* stmt);
+    void compileContinue(const ContinueStmt* stmt);
+    void compileFunctionDecl(const FunctionStmt* stmt);
+
+    // Expression compilation
+    void compileExpr(const Expr* expr);
+    void compileLiteral(const LiteralExpr* expr);
+    void compileVariable(const VariableExpr* expr);
+    void compileUnary(const UnaryExpr* expr);
+    void compileBinary(const BinaryExpr* expr);
+    void compileAssignment(const AssignmentExpr* expr);
+    void compileLogical(const LogicalExpr* expr);
+    void compileCall(const CallExpr* expr);
+    void compileArray(const ArrayExpr* expr);
+    void compileIndex(const IndexExpr* expr);
+    void compileMember(const MemberExpr* expr);
+    void compileMap(const MapExpr* expr);
+
+    // Compiles a function body into a new FunctionProto and returns its index
+    usize compileFunction(const FunctionStmt* stmt);
+
+    // Scopes and variable storage
+    void beginScope(const void* owner);
+    void endScope();
+    void emitScopeExits(usize scopeIndex);
+    void defineVariable(const void* declaration, Symbol name);
+    void emitGet(const Expr* expr, Symbol name);
+    void emitSet(const Expr* expr, Symbol name);
+
+    // Bytecode emission
+    Chunk& currentChunk();
+    void emit(OpCode op);
+    void emit(OpCode op, u16 operand);
+    void emitByte(u8 byte);
+    void emitShort(u16 value);
+    void emitConstant(const Value& value);
+    usize emitJump(OpCode op);
+    void patchJump(usize offset);
+    void emitLoop(usize loopStart);
+    u16 makeName(Symbol name);
+    u16 makeInlineCache();
+
+    void setLine(const Token& token) { m_line = token.getLocation().line; }
+    void addError(const String& message);
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_COMPILER_COMPILER_H
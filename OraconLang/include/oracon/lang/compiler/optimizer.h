@@ -0,0 +1,58 @@
+#ifndef ORACON_LANG_COMPILER_OPTIMIZER_H
+#define ORACON_LANG_COMPILER_OPTIMIZER_H
+
+#include "oracon/lang/ast/ast.h"
+#include "oracon/lang/interpreter/value.h"
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+// AST rewriting pass run once after parsing, before either execution tier.
+// Folds operators applied to literals, removes if/while statements whose
+// condition is a literal, drops GroupingExpr nodes and collapses repeated
+// `not`. Every rewrite computes exactly what the VM and Interpreter would at
+// runtime; operations that would raise a runtime error are left in place.
+class Optimizer {
+public:
+    // With recordLog set, each rewrite is described in getLog()
+    explicit Optimizer(bool recordLog = false);
+
+    void optimize(Program* program);
+
+    usize getRewriteCount() const { return m_rewrites; }
+    const std::vector<String>& getLog() const { return m_log; }
+
+private:
+    Program* m_program;
+    bool m_recordLog;
+    usize m_rewrites;
+    std::vector<String> m_log;
+
+    // Statements
+    void optimizeStatements(std::vector<NodePtr<Stmt>>& statements);
+    void optimizeStmt(NodePtr<Stmt>& stmt);
+    void optimizeFunction(FunctionStmt* stmt);
+
+    // Replaces a loop or if whose condition is a literal with what it reduces to
+    void removeDeadStmt(NodePtr<Stmt>& stmt);
+
+    // Expressions
+    void optimizeExpr(NodePtr<Expr>& expr);
+    void foldUnary(NodePtr<Expr>& expr, UnaryExpr* unary);
+    void foldBinary(NodePtr<Expr>& expr, BinaryExpr* binary);
+    void foldLogical(NodePtr<Expr>& expr, LogicalExpr* logical);
+
+    // Literal conversions
+    static bool literalValue(const Expr* expr, Value& out);
+    NodePtr<Expr> makeLiteral(const Value& value, const Token& at);
+
+    // `at` is copied: it usually belongs to the node being replaced
+    void replace(NodePtr<Expr>& expr, NodePtr<Expr>&& replacement, Token at);
+    void record(const Token& at, const String& before, const String& after);
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_COMPILER_OPTIMIZER_H
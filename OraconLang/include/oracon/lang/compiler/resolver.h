@@ -0,0 +1,97 @@
+#ifndef ORACON_LANG_COMPILER_RESOLVER_H
+#define ORACON_LANG_COMPILER_RESOLVER_H
+
+#include "oracon/lang/ast/ast.h"
+#include <unordered_map>
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+using core::u16;
+using core::usize;
+
+// Where a variable lives at runtime, as decided by the Resolver
+struct VariableSlot {
+    enum class Kind : u8 {
+        Global,     // looked up by name in the global Environment
+        Local,      // stack slot in the current call frame
+        Captured    // slot in a flat Environment, `depth` hops up the scope chain
+    };
+
+    Kind kind = Kind::Global;
+    u16 depth = 0;
+    u16 slot = 0;
+};
+
+// Static scope analysis over a Program.
+// Binds every VariableExpr/AssignmentExpr to its declaration and assigns each
+// local a (depth, slot) pair. Locals referenced from an inner function are
+// "captured" and placed in a per-scope Environment; all other locals get a
+// stack slot. Top-level declarations remain globals.
+// Only the bytecode Compiler uses the slots. The tree-walking Interpreter
+// has no frame stack for Local slots to index, and keeps looking names up
+// in its scope chain.
+class Resolver {
+public:
+    Resolver();
+
+    void resolve(const Program* program);
+
+    bool hasError() const { return m_hasError; }
+    const std::vector<String>& getErrors() const { return m_errors; }
+
+    // Storage for a VariableExpr or AssignmentExpr
+    VariableSlot lookup(const Expr* expr) const;
+
+    // Storage for a declaration: VarDeclStmt, FunctionStmt name, or parameter token
+    VariableSlot lookupDeclaration(const void* declaration) const;
+
+    // Number of captured slots a scope needs (0 = no Environment at runtime).
+    // Scopes are keyed by BlockStmt, ForStmt (its initializer scope) or FunctionStmt.
+    u16 getScopeSize(const void* owner) const;
+
+private:
+    struct Scope {
+        const void* owner;
+        std::unordered_map<Symbol, const void*, SymbolHash> bindings;
+        bool hasEnv;
+        u16 nextEnvSlot;
+        u16 stackDeclared;
+    };
+
+    // Two passes: the first binds references and marks captured declarations,
+    // the second lays out slots once every scope knows whether it needs an Environment.
+    enum class Pass { Bind, Layout };
+
+    Pass m_pass;
+    std::vector<Scope> m_scopes;
+    std::vector<usize> m_functionScopes;  // index of each enclosing function's outermost scope
+    std::vector<u16> m_stackSizes;        // live stack slots per enclosing function
+
+    std::unordered_map<const void*, const void*> m_declarationScope;
+    std::unordered_map<const void*, usize> m_declarationFunction;
+    std::unordered_map<const void*, bool> m_captured;
+    std::unordered_map<const void*, u16> m_scopeSizes;
+    std::unordered_map<const void*, VariableSlot> m_declarations;
+    std::unordered_map<const Expr*, VariableSlot> m_references;
+
+    bool m_hasError;
+    std::vector<String> m_errors;
+
+    void resolveStmt(const Stmt* stmt);
+    void resolveExpr(const Expr* expr);
+    void resolveFunction(const FunctionStmt* stmt);
+    void resolveReference(const Expr* expr, const Token& name);
+
+    void beginScope(const void* owner);
+    void endScope();
+    void declare(const void* declaration, Symbol name);
+
+    void addError(const Token& token, const String& message);
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_COMPILER_RESOLVER_H
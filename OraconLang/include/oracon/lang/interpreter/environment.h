@@ -4,6 +4,7 @@
 #include "oracon/lang/interpreter/value.h"
 #include <unordered_map>
 #include <memory>
+#include <vector>
 
 namespace oracon {
 namespace lang {
@@ -13,14 +14,49 @@ public:
     Environment() : m_parent(nullptr) {}
     explicit Environment(Environment* parent) : m_parent(parent) {}
 
+    // Flat storage for variables the Resolver assigned a (depth, slot) pair
+    Environment(Environment* parent, usize slotCount) : m_slots(slotCount), m_parent(parent) {}
+
+    // Empties the scope and reuses it as a new one, keeping its storage.
+    // Only for a scope nothing else refers to.
+    void reset(Environment* parent, usize slotCount) {
+        m_values.clear();
+        m_slots.assign(slotCount, Value());
+        m_parent = parent;
+    }
+
     void define(const String& name, const Value& value);
     Value get(const String& name) const;
     void set(const String& name, const Value& value);
     bool has(const String& name) const;
     bool hasLocal(const String& name) const;
 
+    // Symbol overloads skip re-hashing the name
+    void define(Symbol name, const Value& value) { m_values[name] = value; }
+    Value get(Symbol name) const;
+    void set(Symbol name, const Value& value);
+
+    // Variable storage for name in this or an enclosing scope; nullptr if undefined
+    Value* lookup(Symbol name);
+
+    Value& slot(usize index) { return m_slots[index]; }
+    Value& slotAt(usize depth, usize index) { return ancestor(depth)->m_slots[index]; }
+    usize getSlotCount() const { return m_slots.size(); }
+
+    Environment* ancestor(usize depth) {
+        Environment* env = this;
+        while (depth-- > 0) {
+            env = env->m_parent;
+        }
+        return env;
+    }
+    Environment* getParent() const { return m_parent; }
+
 private:
-    std::unordered_map<String, Value> m_values;
+    friend class Heap;
+
+    std::unordered_map<Symbol, Value, SymbolHash> m_values;
+    std::vector<Value> m_slots;
     Environment* m_parent;
 };
 
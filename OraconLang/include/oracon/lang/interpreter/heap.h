@@ -0,0 +1,170 @@
+#ifndef ORACON_LANG_INTERPRETER_HEAP_H
+#define ORACON_LANG_INTERPRETER_HEAP_H
+
+#include "oracon/core/memory.h"
+#include "oracon/core/types.h"
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+using core::u8;
+using core::u64;
+using core::f64;
+using core::usize;
+
+class Heap;
+class Environment;
+
+enum class HeapKind : u8 {
+    Array,
+    Map,
+    Function
+};
+
+// Base of the script objects a Heap can track: arrays, maps and functions.
+// An object joins the heap that is current on its thread when it is first
+// wrapped in a Value, and leaves it when destroyed. Copies start untracked.
+// Its Ref count lives in the object, so the collector can read it by address.
+class HeapObject : public core::RefCounted {
+public:
+    Heap* getHeap() const { return m_heap; }
+
+protected:
+    HeapObject() : m_heap(nullptr), m_prev(nullptr), m_next(nullptr), m_bytes(0), m_kind(HeapKind::Array) {}
+    HeapObject(const HeapObject&) : HeapObject() {}
+    HeapObject& operator=(const HeapObject&) { return *this; }
+    ~HeapObject();
+
+    // Called by subclasses when their storage has grown
+    void resized();
+
+private:
+    friend class Heap;
+
+    Heap* m_heap;
+    HeapObject* m_prev;
+    HeapObject* m_next;
+    usize m_bytes;   // size last reported to the heap
+    HeapKind m_kind;
+};
+
+struct HeapStats {
+    usize objects = 0;        // tracked arrays, maps and functions alive
+    usize scopes = 0;         // scope Environments the owner keeps for closures
+    usize bytes = 0;          // measured by the last collection, plus allocations since
+    usize peakBytes = 0;
+    u64 collections = 0;
+    u64 freedObjects = 0;     // objects freed by breaking reference cycles
+    u64 freedScopes = 0;
+    f64 lastPauseMs = 0.0;
+    f64 totalPauseMs = 0.0;
+};
+
+// Accounting and cycle collection for the objects scripts create. Arrays,
+// maps and functions are refcounted, which frees most of them promptly, but
+// a map holding a closure that captured the map, or two arrays holding each
+// other, never reach a count of zero; neither do the scope Environments
+// closures keep alive. collect() finds such garbage by trial deletion:
+// references from tracked objects and known scopes are subtracted from each
+// count, whatever is left is referenced from outside (a VM stack, the host,
+// another heap), and everything not reachable from those roots is freed.
+//
+// A heap belongs to one thread at a time, like the VM that owns it. Strings
+// and typed arrays cannot form cycles and are not tracked; their bytes are
+// charged when they are created and measured again by each collection.
+class Heap {
+public:
+    // Smallest growth between two collections
+    static constexpr usize MIN_COLLECT_BYTES = 4 * 1024 * 1024;
+
+    Heap();
+    // Objects that outlive the heap are detached, not freed
+    ~Heap();
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    // Makes heap the one new objects on this thread join while the scope lasts
+    class Scope {
+    public:
+        explicit Scope(Heap& heap) : m_previous(s_current) { s_current = &heap; }
+        ~Scope() { s_current = m_previous; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Heap* m_previous;
+    };
+
+    // Joins object to the current heap, if there is one and it is untracked
+    static void adopt(HeapObject* object, HeapKind kind) {
+        if (s_current && object && !object->m_heap) {
+            s_current->track(object, kind);
+        }
+    }
+
+    // For memory the heap cannot see being allocated, like new scopes
+    void noteAllocation(usize bytes) { m_otherBytes += bytes; }
+
+    // noteAllocation on the current heap, if there is one
+    static void noteCurrent(usize bytes) {
+        if (s_current) {
+            s_current->noteAllocation(bytes);
+        }
+    }
+
+    // True once the heap has grown by its live size, or MIN_COLLECT_BYTES,
+    // since the last collection
+    bool shouldCollect() const { return getBytes() >= m_threshold; }
+    usize getBytes() const { return m_objectBytes + m_otherBytes; }
+    usize getObjectCount() const { return m_objectCount; }
+
+    // roots are the scopes the program can reach directly: globals and the
+    // scopes of active frames. scopes are the ones that may be garbage; those
+    // found unreachable are emptied and appended to dead for the caller to
+    // destroy. Objects in cycles are freed before this returns.
+    void collect(const std::vector<Environment*>& roots, const std::vector<Environment*>& scopes,
+                 std::vector<Environment*>& dead);
+
+    HeapStats getStats() const;
+
+    static usize sizeOf(const Environment& env);
+
+private:
+    friend class HeapObject;
+
+    inline static thread_local Heap* s_current = nullptr;
+
+    HeapObject m_list;    // sentinel of the circular list of tracked objects
+    usize m_objectCount;
+    usize m_objectBytes;  // kept current as objects are tracked, grow and die
+    usize m_otherBytes;   // scopes, strings and typed arrays: measured by the last
+                          // collection, plus what noteAllocation reported since
+    usize m_threshold;
+    HeapStats m_stats;
+
+    void track(HeapObject* object, HeapKind kind);
+    void untrack(HeapObject* object);
+    void resize(HeapObject* object);
+
+    static usize sizeOf(const HeapObject* object);
+};
+
+inline HeapObject::~HeapObject() {
+    if (m_heap) {
+        m_heap->untrack(this);
+    }
+}
+
+inline void HeapObject::resized() {
+    if (m_heap) {
+        m_heap->resize(this);
+    }
+}
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_INTERPRETER_HEAP_H
@@ -3,28 +3,32 @@
 
 #include "oracon/lang/ast/ast.h"
 #include "oracon/lang/interpreter/environment.h"
+#include "oracon/lang/interpreter/heap.h"
 #include "oracon/lang/interpreter/value.h"
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 namespace oracon {
 namespace lang {
 
-// Control flow exceptions
-class ReturnException : public std::exception {
-public:
-    explicit ReturnException(const Value& value) : m_value(value) {}
-    const Value& getValue() const { return m_value; }
-private:
-    Value m_value;
+// How a statement finished. return, break and continue travel back up
+// through executeStmt as this value rather than as a thrown exception; the
+// value of a return waits in m_returnValue until callUserFunction takes it.
+enum class ExecSignal {
+    Normal,
+    Return,
+    Break,
+    Continue
 };
 
-class BreakException : public std::exception {};
-class ContinueException : public std::exception {};
-
 class Interpreter {
 public:
     Interpreter();
+    ~Interpreter();
+
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
 
     void execute(const Program* program);
     bool hasError() const { return m_hasError; }
@@ -37,25 +41,49 @@ public:
     // Call a function by name from C++
     Value callFunction(const String& name, const std::vector<Value>& arguments);
 
+    // Frees the scopes closures kept that no closure can reach any more,
+    // and reference cycles among script objects. Also runs on its own once
+    // the heap has grown enough.
+    void collectGarbage();
+    HeapStats getHeapStats() const;
+
 private:
+    // Declared first so it outlives every Value the interpreter holds
+    Heap m_heap;
+
     Environment m_globalEnv;
     Environment* m_currentEnv;
+    Value m_returnValue;
+    usize m_callDepth;
     bool m_hasError;
     std::vector<String> m_errors;
 
+    // Scopes a nested function declaration captured. They are kept, not
+    // freed, when their block or call ends, until a collection finds no
+    // closure can reach them. The scopes of blocks and calls still running
+    // are the collector's roots.
+    std::unordered_set<Environment*> m_captured;
+    std::vector<std::unique_ptr<Environment>> m_keptScopes;
+    std::vector<Environment*> m_activeScopes;
+
+    // Emptied call and block scopes, and argument vectors, kept for reuse so
+    // a call need not allocate them
+    std::vector<std::unique_ptr<Environment>> m_freeScopes;
+    std::vector<std::vector<Value>> m_freeArguments;
+
     // Statement execution
-    void executeStmt(const Stmt* stmt);
-    void executeExprStmt(const ExprStmt* stmt);
-    void executeVarDecl(const VarDeclStmt* stmt);
-    void executeBlock(const BlockStmt* stmt, Environment* env);
-    void executeIf(const IfStmt* stmt);
-    void executeWhile(const WhileStmt* stmt);
-    void executeFor(const ForStmt* stmt);
-    void executeReturn(const ReturnStmt* stmt);
-    void executeBreak(const BreakStmt* stmt);
-    void executeContinue(const ContinueStmt* stmt);
-    void executeFunctionDecl(const FunctionStmt* stmt);
-    void executeClassDecl(const ClassStmt* stmt);
+    ExecSignal executeStmt(const Stmt* stmt);
+    ExecSignal executeExprStmt(const ExprStmt* stmt);
+    ExecSignal executeVarDecl(const VarDeclStmt* stmt);
+    ExecSignal executeBlock(const BlockStmt* stmt, Environment* env);
+    ExecSignal executeIf(const IfStmt* stmt);
+    ExecSignal executeWhile(const WhileStmt* stmt);
+    ExecSignal executeFor(const ForStmt* stmt);
+    ExecSignal executeReturn(const ReturnStmt* stmt);
+    ExecSignal executeBreak(const BreakStmt* stmt);
+    ExecSignal executeContinue(const ContinueStmt* stmt);
+    ExecSignal executeFunctionDecl(const FunctionStmt* stmt);
+    ExecSignal executeClassDecl(const ClassStmt* stmt);
 
     // Expression evaluation
     Value evaluateExpr(const Expr* expr);
@@ -72,7 +100,13 @@ private:
     Value evaluateMember(const MemberExpr* expr);
     Value evaluateMap(const MapExpr* expr);
 
+    // Runs block in scope, then frees scope unless a closure captured it
+    ExecSignal executeScoped(const BlockStmt* block, std::unique_ptr<Environment> scope);
+    std::unique_ptr<Environment> acquireScope(Environment* parent);
+    void releaseScope(std::unique_ptr<Environment> scope);
+
     // Function calling
+    Value callFunctionValue(const Value& callee, const std::vector<Value>& arguments);
     Value callUserFunction(const FunctionType& function, const std::vector<Value>& arguments);
 
     // Error handling
@@ -2,30 +2,66 @@
 #define ORACON_LANG_INTERPRETER_VALUE_H
 
 #include "oracon/core/types.h"
-#include <variant>
+#include "oracon/core/memory.h"
+#include "oracon/lang/lexer/symbol.h"
+#include "oracon/lang/interpreter/heap.h"
 #include <vector>
 #include <memory>
+#include <new>
+#include <stdexcept>
 #include <unordered_map>
 #include <functional>
+#include <mutex>
 
 namespace oracon {
 namespace lang {
 
+using core::u8;
+using core::u32;
+using core::i32;
 using core::i64;
+using core::u64;
 using core::f64;
 using core::String;
 using core::usize;
+using core::Ref;
+using core::makeRef;
 
 // Forward declarations
 class Value;
+class Array;
+class Map;
 class Environment;
 class FunctionStmt;
 
+// Arguments of a native call: a view of values owned by the caller
+// (the VM stack, or the Interpreter's argument vector). Never copied.
+class NativeArgs {
+public:
+    NativeArgs() : m_data(nullptr), m_count(0) {}
+    NativeArgs(const Value* data, usize count) : m_data(data), m_count(count) {}
+
+    usize size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    const Value& operator[](usize index) const;
+    const Value* begin() const { return m_data; }
+    const Value* end() const;
+
+private:
+    const Value* m_data;
+    usize m_count;
+};
+
 // Function types
 using NativeFunction = std::function<Value(const std::vector<Value>&)>;
 
+// Allocation-free native: a plain function pointer plus the user data it was
+// registered with. Results that do not fit one Value are written into an
+// array argument supplied by the script (an out-parameter).
+using NativeFn = Value (*)(void* userData, NativeArgs args);
+
 // Callable function object
-class Function {
+class Function : public HeapObject {
 public:
     // User-defined function
     Function(const FunctionStmt* declaration, Environment* closure);
@@ -33,9 +69,24 @@ public:
     // Native/built-in function
     Function(const String& name, usize arity, NativeFunction fn);
 
+    // Fast native taking between minArity and maxArity arguments
+    Function(const String& name, usize minArity, usize maxArity, NativeFn fn, void* userData);
+
+    // Calls a native. Script functions only run inside their Interpreter or
+    // VM (see their callFunction); for those this throws.
     Value call(const std::vector<Value>& arguments, Environment* globals);
 
+    // Invoke a native without building an argument vector (for fast natives)
+    Value callNative(NativeArgs args) const;
+
+    // arity() counts the required arguments; maxArity() also counts the
+    // optional ones only fast natives take. The tree-walking interpreter
+    // passes exactly arity().
     usize arity() const { return m_arity; }
+    usize maxArity() const { return m_maxArity; }
+    bool acceptsArgCount(usize count) const { return count >= m_arity && count <= m_maxArity; }
+    // "Expected N arguments but got count", for a count acceptsArgCount() rejects
+    String arityError(usize count) const;
     const String& name() const { return m_name; }
     bool isNative() const { return m_isNative; }
     const FunctionStmt* getDeclaration() const { return m_declaration; }
@@ -44,6 +95,7 @@ public:
 private:
     String m_name;
     usize m_arity;
+    usize m_maxArity;
     bool m_isNative;
 
     // For user-defined functions
@@ -52,54 +104,105 @@ private:
 
     // For native functions
     NativeFunction m_nativeFunction;
+    NativeFn m_fastNative;
+    void* m_userData;
 };
 
-using FunctionType = std::shared_ptr<Function>;
+using FunctionType = Ref<Function>;
+
+// Array and Map types. Both are references: every Value holding the same
+// ArrayType or MapType sees its writes. Slices and snapshots are separate
+// objects sharing storage copy-on-write.
+using ArrayType = Ref<Array>;
+using MapType = Ref<Map>;
 
-// Array and Map types
-using ArrayType = std::shared_ptr<std::vector<Value>>;
-using MapType = std::shared_ptr<std::unordered_map<String, Value>>;
+// Typed arrays: contiguous primitive storage with no per-element type tag
+using Float64ArrayType = Ref<std::vector<f64>>;
+using Int64ArrayType = Ref<std::vector<i64>>;
 
-enum class ValueType {
+// Strings are immutable once boxed, so copies of a string Value share one
+// buffer. Only a buffer with a single owner is ever appended to (see concat).
+using StringType = Ref<String>;
+
+enum class ValueType : u8 {
     Nil,
     Boolean,
     Integer,
     Float,
     String,
     Array,
+    Float64Array,
+    Int64Array,
     Map,
     Function
 };
 
+// A script value: a one-byte type tag plus an 8-byte payload (16 bytes total).
+// Numbers and booleans are stored inline; strings, arrays, maps and functions
+// are intrusively refcounted heap objects, so copying a Value never deep-copies.
 class Value {
 public:
-    Value() : m_data(nullptr) {}
-    explicit Value(bool b) : m_data(b) {}
-    explicit Value(i64 i) : m_data(i) {}
-    explicit Value(f64 f) : m_data(f) {}
-    explicit Value(const String& s) : m_data(s) {}
-    explicit Value(const ArrayType& arr) : m_data(arr) {}
-    explicit Value(const MapType& map) : m_data(map) {}
-    explicit Value(const FunctionType& fn) : m_data(fn) {}
+    Value() : m_type(ValueType::Nil), m_int(0) {}
+    explicit Value(bool b) : m_type(ValueType::Boolean), m_int(0) { m_bool = b; }
+    explicit Value(i64 i) : m_type(ValueType::Integer), m_int(i) {}
+    explicit Value(f64 f) : m_type(ValueType::Float), m_float(f) {}
+    // New strings and typed arrays are charged to the current Heap, if any
+    explicit Value(const String& s);
+    explicit Value(String&& s);
+    explicit Value(const StringType& s) : m_type(ValueType::String), m_string(s) {}
+    // Arrays, maps and functions join the current Heap, if any (see heap.h)
+    explicit Value(const ArrayType& arr);
+    explicit Value(const Float64ArrayType& arr);
+    explicit Value(const Int64ArrayType& arr);
+    explicit Value(const MapType& map);
+    explicit Value(const FunctionType& fn);
 
-    // Create empty array
-    static Value createArray() {
-        return Value(std::make_shared<std::vector<Value>>());
+    Value(const Value& other) : m_type(ValueType::Nil), m_int(0) { copyFrom(other); }
+    Value(Value&& other) noexcept : m_type(ValueType::Nil), m_int(0) { moveFrom(other); }
+    ~Value() { destroy(); }
+
+    Value& operator=(const Value& other) {
+        if (!holdsObject() && !other.holdsObject()) {
+            m_type = other.m_type;
+            m_int = other.m_int;
+        } else if (this != &other) {
+            Value copy(other);
+            destroy();
+            moveFrom(copy);
+        }
+        return *this;
     }
 
-    // Create array from initializer list
-    static Value createArray(const std::vector<Value>& values) {
-        return Value(std::make_shared<std::vector<Value>>(values));
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            moveFrom(other);
+        }
+        return *this;
     }
 
+    // Create empty array
+    static Value createArray();
+
+    // Create array from a list of values; pass an rvalue to avoid the copy
+    static Value createArray(const std::vector<Value>& values);
+    static Value createArray(std::vector<Value>&& values);
+
     // Create empty map
-    static Value createMap() {
-        return Value(std::make_shared<std::unordered_map<String, Value>>());
-    }
+    static Value createMap();
 
-    ValueType getType() const;
+    ValueType getType() const { return m_type; }
     String toString() const;
 
+    // Appends what toString() returns, without building it separately first
+    void appendTo(String& out) const;
+
+    // Sets target to the string concatenation of a and b, as + does when
+    // either is a string. When target is a and holds the only reference to
+    // its buffer, as the result of an earlier + in the same expression does,
+    // b is appended in place: a chain of + builds one string, not one per +.
+    static void concat(const Value& a, const Value& b, Value& target);
+
     // Type conversion
     bool asBool() const;
     i64 asInteger() const;
@@ -107,14 +210,17 @@ public:
     String asString() const;
 
     // Type checking
-    bool isNil() const { return getType() == ValueType::Nil; }
-    bool isBool() const { return getType() == ValueType::Boolean; }
-    bool isInteger() const { return getType() == ValueType::Integer; }
-    bool isFloat() const { return getType() == ValueType::Float; }
-    bool isString() const { return getType() == ValueType::String; }
-    bool isArray() const { return getType() == ValueType::Array; }
-    bool isMap() const { return getType() == ValueType::Map; }
-    bool isFunction() const { return getType() == ValueType::Function; }
+    bool isNil() const { return m_type == ValueType::Nil; }
+    bool isBool() const { return m_type == ValueType::Boolean; }
+    bool isInteger() const { return m_type == ValueType::Integer; }
+    bool isFloat() const { return m_type == ValueType::Float; }
+    bool isString() const { return m_type == ValueType::String; }
+    bool isArray() const { return m_type == ValueType::Array; }
+    bool isFloat64Array() const { return m_type == ValueType::Float64Array; }
+    bool isInt64Array() const { return m_type == ValueType::Int64Array; }
+    bool isTypedArray() const { return isFloat64Array() || isInt64Array(); }
+    bool isMap() const { return m_type == ValueType::Map; }
+    bool isFunction() const { return m_type == ValueType::Function; }
     bool isNumber() const { return isInteger() || isFloat(); }
 
     // Array operations
@@ -124,6 +230,15 @@ public:
     void arrayPush(const Value& value);
     Value arrayPop();
 
+    // New array over [start, end) of this one, sharing its storage: O(1)
+    Value arraySlice(usize start, usize end) const;
+
+    // A new array or map with the current contents, sharing storage: O(1).
+    // Later writes to either side copy first, so iterating a snapshot is
+    // safe while the original changes. Typed arrays have no shared storage
+    // and are copied. Other values are returned as is.
+    Value snapshot() const;
+
     // Map operations
     usize mapSize() const;
     Value mapGet(const String& key) const;
@@ -131,18 +246,256 @@ public:
     bool mapHas(const String& key) const;
     void mapDelete(const String& key);
 
+    // Map operations with a pre-interned key; no string hashing
+    Value mapGet(Symbol key) const;
+    void mapSet(Symbol key, const Value& value);
+
     // Function operations
     FunctionType asFunction() const;
 
-    // Get raw data (for operations)
+    // Get raw data (for operations); throws if the Value holds another type
     template<typename T>
-    T get() const { return std::get<T>(m_data); }
+    const T& get() const;
+
+    // The shared string buffer itself, for callers that want to keep it alive cheaply
+    const StringType& getStringRef() const { expect(ValueType::String); return m_string; }
+
+private:
+    ValueType m_type;
+    union {
+        bool m_bool;
+        i64 m_int;
+        f64 m_float;
+        StringType m_string;
+        ArrayType m_array;
+        Float64ArrayType m_f64Array;
+        Int64ArrayType m_i64Array;
+        MapType m_map;
+        FunctionType m_function;
+    };
+
+    void expect(ValueType type) const {
+        if (m_type != type) {
+            throw std::runtime_error("Value type mismatch");
+        }
+    }
+
+    // Strings, arrays, maps and functions own a reference; the rest are plain bits
+    bool holdsObject() const { return m_type >= ValueType::String; }
+
+    void destroy() {
+        if (!holdsObject()) {
+            m_type = ValueType::Nil;
+            return;
+        }
+        switch (m_type) {
+            case ValueType::String: m_string.~StringType(); break;
+            case ValueType::Array: m_array.~ArrayType(); break;
+            case ValueType::Float64Array: m_f64Array.~Float64ArrayType(); break;
+            case ValueType::Int64Array: m_i64Array.~Int64ArrayType(); break;
+            case ValueType::Map: m_map.~MapType(); break;
+            case ValueType::Function: m_function.~FunctionType(); break;
+            default: break;
+        }
+        m_type = ValueType::Nil;
+    }
+
+    void copyFrom(const Value& other) {
+        if (!other.holdsObject()) {
+            m_type = other.m_type;
+            m_int = other.m_int;
+            return;
+        }
+        switch (other.m_type) {
+            case ValueType::String: new (&m_string) StringType(other.m_string); break;
+            case ValueType::Array: new (&m_array) ArrayType(other.m_array); break;
+            case ValueType::Float64Array: new (&m_f64Array) Float64ArrayType(other.m_f64Array); break;
+            case ValueType::Int64Array: new (&m_i64Array) Int64ArrayType(other.m_i64Array); break;
+            case ValueType::Map: new (&m_map) MapType(other.m_map); break;
+            case ValueType::Function: new (&m_function) FunctionType(other.m_function); break;
+            default: m_int = other.m_int; break;
+        }
+        m_type = other.m_type;
+    }
+
+    void moveFrom(Value& other) noexcept {
+        if (!other.holdsObject()) {
+            m_type = other.m_type;
+            m_int = other.m_int;
+            return;
+        }
+        switch (other.m_type) {
+            case ValueType::String: new (&m_string) StringType(std::move(other.m_string)); break;
+            case ValueType::Array: new (&m_array) ArrayType(std::move(other.m_array)); break;
+            case ValueType::Float64Array: new (&m_f64Array) Float64ArrayType(std::move(other.m_f64Array)); break;
+            case ValueType::Int64Array: new (&m_i64Array) Int64ArrayType(std::move(other.m_i64Array)); break;
+            case ValueType::Map: new (&m_map) MapType(std::move(other.m_map)); break;
+            case ValueType::Function: new (&m_function) FunctionType(std::move(other.m_function)); break;
+            default: m_int = other.m_int; break;
+        }
+        m_type = other.m_type;
+        other.destroy();
+    }
+};
+
+static_assert(sizeof(Value) == 16, "Value should be a tag plus one 8-byte payload");
+
+template<> inline const bool& Value::get<bool>() const { expect(ValueType::Boolean); return m_bool; }
+template<> inline const i64& Value::get<i64>() const { expect(ValueType::Integer); return m_int; }
+template<> inline const f64& Value::get<f64>() const { expect(ValueType::Float); return m_float; }
+template<> inline const String& Value::get<String>() const { expect(ValueType::String); return *m_string; }
+template<> inline const ArrayType& Value::get<ArrayType>() const { expect(ValueType::Array); return m_array; }
+template<> inline const Float64ArrayType& Value::get<Float64ArrayType>() const { expect(ValueType::Float64Array); return m_f64Array; }
+template<> inline const Int64ArrayType& Value::get<Int64ArrayType>() const { expect(ValueType::Int64Array); return m_i64Array; }
+template<> inline const MapType& Value::get<MapType>() const { expect(ValueType::Map); return m_map; }
+template<> inline const FunctionType& Value::get<FunctionType>() const { expect(ValueType::Function); return m_function; }
+
+// Storage of a script array. Values live in a shared buffer that slices and
+// snapshots reference in O(1); the first write through an Array whose buffer
+// is shared copies its own range first. Reads never copy.
+class Array : public HeapObject {
+public:
+    Array() : m_offset(0), m_size(0) {}
+    explicit Array(std::vector<Value>&& values);
+
+    usize size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const Value& operator[](usize index) const { return (*m_buffer)[m_offset + index]; }
+    const Value* begin() const { return m_buffer ? m_buffer->data() + m_offset : nullptr; }
+    const Value* end() const { return begin() + m_size; }
+    const Value& back() const { return (*this)[m_size - 1]; }
+
+    void set(usize index, Value value);
+    void push_back(Value value);
+    Value pop();
+    void reserve(usize capacity);
+
+    // [start, end) sharing this array's buffer; the bounds must be valid
+    Array slice(usize start, usize end) const;
+
+private:
+    friend class Heap;
+
+    Ref<std::vector<Value>> m_buffer;
+    usize m_offset;
+    usize m_size;
+
+    // Ensures the buffer is unshared and holds exactly this array's range
+    void makeWritable();
+};
+
+// Hidden class shared by every map that received the same keys in the same
+// order. A shape fixes the slot of each key, so a site that saw a shape once
+// can read the slot directly the next time instead of looking the key up.
+// Shapes are never freed, like Symbols.
+class Shape {
+public:
+    // The shape of an empty map
+    static const Shape* root();
+
+    // The shape reached by appending key; created on first use and shared
+    const Shape* withKey(Symbol key) const;
+
+    // Slot of key, or -1 if this shape does not have it
+    i32 find(Symbol key) const;
+
+    usize size() const { return m_keys.size(); }
+    Symbol keyAt(usize slot) const { return m_keys[slot]; }
 
 private:
-    using DataType = std::variant<std::nullptr_t, bool, i64, f64, String, ArrayType, MapType, FunctionType>;
-    DataType m_data;
+    std::vector<Symbol> m_keys;
+
+    mutable std::mutex m_mutex;
+    mutable std::unordered_map<Symbol, std::unique_ptr<Shape>, SymbolHash> m_transitions;
 };
 
+// String-keyed map with values stored in insertion order. Small maps are
+// described by a Shape; a map that grows past MAX_SHAPED_KEYS, has a key
+// erased or gets a runtime Symbol as a key switches to its own key index and
+// reports no shape from then on.
+// Copying a Map is O(1): the copies share storage until one of them writes.
+class Map : public HeapObject {
+public:
+    static constexpr usize MAX_SHAPED_KEYS = 32;
+
+    Map() : m_shape(Shape::root()) {}
+    Map(const Map& other) = default;
+    Map& operator=(const Map& other) = default;
+
+    // A map with a known shape; slots holds one value per key in shape order
+    Map(const Shape* shape, std::vector<Value>&& slots);
+
+    // nullptr if key is absent
+    const Value* find(Symbol key) const;
+    void set(Symbol key, Value value);
+    bool erase(Symbol key);
+
+    usize size() const { return m_storage ? m_storage->slots.size() : 0; }
+    bool empty() const { return size() == 0; }
+
+    // nullptr once the map has left shaped mode
+    const Shape* getShape() const { return m_shape; }
+
+    Symbol keyAt(usize slot) const { return m_shape ? m_shape->keyAt(slot) : m_storage->keys[slot]; }
+    const Value& slot(usize index) const { return m_storage->slots[index]; }
+
+private:
+    friend class Heap;
+
+    struct Storage {
+        Storage() = default;
+        Storage(const Storage& other);
+        Storage& operator=(const Storage&) = delete;
+        ~Storage();
+
+        std::vector<Value> slots;
+
+        // Dictionary mode only. Runtime keys are held while they are here.
+        std::vector<Symbol> keys;
+        std::unordered_map<Symbol, u32, SymbolHash> index;
+        bool hasRuntimeKeys = false;
+    };
+
+    const Shape* m_shape;
+    Ref<Storage> m_storage;  // null while empty
+
+    // Ensures the storage exists and is not shared with a snapshot
+    Storage& makeWritable();
+    void convertToDictionary();
+};
+
+inline Value::Value(const String& s) : m_type(ValueType::String), m_string(makeRef<String>(s)) {
+    Heap::noteCurrent(sizeof(String) + m_string->capacity());
+}
+
+inline Value::Value(String&& s) : m_type(ValueType::String), m_string(makeRef<String>(std::move(s))) {
+    Heap::noteCurrent(sizeof(String) + m_string->capacity());
+}
+
+inline Value::Value(const Float64ArrayType& arr) : m_type(ValueType::Float64Array), m_f64Array(arr) {
+    Heap::noteCurrent(sizeof(*arr) + arr->capacity() * sizeof(f64));
+}
+
+inline Value::Value(const Int64ArrayType& arr) : m_type(ValueType::Int64Array), m_i64Array(arr) {
+    Heap::noteCurrent(sizeof(*arr) + arr->capacity() * sizeof(i64));
+}
+
+inline Value::Value(const ArrayType& arr) : m_type(ValueType::Array), m_array(arr) {
+    Heap::adopt(m_array.get(), HeapKind::Array);
+}
+
+inline Value::Value(const MapType& map) : m_type(ValueType::Map), m_map(map) {
+    Heap::adopt(m_map.get(), HeapKind::Map);
+}
+
+inline Value::Value(const FunctionType& fn) : m_type(ValueType::Function), m_function(fn) {
+    Heap::adopt(m_function.get(), HeapKind::Function);
+}
+
+inline const Value& NativeArgs::operator[](usize index) const { return m_data[index]; }
+inline const Value* NativeArgs::end() const { return m_data + m_count; }
+
 } // namespace lang
 } // namespace oracon
 
@@ -3,15 +3,22 @@
 
 #include "oracon/lang/lexer/token.h"
 #include "oracon/core/types.h"
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 namespace oracon {
 namespace lang {
 
+// Scans a view of the source without copying it. Tokens are views into the
+// same source, so it must outlive them and any Program parsed from them.
 class Lexer {
 public:
-    explicit Lexer(const String& source, const String& filename = "<stdin>");
+    explicit Lexer(std::string_view source, std::string_view filename = "<stdin>");
+    explicit Lexer(const char* source, std::string_view filename = "<stdin>")
+        : Lexer(std::string_view(source), filename) {}
+
+    // A temporary string would be gone before the tokens are scanned
+    Lexer(String&& source, std::string_view filename = "<stdin>") = delete;
 
     std::vector<Token> tokenize();
     Token nextToken();
@@ -28,9 +35,8 @@ private:
     void skipWhitespace();
     void skipComment();
 
-    Token makeToken(TokenType type);
-    Token makeToken(TokenType type, const String& lexeme);
-    Token errorToken(const String& message);
+    Token makeToken(TokenType type); // text is the current source slice
+    Token errorToken(const String& message); // records message; text is the offending slice
 
     Token scanString();
     Token scanNumber();
@@ -40,14 +46,13 @@ private:
     bool isAlpha(char c) const;
     bool isAlphaNumeric(char c) const;
 
-    TokenType identifierType();
-    TokenType checkKeyword(usize start, usize length, const String& rest, TokenType type);
+    TokenType identifierType() const;
 
     void addError(const String& message);
 
 private:
-    String m_source;
-    String m_filename;
+    std::string_view m_source;
+    Symbol m_filename;
     usize m_start;
     usize m_current;
     u32 m_line;
@@ -55,8 +60,6 @@ private:
     u32 m_startColumn;
     bool m_hasError;
     std::vector<String> m_errors;
-
-    static const std::unordered_map<String, TokenType> s_keywords;
 };
 
 } // namespace lang
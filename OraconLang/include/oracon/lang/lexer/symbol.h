@@ -0,0 +1,75 @@
+#ifndef ORACON_LANG_LEXER_SYMBOL_H
+#define ORACON_LANG_LEXER_SYMBOL_H
+
+#include "oracon/core/types.h"
+#include <atomic>
+#include <string_view>
+
+namespace oracon {
+namespace lang {
+
+using core::String;
+using core::usize;
+
+// An interned string. Every distinct spelling maps to one process-wide entry,
+// so Symbols compare by pointer and carry their hash with them. Identifiers,
+// member names and map keys are Symbols. Spellings interned by the compiler or
+// the host live forever; a key that only appears at runtime, such as one
+// passed to Value::mapSet(String), gets a runtime entry that maps hold with
+// retain() and that is freed when the last of them lets go.
+class Symbol {
+public:
+    struct Entry {
+        String text;
+        usize hash;
+        mutable std::atomic<bool> permanent;
+        mutable usize holds; // runtime entries only; guarded by the table
+    };
+
+    Symbol() : m_entry(nullptr) {}
+
+    // Returns the Symbol for text, creating it on first use. The entry is
+    // permanent, and a runtime entry with the same spelling becomes so.
+    // Only a new spelling allocates; repeat lookups never copy text.
+    static Symbol intern(std::string_view text);
+
+    // Returns the Symbol for a key made at runtime, with one hold taken for
+    // the caller: a new spelling gets a runtime entry. Pair with release().
+    static Symbol acquire(std::string_view text);
+
+    // Returns the Symbol for text if it is interned or held, otherwise an
+    // empty Symbol. Lets lookups with a runtime string skip keys that cannot
+    // exist. Lookups take no exclusive lock.
+    static Symbol find(std::string_view text);
+
+    static usize getInternedCount();
+
+    // Holds a runtime entry alive; no-ops for permanent ones. Keep a runtime
+    // Symbol only while holding it, since its entry may be reused afterwards.
+    void retain() const;
+    void release() const;
+    bool isRuntime() const { return m_entry && !m_entry->permanent.load(std::memory_order_acquire); }
+
+    const String& str() const { return m_entry ? m_entry->text : s_empty; }
+    usize hash() const { return m_entry ? m_entry->hash : 0; }
+    bool isEmpty() const { return m_entry == nullptr; }
+
+    bool operator==(const Symbol& other) const { return m_entry == other.m_entry; }
+    bool operator!=(const Symbol& other) const { return m_entry != other.m_entry; }
+
+private:
+    explicit Symbol(const Entry* entry) : m_entry(entry) {}
+
+    const Entry* m_entry;
+
+    static const String s_empty;
+};
+
+struct SymbolHash {
+    usize operator()(const Symbol& symbol) const { return symbol.hash(); }
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_LEXER_SYMBOL_H
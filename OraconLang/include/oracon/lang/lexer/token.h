@@ -2,7 +2,9 @@
 #define ORACON_LANG_LEXER_TOKEN_H
 
 #include "oracon/core/types.h"
+#include "oracon/lang/lexer/symbol.h"
 #include <string>
+#include <string_view>
 #include <ostream>
 
 namespace oracon {
@@ -97,25 +99,34 @@ enum class TokenType {
     INVALID
 };
 
+// The file name is interned, so copying a location never copies a string
 struct SourceLocation {
-    String filename;
+    Symbol filename;
     u32 line;
     u32 column;
 
-    SourceLocation(const String& file = "", u32 ln = 1, u32 col = 1)
+    SourceLocation(Symbol file = Symbol(), u32 ln = 1, u32 col = 1)
         : filename(file), line(ln), column(col) {}
 };
 
+// A token's text is a view into the source it was scanned from, so lexing
+// copies nothing and the source must outlive its tokens and any AST built
+// from them. Only identifiers are interned, once, when the token is made;
+// literals and punctuation never enter the global symbol table. A STRING
+// token's text is the literal between its quotes with escapes still in place
+// (see unescapeString).
 class Token {
 public:
-    Token(TokenType type, const String& lexeme, const SourceLocation& loc)
+    Token(TokenType type, std::string_view lexeme, const SourceLocation& loc)
         : m_type(type)
         , m_lexeme(lexeme)
+        , m_symbol(type == TokenType::IDENTIFIER ? Symbol::intern(lexeme) : Symbol())
         , m_location(loc)
     {}
 
     TokenType getType() const { return m_type; }
-    const String& getLexeme() const { return m_lexeme; }
+    std::string_view getLexeme() const { return m_lexeme; }
+    Symbol getSymbol() const { return m_symbol; } // identifiers only
     const SourceLocation& getLocation() const { return m_location; }
 
     bool is(TokenType type) const { return m_type == type; }
@@ -132,12 +143,21 @@ public:
 
 private:
     TokenType m_type;
-    String m_lexeme;
+    std::string_view m_lexeme;
+    Symbol m_symbol;
     SourceLocation m_location;
 };
 
 const char* tokenTypeToString(TokenType type);
 
+// Keyword type for text, or IDENTIFIER if it is not a keyword.
+// A compile-time perfect hash: one table probe and at most one compare.
+TokenType lookupKeyword(std::string_view text);
+
+// Value of a STRING token's text: \n, \t, \r, \0 and a backslash before any
+// other character (such as \\ or \") resolved
+String unescapeString(std::string_view text);
+
 } // namespace lang
 } // namespace oracon
 
@@ -24,6 +24,7 @@ public:
 private:
     const std::vector<Token>& m_tokens;
     usize m_current;
+    Program* m_program; // the tree being built; owns the node arena
     bool m_hasError;
     std::vector<String> m_errors;
 
@@ -42,34 +43,41 @@ private:
     bool match(const std::vector<TokenType>& types);
     Token consume(TokenType type, const String& message);
 
+    // Allocate a node in the arena of the program being parsed
+    template<typename T, typename... Args>
+    NodePtr<T> make(Args&&... args) {
+        return m_program->make<T>(std::forward<Args>(args)...);
+    }
+
     // Statement parsing
-    UniquePtr<Stmt> declaration();
-    UniquePtr<Stmt> varDeclaration();
-    UniquePtr<Stmt> functionDeclaration(const String& kind);
-    UniquePtr<Stmt> classDeclaration();
-    UniquePtr<Stmt> statement();
-    UniquePtr<Stmt> exprStatement();
-    UniquePtr<Stmt> ifStatement();
-    UniquePtr<Stmt> whileStatement();
-    UniquePtr<Stmt> forStatement();
-    UniquePtr<Stmt> returnStatement();
-    UniquePtr<Stmt> breakStatement();
-    UniquePtr<Stmt> continueStatement();
-    UniquePtr<BlockStmt> blockStatement();
+    NodePtr<Stmt> declaration();
+    NodePtr<Stmt> varDeclaration();
+    NodePtr<Stmt> functionDeclaration(const String& kind);
+    NodePtr<Stmt> classDeclaration();
+    NodePtr<Stmt> statement();
+    NodePtr<Stmt> exprStatement();
+    NodePtr<Stmt> ifStatement();
+    NodePtr<Stmt> whileStatement();
+    NodePtr<Stmt> forStatement();
+    NodePtr<Stmt> returnStatement();
+    NodePtr<Stmt> breakStatement();
+    NodePtr<Stmt> continueStatement();
+    NodePtr<BlockStmt> blockStatement();
 
     // Expression parsing (by precedence)
-    UniquePtr<Expr> expression();
-    UniquePtr<Expr> assignment();
-    UniquePtr<Expr> logicalOr();
-    UniquePtr<Expr> logicalAnd();
-    UniquePtr<Expr> equality();
-    UniquePtr<Expr> comparison();
-    UniquePtr<Expr> term();
-    UniquePtr<Expr> factor();
-    UniquePtr<Expr> unary();
-    UniquePtr<Expr> power();
-    UniquePtr<Expr> postfix();
-    UniquePtr<Expr> primary();
+    NodePtr<Expr> expression();
+    NodePtr<Expr> assignment();
+    NodePtr<Expr> logicalOr();
+    NodePtr<Expr> logicalAnd();
+    NodePtr<Expr> equality();
+    NodePtr<Expr> comparison();
+    NodePtr<Expr> term();
+    NodePtr<Expr> factor();
+    NodePtr<Expr> unary();
+    NodePtr<Expr> power();
+    NodePtr<Expr> postfix();
+    NodePtr<Expr> primary();
+    NodePtr<Expr> literal(const Token& token);
 };
 
 } // namespace lang
@@ -8,6 +8,14 @@ namespace lang {
 
 void registerBuiltins(Environment& env);
 
+// Float64Array/Int64Array constructors and bulk math (float64Array, vadd,
+// vscale, vdot, vsum, vmin, vmax, ...); see src/runtime/typed_arrays.cpp
+void registerTypedArrayBuiltins(Environment& env);
+
+// slice and snapshot: O(1) copy-on-write views of arrays and maps;
+// see src/runtime/collections.cpp
+void registerCollectionBuiltins(Environment& env);
+
 } // namespace lang
 } // namespace oracon
 
@@ -0,0 +1,59 @@
+#ifndef ORACON_LANG_VM_CLOSURE_TIER_H
+#define ORACON_LANG_VM_CLOSURE_TIER_H
+
+#include "oracon/lang/compiler/compiler.h"
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+class VM;
+
+// One pre-decoded operation of a function running in the VM's closure tier.
+// A step covers one bytecode instruction, or several fused ones, with its
+// operands already resolved: a local slot, a constant or global bound by
+// address, or the value stack. fn runs the step and returns the next one,
+// or nullptr when the dispatcher must take over (return to the caller's
+// tier, suspend, error).
+struct ClosureStep {
+    using Fn = const ClosureStep* (*)(VM& vm, const ClosureStep* step);
+
+    union Operand {
+        u32 slot;             // frame slot of a local
+        const Value* value;   // constant, global or literal
+    };
+
+    Fn fn = nullptr;
+    // Bytecode position just past the instruction the step stands for, kept
+    // in the frame at safepoints so errors and samples report its line
+    const u8* ip = nullptr;
+    Operand a = {0};
+    Operand b = {0};
+    const ClosureStep* target = nullptr;   // jumps
+    mutable Value* global = nullptr;       // globals, bound on first use if not yet defined
+    Symbol name;                           // globals and members
+    const u8* keys = nullptr;              // BUILD_MAP: the name operands in the bytecode
+    u32 dest = 0;                          // local a fused store writes
+    u16 count = 0;                         // arguments, elements, scope slots, depth
+    u16 index = 0;                         // scope slot, function index
+    u16 site = NO_INLINE_CACHE;
+};
+
+// The closure-tier form of one FunctionProto, built by the VM once the
+// function is hot. Steps point into the proto's chunk and the VM's globals,
+// so it lives no longer than either.
+class ClosureCode {
+public:
+    explicit ClosureCode(std::vector<ClosureStep> steps) : m_steps(std::move(steps)) {}
+
+    const ClosureStep* entry() const { return m_steps.data(); }
+    usize size() const { return m_steps.size(); }
+
+private:
+    std::vector<ClosureStep> m_steps;
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_VM_CLOSURE_TIER_H
@@ -0,0 +1,195 @@
+#ifndef ORACON_LANG_VM_OPERATORS_H
+#define ORACON_LANG_VM_OPERATORS_H
+
+#include "oracon/lang/interpreter/value.h"
+#include <cmath>
+#include <limits>
+
+namespace oracon {
+namespace lang {
+namespace ops {
+
+// Semantics of the VM's arithmetic, comparison and equality opcodes, shared
+// by the bytecode loop, the closure tier and the tree-walking Interpreter so
+// they cannot drift apart.
+// apply() stores the result in out, which may alias an operand, and returns
+// nullptr; or returns the runtime error message and leaves out untouched.
+
+constexpr i64 I64_MIN = std::numeric_limits<i64>::min();
+constexpr i64 I64_MAX = std::numeric_limits<i64>::max();
+
+// Signed overflow is undefined, so integer operators check before computing
+inline bool addOverflows(i64 a, i64 b) {
+    return (b > 0 && a > I64_MAX - b) || (b < 0 && a < I64_MIN - b);
+}
+
+inline bool subtractOverflows(i64 a, i64 b) {
+    return (b < 0 && a > I64_MAX + b) || (b > 0 && a < I64_MIN + b);
+}
+
+inline bool multiplyOverflows(i64 a, i64 b) {
+    if (a > 0) {
+        return b > 0 ? a > I64_MAX / b : b < I64_MIN / a;
+    }
+    return b > 0 ? a < I64_MIN / b : (a != 0 && b < I64_MAX / a);
+}
+
+// An int and a float compare as floats, as ordering does; otherwise values
+// of different types are never equal. Containers compare by identity.
+inline bool valuesEqual(const Value& a, const Value& b) {
+    if (a.getType() != b.getType()) {
+        return a.isNumber() && b.isNumber() && a.asFloat() == b.asFloat();
+    }
+
+    switch (a.getType()) {
+        case ValueType::Nil: return true;
+        case ValueType::Boolean: return a.get<bool>() == b.get<bool>();
+        case ValueType::Integer: return a.get<i64>() == b.get<i64>();
+        case ValueType::Float: return a.get<f64>() == b.get<f64>();
+        case ValueType::String:
+            return a.getStringRef() == b.getStringRef() || a.get<String>() == b.get<String>();
+        case ValueType::Array: return a.get<ArrayType>() == b.get<ArrayType>();
+        case ValueType::Float64Array: return a.get<Float64ArrayType>() == b.get<Float64ArrayType>();
+        case ValueType::Int64Array: return a.get<Int64ArrayType>() == b.get<Int64ArrayType>();
+        case ValueType::Map: return a.get<MapType>() == b.get<MapType>();
+        case ValueType::Function: return a.get<FunctionType>() == b.get<FunctionType>();
+    }
+    return false;
+}
+
+struct Add {
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        if (a.isInteger() && b.isInteger()) {
+            if (addOverflows(a.get<i64>(), b.get<i64>())) return "Integer overflow";
+            out = Value(a.get<i64>() + b.get<i64>());
+        } else if (a.isNumber() && b.isNumber()) {
+            out = Value(a.asFloat() + b.asFloat());
+        } else if (a.isString() || b.isString()) {
+            // In place when out is a: a stack temporary, or `s = s + ...` on a local
+            Value::concat(a, b, out);
+        } else {
+            return "Operands must be numbers or strings";
+        }
+        return nullptr;
+    }
+};
+
+struct Subtract {
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        if (a.isInteger() && b.isInteger()) {
+            if (subtractOverflows(a.get<i64>(), b.get<i64>())) return "Integer overflow";
+            out = Value(a.get<i64>() - b.get<i64>());
+        } else if (a.isNumber() && b.isNumber()) {
+            out = Value(a.asFloat() - b.asFloat());
+        } else {
+            return "Operands must be numbers";
+        }
+        return nullptr;
+    }
+};
+
+struct Multiply {
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        if (a.isInteger() && b.isInteger()) {
+            if (multiplyOverflows(a.get<i64>(), b.get<i64>())) return "Integer overflow";
+            out = Value(a.get<i64>() * b.get<i64>());
+        } else if (a.isNumber() && b.isNumber()) {
+            out = Value(a.asFloat() * b.asFloat());
+        } else {
+            return "Operands must be numbers";
+        }
+        return nullptr;
+    }
+};
+
+struct Divide {
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        if (a.isInteger() && b.isInteger()) {
+            if (b.get<i64>() == 0) return "Division by zero";
+            if (a.get<i64>() == I64_MIN && b.get<i64>() == -1) return "Integer overflow";
+            out = Value(a.get<i64>() / b.get<i64>());
+        } else if (a.isNumber() && b.isNumber()) {
+            if (b.asFloat() == 0.0) return "Division by zero";
+            out = Value(a.asFloat() / b.asFloat());
+        } else {
+            return "Operands must be numbers";
+        }
+        return nullptr;
+    }
+};
+
+struct Modulo {
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        if (!a.isInteger() || !b.isInteger()) return "Operands must be integers";
+        if (b.get<i64>() == 0) return "Modulo by zero";
+        if (a.get<i64>() == I64_MIN && b.get<i64>() == -1) return "Integer overflow";
+        out = Value(a.get<i64>() % b.get<i64>());
+        return nullptr;
+    }
+};
+
+struct Power {
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        if (!a.isNumber() || !b.isNumber()) return "Operands must be numbers";
+        out = Value(std::pow(a.asFloat(), b.asFloat()));
+        return nullptr;
+    }
+};
+
+struct Negate {
+    static const char* apply(const Value& a, Value& out) {
+        if (a.isInteger()) {
+            if (a.get<i64>() == I64_MIN) return "Integer overflow";
+            out = Value(-a.get<i64>());
+        } else if (a.isFloat()) {
+            out = Value(-a.get<f64>());
+        } else {
+            return "Operand must be a number";
+        }
+        return nullptr;
+    }
+};
+
+// Comparisons also test() for a fused branch, without making a Value
+template<typename Compare>
+struct Comparison {
+    static const char* test(const Value& a, const Value& b, bool& result) {
+        if (a.isInteger() && b.isInteger()) {
+            result = Compare()(a.get<i64>(), b.get<i64>());
+        } else if (a.isNumber() && b.isNumber()) {
+            result = Compare()(a.asFloat(), b.asFloat());
+        } else {
+            return "Operands must be numbers";
+        }
+        return nullptr;
+    }
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        bool result;
+        if (const char* error = test(a, b, result)) return error;
+        out = Value(result);
+        return nullptr;
+    }
+};
+
+struct LessThan { template<typename T> bool operator()(T x, T y) const { return x < y; } };
+struct LessEqual { template<typename T> bool operator()(T x, T y) const { return x <= y; } };
+struct GreaterThan { template<typename T> bool operator()(T x, T y) const { return x > y; } };
+struct GreaterEqual { template<typename T> bool operator()(T x, T y) const { return x >= y; } };
+
+template<bool Equal>
+struct Equality {
+    static const char* test(const Value& a, const Value& b, bool& result) {
+        result = valuesEqual(a, b) == Equal;
+        return nullptr;
+    }
+    static const char* apply(const Value& a, const Value& b, Value& out) {
+        out = Value(valuesEqual(a, b) == Equal);
+        return nullptr;
+    }
+};
+
+} // namespace ops
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_VM_OPERATORS_H
@@ -0,0 +1,103 @@
+#ifndef ORACON_LANG_VM_PROFILER_H
+#define ORACON_LANG_VM_PROFILER_H
+
+#include "oracon/lang/compiler/compiler.h"
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+using core::u64;
+
+// Sampling profiler for scripts run on a VM. Attach one with
+// VM::setProfiler; while attached, the VM counts every call to a script
+// function and, at loop and call boundaries, records the call stack once
+// per sample interval of script execution time. Each sample is weighted
+// with the time that passed since the previous one, so the totals add up
+// to the time spent running scripts.
+//
+// A Profiler is not thread-safe. Give each VM its own and merge() them to
+// see several scripts together. It caches function lookups by FunctionProto
+// address: call forgetPrograms() or reset() when a program it has seen is
+// destroyed.
+class Profiler {
+public:
+    struct FunctionStats {
+        String name;
+        u64 calls = 0;
+        u64 selfNs = 0;    // sampled time with the function on top of the stack
+        u64 totalNs = 0;   // sampled time with the function anywhere on the stack
+    };
+
+    struct LineStats {
+        String function;
+        u32 line = 0;
+        u64 selfNs = 0;
+    };
+
+    // One stack frame handed to recordSample, outermost first
+    struct Frame {
+        const FunctionProto* proto;
+        u32 line;
+    };
+
+    explicit Profiler(f64 sampleIntervalMs = 1.0);
+
+    f64 getSampleIntervalMs() const { return m_sampleIntervalMs; }
+    u64 getSampleIntervalNs() const { return m_sampleIntervalNs; }
+
+    // Called by the VM
+    void recordCall(const FunctionProto* proto);
+    void recordSample(const std::vector<Frame>& stack, u64 weightNs);
+
+    // Adds another profiler's results to this one
+    void merge(const Profiler& other);
+    void reset();
+    // Drops cached proto addresses but keeps the results
+    void forgetPrograms() { m_protoIndex.clear(); }
+
+    u64 getSampleCount() const { return m_samples; }
+    u64 getSampledNs() const { return m_sampledNs; }
+
+    // Sorted by self time, highest first
+    std::vector<FunctionStats> getFunctions() const;
+    std::vector<LineStats> getLines() const;
+
+    // One line per distinct stack, "outer;inner;leaf <microseconds>", the
+    // input format of flamegraph.pl and compatible viewers
+    String toFoldedStacks() const;
+
+    // Plain-text table of the hottest functions and lines
+    String report(usize maxRows = 20) const;
+
+private:
+    f64 m_sampleIntervalMs;
+    u64 m_sampleIntervalNs;
+
+    // Functions are identified by name, so the same function in several
+    // VMs, or in a reloaded program, adds up. The proto index is a cache of
+    // the name lookup.
+    std::unordered_map<const FunctionProto*, usize> m_protoIndex;
+    std::unordered_map<String, usize> m_nameIndex;
+    std::vector<FunctionStats> m_functions;
+
+    std::map<std::pair<String, u32>, u64> m_lines;
+    std::map<String, u64> m_stacks;
+    u64 m_samples;
+    u64 m_sampledNs;
+
+    // Scratch for recordSample
+    std::vector<usize> m_seen;
+    String m_key;
+
+    FunctionStats& statsFor(const FunctionProto* proto);
+    FunctionStats& statsNamed(const String& name);
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_VM_PROFILER_H
@@ -0,0 +1,320 @@
+#ifndef ORACON_LANG_VM_VM_H
+#define ORACON_LANG_VM_VM_H
+
+#include "oracon/lang/compiler/compiler.h"
+#include "oracon/lang/interpreter/environment.h"
+#include "oracon/lang/interpreter/value.h"
+#include "oracon/lang/vm/closure_tier.h"
+#include "oracon/lang/vm/profiler.h"
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace oracon {
+namespace lang {
+
+// Selects how a script is executed: by walking the AST with Interpreter,
+// or by compiling it with Compiler and running the bytecode on a VM.
+// Components default to Bytecode; TreeWalk is opt-in.
+enum class ExecutionMode {
+    TreeWalk,
+    Bytecode
+};
+
+// Limits for one execute() or callFunction() call. A script that runs past
+// either is aborted with a runtime error reported through getErrors().
+// Fuel is charged one unit per loop iteration and per call, the only ways a
+// script can run for unbounded time. The heap limit applies to the VM's
+// whole heap, across calls; it is checked with the fuel, after collecting
+// garbage. Zero means unlimited.
+struct ExecutionBudget {
+    u64 fuel = 0;
+    f64 timeLimitMs = 0.0;
+    usize heapLimitBytes = 0;
+};
+
+// Stack-based virtual machine for programs produced by Compiler.
+// Mirrors the public surface of Interpreter so the two are interchangeable.
+class VM {
+public:
+    VM();
+    ~VM();
+
+    // Natives registered by the VM keep a pointer to it
+    VM(const VM&) = delete;
+    VM& operator=(const VM&) = delete;
+
+    void execute(const CompiledProgram* program);
+
+    // Replaces the running program with a new version of the same script
+    // without losing state. Only the new top level's declarations run:
+    // every top-level func is rebound, and a let or const is evaluated only
+    // if its global does not exist yet, or if its initializer is a literal,
+    // array or map of another type than the global's value (integers and
+    // floats count as one type). Other top-level statements are
+    // skipped, so they do not repeat their effects. Function values of
+    // the old version, stored in data or running as coroutines, call the new
+    // body of the top-level function with the same name and arity from then
+    // on. Nested functions of the old version, and frames already running
+    // it, keep running the old code. Every earlier program must outlive the
+    // VM. False on error.
+    bool reload(const CompiledProgram* program);
+
+    bool hasError() const { return m_hasError; }
+    const std::vector<String>& getErrors() const { return m_errors; }
+
+    // Access to global environment (for scripting API)
+    Environment& getGlobalEnv() { return m_globalEnv; }
+    const Environment& getGlobalEnv() const { return m_globalEnv; }
+
+    // Call a function by name from C++
+    Value callFunction(const String& name, const std::vector<Value>& arguments);
+    // Skips hashing the name; for hosts calling the same function every frame
+    Value callFunction(Symbol name, const std::vector<Value>& arguments);
+
+    // Applies to every later execute() and callFunction() call
+    void setBudget(const ExecutionBudget& budget) { m_budget = budget; }
+    const ExecutionBudget& getBudget() const { return m_budget; }
+
+    // Fuel charged by the most recent execute() or callFunction()
+    u64 getFuelUsed() const { return m_fuelUsed + (m_fuelWindow - m_fuelTick); }
+
+    // Attaches a profiler, or detaches it with nullptr. The VM does not own
+    // it. Without one, profiling costs nothing beyond a null check per call.
+    void setProfiler(Profiler* profiler);
+    Profiler* getProfiler() const { return m_profiler; }
+
+    // Frees reference cycles among the objects scripts created and the
+    // scopes only they kept alive. Runs on its own once the heap has grown
+    // enough; calling it between updates bounds the pause instead.
+    void collectGarbage();
+    HeapStats getHeapStats() const;
+
+    // Coroutines. Each runs on its own small stack and first runs at the next
+    // updateCoroutines(); scripts start them with startCoroutine(fn, ...).
+    // Inside one, yield(), wait(seconds) and waitUntil(fn) suspend it until
+    // the next update, until that much coroutine time has passed, or until
+    // fn() returns a truthy value.
+    void startCoroutine(const Value& function, const std::vector<Value>& arguments);
+
+    // Advances coroutine time and resumes every coroutine that is due. When
+    // none are, this is a single comparison.
+    void updateCoroutines(f64 deltaTime);
+
+    bool hasCoroutines() const { return !m_coroutines.empty(); }
+    usize getCoroutineCount() const { return m_coroutines.size(); }
+
+    // Closure tier. A script function called this many times is translated
+    // into pre-decoded steps (see closure_tier.h) and runs as those from its
+    // next call on. Zero keeps everything on bytecode.
+    static constexpr u32 TIER_UP_CALLS = 1000;
+    void setTierUpThreshold(u32 calls) { m_tierUpCalls = calls; }
+    u32 getTierUpThreshold() const { return m_tierUpCalls; }
+    usize getTieredFunctionCount() const;
+
+private:
+    friend class ClosureCompiler;
+
+    struct TierState {
+        u32 calls = 0;
+        bool failed = false;   // the function uses something the tier cannot translate
+        std::unique_ptr<ClosureCode> code;
+    };
+
+    // What one MEMBER_GET, INDEX_GET, CALL or BUILD_MAP site saw last time,
+    // so the common monomorphic case skips the generic lookup
+    struct InlineCache {
+        const Shape* shape = nullptr;          // receiver shape, or the shape a literal built
+        u32 slot = 0;                          // slot of the key in that shape
+        Value key;                             // INDEX_GET: last string key, held so its identity is stable
+        Symbol symbol;                         // INDEX_GET: that key interned
+        const FunctionStmt* callee = nullptr;  // CALL: last function declaration called
+        const FunctionProto* proto = nullptr;  // CALL: its compiled body
+        TierState* tier = nullptr;             // CALL: its closure-tier state
+    };
+
+    struct CallFrame {
+        const FunctionProto* proto;
+        const u8* ip;
+        Value* slots;
+        Environment* env;   // innermost scope Environment for captured variables
+        usize scopeBase;    // m_scopes size when the frame was entered
+        const ClosureStep* resume;   // next step of a closure-tier frame; nullptr on bytecode
+        InlineCache* caches;         // the inline caches of proto's program
+    };
+
+    // A suspended call stack. While a coroutine runs, its state is swapped
+    // with the VM's own stack, frames and scopes.
+    struct Coroutine {
+        std::unique_ptr<Value[]> stack;
+        Value* stackTop;
+        usize stackCapacity;
+        std::vector<CallFrame> frames;
+        std::vector<std::unique_ptr<Environment>> scopes;
+        usize escapedMark;
+
+        bool started;      // the function and arguments are still on the stack until then
+        u8 argCount;
+        f64 wakeTime;
+        Value condition;   // waitUntil function, or nil
+    };
+
+    static constexpr usize STACK_MAX = 16384;
+    static constexpr usize COROUTINE_STACK_SIZE = 2048;
+    static constexpr usize FRAMES_MAX = 256;
+    static constexpr usize FREE_SCOPES_MAX = 256;
+
+    // Fuel spent between two budget checks; bounds how often the clock is read
+    static constexpr u64 FUEL_CHECK_INTERVAL = 1024;
+    // Shorter interval while profiling, so samples land near their deadline
+    static constexpr u64 PROFILE_CHECK_INTERVAL = 64;
+
+    // Declared first so it outlives every Value the VM holds
+    Heap m_heap;
+
+    Environment m_globalEnv;
+    const CompiledProgram* m_program;
+
+    // Top-level functions of replaced programs, by declaration, and their
+    // body in the current one
+    std::unordered_map<const FunctionStmt*, const FunctionProto*> m_redirects;
+    // Programs run before m_program, newest last. Their nested functions and
+    // the suspended frames running them keep their own code and caches.
+    std::vector<const CompiledProgram*> m_retiredPrograms;
+    // The declaration-only top levels reload() ran; the profiler keys on them
+    std::vector<UniquePtr<FunctionProto>> m_reloadScripts;
+
+    std::unique_ptr<Value[]> m_stack;
+    Value* m_stackTop;
+    usize m_stackCapacity;
+    std::vector<CallFrame> m_frames;
+    // One table per program, indexed by its site numbers. Tables never
+    // resize, so frames hold a pointer into theirs.
+    std::unordered_map<const CompiledProgram*, std::vector<InlineCache>> m_inlineCaches;
+    InlineCache* m_programCaches;   // m_program's table
+
+    // Environments created by PUSH_SCOPE. Those below m_escapedMark may be
+    // referenced by a closure and are kept alive for the VM's lifetime.
+    std::vector<std::unique_ptr<Environment>> m_scopes;
+    usize m_escapedMark;
+    // Popped scopes no closure reached, emptied and kept for the next
+    // PUSH_SCOPE, so entering a block stops allocating once warmed up
+    std::vector<std::unique_ptr<Environment>> m_freeScopes;
+
+    std::vector<std::unique_ptr<Coroutine>> m_coroutines;
+    // Escaped scopes of finished coroutines; closures may still reach them
+    std::vector<std::unique_ptr<Environment>> m_retiredScopes;
+    Coroutine* m_running;      // nullptr on the main stack
+    bool m_suspendRequested;   // set by yield/wait/waitUntil, checked after each CALL
+    f64 m_time;
+    f64 m_nextWake;            // earliest time any coroutine can be due
+
+    bool m_hasError;
+    std::vector<String> m_errors;
+
+    // Closure tier state, keyed by proto
+    std::unordered_map<const FunctionProto*, TierState> m_tiers;
+    // Code of an earlier program that suspended frames may still be running
+    std::vector<std::unique_ptr<ClosureCode>> m_retiredCode;
+    u32 m_tierUpCalls;
+    // Registers of runSteps: the running frame's slots and how it ended
+    Value* m_stepSlots;
+    usize m_stepExitDepth;
+    bool m_stepFailed;
+    bool m_switchTier;   // the top frame runs in the other tier
+
+    // Budget state. The dispatch loop only decrements m_fuelTick; the limits
+    // are checked when it reaches zero.
+    ExecutionBudget m_budget;
+    u64 m_fuelUsed;    // charged in windows that have been checked
+    u64 m_fuelWindow;  // size of the current window
+    u64 m_fuelTick;    // fuel left in the current window
+    std::chrono::steady_clock::time_point m_deadline;
+
+    void startBudget();
+    // Closes the current window; false once a limit has been reached
+    bool checkBudget();
+
+    // Profiling state. Only script execution time counts towards the
+    // sample interval; the clock is paused between top-level calls.
+    Profiler* m_profiler;
+    std::chrono::steady_clock::time_point m_profileClock;
+    u64 m_profileElapsedNs;
+    std::vector<Profiler::Frame> m_profileStack;
+
+    // Called from checkBudget; samples the stack once the interval has passed
+    void profileSafepoint();
+    void pauseProfile();
+
+    // Runs script, the top level of program or a part of it, in the globals
+    void runScript(const CompiledProgram* program, const FunctionProto* script);
+
+    // Runs until the frame stack drops back to exitDepth, or a coroutine
+    // suspends, handing the top frame to whichever tier it runs in
+    bool run(usize exitDepth);
+    bool runBytecode(usize exitDepth);
+    bool runSteps(usize exitDepth);
+
+    // Translates proto for the closure tier; the entry step, or nullptr
+    const ClosureStep* tierUp(const FunctionProto* proto, TierState& tier);
+    // Forgets translated code when the program changes
+    void resetTiers();
+
+    // Calls callee on the current stack and runs it to completion
+    Value invoke(const Value& callee, const std::vector<Value>& arguments);
+
+    void switchStacks(Coroutine& coroutine);
+    // Runs until the coroutine suspends, returns or fails; false once it is finished
+    bool resume(Coroutine& coroutine);
+    // Called by the yield natives; throws outside a coroutine
+    void suspend(f64 wakeTime, const Value& condition);
+
+    void registerCoroutineBuiltins();
+    static Value nativeStartCoroutine(void* userData, NativeArgs args);
+    static Value nativeYield(void* userData, NativeArgs args);
+    static Value nativeWait(void* userData, NativeArgs args);
+    static Value nativeWaitUntil(void* userData, NativeArgs args);
+
+    bool callValue(const Value& callee, u8 argCount, InlineCache* cache = nullptr);
+    bool callNative(const FunctionType& function, u8 argCount);
+    // The compiled body of a function value, from whichever program declared it
+    const FunctionProto* findProto(const Function& function) const;
+    InlineCache* inlineCachesOf(const CompiledProgram* program);
+    // The running frame's cache for a site; nullptr for an uncached site
+    InlineCache* inlineCache(u16 site) {
+        return site != NO_INLINE_CACHE ? &m_frames.back().caches[site] : nullptr;
+    }
+    // Map reads through a site's cache (nullptr for none); nullptr for a missing key
+    const Value* getMember(const Map& map, Symbol key, InlineCache* cache);
+    const Value* getIndex(const Map& map, const Value& key, InlineCache* cache);
+    // INDEX_GET on any receiver; result may alias object. An error message, or nullptr
+    const char* indexValue(const Value& object, const Value& index, InlineCache* cache, Value& result);
+
+
+    void push(const Value& value) { *m_stackTop++ = value; }
+    void push(Value&& value) { *m_stackTop++ = std::move(value); }
+    Value pop() { return std::move(*--m_stackTop); }
+    Value& peek(usize distance) { return m_stackTop[-1 - static_cast<std::ptrdiff_t>(distance)]; }
+
+    // Drop frames and stack values above the given marks after an error
+    void unwind(usize frameDepth, Value* stackTop);
+
+    // PUSH_SCOPE and POP_SCOPE of a scope above the escaped mark, in both tiers
+    Environment* pushScope(Environment* parent, usize slotCount);
+    void popScope();
+    // Free scope Environments above base that no closure can reach
+    void releaseScopes(usize base);
+    // Removes collected scopes (dead is sorted) from one stack's list, keeping indices into it valid
+    static void removeScopes(std::vector<std::unique_ptr<Environment>>& scopes, usize& escapedMark,
+                             std::vector<CallFrame>& frames, const std::vector<Environment*>& dead);
+    // Collects if the heap has grown enough; false if it is still over the limit
+    bool checkHeap();
+
+    void runtimeError(const String& message);
+};
+
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_VM_VM_H
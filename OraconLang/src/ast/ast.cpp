@@ -0,0 +1,103 @@
+#include "oracon/lang/ast/ast.h"
+
+namespace oracon {
+namespace lang {
+
+// toString renders a node back as source, for diagnostics and the
+// optimizer's rewrite log. Parentheses appear only where the source had them.
+
+namespace {
+
+String joined(const std::vector<NodePtr<Expr>>& exprs) {
+    String out;
+    for (usize i = 0; i < exprs.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += exprs[i]->toString();
+    }
+    return out;
+}
+
+} // namespace
+
+String LiteralExpr::toString() const {
+    if (m_token.is(TokenType::STRING)) {
+        return "\"" + String(m_token.getLexeme()) + "\"";
+    }
+    return String(m_token.getLexeme());
+}
+
+String UnaryExpr::toString() const {
+    String op(m_operator.getLexeme());
+    // Keyword operators need a space before their operand
+    return m_operator.is(TokenType::NOT) && op == "not" ? op + " " + m_operand->toString()
+                                                        : op + m_operand->toString();
+}
+
+String BinaryExpr::toString() const {
+    return m_left->toString() + " " + String(m_operator.getLexeme()) + " " + m_right->toString();
+}
+
+String GroupingExpr::toString() const {
+    return "(" + m_expr->toString() + ")";
+}
+
+String AssignmentExpr::toString() const {
+    return String(m_name.getLexeme()) + " = " + m_value->toString();
+}
+
+String LogicalExpr::toString() const {
+    return m_left->toString() + " " + String(m_operator.getLexeme()) + " " + m_right->toString();
+}
+
+String CallExpr::toString() const {
+    return m_callee->toString() + "(" + joined(m_arguments) + ")";
+}
+
+String ArrayExpr::toString() const {
+    return "[" + joined(m_elements) + "]";
+}
+
+String IndexExpr::toString() const {
+    return m_object->toString() + "[" + m_index->toString() + "]";
+}
+
+String MemberExpr::toString() const {
+    return m_object->toString() + "." + String(m_member.getLexeme());
+}
+
+String MapExpr::toString() const {
+    String out = "{";
+    for (usize i = 0; i < m_pairs.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += m_pairs[i].first + ": " + m_pairs[i].second->toString();
+    }
+    return out + "}";
+}
+
+String ExprStmt::toString() const {
+    return m_expr->toString() + ";";
+}
+
+String VarDeclStmt::toString() const {
+    String out = (m_isConst ? "const " : "let ") + String(m_name.getLexeme());
+    if (m_initializer) {
+        out += " = " + m_initializer->toString();
+    }
+    return out + ";";
+}
+
+String FunctionStmt::toString() const {
+    String out = "func " + String(m_name.getLexeme()) + "(";
+    for (usize i = 0; i < m_parameters.size(); ++i) {
+        if (i > 0) out += ", ";
+        out += String(m_parameters[i].getLexeme());
+    }
+    return out + ")";
+}
+
+String ClassStmt::toString() const {
+    return "class " + String(m_name.getLexeme());
+}
+
+} // namespace lang
+} // namespace oracon
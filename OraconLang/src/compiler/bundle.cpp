@@ -0,0 +1,663 @@
+#include "oracon/lang/compiler/bundle.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string_view>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+const char MAGIC[4] = {'O', 'R', 'C', 'B'};
+
+enum ConstantTag : u8 {
+    TAG_NIL,
+    TAG_BOOL,
+    TAG_INTEGER,
+    TAG_FLOAT,
+    TAG_STRING
+};
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<u8>& out) : m_out(out) {}
+
+    void byte(u8 value) { m_out.push_back(value); }
+
+    void u32le(u32 value) {
+        for (int i = 0; i < 4; ++i) {
+            m_out.push_back(static_cast<u8>(value >> (8 * i)));
+        }
+    }
+
+    void u64le(u64 value) {
+        for (int i = 0; i < 8; ++i) {
+            m_out.push_back(static_cast<u8>(value >> (8 * i)));
+        }
+    }
+
+    void string(std::string_view text) {
+        u32le(static_cast<u32>(text.size()));
+        m_out.insert(m_out.end(), text.begin(), text.end());
+    }
+
+    void bytes(const u8* data, usize size) {
+        u32le(static_cast<u32>(size));
+        m_out.insert(m_out.end(), data, data + size);
+    }
+
+private:
+    std::vector<u8>& m_out;
+};
+
+// Reads from a bounded range; once a read runs past the end every later
+// read returns zero and failed() stays set
+class ByteReader {
+public:
+    ByteReader(const u8* data, usize size) : m_data(data), m_size(size), m_pos(0), m_failed(false) {}
+
+    bool failed() const { return m_failed; }
+    usize remaining() const { return m_size - m_pos; }
+
+    const u8* take(usize count) {
+        if (m_failed || count > m_size - m_pos) {
+            m_failed = true;
+            return nullptr;
+        }
+        const u8* at = m_data + m_pos;
+        m_pos += count;
+        return at;
+    }
+
+    u8 byte() {
+        const u8* at = take(1);
+        return at ? *at : 0;
+    }
+
+    u32 u32le() {
+        const u8* at = take(4);
+        if (!at) return 0;
+        u32 value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<u32>(at[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    u64 u64le() {
+        const u8* at = take(8);
+        if (!at) return 0;
+        u64 value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<u64>(at[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    std::string_view string() {
+        u32 length = u32le();
+        const u8* at = take(length);
+        return at ? std::string_view(reinterpret_cast<const char*>(at), length) : std::string_view();
+    }
+
+private:
+    const u8* m_data;
+    usize m_size;
+    usize m_pos;
+    bool m_failed;
+};
+
+u16 readOperand(const u8* at) {
+    return static_cast<u16>((at[0] << 8) | at[1]);
+}
+
+// The VM indexes pools, slots and caches with instruction operands without
+// checking them, so a loaded chunk must only refer to what exists. Returns
+// what is wrong, or nullptr. Runs after computeMaxStack has checked the
+// instructions themselves.
+const char* checkOperands(const Chunk& chunk, usize maxStack, u32 functionCount, u32 cacheCount) {
+    const u8* code = chunk.getCode();
+    const usize constants = chunk.getConstants().size();
+    const usize names = chunk.getNames().size();
+    auto badCache = [cacheCount](u16 site) { return site != NO_INLINE_CACHE && site >= cacheCount; };
+
+    for (usize offset = 0; offset < chunk.size();) {
+        usize length = chunk.instructionLength(offset);
+        if (length == 0 || length > chunk.size() - offset) return "malformed bytecode";
+        const u8* operands = code + offset + 1;
+
+        switch (static_cast<OpCode>(code[offset])) {
+            case OpCode::CONSTANT:
+                if (readOperand(operands) >= constants) return "constant index out of range";
+                break;
+            case OpCode::GET_LOCAL:
+            case OpCode::SET_LOCAL:
+                if (readOperand(operands) >= maxStack) return "local slot out of range";
+                break;
+            case OpCode::GET_GLOBAL:
+            case OpCode::SET_GLOBAL:
+            case OpCode::DEFINE_GLOBAL:
+                if (readOperand(operands) >= names) return "name index out of range";
+                break;
+            case OpCode::MEMBER_GET:
+                if (readOperand(operands) >= names) return "name index out of range";
+                if (badCache(readOperand(operands + 2))) return "inline cache out of range";
+                break;
+            case OpCode::BUILD_MAP: {
+                u16 pairs = readOperand(operands);
+                if (badCache(readOperand(operands + 2))) return "inline cache out of range";
+                for (u16 k = 0; k < pairs; ++k) {
+                    if (readOperand(operands + 4 + 2 * k) >= names) return "name index out of range";
+                }
+                break;
+            }
+            case OpCode::CALL:
+                if (badCache(readOperand(operands + 1))) return "inline cache out of range";
+                break;
+            case OpCode::INDEX_GET:
+                if (badCache(readOperand(operands))) return "inline cache out of range";
+                break;
+            case OpCode::FUNCTION: {
+                // Function 0 is the top-level script, which is never a value
+                u16 index = readOperand(operands);
+                if (index == 0 || index >= functionCount) return "function index out of range";
+                break;
+            }
+            default:
+                break;
+        }
+        offset += length;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+// ===== BundleWriter =====
+
+bool BundleWriter::add(const String& name, const CompiledProgram& program) {
+    std::vector<u8> data;
+    ByteWriter out(data);
+
+    out.u32le(static_cast<u32>(program.getInlineCacheCount()));
+    out.u32le(static_cast<u32>(program.getFunctionCount()));
+
+    for (usize i = 0; i < program.getFunctionCount(); ++i) {
+        const FunctionProto* proto = program.getFunction(i);
+        const FunctionStmt* declaration = proto->declaration;
+
+        out.string(proto->name);
+        out.u32le(declaration ? declaration->getName().getLocation().line : 0);
+        if (declaration) {
+            out.u32le(static_cast<u32>(declaration->getParameters().size()));
+            for (const auto& param : declaration->getParameters()) {
+                out.string(param.getLexeme());
+            }
+        } else {
+            out.u32le(0);
+        }
+
+        const Chunk& chunk = proto->chunk;
+        out.bytes(chunk.getCode(), chunk.size());
+
+        const auto& runs = chunk.getLineRuns();
+        out.u32le(static_cast<u32>(runs.size()));
+        u32 start = 0;
+        for (const auto& run : runs) {
+            out.u32le(run.end - start);
+            out.u32le(run.line);
+            start = run.end;
+        }
+
+        out.u32le(static_cast<u32>(chunk.getConstants().size()));
+        for (const Value& constant : chunk.getConstants()) {
+            switch (constant.getType()) {
+                case ValueType::Nil:
+                    out.byte(TAG_NIL);
+                    break;
+                case ValueType::Boolean:
+                    out.byte(TAG_BOOL);
+                    out.byte(constant.get<bool>() ? 1 : 0);
+                    break;
+                case ValueType::Integer:
+                    out.byte(TAG_INTEGER);
+                    out.u64le(static_cast<u64>(constant.get<i64>()));
+                    break;
+                case ValueType::Float: {
+                    f64 number = constant.get<f64>();
+                    u64 bits;
+                    std::memcpy(&bits, &number, sizeof(bits));
+                    out.byte(TAG_FLOAT);
+                    out.u64le(bits);
+                    break;
+                }
+                case ValueType::String:
+                    out.byte(TAG_STRING);
+                    out.string(constant.get<String>());
+                    break;
+                default:
+                    m_errors.push_back(name + ": cannot store a " + constant.toString() +
+                                       " constant in " + proto->name);
+                    return false;
+            }
+        }
+
+        out.u32le(static_cast<u32>(chunk.getNames().size()));
+        for (const Symbol& symbol : chunk.getNames()) {
+            out.string(symbol.str());
+        }
+    }
+
+    out.u32le(static_cast<u32>(program.getGlobalDeclarations().size()));
+    for (const GlobalDeclaration& global : program.getGlobalDeclarations()) {
+        out.string(global.name.str());
+        out.u32le(global.start);
+        out.u32le(global.end);
+        out.byte(global.isFunction ? 1 : 0);
+        out.byte(static_cast<u8>(global.type));
+    }
+
+    for (auto& entry : m_programs) {
+        if (entry.name == name) {
+            entry.data = std::move(data);
+            return true;
+        }
+    }
+    m_programs.push_back({name, std::move(data)});
+    return true;
+}
+
+std::vector<u8> BundleWriter::serialize() const {
+    std::vector<u8> data(MAGIC, MAGIC + sizeof(MAGIC));
+    ByteWriter out(data);
+    out.u32le(VERSION);
+    out.u32le(static_cast<u32>(m_programs.size()));
+
+    // The directory's size is known up front, so offsets can be written in one pass
+    usize offset = data.size();
+    for (const auto& entry : m_programs) {
+        offset += 4 + entry.name.size() + 8 + 8;
+    }
+    for (const auto& entry : m_programs) {
+        out.string(entry.name);
+        out.u64le(offset);
+        out.u64le(entry.data.size());
+        offset += entry.data.size();
+    }
+
+    for (const auto& entry : m_programs) {
+        data.insert(data.end(), entry.data.begin(), entry.data.end());
+    }
+    return data;
+}
+
+bool BundleWriter::write(const String& path) {
+    std::vector<u8> data = serialize();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        m_errors.push_back("Failed to open " + path + " for writing");
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        m_errors.push_back("Failed to write " + path);
+        return false;
+    }
+    return true;
+}
+
+// ===== ScriptBundle =====
+
+ScriptBundle::ScriptBundle()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_mapping(nullptr)
+{}
+
+ScriptBundle::~ScriptBundle() {
+    close();
+}
+
+bool ScriptBundle::open(const String& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        addError("Failed to open bundle: " + path);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        addError("Empty or unreadable bundle: " + path);
+        return false;
+    }
+
+    // The mapping keeps the file open on its own
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        addError("Failed to map bundle: " + path);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        addError("Failed to map bundle: " + path);
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_data = static_cast<const u8*>(view);
+    m_size = static_cast<usize>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        addError("Failed to open bundle: " + path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        addError("Empty or unreadable bundle: " + path);
+        return false;
+    }
+
+    // The mapping keeps the file open on its own
+    usize size = static_cast<usize>(info.st_size);
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        addError("Failed to map bundle: " + path);
+        return false;
+    }
+
+    m_data = static_cast<const u8*>(view);
+    m_size = size;
+#endif
+
+    if (!readDirectory()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ScriptBundle::close() {
+    m_directory.clear();
+    if (!m_data) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+#else
+    munmap(const_cast<u8*>(m_data), m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+}
+
+bool ScriptBundle::readDirectory() {
+    ByteReader in(m_data, m_size);
+
+    const u8* magic = in.take(sizeof(MAGIC));
+    if (!magic || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        addError("Not a script bundle");
+        return false;
+    }
+
+    u32 version = in.u32le();
+    if (version != BundleWriter::VERSION) {
+        addError("Unsupported script bundle version " + std::to_string(version));
+        return false;
+    }
+
+    u32 count = in.u32le();
+    for (u32 i = 0; i < count && !in.failed(); ++i) {
+        String name(in.string());
+        u64 offset = in.u64le();
+        u64 size = in.u64le();
+        if (offset > m_size || size > m_size - offset) {
+            addError("Script bundle entry " + name + " lies outside the file");
+            return false;
+        }
+
+        Entry& entry = m_directory[name];
+        entry.offset = static_cast<usize>(offset);
+        entry.size = static_cast<usize>(size);
+    }
+
+    if (in.failed()) {
+        addError("Truncated script bundle directory");
+        return false;
+    }
+    return true;
+}
+
+const CompiledProgram* ScriptBundle::find(const String& name) const {
+    auto it = m_directory.find(name);
+    if (it == m_directory.end()) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry& entry = it->second;
+    if (!entry.decoded) {
+        entry.program = decode(name, entry);
+        entry.decoded = true;
+    }
+    return entry.program.get();
+}
+
+std::vector<String> ScriptBundle::getNames() const {
+    std::vector<String> names;
+    names.reserve(m_directory.size());
+    for (const auto& entry : m_directory) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+UniquePtr<CompiledProgram> ScriptBundle::decode(const String& name, const Entry& entry) const {
+    ByteReader in(m_data + entry.offset, entry.size);
+
+    auto program = std::make_unique<CompiledProgram>();
+    program->m_declarations = std::make_unique<Program>();
+    Symbol filename = Symbol::intern(name);
+
+    u32 cacheCount = in.u32le();
+    if (cacheCount > NO_INLINE_CACHE) {
+        m_errors.push_back(name + ": bad inline cache count");
+        return nullptr;
+    }
+    program->m_inlineCacheCount = cacheCount;
+    u32 functionCount = in.u32le();
+    if (functionCount == 0 || functionCount > std::numeric_limits<u16>::max() + 1u) {
+        m_errors.push_back(name + ": bad function count");
+        return nullptr;
+    }
+
+    for (u32 i = 0; i < functionCount && !in.failed(); ++i) {
+        auto proto = std::make_unique<FunctionProto>();
+        proto->program = program.get();
+        proto->name = String(in.string());
+        u32 line = in.u32le();
+
+        u32 paramCount = in.u32le();
+        std::vector<Token> params;
+        for (u32 p = 0; p < paramCount && !in.failed(); ++p) {
+            params.emplace_back(TokenType::IDENTIFIER, in.string(), SourceLocation(filename, line, 1));
+        }
+        proto->arity = paramCount;
+
+        Chunk& chunk = proto->chunk;
+        // The code stays in the mapping, which outlives every decoded program
+        u32 codeSize = in.u32le();
+        chunk.m_mappedCode = in.take(codeSize);
+        chunk.m_mappedSize = chunk.m_mappedCode ? codeSize : 0;
+
+        u32 runCount = in.u32le();
+        chunk.m_lines.reserve(std::min<usize>(runCount, in.remaining() / 8));
+        u32 covered = 0;
+        for (u32 r = 0; r < runCount && !in.failed(); ++r) {
+            u32 length = in.u32le();
+            u32 runLine = in.u32le();
+            if (length > codeSize - covered) {
+                m_errors.push_back(name + ": line table longer than the code");
+                return nullptr;
+            }
+            covered += length;
+            chunk.m_lines.push_back({covered, runLine});
+        }
+
+        // Every count read below is bounded by the bytes left, so a corrupt
+        // count cannot make the loops run long before the reader fails
+        u32 constantCount = in.u32le();
+        chunk.m_constants.reserve(std::min<usize>(constantCount, in.remaining()));
+        for (u32 c = 0; c < constantCount && !in.failed(); ++c) {
+            switch (in.byte()) {
+                case TAG_NIL:
+                    chunk.m_constants.emplace_back();
+                    break;
+                case TAG_BOOL:
+                    chunk.m_constants.emplace_back(in.byte() != 0);
+                    break;
+                case TAG_INTEGER:
+                    chunk.m_constants.emplace_back(static_cast<i64>(in.u64le()));
+                    break;
+                case TAG_FLOAT: {
+                    u64 bits = in.u64le();
+                    f64 number;
+                    std::memcpy(&number, &bits, sizeof(number));
+                    chunk.m_constants.emplace_back(number);
+                    break;
+                }
+                case TAG_STRING:
+                    chunk.m_constants.emplace_back(String(in.string()));
+                    break;
+                default:
+                    m_errors.push_back(name + ": unknown constant tag");
+                    return nullptr;
+            }
+        }
+
+        proto->maxStack = chunk.computeMaxStack(proto->arity + 1);
+        if (proto->maxStack == 0 && !in.failed()) {
+            m_errors.push_back(name + ": malformed bytecode in " + proto->name);
+            return nullptr;
+        }
+
+        u32 nameCount = in.u32le();
+        chunk.m_names.reserve(std::min<usize>(nameCount, in.remaining()));
+        for (u32 n = 0; n < nameCount && !in.failed(); ++n) {
+            chunk.m_names.push_back(Symbol::intern(in.string()));
+        }
+
+        if (in.failed()) break;
+        if (const char* error = checkOperands(chunk, proto->maxStack, functionCount, cacheCount)) {
+            m_errors.push_back(name + ": " + error + " in " + proto->name);
+            return nullptr;
+        }
+
+        // Functions need a declaration: it names them and keys the VM's lookup
+        if (i > 0) {
+            Program& declarations = *program->m_declarations;
+            Token fnName(TokenType::IDENTIFIER, proto->name, SourceLocation(filename, line, 1));
+            auto body = declarations.make<BlockStmt>(std::vector<NodePtr<Stmt>>());
+            auto declaration = declarations.make<FunctionStmt>(fnName, std::move(params), std::move(body));
+            proto->declaration = declaration.get();
+            program->m_byDeclaration[declaration.get()] = proto.get();
+            declarations.addStatement(std::move(declaration));
+        }
+
+        program->m_functions.push_back(std::move(proto));
+    }
+
+    if (in.failed()) {
+        m_errors.push_back(name + ": truncated program");
+        return nullptr;
+    }
+
+    // Each declaration must cover whole instructions of the script and end
+    // by binding its global, since reload() runs the ranges on their own
+    const Chunk& script = program->m_functions.front()->chunk;
+    std::vector<bool> boundaries(script.size() + 1, false);
+    for (usize offset = 0; offset < script.size(); offset += script.instructionLength(offset)) {
+        boundaries[offset] = true;
+    }
+    boundaries[script.size()] = true;
+
+    u32 globalCount = in.u32le();
+    program->m_globals.reserve(std::min<usize>(globalCount, in.remaining()));
+    for (u32 g = 0; g < globalCount && !in.failed(); ++g) {
+        GlobalDeclaration global;
+        global.name = Symbol::intern(in.string());
+        global.start = in.u32le();
+        global.end = in.u32le();
+        global.isFunction = in.byte() != 0;
+        u8 type = in.byte();
+        if (type > static_cast<u8>(ValueType::Function)) {
+            m_errors.push_back(name + ": bad global declaration " + global.name.str());
+            return nullptr;
+        }
+        global.type = static_cast<ValueType>(type);
+        if (in.failed()) break;
+
+        u32 bind = global.end - 3;
+        if (global.start > global.end || global.end > script.size() || global.end - global.start < 3 ||
+            !boundaries[global.start] || !boundaries[bind] || script.getCode()[bind] != static_cast<u8>(OpCode::DEFINE_GLOBAL) ||
+            script.getNames()[readOperand(script.getCode() + bind + 1)] != global.name) {
+            m_errors.push_back(name + ": bad global declaration " + global.name.str());
+            return nullptr;
+        }
+        program->m_globals.push_back(global);
+    }
+
+    if (in.failed()) {
+        m_errors.push_back(name + ": truncated program");
+        return nullptr;
+    }
+    return program;
+}
+
+bool ScriptBundle::hasError() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_errors.empty();
+}
+
+std::vector<String> ScriptBundle::getErrors() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_errors;
+}
+
+void ScriptBundle::addError(const String& message) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_errors.push_back(message);
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,371 @@
+#include "oracon/lang/compiler/chunk.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace oracon {
+namespace lang {
+
+const char* opCodeToString(OpCode op) {
+    switch (op) {
+        case OpCode::CONSTANT: return "CONSTANT";
+        case OpCode::NIL: return "NIL";
+        case OpCode::TRUE: return "TRUE";
+        case OpCode::FALSE: return "FALSE";
+        case OpCode::POP: return "POP";
+        case OpCode::GET_LOCAL: return "GET_LOCAL";
+        case OpCode::SET_LOCAL: return "SET_LOCAL";
+        case OpCode::GET_GLOBAL: return "GET_GLOBAL";
+        case OpCode::SET_GLOBAL: return "SET_GLOBAL";
+        case OpCode::DEFINE_GLOBAL: return "DEFINE_GLOBAL";
+        case OpCode::GET_SCOPED: return "GET_SCOPED";
+        case OpCode::SET_SCOPED: return "SET_SCOPED";
+        case OpCode::DEFINE_SCOPED: return "DEFINE_SCOPED";
+        case OpCode::PUSH_SCOPE: return "PUSH_SCOPE";
+        case OpCode::POP_SCOPE: return "POP_SCOPE";
+        case OpCode::ADD: return "ADD";
+        case OpCode::SUBTRACT: return "SUBTRACT";
+        case OpCode::MULTIPLY: return "MULTIPLY";
+        case OpCode::DIVIDE: return "DIVIDE";
+        case OpCode::MODULO: return "MODULO";
+        case OpCode::POWER: return "POWER";
+        case OpCode::NEGATE: return "NEGATE";
+        case OpCode::POSITIVE: return "POSITIVE";
+        case OpCode::NOT: return "NOT";
+        case OpCode::EQUAL: return "EQUAL";
+        case OpCode::NOT_EQUAL: return "NOT_EQUAL";
+        case OpCode::LESS: return "LESS";
+        case OpCode::LESS_EQUAL: return "LESS_EQUAL";
+        case OpCode::GREATER: return "GREATER";
+        case OpCode::GREATER_EQUAL: return "GREATER_EQUAL";
+        case OpCode::JUMP: return "JUMP";
+        case OpCode::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case OpCode::LOOP: return "LOOP";
+        case OpCode::CALL: return "CALL";
+        case OpCode::RETURN: return "RETURN";
+        case OpCode::BUILD_ARRAY: return "BUILD_ARRAY";
+        case OpCode::BUILD_MAP: return "BUILD_MAP";
+        case OpCode::INDEX_GET: return "INDEX_GET";
+        case OpCode::MEMBER_GET: return "MEMBER_GET";
+        case OpCode::FUNCTION: return "FUNCTION";
+        default: return "UNKNOWN";
+    }
+}
+
+void Chunk::write(u8 byte, u32 line) {
+    m_code.push_back(byte);
+    if (!m_lines.empty() && m_lines.back().line == line) {
+        m_lines.back().end = static_cast<u32>(m_code.size());
+    } else {
+        m_lines.push_back({static_cast<u32>(m_code.size()), line});
+    }
+}
+
+void Chunk::clearCode() {
+    m_code.clear();
+    m_mappedCode = nullptr;
+    m_mappedSize = 0;
+    m_lines.clear();
+}
+
+usize Chunk::addConstant(const Value& value) {
+    m_constants.push_back(value);
+    return m_constants.size() - 1;
+}
+
+usize Chunk::addName(Symbol name) {
+    for (usize i = 0; i < m_names.size(); ++i) {
+        if (m_names[i] == name) {
+            return i;
+        }
+    }
+    m_names.push_back(name);
+    return m_names.size() - 1;
+}
+
+u32 Chunk::getLine(usize offset) const {
+    auto run = std::upper_bound(m_lines.begin(), m_lines.end(), offset,
+                                [](usize at, const LineRun& r) { return at < r.end; });
+    if (run == m_lines.end()) {
+        return m_lines.empty() ? 0 : m_lines.back().line;
+    }
+    return run->line;
+}
+
+namespace {
+
+u16 readShort(const u8* at) {
+    return static_cast<u16>((at[0] << 8) | at[1]);
+}
+
+} // namespace
+
+usize Chunk::instructionLength(usize offset) const {
+    const u8* code = getCode();
+    switch (static_cast<OpCode>(code[offset])) {
+        case OpCode::NIL:
+        case OpCode::TRUE:
+        case OpCode::FALSE:
+        case OpCode::POP:
+        case OpCode::POP_SCOPE:
+        case OpCode::ADD:
+        case OpCode::SUBTRACT:
+        case OpCode::MULTIPLY:
+        case OpCode::DIVIDE:
+        case OpCode::MODULO:
+        case OpCode::POWER:
+        case OpCode::NEGATE:
+        case OpCode::POSITIVE:
+        case OpCode::NOT:
+        case OpCode::EQUAL:
+        case OpCode::NOT_EQUAL:
+        case OpCode::LESS:
+        case OpCode::LESS_EQUAL:
+        case OpCode::GREATER:
+        case OpCode::GREATER_EQUAL:
+        case OpCode::RETURN:
+            return 1;
+        case OpCode::CONSTANT:
+        case OpCode::GET_LOCAL:
+        case OpCode::SET_LOCAL:
+        case OpCode::GET_GLOBAL:
+        case OpCode::SET_GLOBAL:
+        case OpCode::DEFINE_GLOBAL:
+        case OpCode::DEFINE_SCOPED:
+        case OpCode::PUSH_SCOPE:
+        case OpCode::JUMP:
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::LOOP:
+        case OpCode::BUILD_ARRAY:
+        case OpCode::INDEX_GET:
+        case OpCode::FUNCTION:
+            return 3;
+        case OpCode::CALL:
+            return 4;
+        case OpCode::GET_SCOPED:
+        case OpCode::SET_SCOPED:
+        case OpCode::MEMBER_GET:
+            return 5;
+        case OpCode::BUILD_MAP:
+            return offset + 3 <= size() ? 5 + 2 * static_cast<usize>(readShort(&code[offset + 1])) : 0;
+    }
+    return 0;
+}
+
+usize Chunk::computeMaxStack(usize entryDepth) const {
+    // Compiled code is structured, so every offset has one depth; walk each
+    // path once, seeding jump targets as they are found
+    constexpr usize UNSEEN = static_cast<usize>(-1);
+    const u8* code = getCode();
+    const usize codeSize = size();
+    std::vector<usize> depthAt(codeSize, UNSEEN);
+    std::vector<usize> pending;
+    usize maxDepth = entryDepth;
+
+    auto reach = [&](usize offset, usize depth) {
+        if (offset >= codeSize) return false;
+        if (depthAt[offset] == UNSEEN) {
+            depthAt[offset] = depth;
+            pending.push_back(offset);
+            return true;
+        }
+        return depthAt[offset] == depth;
+    };
+
+    if (!reach(0, entryDepth)) return 0;
+
+    while (!pending.empty()) {
+        usize offset = pending.back();
+        pending.pop_back();
+        usize depth = depthAt[offset];
+
+        usize length = instructionLength(offset);
+        if (length == 0 || offset + length > codeSize) return 0;
+        OpCode op = static_cast<OpCode>(code[offset]);
+        usize operand = length >= 3 ? readShort(&code[offset + 1]) : 0;
+
+        usize pops = 0;
+        usize pushes = 0;
+        switch (op) {
+            case OpCode::CONSTANT:
+            case OpCode::NIL:
+            case OpCode::TRUE:
+            case OpCode::FALSE:
+            case OpCode::GET_LOCAL:
+            case OpCode::GET_GLOBAL:
+            case OpCode::GET_SCOPED:
+            case OpCode::FUNCTION:
+                pushes = 1;
+                break;
+            case OpCode::POP:
+            case OpCode::DEFINE_GLOBAL:
+            case OpCode::DEFINE_SCOPED:
+            case OpCode::RETURN:
+                pops = 1;
+                break;
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::MODULO:
+            case OpCode::POWER:
+            case OpCode::EQUAL:
+            case OpCode::NOT_EQUAL:
+            case OpCode::LESS:
+            case OpCode::LESS_EQUAL:
+            case OpCode::GREATER:
+            case OpCode::GREATER_EQUAL:
+            case OpCode::INDEX_GET:
+                pops = 2;
+                pushes = 1;
+                break;
+            case OpCode::SET_LOCAL:
+            case OpCode::SET_GLOBAL:
+            case OpCode::SET_SCOPED:
+            case OpCode::NEGATE:
+            case OpCode::POSITIVE:
+            case OpCode::NOT:
+            case OpCode::MEMBER_GET:
+            case OpCode::JUMP_IF_FALSE:
+                pops = 1;
+                pushes = 1;
+                break;
+            case OpCode::CALL:
+                pops = static_cast<usize>(code[offset + 1]) + 1;
+                pushes = 1;
+                break;
+            case OpCode::BUILD_ARRAY:
+            case OpCode::BUILD_MAP:
+                pops = operand;
+                pushes = 1;
+                break;
+            case OpCode::PUSH_SCOPE:
+            case OpCode::POP_SCOPE:
+            case OpCode::JUMP:
+            case OpCode::LOOP:
+                break;
+        }
+
+        if (pops > depth) return 0;
+        depth = depth - pops + pushes;
+        maxDepth = std::max(maxDepth, depth);
+
+        bool ok = true;
+        if (op == OpCode::JUMP) {
+            ok = reach(offset + 3 + operand, depth);
+        } else if (op == OpCode::LOOP) {
+            ok = operand <= offset + 3 && reach(offset + 3 - operand, depth);
+        } else if (op == OpCode::JUMP_IF_FALSE) {
+            ok = reach(offset + 3 + operand, depth) && reach(offset + 3, depth);
+        } else if (op != OpCode::RETURN) {
+            ok = reach(offset + length, depth);
+        }
+        if (!ok) return 0;
+    }
+
+    return maxDepth;
+}
+
+String Chunk::disassemble(const String& name) const {
+    String out = "== " + name + " ==\n";
+    for (usize offset = 0; offset < size();) {
+        offset = disassembleInstruction(offset, out);
+    }
+    return out;
+}
+
+usize Chunk::disassembleInstruction(usize offset, String& out) const {
+    std::ostringstream oss;
+    oss << std::setw(4) << std::setfill('0') << offset << " ";
+    if (offset > 0 && getLine(offset) == getLine(offset - 1)) {
+        oss << "   | ";
+    } else {
+        oss << std::setw(4) << std::setfill(' ') << getLine(offset) << " ";
+    }
+
+    const u8* code = getCode();
+    OpCode op = static_cast<OpCode>(code[offset]);
+    oss << opCodeToString(op);
+
+    auto readShort = [code](usize at) -> u16 {
+        return static_cast<u16>((code[at] << 8) | code[at + 1]);
+    };
+
+    auto cacheOperand = [&readShort](usize at) -> String {
+        u16 cache = readShort(at);
+        return cache == NO_INLINE_CACHE ? String(" ic -") : " ic " + std::to_string(cache);
+    };
+
+    usize next = offset + 1;
+    switch (op) {
+        case OpCode::CONSTANT: {
+            u16 index = readShort(offset + 1);
+            oss << " " << index << " '" << m_constants[index].toString() << "'";
+            next = offset + 3;
+            break;
+        }
+        case OpCode::GET_GLOBAL:
+        case OpCode::SET_GLOBAL:
+        case OpCode::DEFINE_GLOBAL: {
+            u16 index = readShort(offset + 1);
+            oss << " " << index << " '" << m_names[index].str() << "'";
+            next = offset + 3;
+            break;
+        }
+        case OpCode::MEMBER_GET: {
+            u16 index = readShort(offset + 1);
+            oss << " " << index << " '" << m_names[index].str() << "'" << cacheOperand(offset + 3);
+            next = offset + 5;
+            break;
+        }
+        case OpCode::GET_SCOPED:
+        case OpCode::SET_SCOPED:
+            oss << " " << readShort(offset + 1) << ":" << readShort(offset + 3);
+            next = offset + 5;
+            break;
+        case OpCode::GET_LOCAL:
+        case OpCode::SET_LOCAL:
+        case OpCode::DEFINE_SCOPED:
+        case OpCode::PUSH_SCOPE:
+        case OpCode::BUILD_ARRAY:
+        case OpCode::FUNCTION:
+            oss << " " << readShort(offset + 1);
+            next = offset + 3;
+            break;
+        case OpCode::BUILD_MAP: {
+            u16 count = readShort(offset + 1);
+            oss << " " << count;
+            for (u16 i = 0; i < count; ++i) {
+                oss << (i == 0 ? " '" : ", '") << m_names[readShort(offset + 5 + i * 2)].str() << "'";
+            }
+            oss << cacheOperand(offset + 3);
+            next = offset + 5 + count * 2;
+            break;
+        }
+        case OpCode::JUMP:
+        case OpCode::JUMP_IF_FALSE:
+            oss << " -> " << (offset + 3 + readShort(offset + 1));
+            next = offset + 3;
+            break;
+        case OpCode::LOOP:
+            oss << " -> " << (offset + 3 - readShort(offset + 1));
+            next = offset + 3;
+            break;
+        case OpCode::CALL:
+            oss << " " << static_cast<u32>(code[offset + 1]) << cacheOperand(offset + 2);
+            next = offset + 4;
+            break;
+        case OpCode::INDEX_GET:
+            oss << cacheOperand(offset + 1);
+            next = offset + 3;
+            break;
+        default:
+            break;
+    }
+
+    out += oss.str() + "\n";
+    return next;
+}
+
+} // namespace lang
+} // namespace oracon
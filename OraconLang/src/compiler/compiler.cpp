@@ -0,0 +1,647 @@
+#include "oracon/lang/compiler/compiler.h"
+#include <limits>
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+// ===== CompiledProgram =====
+
+const FunctionProto* CompiledProgram::findFunction(const FunctionStmt* declaration) const {
+    auto it = m_byDeclaration.find(declaration);
+    return it != m_byDeclaration.end() ? it->second : nullptr;
+}
+
+String CompiledProgram::disassemble() const {
+    String out;
+    for (const auto& fn : m_functions) {
+        out += fn->chunk.disassemble(fn->name);
+    }
+    return out;
+}
+
+namespace {
+
+// What a global's initializer evaluates to, when its form alone says so
+ValueType initializerType(const Expr* initializer) {
+    if (!initializer) return ValueType::Nil;
+    switch (initializer->getKind()) {
+        case ExprKind::Literal:
+            return static_cast<const LiteralExpr*>(initializer)->getValue().getType();
+        case ExprKind::Unary: {
+            // A negative number
+            auto* unary = static_cast<const UnaryExpr*>(initializer);
+            ValueType type = initializerType(unary->getOperand());
+            bool number = type == ValueType::Integer || type == ValueType::Float;
+            return unary->getOperator().getType() == TokenType::MINUS && number ? type : ValueType::Nil;
+        }
+        case ExprKind::Array: return ValueType::Array;
+        case ExprKind::Map: return ValueType::Map;
+        default: return ValueType::Nil;
+    }
+}
+
+} // namespace
+
+// ===== Compiler =====
+
+Compiler::Compiler()
+    : m_current(nullptr)
+    , m_line(1)
+    , m_hasError(false)
+{}
+
+UniquePtr<CompiledProgram> Compiler::compile(const Program* program) {
+    m_program = std::make_unique<CompiledProgram>();
+    m_hasError = false;
+    m_errors.clear();
+
+    m_resolver.resolve(program);
+    if (m_resolver.hasError()) {
+        m_hasError = true;
+        m_errors = m_resolver.getErrors();
+        return std::move(m_program);
+    }
+
+    auto script = std::make_unique<FunctionProto>();
+    script->name = "<script>";
+    script->program = m_program.get();
+    FunctionProto* scriptProto = script.get();
+    m_program->m_functions.push_back(std::move(script));
+
+    FunctionState state{scriptProto, nullptr, {}, {}};
+    m_current = &state;
+
+    for (const auto& stmt : program->getStatements()) {
+        u32 start = static_cast<u32>(scriptProto->chunk.size());
+        compileStmt(stmt.get());
+        u32 end = static_cast<u32>(scriptProto->chunk.size());
+        if (auto* var = dynamic_cast<const VarDeclStmt*>(stmt.get())) {
+            m_program->m_globals.push_back({var->getName().getSymbol(), start, end, false,
+                                            initializerType(var->getInitializer())});
+        } else if (auto* fn = dynamic_cast<const FunctionStmt*>(stmt.get())) {
+            m_program->m_globals.push_back({fn->getName().getSymbol(), start, end, true});
+        }
+    }
+    emit(OpCode::NIL);
+    emit(OpCode::RETURN);
+    scriptProto->maxStack = scriptProto->chunk.computeMaxStack(1);
+
+    m_current = nullptr;
+    return std::move(m_program);
+}
+
+void Compiler::addError(const String& message) {
+    m_hasError = true;
+    m_errors.push_back("Compile error at line " + std::to_string(m_line) + ": " + message);
+}
+
+// ===== Statements =====
+
+void Compiler::compileStmt(const Stmt* stmt) {
+    if (!stmt) return;
+
+    switch (stmt->getKind()) {
+        case StmtKind::Expr:
+            compileExpr(static_cast<const ExprStmt*>(stmt)->getExpression());
+            emit(OpCode::POP);
+            break;
+        case StmtKind::VarDecl:
+            compileVarDecl(static_cast<const VarDeclStmt*>(stmt));
+            break;
+        case StmtKind::Block: {
+            auto* block = static_cast<const BlockStmt*>(stmt);
+            beginScope(block);
+            compileBlock(block);
+            endScope();
+            break;
+        }
+        case StmtKind::If:
+            compileIf(static_cast<const IfStmt*>(stmt));
+            break;
+        case StmtKind::While:
+            compileWhile(static_cast<const WhileStmt*>(stmt));
+            break;
+        case StmtKind::For:
+            compileFor(static_cast<const ForStmt*>(stmt));
+            break;
+        case StmtKind::Return:
+            compileReturn(static_cast<const ReturnStmt*>(stmt));
+            break;
+        case StmtKind::Break:
+            compileBreak(static_cast<const BreakStmt*>(stmt));
+            break;
+        case StmtKind::Continue:
+            compileContinue(static_cast<const ContinueStmt*>(stmt));
+            break;
+        case StmtKind::Function:
+            compileFunctionDecl(static_cast<const FunctionStmt*>(stmt));
+            break;
+        case StmtKind::Class:
+            setLine(static_cast<const ClassStmt*>(stmt)->getName());
+            addError("Classes are not supported in bytecode mode");
+            break;
+    }
+}
+
+void Compiler::compileVarDecl(const VarDeclStmt* stmt) {
+    setLine(stmt->getName());
+    if (stmt->getInitializer()) {
+        compileExpr(stmt->getInitializer());
+    } else {
+        emit(OpCode::NIL);
+    }
+    defineVariable(stmt, stmt->getName().getSymbol());
+}
+
+void Compiler::compileBlock(const BlockStmt* stmt) {
+    for (const auto& s : stmt->getStatements()) {
+        compileStmt(s.get());
+    }
+}
+
+void Compiler::compileIf(const IfStmt* stmt) {
+    compileExpr(stmt->getCondition());
+
+    usize thenJump = emitJump(OpCode::JUMP_IF_FALSE);
+    emit(OpCode::POP);
+    compileStmt(stmt->getThenBranch());
+
+    usize elseJump = emitJump(OpCode::JUMP);
+    patchJump(thenJump);
+    emit(OpCode::POP);
+    compileStmt(stmt->getElseBranch());
+    patchJump(elseJump);
+}
+
+void Compiler::compileWhile(const WhileStmt* stmt) {
+    usize loopStart = currentChunk().size();
+    m_current->loops.push_back({loopStart, m_current->scopes.size(), false, {}, {}});
+
+    compileExpr(stmt->getCondition());
+    usize exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+    emit(OpCode::POP);
+    compileStmt(stmt->getBody());
+    emitLoop(loopStart);
+
+    patchJump(exitJump);
+    emit(OpCode::POP);
+
+    for (usize jump : m_current->loops.back().breakJumps) {
+        patchJump(jump);
+    }
+    m_current->loops.pop_back();
+}
+
+void Compiler::compileFor(const ForStmt* stmt) {
+    beginScope(stmt);
+    compileStmt(stmt->getInitializer());
+
+    usize loopStart = currentChunk().size();
+    m_current->loops.push_back({loopStart, m_current->scopes.size(), true, {}, {}});
+
+    usize exitJump = 0;
+    bool hasCondition = stmt->getCondition() != nullptr;
+    if (hasCondition) {
+        compileExpr(stmt->getCondition());
+        exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+        emit(OpCode::POP);
+    }
+
+    compileStmt(stmt->getBody());
+
+    for (usize jump : m_current->loops.back().continueJumps) {
+        patchJump(jump);
+    }
+    if (stmt->getIncrement()) {
+        compileExpr(stmt->getIncrement());
+        emit(OpCode::POP);
+    }
+    emitLoop(loopStart);
+
+    if (hasCondition) {
+        patchJump(exitJump);
+        emit(OpCode::POP);
+    }
+
+    for (usize jump : m_current->loops.back().breakJumps) {
+        patchJump(jump);
+    }
+    m_current->loops.pop_back();
+    endScope();
+}
+
+void Compiler::compileReturn(const ReturnStmt* stmt) {
+    setLine(stmt->getKeyword());
+    if (stmt->getValue()) {
+        compileExpr(stmt->getValue());
+    } else {
+        emit(OpCode::NIL);
+    }
+    emit(OpCode::RETURN);
+}
+
+void Compiler::compileBreak(const BreakStmt* stmt) {
+    setLine(stmt->getKeyword());
+    if (m_current->loops.empty()) {
+        addError("Cannot use 'break' outside of a loop");
+        return;
+    }
+
+    Loop& loop = m_current->loops.back();
+    emitScopeExits(loop.scopeIndex);
+    loop.breakJumps.push_back(emitJump(OpCode::JUMP));
+}
+
+void Compiler::compileContinue(const ContinueStmt* stmt) {
+    setLine(stmt->getKeyword());
+    if (m_current->loops.empty()) {
+        addError("Cannot use 'continue' outside of a loop");
+        return;
+    }
+
+    Loop& loop = m_current->loops.back();
+    emitScopeExits(loop.scopeIndex);
+    if (loop.isFor) {
+        // The increment clause is emitted after the body, so jump forward to it
+        loop.continueJumps.push_back(emitJump(OpCode::JUMP));
+    } else {
+        emitLoop(loop.start);
+    }
+}
+
+void Compiler::compileFunctionDecl(const FunctionStmt* stmt) {
+    setLine(stmt->getName());
+    usize index = compileFunction(stmt);
+    emit(OpCode::FUNCTION, static_cast<u16>(index));
+    defineVariable(stmt, stmt->getName().getSymbol());
+}
+
+usize Compiler::compileFunction(const FunctionStmt* stmt) {
+    auto proto = std::make_unique<FunctionProto>();
+    proto->name = String(stmt->getName().getLexeme());
+    proto->arity = stmt->getParameters().size();
+    proto->declaration = stmt;
+    proto->program = m_program.get();
+
+    FunctionProto* protoPtr = proto.get();
+    usize index = m_program->m_functions.size();
+    if (index > std::numeric_limits<u16>::max()) {
+        addError("Too many functions in one program");
+        return 0;
+    }
+    m_program->m_functions.push_back(std::move(proto));
+    m_program->m_byDeclaration[stmt] = protoPtr;
+
+    FunctionState state{protoPtr, m_current, {}, {}};
+    m_current = &state;
+
+    // Parameters and body share one scope, as in callUserFunction.
+    // RETURN tears the whole frame down, so this scope is never closed explicitly.
+    beginScope(stmt);
+
+    // Arguments arrive on the stack; captured ones are copied into the scope's Environment
+    const auto& params = stmt->getParameters();
+    for (usize i = 0; i < params.size(); ++i) {
+        VariableSlot slot = m_resolver.lookupDeclaration(&params[i]);
+        if (slot.kind == VariableSlot::Kind::Captured) {
+            emit(OpCode::GET_LOCAL, static_cast<u16>(i + 1));
+            emit(OpCode::DEFINE_SCOPED, slot.slot);
+        } else {
+            m_current->scopes.back().stackLocals++;
+        }
+    }
+
+    compileBlock(stmt->getBody());
+    emit(OpCode::NIL);
+    emit(OpCode::RETURN);
+    protoPtr->maxStack = protoPtr->chunk.computeMaxStack(protoPtr->arity + 1);
+
+    m_current = state.enclosing;
+    return index;
+}
+
+// ===== Expressions =====
+
+void Compiler::compileExpr(const Expr* expr) {
+    if (!expr) {
+        emit(OpCode::NIL);
+        return;
+    }
+
+    switch (expr->getKind()) {
+        case ExprKind::Variable: compileVariable(static_cast<const VariableExpr*>(expr)); break;
+        case ExprKind::Literal: compileLiteral(static_cast<const LiteralExpr*>(expr)); break;
+        case ExprKind::Binary: compileBinary(static_cast<const BinaryExpr*>(expr)); break;
+        case ExprKind::Call: compileCall(static_cast<const CallExpr*>(expr)); break;
+        case ExprKind::Assignment: compileAssignment(static_cast<const AssignmentExpr*>(expr)); break;
+        case ExprKind::Index: compileIndex(static_cast<const IndexExpr*>(expr)); break;
+        case ExprKind::Member: compileMember(static_cast<const MemberExpr*>(expr)); break;
+        case ExprKind::Logical: compileLogical(static_cast<const LogicalExpr*>(expr)); break;
+        case ExprKind::Unary: compileUnary(static_cast<const UnaryExpr*>(expr)); break;
+        case ExprKind::Grouping: compileExpr(static_cast<const GroupingExpr*>(expr)->getExpression()); break;
+        case ExprKind::Array: compileArray(static_cast<const ArrayExpr*>(expr)); break;
+        case ExprKind::Map: compileMap(static_cast<const MapExpr*>(expr)); break;
+    }
+}
+
+void Compiler::compileLiteral(const LiteralExpr* expr) {
+    setLine(expr->getToken());
+
+    const Value& value = expr->getValue();
+    switch (value.getType()) {
+        case ValueType::Nil:
+            emit(OpCode::NIL);
+            break;
+        case ValueType::Boolean:
+            emit(value.get<bool>() ? OpCode::TRUE : OpCode::FALSE);
+            break;
+        default:
+            emitConstant(value);
+            break;
+    }
+}
+
+void Compiler::compileVariable(const VariableExpr* expr) {
+    const Token& name = expr->getName();
+    setLine(name);
+
+    emitGet(expr, name.getSymbol());
+}
+
+void Compiler::compileAssignment(const AssignmentExpr* expr) {
+    compileExpr(expr->getValue());
+
+    const Token& name = expr->getName();
+    setLine(name);
+
+    emitSet(expr, name.getSymbol());
+}
+
+void Compiler::compileUnary(const UnaryExpr* expr) {
+    compileExpr(expr->getOperand());
+    setLine(expr->getOperator());
+
+    switch (expr->getOperator().getType()) {
+        case TokenType::MINUS: emit(OpCode::NEGATE); break;
+        case TokenType::PLUS: emit(OpCode::POSITIVE); break;
+        case TokenType::NOT: emit(OpCode::NOT); break;
+        default: addError("Unknown unary operator"); break;
+    }
+}
+
+void Compiler::compileBinary(const BinaryExpr* expr) {
+    compileExpr(expr->getLeft());
+    compileExpr(expr->getRight());
+    setLine(expr->getOperator());
+
+    switch (expr->getOperator().getType()) {
+        case TokenType::PLUS: emit(OpCode::ADD); break;
+        case TokenType::MINUS: emit(OpCode::SUBTRACT); break;
+        case TokenType::STAR: emit(OpCode::MULTIPLY); break;
+        case TokenType::SLASH: emit(OpCode::DIVIDE); break;
+        case TokenType::PERCENT: emit(OpCode::MODULO); break;
+        case TokenType::POWER: emit(OpCode::POWER); break;
+        case TokenType::EQUAL: emit(OpCode::EQUAL); break;
+        case TokenType::NOT_EQUAL: emit(OpCode::NOT_EQUAL); break;
+        case TokenType::LESS: emit(OpCode::LESS); break;
+        case TokenType::LESS_EQUAL: emit(OpCode::LESS_EQUAL); break;
+        case TokenType::GREATER: emit(OpCode::GREATER); break;
+        case TokenType::GREATER_EQUAL: emit(OpCode::GREATER_EQUAL); break;
+        default: addError("Unknown binary operator"); break;
+    }
+}
+
+void Compiler::compileLogical(const LogicalExpr* expr) {
+    compileExpr(expr->getLeft());
+    setLine(expr->getOperator());
+
+    if (expr->getOperator().getType() == TokenType::OR) {
+        usize elseJump = emitJump(OpCode::JUMP_IF_FALSE);
+        usize endJump = emitJump(OpCode::JUMP);
+        patchJump(elseJump);
+        emit(OpCode::POP);
+        compileExpr(expr->getRight());
+        patchJump(endJump);
+    } else {
+        usize endJump = emitJump(OpCode::JUMP_IF_FALSE);
+        emit(OpCode::POP);
+        compileExpr(expr->getRight());
+        patchJump(endJump);
+    }
+}
+
+void Compiler::compileCall(const CallExpr* expr) {
+    compileExpr(expr->getCallee());
+
+    const auto& args = expr->getArguments();
+    for (const auto& arg : args) {
+        compileExpr(arg.get());
+    }
+
+    setLine(expr->getParen());
+    if (args.size() > std::numeric_limits<u8>::max()) {
+        addError("Cannot have more than 255 arguments");
+        return;
+    }
+    emit(OpCode::CALL);
+    emitByte(static_cast<u8>(args.size()));
+    emitShort(makeInlineCache());
+}
+
+void Compiler::compileArray(const ArrayExpr* expr) {
+    const auto& elements = expr->getElements();
+    for (const auto& element : elements) {
+        compileExpr(element.get());
+    }
+
+    if (elements.size() > std::numeric_limits<u16>::max()) {
+        addError("Too many elements in array literal");
+        return;
+    }
+    emit(OpCode::BUILD_ARRAY, static_cast<u16>(elements.size()));
+}
+
+void Compiler::compileIndex(const IndexExpr* expr) {
+    compileExpr(expr->getObject());
+    compileExpr(expr->getIndex());
+    emit(OpCode::INDEX_GET, makeInlineCache());
+}
+
+void Compiler::compileMember(const MemberExpr* expr) {
+    compileExpr(expr->getObject());
+    setLine(expr->getMember());
+    emit(OpCode::MEMBER_GET, makeName(expr->getMember().getSymbol()));
+    emitShort(makeInlineCache());
+}
+
+void Compiler::compileMap(const MapExpr* expr) {
+    const auto& pairs = expr->getPairs();
+    for (const auto& pair : pairs) {
+        compileExpr(pair.second.get());
+    }
+
+    if (pairs.size() > std::numeric_limits<u16>::max()) {
+        addError("Too many entries in map literal");
+        return;
+    }
+    emit(OpCode::BUILD_MAP, static_cast<u16>(pairs.size()));
+    emitShort(makeInlineCache());
+    for (const auto& pair : pairs) {
+        emitShort(makeName(Symbol::intern(pair.first)));
+    }
+}
+
+// ===== Scopes =====
+
+void Compiler::beginScope(const void* owner) {
+    u16 envSlots = m_resolver.getScopeSize(owner);
+    if (envSlots > 0) {
+        emit(OpCode::PUSH_SCOPE, envSlots);
+    }
+    m_current->scopes.push_back({0, envSlots > 0});
+}
+
+void Compiler::endScope() {
+    emitScopeExits(m_current->scopes.size() - 1);
+    m_current->scopes.pop_back();
+}
+
+void Compiler::emitScopeExits(usize scopeIndex) {
+    const auto& scopes = m_current->scopes;
+    for (usize i = scopes.size(); i-- > scopeIndex;) {
+        for (u16 n = 0; n < scopes[i].stackLocals; ++n) {
+            emit(OpCode::POP);
+        }
+        if (scopes[i].hasEnv) {
+            emit(OpCode::POP_SCOPE);
+        }
+    }
+}
+
+void Compiler::defineVariable(const void* declaration, Symbol name) {
+    VariableSlot slot = m_resolver.lookupDeclaration(declaration);
+    switch (slot.kind) {
+        case VariableSlot::Kind::Global:
+            emit(OpCode::DEFINE_GLOBAL, makeName(name));
+            break;
+        case VariableSlot::Kind::Local:
+            // The value stays where it is; that stack slot is the variable
+            m_current->scopes.back().stackLocals++;
+            break;
+        case VariableSlot::Kind::Captured:
+            emit(OpCode::DEFINE_SCOPED, slot.slot);
+            break;
+    }
+}
+
+void Compiler::emitGet(const Expr* expr, Symbol name) {
+    VariableSlot slot = m_resolver.lookup(expr);
+    switch (slot.kind) {
+        case VariableSlot::Kind::Global:
+            emit(OpCode::GET_GLOBAL, makeName(name));
+            break;
+        case VariableSlot::Kind::Local:
+            emit(OpCode::GET_LOCAL, slot.slot);
+            break;
+        case VariableSlot::Kind::Captured:
+            emit(OpCode::GET_SCOPED, slot.depth);
+            emitShort(slot.slot);
+            break;
+    }
+}
+
+void Compiler::emitSet(const Expr* expr, Symbol name) {
+    VariableSlot slot = m_resolver.lookup(expr);
+    switch (slot.kind) {
+        case VariableSlot::Kind::Global:
+            emit(OpCode::SET_GLOBAL, makeName(name));
+            break;
+        case VariableSlot::Kind::Local:
+            emit(OpCode::SET_LOCAL, slot.slot);
+            break;
+        case VariableSlot::Kind::Captured:
+            emit(OpCode::SET_SCOPED, slot.depth);
+            emitShort(slot.slot);
+            break;
+    }
+}
+
+// ===== Emission =====
+
+Chunk& Compiler::currentChunk() {
+    return m_current->proto->chunk;
+}
+
+void Compiler::emit(OpCode op) {
+    currentChunk().write(op, m_line);
+}
+
+void Compiler::emit(OpCode op, u16 operand) {
+    emit(op);
+    emitShort(operand);
+}
+
+void Compiler::emitByte(u8 byte) {
+    currentChunk().write(byte, m_line);
+}
+
+void Compiler::emitShort(u16 value) {
+    emitByte(static_cast<u8>((value >> 8) & 0xff));
+    emitByte(static_cast<u8>(value & 0xff));
+}
+
+void Compiler::emitConstant(const Value& value) {
+    usize index = currentChunk().addConstant(value);
+    if (index > std::numeric_limits<u16>::max()) {
+        addError("Too many constants in one function");
+        return;
+    }
+    emit(OpCode::CONSTANT, static_cast<u16>(index));
+}
+
+usize Compiler::emitJump(OpCode op) {
+    emit(op);
+    emitShort(0xffff);
+    return currentChunk().size() - 2;
+}
+
+void Compiler::patchJump(usize offset) {
+    usize jump = currentChunk().size() - offset - 2;
+    if (jump > std::numeric_limits<u16>::max()) {
+        addError("Too much code to jump over");
+        return;
+    }
+
+    currentChunk().patch(offset, static_cast<u8>((jump >> 8) & 0xff));
+    currentChunk().patch(offset + 1, static_cast<u8>(jump & 0xff));
+}
+
+void Compiler::emitLoop(usize loopStart) {
+    emit(OpCode::LOOP);
+
+    usize offset = currentChunk().size() - loopStart + 2;
+    if (offset > std::numeric_limits<u16>::max()) {
+        addError("Loop body too large");
+    }
+    emitShort(static_cast<u16>(offset));
+}
+
+u16 Compiler::makeName(Symbol name) {
+    usize index = currentChunk().addName(name);
+    if (index > std::numeric_limits<u16>::max()) {
+        addError("Too many global names in one function");
+        return 0;
+    }
+    return static_cast<u16>(index);
+}
+
+u16 Compiler::makeInlineCache() {
+    if (m_program->m_inlineCacheCount >= NO_INLINE_CACHE) {
+        return NO_INLINE_CACHE;
+    }
+    return static_cast<u16>(m_program->m_inlineCacheCount++);
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,351 @@
+#include "oracon/lang/compiler/optimizer.h"
+#include "oracon/lang/vm/operators.h"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// Inverse of unescapeString, so a folded string literal reads back as itself
+String escapeString(const String& text) {
+    String result;
+    result.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            case '\r': result += "\\r"; break;
+            case '\0': result += "\\0"; break;
+            default: result += c; break;
+        }
+    }
+    return result;
+}
+
+bool isDeclaration(const Stmt* stmt) {
+    return dynamic_cast<const VarDeclStmt*>(stmt) || dynamic_cast<const FunctionStmt*>(stmt) ||
+           dynamic_cast<const ClassStmt*>(stmt);
+}
+
+} // namespace
+
+Optimizer::Optimizer(bool recordLog)
+    : m_program(nullptr)
+    , m_recordLog(recordLog)
+    , m_rewrites(0)
+{}
+
+void Optimizer::optimize(Program* program) {
+    if (!program) return;
+
+    m_program = program;
+    m_rewrites = 0;
+    m_log.clear();
+
+    optimizeStatements(program->m_statements);
+    m_program = nullptr;
+}
+
+void Optimizer::record(const Token& at, const String& before, const String& after) {
+    m_rewrites++;
+    if (m_recordLog) {
+        m_log.push_back("line " + std::to_string(at.getLocation().line) + ": " + before + " => " + after);
+    }
+}
+
+// ===== Statements =====
+
+void Optimizer::optimizeStatements(std::vector<NodePtr<Stmt>>& statements) {
+    bool removed = false;
+    for (auto& stmt : statements) {
+        optimizeStmt(stmt);
+        removed = removed || !stmt;
+    }
+
+    if (removed) {
+        std::vector<NodePtr<Stmt>> kept;
+        kept.reserve(statements.size());
+        for (auto& stmt : statements) {
+            if (stmt) kept.push_back(std::move(stmt));
+        }
+        statements = std::move(kept);
+    }
+}
+
+// Leaves stmt null when it has no effect; callers that need a statement
+// in that position substitute an empty block.
+void Optimizer::optimizeStmt(NodePtr<Stmt>& stmt) {
+    if (!stmt) return;
+
+    auto optimizeBody = [this](NodePtr<Stmt>& body) {
+        optimizeStmt(body);
+        if (!body) {
+            body = m_program->make<BlockStmt>(std::vector<NodePtr<Stmt>>());
+        }
+    };
+
+    if (auto* s = dynamic_cast<ExprStmt*>(stmt.get())) {
+        optimizeExpr(s->m_expr);
+        // A bare literal has no effect
+        Value value;
+        if (literalValue(s->m_expr.get(), value)) {
+            record(static_cast<const LiteralExpr*>(s->m_expr.get())->getToken(), s->m_expr->toString() + ";", "removed");
+            stmt.reset();
+        }
+    } else if (auto* s = dynamic_cast<VarDeclStmt*>(stmt.get())) {
+        optimizeExpr(s->m_initializer);
+    } else if (auto* s = dynamic_cast<BlockStmt*>(stmt.get())) {
+        optimizeStatements(s->m_statements);
+    } else if (auto* s = dynamic_cast<IfStmt*>(stmt.get())) {
+        optimizeExpr(s->m_condition);
+        optimizeBody(s->m_thenBranch);
+        optimizeStmt(s->m_elseBranch);
+        removeDeadStmt(stmt);
+    } else if (auto* s = dynamic_cast<WhileStmt*>(stmt.get())) {
+        optimizeExpr(s->m_condition);
+        optimizeBody(s->m_body);
+        removeDeadStmt(stmt);
+    } else if (auto* s = dynamic_cast<ForStmt*>(stmt.get())) {
+        optimizeStmt(s->m_initializer);
+        optimizeExpr(s->m_condition);
+        optimizeExpr(s->m_increment);
+        optimizeBody(s->m_body);
+        removeDeadStmt(stmt);
+    } else if (auto* s = dynamic_cast<ReturnStmt*>(stmt.get())) {
+        optimizeExpr(s->m_value);
+    } else if (auto* s = dynamic_cast<FunctionStmt*>(stmt.get())) {
+        optimizeFunction(s);
+    } else if (auto* s = dynamic_cast<ClassStmt*>(stmt.get())) {
+        for (auto& method : s->m_methods) {
+            optimizeFunction(method.get());
+        }
+    }
+}
+
+void Optimizer::optimizeFunction(FunctionStmt* stmt) {
+    optimizeStatements(stmt->m_body->m_statements);
+}
+
+void Optimizer::removeDeadStmt(NodePtr<Stmt>& stmt) {
+    Value condition;
+
+    if (auto* s = dynamic_cast<IfStmt*>(stmt.get())) {
+        if (!literalValue(s->m_condition.get(), condition)) return;
+
+        String before = "if (" + s->m_condition->toString() + ")";
+        Token at = static_cast<const LiteralExpr*>(s->m_condition.get())->getToken();
+        NodePtr<Stmt> taken = condition.asBool() ? std::move(s->m_thenBranch) : std::move(s->m_elseBranch);
+
+        // A lone declaration keeps the branch's scope
+        if (taken && isDeclaration(taken.get())) {
+            std::vector<NodePtr<Stmt>> wrapped;
+            wrapped.push_back(std::move(taken));
+            taken = m_program->make<BlockStmt>(std::move(wrapped));
+        }
+
+        record(at, before, condition.asBool() ? "then branch" : (taken ? "else branch" : "removed"));
+        stmt = std::move(taken);
+    } else if (auto* s = dynamic_cast<WhileStmt*>(stmt.get())) {
+        if (!literalValue(s->m_condition.get(), condition) || condition.asBool()) return;
+
+        record(static_cast<const LiteralExpr*>(s->m_condition.get())->getToken(),
+               "while (" + s->m_condition->toString() + ")", "removed");
+        stmt.reset();
+    } else if (auto* s = dynamic_cast<ForStmt*>(stmt.get())) {
+        if (!s->m_condition || !literalValue(s->m_condition.get(), condition) || condition.asBool()) {
+            return;
+        }
+
+        // The initializer still runs once, in the loop's own scope
+        record(static_cast<const LiteralExpr*>(s->m_condition.get())->getToken(),
+               "for (...; " + s->m_condition->toString() + "; ...)", s->m_initializer ? "initializer" : "removed");
+        if (s->m_initializer) {
+            std::vector<NodePtr<Stmt>> init;
+            init.push_back(std::move(s->m_initializer));
+            stmt = m_program->make<BlockStmt>(std::move(init));
+        } else {
+            stmt.reset();
+        }
+    }
+}
+
+// ===== Expressions =====
+
+void Optimizer::optimizeExpr(NodePtr<Expr>& expr) {
+    if (!expr) return;
+
+    if (auto* e = dynamic_cast<GroupingExpr*>(expr.get())) {
+        // Parentheses only matter to the parser
+        optimizeExpr(e->m_expr);
+        NodePtr<Expr> inner = std::move(e->m_expr);
+        expr = std::move(inner);
+        m_rewrites++;
+    } else if (auto* e = dynamic_cast<UnaryExpr*>(expr.get())) {
+        optimizeExpr(e->m_operand);
+        foldUnary(expr, e);
+    } else if (auto* e = dynamic_cast<BinaryExpr*>(expr.get())) {
+        optimizeExpr(e->m_left);
+        optimizeExpr(e->m_right);
+        foldBinary(expr, e);
+    } else if (auto* e = dynamic_cast<LogicalExpr*>(expr.get())) {
+        optimizeExpr(e->m_left);
+        optimizeExpr(e->m_right);
+        foldLogical(expr, e);
+    } else if (auto* e = dynamic_cast<AssignmentExpr*>(expr.get())) {
+        optimizeExpr(e->m_value);
+    } else if (auto* e = dynamic_cast<CallExpr*>(expr.get())) {
+        optimizeExpr(e->m_callee);
+        for (auto& arg : e->m_arguments) {
+            optimizeExpr(arg);
+        }
+    } else if (auto* e = dynamic_cast<ArrayExpr*>(expr.get())) {
+        for (auto& element : e->m_elements) {
+            optimizeExpr(element);
+        }
+    } else if (auto* e = dynamic_cast<IndexExpr*>(expr.get())) {
+        optimizeExpr(e->m_object);
+        optimizeExpr(e->m_index);
+    } else if (auto* e = dynamic_cast<MemberExpr*>(expr.get())) {
+        optimizeExpr(e->m_object);
+    } else if (auto* e = dynamic_cast<MapExpr*>(expr.get())) {
+        for (auto& pair : e->m_pairs) {
+            optimizeExpr(pair.second);
+        }
+    }
+}
+
+void Optimizer::foldUnary(NodePtr<Expr>& expr, UnaryExpr* unary) {
+    TokenType op = unary->m_operator.getType();
+
+    Value operand;
+    if (literalValue(unary->m_operand.get(), operand)) {
+        Value result;
+        if (op == TokenType::NOT) {
+            result = Value(!operand.asBool());
+        } else if (op == TokenType::MINUS) {
+            if (ops::Negate::apply(operand, result)) return;
+        } else if (op == TokenType::PLUS && operand.isNumber()) {
+            result = operand;
+        } else {
+            return;
+        }
+        replace(expr, makeLiteral(result, unary->m_operator), unary->m_operator);
+        return;
+    }
+
+    // `not` always yields a bool, so three in a row equal one
+    if (op == TokenType::NOT) {
+        auto* inner = dynamic_cast<UnaryExpr*>(unary->m_operand.get());
+        if (inner && inner->m_operator.is(TokenType::NOT)) {
+            auto* innermost = dynamic_cast<UnaryExpr*>(inner->m_operand.get());
+            if (innermost && innermost->m_operator.is(TokenType::NOT)) {
+                replace(expr, std::move(inner->m_operand), unary->m_operator);
+            }
+        }
+    }
+}
+
+void Optimizer::foldBinary(NodePtr<Expr>& expr, BinaryExpr* binary) {
+    Value a, b;
+    if (!literalValue(binary->m_left.get(), a) || !literalValue(binary->m_right.get(), b)) {
+        return;
+    }
+
+    TokenType op = binary->m_operator.getType();
+    Value result;
+    const char* error;
+
+    // Anything the VM would reject (overflow, division by zero) stays a runtime error
+    switch (op) {
+        case TokenType::PLUS: error = ops::Add::apply(a, b, result); break;
+        case TokenType::MINUS: error = ops::Subtract::apply(a, b, result); break;
+        case TokenType::STAR: error = ops::Multiply::apply(a, b, result); break;
+        case TokenType::SLASH: error = ops::Divide::apply(a, b, result); break;
+        case TokenType::PERCENT: error = ops::Modulo::apply(a, b, result); break;
+        case TokenType::POWER: error = ops::Power::apply(a, b, result); break;
+        case TokenType::EQUAL: error = ops::Equality<true>::apply(a, b, result); break;
+        case TokenType::NOT_EQUAL: error = ops::Equality<false>::apply(a, b, result); break;
+        case TokenType::LESS: error = ops::Comparison<ops::LessThan>::apply(a, b, result); break;
+        case TokenType::LESS_EQUAL: error = ops::Comparison<ops::LessEqual>::apply(a, b, result); break;
+        case TokenType::GREATER: error = ops::Comparison<ops::GreaterThan>::apply(a, b, result); break;
+        case TokenType::GREATER_EQUAL: error = ops::Comparison<ops::GreaterEqual>::apply(a, b, result); break;
+        default: return;
+    }
+    if (error) {
+        return;
+    }
+
+    // Infinities and NaN have no literal spelling
+    if (result.isFloat() && !std::isfinite(result.get<f64>())) {
+        return;
+    }
+
+    replace(expr, makeLiteral(result, binary->m_operator), binary->m_operator);
+}
+
+void Optimizer::foldLogical(NodePtr<Expr>& expr, LogicalExpr* logical) {
+    Value left;
+    if (!literalValue(logical->m_left.get(), left)) {
+        return;
+    }
+
+    // `and`/`or` evaluate to one of their operands
+    bool isOr = logical->m_operator.is(TokenType::OR);
+    bool takeLeft = isOr ? left.asBool() : !left.asBool();
+
+    replace(expr, std::move(takeLeft ? logical->m_left : logical->m_right), logical->m_operator);
+}
+
+void Optimizer::replace(NodePtr<Expr>& expr, NodePtr<Expr>&& replacement, Token at) {
+    if (!replacement) return;
+
+    // Take the replacement out of the tree only after describing the old node
+    String before = m_recordLog ? expr->toString() : String();
+    NodePtr<Expr> node = std::move(replacement);
+    record(at, before, m_recordLog ? node->toString() : String());
+    expr = std::move(node);
+}
+
+// ===== Literals =====
+
+bool Optimizer::literalValue(const Expr* expr, Value& out) {
+    const auto* literal = dynamic_cast<const LiteralExpr*>(expr);
+    if (!literal) return false;
+
+    out = literal->getValue();
+    return true;
+}
+
+NodePtr<Expr> Optimizer::makeLiteral(const Value& value, const Token& at) {
+    const SourceLocation& loc = at.getLocation();
+
+    // The token is the value's source text, for toString() and locations
+    switch (value.getType()) {
+        case ValueType::Nil:
+            return m_program->make<LiteralExpr>(Token(TokenType::NIL, "nil", loc), value);
+        case ValueType::Boolean:
+            return value.get<bool>() ? m_program->make<LiteralExpr>(Token(TokenType::TRUE, "true", loc), value)
+                                     : m_program->make<LiteralExpr>(Token(TokenType::FALSE, "false", loc), value);
+        case ValueType::Integer:
+            return m_program->make<LiteralExpr>(
+                Token(TokenType::INTEGER, m_program->makeText(std::to_string(value.get<i64>())), loc), value);
+        case ValueType::Float: {
+            // 17 significant digits round-trip any double through stod
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value.get<f64>());
+            return m_program->make<LiteralExpr>(Token(TokenType::FLOAT, m_program->makeText(buffer), loc), value);
+        }
+        case ValueType::String:
+            return m_program->make<LiteralExpr>(
+                Token(TokenType::STRING, m_program->makeText(escapeString(value.get<String>())), loc), value);
+        default:
+            return nullptr;
+    }
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,300 @@
+#include "oracon/lang/compiler/resolver.h"
+#include <limits>
+
+namespace oracon {
+namespace lang {
+
+Resolver::Resolver()
+    : m_pass(Pass::Bind)
+    , m_hasError(false)
+{}
+
+void Resolver::resolve(const Program* program) {
+    m_hasError = false;
+    m_errors.clear();
+    m_captured.clear();
+    m_scopeSizes.clear();
+    m_declarations.clear();
+    m_references.clear();
+
+    for (Pass pass : {Pass::Bind, Pass::Layout}) {
+        m_pass = pass;
+        m_scopes.clear();
+        m_functionScopes.clear();
+        m_stackSizes.assign(1, 1); // the script frame; slot 0 holds the callee
+
+        for (const auto& stmt : program->getStatements()) {
+            resolveStmt(stmt.get());
+        }
+
+        if (pass == Pass::Bind) {
+            for (const auto& entry : m_captured) {
+                m_scopeSizes[m_declarationScope[entry.first]]++;
+            }
+        }
+    }
+}
+
+VariableSlot Resolver::lookup(const Expr* expr) const {
+    auto it = m_references.find(expr);
+    return it != m_references.end() ? it->second : VariableSlot{};
+}
+
+VariableSlot Resolver::lookupDeclaration(const void* declaration) const {
+    auto it = m_declarations.find(declaration);
+    return it != m_declarations.end() ? it->second : VariableSlot{};
+}
+
+u16 Resolver::getScopeSize(const void* owner) const {
+    auto it = m_scopeSizes.find(owner);
+    return it != m_scopeSizes.end() ? it->second : 0;
+}
+
+void Resolver::addError(const Token& token, const String& message) {
+    m_hasError = true;
+    m_errors.push_back("Resolve error at line " + std::to_string(token.getLocation().line) + ": " + message);
+}
+
+// ===== Statements =====
+
+void Resolver::resolveStmt(const Stmt* stmt) {
+    if (!stmt) return;
+
+    switch (stmt->getKind()) {
+        case StmtKind::Expr:
+            resolveExpr(static_cast<const ExprStmt*>(stmt)->getExpression());
+            break;
+        case StmtKind::VarDecl: {
+            auto* s = static_cast<const VarDeclStmt*>(stmt);
+            resolveExpr(s->getInitializer());
+            declare(s, s->getName().getSymbol());
+            break;
+        }
+        case StmtKind::Block: {
+            auto* s = static_cast<const BlockStmt*>(stmt);
+            beginScope(s);
+            for (const auto& inner : s->getStatements()) {
+                resolveStmt(inner.get());
+            }
+            endScope();
+            break;
+        }
+        case StmtKind::If: {
+            auto* s = static_cast<const IfStmt*>(stmt);
+            resolveExpr(s->getCondition());
+            resolveStmt(s->getThenBranch());
+            resolveStmt(s->getElseBranch());
+            break;
+        }
+        case StmtKind::While: {
+            auto* s = static_cast<const WhileStmt*>(stmt);
+            resolveExpr(s->getCondition());
+            resolveStmt(s->getBody());
+            break;
+        }
+        case StmtKind::For: {
+            auto* s = static_cast<const ForStmt*>(stmt);
+            beginScope(s);
+            resolveStmt(s->getInitializer());
+            resolveExpr(s->getCondition());
+            resolveStmt(s->getBody());
+            resolveExpr(s->getIncrement());
+            endScope();
+            break;
+        }
+        case StmtKind::Return:
+            resolveExpr(static_cast<const ReturnStmt*>(stmt)->getValue());
+            break;
+        case StmtKind::Function: {
+            // Declared before the body so the function can refer to itself
+            auto* s = static_cast<const FunctionStmt*>(stmt);
+            declare(s, s->getName().getSymbol());
+            resolveFunction(s);
+            break;
+        }
+        case StmtKind::Class: {
+            auto* s = static_cast<const ClassStmt*>(stmt);
+            declare(s, s->getName().getSymbol());
+            break;
+        }
+        case StmtKind::Break:
+        case StmtKind::Continue:
+            break;
+    }
+}
+
+void Resolver::resolveFunction(const FunctionStmt* stmt) {
+    beginScope(stmt);
+    m_functionScopes.push_back(m_scopes.size() - 1);
+    m_stackSizes.push_back(1);
+
+    for (const auto& param : stmt->getParameters()) {
+        declare(&param, param.getSymbol());
+
+        // Arguments always arrive on the stack, so a captured one still uses its slot
+        if (m_pass == Pass::Layout && m_declarations[&param].kind == VariableSlot::Kind::Captured) {
+            m_stackSizes.back()++;
+        }
+    }
+
+    for (const auto& inner : stmt->getBody()->getStatements()) {
+        resolveStmt(inner.get());
+    }
+
+    m_functionScopes.pop_back();
+    endScope();
+    m_stackSizes.pop_back();
+}
+
+// ===== Expressions =====
+
+void Resolver::resolveExpr(const Expr* expr) {
+    if (!expr) return;
+
+    switch (expr->getKind()) {
+        case ExprKind::Variable: {
+            auto* e = static_cast<const VariableExpr*>(expr);
+            resolveReference(e, e->getName());
+            break;
+        }
+        case ExprKind::Assignment: {
+            auto* e = static_cast<const AssignmentExpr*>(expr);
+            resolveExpr(e->getValue());
+            resolveReference(e, e->getName());
+            break;
+        }
+        case ExprKind::Binary: {
+            auto* e = static_cast<const BinaryExpr*>(expr);
+            resolveExpr(e->getLeft());
+            resolveExpr(e->getRight());
+            break;
+        }
+        case ExprKind::Logical: {
+            auto* e = static_cast<const LogicalExpr*>(expr);
+            resolveExpr(e->getLeft());
+            resolveExpr(e->getRight());
+            break;
+        }
+        case ExprKind::Unary:
+            resolveExpr(static_cast<const UnaryExpr*>(expr)->getOperand());
+            break;
+        case ExprKind::Grouping:
+            resolveExpr(static_cast<const GroupingExpr*>(expr)->getExpression());
+            break;
+        case ExprKind::Call: {
+            auto* e = static_cast<const CallExpr*>(expr);
+            resolveExpr(e->getCallee());
+            for (const auto& arg : e->getArguments()) {
+                resolveExpr(arg.get());
+            }
+            break;
+        }
+        case ExprKind::Index: {
+            auto* e = static_cast<const IndexExpr*>(expr);
+            resolveExpr(e->getObject());
+            resolveExpr(e->getIndex());
+            break;
+        }
+        case ExprKind::Member:
+            resolveExpr(static_cast<const MemberExpr*>(expr)->getObject());
+            break;
+        case ExprKind::Array:
+            for (const auto& element : static_cast<const ArrayExpr*>(expr)->getElements()) {
+                resolveExpr(element.get());
+            }
+            break;
+        case ExprKind::Map:
+            for (const auto& pair : static_cast<const MapExpr*>(expr)->getPairs()) {
+                resolveExpr(pair.second.get());
+            }
+            break;
+        case ExprKind::Literal:
+            break;
+    }
+}
+
+void Resolver::resolveReference(const Expr* expr, const Token& name) {
+    for (usize i = m_scopes.size(); i-- > 0;) {
+        auto it = m_scopes[i].bindings.find(name.getSymbol());
+        if (it == m_scopes[i].bindings.end()) {
+            continue;
+        }
+
+        const void* declaration = it->second;
+        if (m_pass == Pass::Bind) {
+            if (m_declarationFunction[declaration] < m_functionScopes.size()) {
+                m_captured[declaration] = true;
+            }
+            return;
+        }
+
+        VariableSlot slot = m_declarations[declaration];
+        if (slot.kind == VariableSlot::Kind::Captured) {
+            usize depth = 0;
+            for (usize j = i + 1; j < m_scopes.size(); ++j) {
+                if (m_scopes[j].hasEnv) depth++;
+            }
+            if (depth > std::numeric_limits<u16>::max()) {
+                addError(name, "Scope nesting too deep");
+            }
+            slot.depth = static_cast<u16>(depth);
+        }
+        m_references[expr] = slot;
+        return;
+    }
+
+    if (m_pass == Pass::Layout) {
+        m_references[expr] = VariableSlot{};
+    }
+}
+
+// ===== Scopes =====
+
+void Resolver::beginScope(const void* owner) {
+    m_scopes.push_back({owner, {}, getScopeSize(owner) > 0, 0, 0});
+}
+
+void Resolver::endScope() {
+    if (m_pass == Pass::Layout) {
+        m_stackSizes.back() -= m_scopes.back().stackDeclared;
+    }
+    m_scopes.pop_back();
+}
+
+void Resolver::declare(const void* declaration, Symbol name) {
+    // Top-level declarations are globals
+    if (m_scopes.empty()) {
+        if (m_pass == Pass::Layout) {
+            m_declarations[declaration] = VariableSlot{};
+        }
+        return;
+    }
+
+    Scope& scope = m_scopes.back();
+    scope.bindings[name] = declaration;
+
+    if (m_pass == Pass::Bind) {
+        m_declarationScope[declaration] = scope.owner;
+        m_declarationFunction[declaration] = m_functionScopes.size();
+        return;
+    }
+
+    VariableSlot slot;
+    if (m_captured.count(declaration)) {
+        slot.kind = VariableSlot::Kind::Captured;
+        slot.slot = scope.nextEnvSlot++;
+    } else {
+        if (m_stackSizes.back() == std::numeric_limits<u16>::max()) {
+            m_hasError = true;
+            m_errors.push_back("Resolve error: too many local variables in one function");
+            return;
+        }
+        slot.kind = VariableSlot::Kind::Local;
+        slot.slot = m_stackSizes.back()++;
+        scope.stackDeclared++;
+    }
+    m_declarations[declaration] = slot;
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,70 @@
+#include "oracon/lang/interpreter/environment.h"
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+void Environment::define(const String& name, const Value& value) {
+    define(Symbol::intern(name), value);
+}
+
+Value Environment::get(const String& name) const {
+    Symbol symbol = Symbol::find(name);
+    if (symbol.isEmpty()) {
+        throw std::runtime_error("Undefined variable: " + name);
+    }
+    return get(symbol);
+}
+
+void Environment::set(const String& name, const Value& value) {
+    Symbol symbol = Symbol::find(name);
+    if (symbol.isEmpty()) {
+        throw std::runtime_error("Undefined variable: " + name);
+    }
+    set(symbol, value);
+}
+
+bool Environment::has(const String& name) const {
+    Symbol symbol = Symbol::find(name);
+    for (const Environment* env = this; env; env = env->m_parent) {
+        if (env->m_values.count(symbol)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Environment::hasLocal(const String& name) const {
+    return m_values.count(Symbol::find(name)) > 0;
+}
+
+Value Environment::get(Symbol name) const {
+    for (const Environment* env = this; env; env = env->m_parent) {
+        auto it = env->m_values.find(name);
+        if (it != env->m_values.end()) {
+            return it->second;
+        }
+    }
+    throw std::runtime_error("Undefined variable: " + name.str());
+}
+
+void Environment::set(Symbol name, const Value& value) {
+    Value* slot = lookup(name);
+    if (!slot) {
+        throw std::runtime_error("Undefined variable: " + name.str());
+    }
+    *slot = value;
+}
+
+Value* Environment::lookup(Symbol name) {
+    for (Environment* env = this; env; env = env->m_parent) {
+        auto it = env->m_values.find(name);
+        if (it != env->m_values.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace lang
+} // namespace oracon
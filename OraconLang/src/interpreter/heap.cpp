@@ -0,0 +1,341 @@
+#include "oracon/lang/interpreter/heap.h"
+#include "oracon/lang/interpreter/environment.h"
+#include "oracon/lang/interpreter/value.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// Bookkeeping node of a hash table entry, for estimates
+constexpr usize HASH_NODE_OVERHEAD = 2 * sizeof(void*);
+
+usize sizeOfValues(const std::vector<Value>& values) {
+    return sizeof(values) + values.capacity() * sizeof(Value);
+}
+
+} // namespace
+
+Heap::Heap()
+    : m_objectCount(0)
+    , m_objectBytes(0)
+    , m_otherBytes(0)
+    , m_threshold(MIN_COLLECT_BYTES)
+{
+    m_list.m_prev = &m_list;
+    m_list.m_next = &m_list;
+}
+
+Heap::~Heap() {
+    HeapObject* object = m_list.m_next;
+    while (object != &m_list) {
+        HeapObject* next = object->m_next;
+        object->m_heap = nullptr;
+        object->m_prev = nullptr;
+        object->m_next = nullptr;
+        object = next;
+    }
+}
+
+void Heap::track(HeapObject* object, HeapKind kind) {
+    object->m_heap = this;
+    object->m_kind = kind;
+    object->m_prev = &m_list;
+    object->m_next = m_list.m_next;
+    m_list.m_next->m_prev = object;
+    m_list.m_next = object;
+
+    object->m_bytes = sizeOf(object);
+    m_objectBytes += object->m_bytes;
+    ++m_objectCount;
+}
+
+void Heap::untrack(HeapObject* object) {
+    object->m_prev->m_next = object->m_next;
+    object->m_next->m_prev = object->m_prev;
+    object->m_heap = nullptr;
+
+    m_objectBytes -= std::min(m_objectBytes, object->m_bytes);
+    --m_objectCount;
+}
+
+void Heap::resize(HeapObject* object) {
+    usize bytes = sizeOf(object);
+    m_objectBytes -= std::min(m_objectBytes, object->m_bytes);
+    m_objectBytes += bytes;
+    object->m_bytes = bytes;
+}
+
+usize Heap::sizeOf(const HeapObject* object) {
+    switch (object->m_kind) {
+        case HeapKind::Array: {
+            const Array* array = static_cast<const Array*>(object);
+            return sizeof(Array) + (array->m_buffer ? sizeOfValues(*array->m_buffer) : 0);
+        }
+        case HeapKind::Map: {
+            const Map* map = static_cast<const Map*>(object);
+            usize bytes = sizeof(Map);
+            if (map->m_storage) {
+                const Map::Storage& storage = *map->m_storage;
+                bytes += sizeof(Map::Storage) + storage.slots.capacity() * sizeof(Value) +
+                         storage.keys.capacity() * sizeof(Symbol) +
+                         storage.index.size() * (sizeof(std::pair<const Symbol, u32>) + HASH_NODE_OVERHEAD) +
+                         storage.index.bucket_count() * sizeof(void*);
+            }
+            return bytes;
+        }
+        case HeapKind::Function:
+            return sizeof(Function);
+    }
+    return 0;
+}
+
+usize Heap::sizeOf(const Environment& env) {
+    return sizeof(Environment) + env.m_slots.capacity() * sizeof(Value) +
+           env.m_values.size() * (sizeof(std::pair<const Symbol, Value>) + HASH_NODE_OVERHEAD) +
+           env.m_values.bucket_count() * sizeof(void*);
+}
+
+HeapStats Heap::getStats() const {
+    HeapStats stats = m_stats;
+    stats.objects = m_objectCount;
+    stats.bytes = getBytes();
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+    return stats;
+}
+
+void Heap::collect(const std::vector<Environment*>& roots, const std::vector<Environment*>& scopes,
+                   std::vector<Environment*>& dead) {
+    auto start = std::chrono::steady_clock::now();
+    m_stats.peakBytes = std::max(m_stats.peakBytes, getBytes());
+
+    // Nodes are tracked objects and the array buffers and map storages they
+    // point to, which slices and snapshots share. refs starts as the
+    // refcount and ends as the number of references from outside the heap.
+    struct Node {
+        i64 refs;
+        bool marked;
+    };
+    struct Container {
+        HeapKind kind;   // Array for a buffer, Map for a storage
+        const void* address;
+    };
+    using Buffer = std::vector<Value>;
+
+    std::unordered_map<const void*, Node> nodes;
+    std::vector<Container> containers;
+    std::unordered_map<Environment*, bool> envs;   // known scopes, and whether they are reachable
+
+    nodes.reserve(m_objectCount * 2);
+    for (Environment* env : roots) {
+        if (env) envs.emplace(env, false);
+    }
+    for (Environment* env : scopes) {
+        if (env) envs.emplace(env, false);
+    }
+
+    auto trackedObject = [this](const Value& value) -> HeapObject* {
+        HeapObject* object = nullptr;
+        switch (value.getType()) {
+            case ValueType::Array: object = value.get<ArrayType>().get(); break;
+            case ValueType::Map: object = value.get<MapType>().get(); break;
+            case ValueType::Function: object = value.get<FunctionType>().get(); break;
+            default: break;
+        }
+        return object && object->m_heap == this ? object : nullptr;
+    };
+
+    auto forEachValue = [](const Container& container, auto&& fn) {
+        if (container.kind == HeapKind::Array) {
+            for (const Value& value : *static_cast<const Buffer*>(container.address)) fn(value);
+        } else {
+            for (const Value& value : static_cast<const Map::Storage*>(container.address)->slots) fn(value);
+        }
+    };
+    auto forEachEnvValue = [](const Environment* env, auto&& fn) {
+        for (const auto& entry : env->m_values) fn(entry.second);
+        for (const Value& value : env->m_slots) fn(value);
+    };
+
+    // Counts, with the references from objects to their containers taken off
+    for (HeapObject* object = m_list.m_next; object != &m_list; object = object->m_next) {
+        nodes.emplace(object, Node{static_cast<i64>(object->getRefCount()), false});
+    }
+    for (HeapObject* object = m_list.m_next; object != &m_list; object = object->m_next) {
+        const void* address = nullptr;
+        u32 count = 0;
+        if (object->m_kind == HeapKind::Array) {
+            const Array* array = static_cast<const Array*>(object);
+            address = array->m_buffer.get();
+            count = array->m_buffer.useCount();
+        } else if (object->m_kind == HeapKind::Map) {
+            const Map* map = static_cast<const Map*>(object);
+            address = map->m_storage.get();
+            count = map->m_storage.useCount();
+        }
+        if (!address) continue;
+
+        auto inserted = nodes.emplace(address, Node{static_cast<i64>(count), false});
+        if (inserted.second) {
+            containers.push_back({object->m_kind, address});
+        }
+        inserted.first->second.refs--;
+    }
+
+    // ...and the references held by containers and scopes
+    auto subtract = [&](const Value& value) {
+        if (HeapObject* object = trackedObject(value)) {
+            nodes[object].refs--;
+        }
+    };
+    for (const Container& container : containers) {
+        forEachValue(container, subtract);
+    }
+    for (const auto& entry : envs) {
+        forEachEnvValue(entry.first, subtract);
+    }
+
+    // Mark from what is still referenced from outside, and from the root scopes
+    std::vector<HeapObject*> objectStack;
+    std::vector<Container> containerStack;
+    std::vector<Environment*> envStack;
+    std::unordered_set<const void*> counted;   // strings and typed arrays already measured
+    usize objectBytes = 0;
+    usize otherBytes = 0;
+
+    auto markObject = [&](HeapObject* object) {
+        Node& node = nodes[object];
+        if (!node.marked) {
+            node.marked = true;
+            objectStack.push_back(object);
+        }
+    };
+    auto markContainer = [&](const Container& container) {
+        Node& node = nodes[container.address];
+        if (!node.marked) {
+            node.marked = true;
+            containerStack.push_back(container);
+        }
+    };
+    auto markEnv = [&](Environment* env) {
+        auto it = envs.find(env);
+        if (it != envs.end() && !it->second) {
+            it->second = true;
+            envStack.push_back(env);
+        }
+    };
+    auto markValue = [&](const Value& value) {
+        if (HeapObject* object = trackedObject(value)) {
+            markObject(object);
+        } else if (value.isString()) {
+            const String* string = value.getStringRef().get();
+            if (counted.insert(string).second) otherBytes += sizeof(String) + string->capacity();
+        } else if (value.isFloat64Array()) {
+            const std::vector<f64>* array = value.get<Float64ArrayType>().get();
+            if (counted.insert(array).second) otherBytes += sizeof(*array) + array->capacity() * sizeof(f64);
+        } else if (value.isInt64Array()) {
+            const std::vector<i64>* array = value.get<Int64ArrayType>().get();
+            if (counted.insert(array).second) otherBytes += sizeof(*array) + array->capacity() * sizeof(i64);
+        }
+    };
+
+    for (HeapObject* object = m_list.m_next; object != &m_list; object = object->m_next) {
+        if (nodes[object].refs > 0) markObject(object);
+    }
+    for (const Container& container : containers) {
+        if (nodes[container.address].refs > 0) markContainer(container);
+    }
+    for (Environment* env : roots) {
+        if (env) markEnv(env);
+    }
+
+    while (!objectStack.empty() || !containerStack.empty() || !envStack.empty()) {
+        if (!objectStack.empty()) {
+            HeapObject* object = objectStack.back();
+            objectStack.pop_back();
+            object->m_bytes = sizeOf(object);
+            objectBytes += object->m_bytes;
+
+            if (object->m_kind == HeapKind::Array) {
+                const Array* array = static_cast<const Array*>(object);
+                if (array->m_buffer) markContainer({HeapKind::Array, array->m_buffer.get()});
+            } else if (object->m_kind == HeapKind::Map) {
+                const Map* map = static_cast<const Map*>(object);
+                if (map->m_storage) markContainer({HeapKind::Map, map->m_storage.get()});
+            } else {
+                markEnv(static_cast<const Function*>(object)->getClosure());
+            }
+        } else if (!containerStack.empty()) {
+            Container container = containerStack.back();
+            containerStack.pop_back();
+            forEachValue(container, markValue);
+        } else {
+            Environment* env = envStack.back();
+            envStack.pop_back();
+            otherBytes += sizeOf(*env);
+            forEachEnvValue(env, markValue);
+            markEnv(env->m_parent);
+        }
+    }
+
+    // Whatever is unmarked is only referenced by other garbage. Move the
+    // contents out of all of it before releasing anything, so no object is
+    // freed while the collector still points to it.
+    std::vector<Ref<Buffer>> buffers;
+    std::vector<Ref<Map::Storage>> storages;
+    std::vector<Value> values;
+    usize garbage = 0;
+
+    for (HeapObject* object = m_list.m_next; object != &m_list; object = object->m_next) {
+        if (nodes[object].marked) continue;
+        ++garbage;
+        if (object->m_kind == HeapKind::Array) {
+            Array* array = static_cast<Array*>(object);
+            buffers.push_back(std::move(array->m_buffer));
+            array->m_offset = 0;
+            array->m_size = 0;
+        } else if (object->m_kind == HeapKind::Map) {
+            Map* map = static_cast<Map*>(object);
+            storages.push_back(std::move(map->m_storage));
+            map->m_shape = Shape::root();
+        }
+    }
+
+    usize deadBefore = dead.size();
+    for (Environment* env : scopes) {
+        auto it = envs.find(env);
+        if (it == envs.end() || it->second) continue;
+        for (auto& entry : env->m_values) {
+            values.push_back(std::move(entry.second));
+        }
+        for (Value& value : env->m_slots) {
+            values.push_back(std::move(value));
+        }
+        env->m_values.clear();
+        env->m_slots.clear();
+        it->second = true;   // listed once even if it appears twice
+        dead.push_back(env);
+    }
+
+    values.clear();
+    storages.clear();
+    buffers.clear();
+
+    m_objectBytes = objectBytes;
+    m_otherBytes = otherBytes;
+    m_threshold = getBytes() + std::max(MIN_COLLECT_BYTES, getBytes());
+
+    f64 pauseMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m_stats.collections++;
+    m_stats.freedObjects += garbage;
+    m_stats.freedScopes += dead.size() - deadBefore;
+    m_stats.lastPauseMs = pauseMs;
+    m_stats.totalPauseMs += pauseMs;
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,521 @@
+#include "oracon/lang/interpreter/interpreter.h"
+#include "oracon/lang/runtime/builtins.h"
+#include "oracon/lang/vm/operators.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// Script calls recurse on the C++ stack; deeper than this is reported
+// instead of overflowing it
+constexpr usize MAX_CALL_DEPTH = 256;
+
+// Most scopes and argument vectors kept for reuse
+constexpr usize FREE_SCOPES_MAX = 256;
+constexpr usize FREE_ARGUMENTS_MAX = 64;
+
+template<typename Op>
+Value applyBinary(const Value& a, const Value& b) {
+    Value result;
+    if (const char* error = Op::apply(a, b, result)) {
+        throw std::runtime_error(error);
+    }
+    return result;
+}
+
+} // namespace
+
+Interpreter::Interpreter()
+    : m_currentEnv(&m_globalEnv)
+    , m_callDepth(0)
+    , m_hasError(false)
+{
+    defineBuiltins();
+}
+
+Interpreter::~Interpreter() {
+    // As in the VM: collecting with no roots frees the cycles among what the
+    // interpreter holds; values the host still holds survive
+    std::vector<Environment*> scopes;
+    scopes.push_back(&m_globalEnv);
+    for (const auto& scope : m_keptScopes) scopes.push_back(scope.get());
+    std::vector<Environment*> dead;
+    m_heap.collect({}, scopes, dead);
+}
+
+void Interpreter::execute(const Program* program) {
+    if (!program) return;
+
+    Heap::Scope heapScope(m_heap);
+    try {
+        for (const auto& stmt : program->getStatements()) {
+            // return, break and continue outside a function or loop end the script
+            if (executeStmt(stmt.get()) != ExecSignal::Normal) {
+                break;
+            }
+        }
+    } catch (const std::exception& e) {
+        runtimeError(e.what());
+    }
+
+    m_currentEnv = &m_globalEnv;
+    m_callDepth = 0;
+    m_returnValue = Value();
+}
+
+Value Interpreter::callFunction(const String& name, const std::vector<Value>& arguments) {
+    Heap::Scope heapScope(m_heap);
+    Value result;
+    try {
+        result = callFunctionValue(m_globalEnv.get(name), arguments);
+    } catch (const std::exception& e) {
+        runtimeError(e.what());
+    }
+
+    m_currentEnv = &m_globalEnv;
+    m_callDepth = 0;
+    return result;
+}
+
+// ===== Statements =====
+
+ExecSignal Interpreter::executeStmt(const Stmt* stmt) {
+    switch (stmt->getKind()) {
+        case StmtKind::Expr: return executeExprStmt(static_cast<const ExprStmt*>(stmt));
+        case StmtKind::VarDecl: return executeVarDecl(static_cast<const VarDeclStmt*>(stmt));
+        case StmtKind::If: return executeIf(static_cast<const IfStmt*>(stmt));
+        case StmtKind::While: return executeWhile(static_cast<const WhileStmt*>(stmt));
+        case StmtKind::For: return executeFor(static_cast<const ForStmt*>(stmt));
+        case StmtKind::Return: return executeReturn(static_cast<const ReturnStmt*>(stmt));
+        case StmtKind::Break: return executeBreak(static_cast<const BreakStmt*>(stmt));
+        case StmtKind::Continue: return executeContinue(static_cast<const ContinueStmt*>(stmt));
+        case StmtKind::Function: return executeFunctionDecl(static_cast<const FunctionStmt*>(stmt));
+        case StmtKind::Class: return executeClassDecl(static_cast<const ClassStmt*>(stmt));
+        case StmtKind::Block:
+            return executeScoped(static_cast<const BlockStmt*>(stmt), acquireScope(m_currentEnv));
+    }
+    throw std::runtime_error("Unknown statement type");
+}
+
+ExecSignal Interpreter::executeExprStmt(const ExprStmt* stmt) {
+    evaluateExpr(stmt->getExpression());
+    return ExecSignal::Normal;
+}
+
+ExecSignal Interpreter::executeVarDecl(const VarDeclStmt* stmt) {
+    Value value;
+    if (stmt->getInitializer()) {
+        value = evaluateExpr(stmt->getInitializer());
+    }
+    m_currentEnv->define(stmt->getName().getSymbol(), value);
+    return ExecSignal::Normal;
+}
+
+ExecSignal Interpreter::executeBlock(const BlockStmt* stmt, Environment* env) {
+    Environment* previous = m_currentEnv;
+    m_currentEnv = env;
+
+    ExecSignal signal = ExecSignal::Normal;
+    try {
+        for (const auto& inner : stmt->getStatements()) {
+            signal = executeStmt(inner.get());
+            if (signal != ExecSignal::Normal) break;
+        }
+    } catch (...) {
+        m_currentEnv = previous;
+        throw;
+    }
+
+    m_currentEnv = previous;
+    return signal;
+}
+
+ExecSignal Interpreter::executeScoped(const BlockStmt* block, std::unique_ptr<Environment> scope) {
+    m_activeScopes.push_back(scope.get());
+    ExecSignal signal = ExecSignal::Normal;
+    try {
+        signal = executeBlock(block, scope.get());
+    } catch (...) {
+        releaseScope(std::move(scope));
+        throw;
+    }
+    releaseScope(std::move(scope));
+    return signal;
+}
+
+std::unique_ptr<Environment> Interpreter::acquireScope(Environment* parent) {
+    if (m_freeScopes.empty()) {
+        return std::make_unique<Environment>(parent);
+    }
+    std::unique_ptr<Environment> scope = std::move(m_freeScopes.back());
+    m_freeScopes.pop_back();
+    scope->reset(parent, 0);
+    return scope;
+}
+
+void Interpreter::releaseScope(std::unique_ptr<Environment> scope) {
+    m_activeScopes.pop_back();
+    if (!m_captured.empty() && m_captured.erase(scope.get()) > 0) {
+        m_heap.noteAllocation(Heap::sizeOf(*scope));
+        m_keptScopes.push_back(std::move(scope));
+    } else if (m_freeScopes.size() < FREE_SCOPES_MAX) {
+        // Drop what it holds now rather than when it is reused
+        scope->reset(nullptr, 0);
+        m_freeScopes.push_back(std::move(scope));
+    }
+    if (m_heap.shouldCollect()) {
+        collectGarbage();
+    }
+}
+
+void Interpreter::collectGarbage() {
+    // Roots are the globals and every block and call still running; a kept
+    // scope survives only while one of them, or a value held from outside,
+    // reaches a closure over it
+    std::vector<Environment*> roots;
+    roots.push_back(&m_globalEnv);
+    roots.insert(roots.end(), m_activeScopes.begin(), m_activeScopes.end());
+    std::vector<Environment*> scopes;
+    for (const auto& scope : m_keptScopes) scopes.push_back(scope.get());
+
+    std::vector<Environment*> dead;
+    m_heap.collect(roots, scopes, dead);
+    if (dead.empty()) return;
+
+    std::sort(dead.begin(), dead.end());
+    m_keptScopes.erase(std::remove_if(m_keptScopes.begin(), m_keptScopes.end(),
+        [&dead](const std::unique_ptr<Environment>& scope) {
+            return std::binary_search(dead.begin(), dead.end(), scope.get());
+        }), m_keptScopes.end());
+}
+
+HeapStats Interpreter::getHeapStats() const {
+    HeapStats stats = m_heap.getStats();
+    stats.scopes = m_keptScopes.size();
+    return stats;
+}
+
+ExecSignal Interpreter::executeIf(const IfStmt* stmt) {
+    if (evaluateExpr(stmt->getCondition()).asBool()) {
+        return executeStmt(stmt->getThenBranch());
+    }
+    if (stmt->getElseBranch()) {
+        return executeStmt(stmt->getElseBranch());
+    }
+    return ExecSignal::Normal;
+}
+
+ExecSignal Interpreter::executeWhile(const WhileStmt* stmt) {
+    while (evaluateExpr(stmt->getCondition()).asBool()) {
+        ExecSignal signal = executeStmt(stmt->getBody());
+        if (signal == ExecSignal::Break) break;
+        if (signal == ExecSignal::Return) return signal;
+    }
+    return ExecSignal::Normal;
+}
+
+// The initializer's variable lives in a scope of its own around the loop
+ExecSignal Interpreter::executeFor(const ForStmt* stmt) {
+    auto scope = acquireScope(m_currentEnv);
+    Environment* previous = m_currentEnv;
+    m_currentEnv = scope.get();
+    m_activeScopes.push_back(scope.get());
+
+    ExecSignal result = ExecSignal::Normal;
+    try {
+        if (stmt->getInitializer()) {
+            executeStmt(stmt->getInitializer());
+        }
+        while (!stmt->getCondition() || evaluateExpr(stmt->getCondition()).asBool()) {
+            ExecSignal signal = executeStmt(stmt->getBody());
+            if (signal == ExecSignal::Break) break;
+            if (signal == ExecSignal::Return) {
+                result = signal;
+                break;
+            }
+            if (stmt->getIncrement()) {
+                evaluateExpr(stmt->getIncrement());
+            }
+        }
+    } catch (...) {
+        m_currentEnv = previous;
+        releaseScope(std::move(scope));
+        throw;
+    }
+
+    m_currentEnv = previous;
+    releaseScope(std::move(scope));
+    return result;
+}
+
+ExecSignal Interpreter::executeReturn(const ReturnStmt* stmt) {
+    m_returnValue = stmt->getValue() ? evaluateExpr(stmt->getValue()) : Value();
+    return ExecSignal::Return;
+}
+
+ExecSignal Interpreter::executeBreak(const BreakStmt* stmt) {
+    (void)stmt;
+    return ExecSignal::Break;
+}
+
+ExecSignal Interpreter::executeContinue(const ContinueStmt* stmt) {
+    (void)stmt;
+    return ExecSignal::Continue;
+}
+
+ExecSignal Interpreter::executeFunctionDecl(const FunctionStmt* stmt) {
+    // A function declared inside a block or call keeps every scope it can see
+    for (Environment* env = m_currentEnv; env && env != &m_globalEnv; env = env->getParent()) {
+        m_captured.insert(env);
+    }
+
+    Value function(makeRef<Function>(stmt, m_currentEnv));
+    m_currentEnv->define(stmt->getName().getSymbol(), function);
+    return ExecSignal::Normal;
+}
+
+ExecSignal Interpreter::executeClassDecl(const ClassStmt* stmt) {
+    (void)stmt;
+    throw std::runtime_error("Classes are not supported yet");
+}
+
+// ===== Expressions =====
+
+Value Interpreter::evaluateExpr(const Expr* expr) {
+    switch (expr->getKind()) {
+        case ExprKind::Variable: return evaluateVariable(static_cast<const VariableExpr*>(expr));
+        case ExprKind::Literal: return evaluateLiteral(static_cast<const LiteralExpr*>(expr));
+        case ExprKind::Binary: return evaluateBinary(static_cast<const BinaryExpr*>(expr));
+        case ExprKind::Call: return evaluateCall(static_cast<const CallExpr*>(expr));
+        case ExprKind::Assignment: return evaluateAssignment(static_cast<const AssignmentExpr*>(expr));
+        case ExprKind::Index: return evaluateIndex(static_cast<const IndexExpr*>(expr));
+        case ExprKind::Member: return evaluateMember(static_cast<const MemberExpr*>(expr));
+        case ExprKind::Logical: return evaluateLogical(static_cast<const LogicalExpr*>(expr));
+        case ExprKind::Unary: return evaluateUnary(static_cast<const UnaryExpr*>(expr));
+        case ExprKind::Grouping: return evaluateGrouping(static_cast<const GroupingExpr*>(expr));
+        case ExprKind::Array: return evaluateArray(static_cast<const ArrayExpr*>(expr));
+        case ExprKind::Map: return evaluateMap(static_cast<const MapExpr*>(expr));
+    }
+    throw std::runtime_error("Unknown expression type");
+}
+
+Value Interpreter::evaluateLiteral(const LiteralExpr* expr) {
+    return expr->getValue();
+}
+
+Value Interpreter::evaluateVariable(const VariableExpr* expr) {
+    return m_currentEnv->get(expr->getName().getSymbol());
+}
+
+Value Interpreter::evaluateUnary(const UnaryExpr* expr) {
+    Value operand = evaluateExpr(expr->getOperand());
+
+    switch (expr->getOperator().getType()) {
+        case TokenType::MINUS: {
+            Value result;
+            if (const char* error = ops::Negate::apply(operand, result)) {
+                throw std::runtime_error(error);
+            }
+            return result;
+        }
+        case TokenType::PLUS:
+            if (!operand.isNumber()) throw std::runtime_error("Operand must be a number");
+            return operand;
+        case TokenType::NOT:
+            return Value(!operand.asBool());
+        default:
+            throw std::runtime_error("Unknown unary operator");
+    }
+}
+
+// Same semantics as the VM's opcodes (see vm/operators.h)
+Value Interpreter::evaluateBinary(const BinaryExpr* expr) {
+    Value left = evaluateExpr(expr->getLeft());
+    Value right = evaluateExpr(expr->getRight());
+
+    switch (expr->getOperator().getType()) {
+        case TokenType::PLUS: return applyBinary<ops::Add>(left, right);
+        case TokenType::MINUS: return applyBinary<ops::Subtract>(left, right);
+        case TokenType::STAR: return applyBinary<ops::Multiply>(left, right);
+        case TokenType::SLASH: return applyBinary<ops::Divide>(left, right);
+        case TokenType::PERCENT: return applyBinary<ops::Modulo>(left, right);
+        case TokenType::POWER: return applyBinary<ops::Power>(left, right);
+        case TokenType::EQUAL: return applyBinary<ops::Equality<true>>(left, right);
+        case TokenType::NOT_EQUAL: return applyBinary<ops::Equality<false>>(left, right);
+        case TokenType::LESS: return applyBinary<ops::Comparison<ops::LessThan>>(left, right);
+        case TokenType::LESS_EQUAL: return applyBinary<ops::Comparison<ops::LessEqual>>(left, right);
+        case TokenType::GREATER: return applyBinary<ops::Comparison<ops::GreaterThan>>(left, right);
+        case TokenType::GREATER_EQUAL: return applyBinary<ops::Comparison<ops::GreaterEqual>>(left, right);
+        default:
+            throw std::runtime_error("Unknown binary operator");
+    }
+}
+
+Value Interpreter::evaluateGrouping(const GroupingExpr* expr) {
+    return evaluateExpr(expr->getExpression());
+}
+
+Value Interpreter::evaluateAssignment(const AssignmentExpr* expr) {
+    Value value = evaluateExpr(expr->getValue());
+    m_currentEnv->set(expr->getName().getSymbol(), value);
+    return value;
+}
+
+Value Interpreter::evaluateLogical(const LogicalExpr* expr) {
+    Value left = evaluateExpr(expr->getLeft());
+    if (expr->getOperator().is(TokenType::OR)) {
+        if (left.asBool()) return left;
+    } else if (!left.asBool()) {
+        return left;
+    }
+    return evaluateExpr(expr->getRight());
+}
+
+Value Interpreter::evaluateCall(const CallExpr* expr) {
+    Value callee = evaluateExpr(expr->getCallee());
+
+    // Nested calls each take their own vector; one lost to an exception is
+    // simply not reused
+    std::vector<Value> arguments;
+    if (!m_freeArguments.empty()) {
+        arguments = std::move(m_freeArguments.back());
+        m_freeArguments.pop_back();
+    }
+    arguments.reserve(expr->getArguments().size());
+    for (const auto& argument : expr->getArguments()) {
+        arguments.push_back(evaluateExpr(argument.get()));
+    }
+
+    Value result = callFunctionValue(callee, arguments);
+    if (m_freeArguments.size() < FREE_ARGUMENTS_MAX) {
+        arguments.clear();
+        m_freeArguments.push_back(std::move(arguments));
+    }
+    return result;
+}
+
+Value Interpreter::evaluateArray(const ArrayExpr* expr) {
+    std::vector<Value> elements;
+    elements.reserve(expr->getElements().size());
+    for (const auto& element : expr->getElements()) {
+        elements.push_back(evaluateExpr(element.get()));
+    }
+    return Value::createArray(std::move(elements));
+}
+
+Value Interpreter::evaluateIndex(const IndexExpr* expr) {
+    Value object = evaluateExpr(expr->getObject());
+    Value index = evaluateExpr(expr->getIndex());
+
+    if (object.isArray() || object.isTypedArray()) {
+        if (!index.isInteger()) throw std::runtime_error("Array index must be an integer");
+        i64 i = index.get<i64>();
+        if (i < 0) throw std::runtime_error("Array index cannot be negative");
+        usize at = static_cast<usize>(i);
+        if (object.isArray()) {
+            if (at >= object.arraySize()) throw std::runtime_error("Array index out of bounds");
+            return object.arrayGet(at);
+        }
+        if (object.isFloat64Array()) {
+            const auto& array = object.get<Float64ArrayType>();
+            if (at >= array->size()) throw std::runtime_error("Array index out of bounds");
+            return Value((*array)[at]);
+        }
+        const auto& array = object.get<Int64ArrayType>();
+        if (at >= array->size()) throw std::runtime_error("Array index out of bounds");
+        return Value((*array)[at]);
+    }
+
+    if (object.isMap()) {
+        if (!index.isString()) throw std::runtime_error("Map key must be a string");
+        return object.mapGet(index.get<String>());
+    }
+
+    throw std::runtime_error("Can only index arrays and maps");
+}
+
+Value Interpreter::evaluateMember(const MemberExpr* expr) {
+    Value object = evaluateExpr(expr->getObject());
+    const Token& member = expr->getMember();
+    if (!object.isMap()) {
+        throw std::runtime_error("Only maps have members: '" + String(member.getLexeme()) + "'");
+    }
+    return object.mapGet(member.getSymbol());
+}
+
+Value Interpreter::evaluateMap(const MapExpr* expr) {
+    Value map = Value::createMap();
+    for (const auto& pair : expr->getPairs()) {
+        // Keys written in the source are permanent, as the compiler makes them
+        map.mapSet(Symbol::intern(pair.first), evaluateExpr(pair.second.get()));
+    }
+    return map;
+}
+
+// ===== Calls =====
+
+Value Interpreter::callFunctionValue(const Value& callee, const std::vector<Value>& arguments) {
+    if (!callee.isFunction()) {
+        throw std::runtime_error("Can only call functions");
+    }
+
+    const FunctionType& function = callee.get<FunctionType>();
+    if (function->isNative()) {
+        return function->call(arguments, &m_globalEnv);
+    }
+    return callUserFunction(function, arguments);
+}
+
+Value Interpreter::callUserFunction(const FunctionType& function, const std::vector<Value>& arguments) {
+    if (arguments.size() != function->arity()) {
+        throw std::runtime_error(function->arityError(arguments.size()));
+    }
+    if (m_callDepth >= MAX_CALL_DEPTH) {
+        throw std::runtime_error("Stack overflow");
+    }
+
+    const FunctionStmt* declaration = function->getDeclaration();
+    Environment* closure = function->getClosure() ? function->getClosure() : &m_globalEnv;
+    auto scope = acquireScope(closure);
+
+    const auto& params = declaration->getParameters();
+    for (usize i = 0; i < params.size(); ++i) {
+        scope->define(params[i].getSymbol(), arguments[i]);
+    }
+
+    m_callDepth++;
+    ExecSignal signal = ExecSignal::Normal;
+    try {
+        signal = executeScoped(declaration->getBody(), std::move(scope));
+    } catch (...) {
+        m_callDepth--;
+        throw;
+    }
+    m_callDepth--;
+
+    if (signal != ExecSignal::Return) {
+        return Value();
+    }
+    Value result = std::move(m_returnValue);
+    m_returnValue = Value();
+    return result;
+}
+
+// ===== Errors and builtins =====
+
+void Interpreter::runtimeError(const String& message) {
+    m_hasError = true;
+    m_errors.push_back("Runtime error: " + message);
+}
+
+void Interpreter::defineBuiltins() {
+    registerBuiltins(m_globalEnv);
+    registerTypedArrayBuiltins(m_globalEnv);
+    registerCollectionBuiltins(m_globalEnv);
+}
+
+} // namespace lang
+} // namespace oracon
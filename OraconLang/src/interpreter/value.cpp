@@ -0,0 +1,560 @@
+#include "oracon/lang/interpreter/value.h"
+#include "oracon/lang/interpreter/environment.h"
+#include "oracon/lang/ast/ast.h"
+#include <charconv>
+#include <sstream>
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+// ===== Function =====
+
+Function::Function(const FunctionStmt* declaration, Environment* closure)
+    : m_name(String(declaration->getName().getLexeme()))
+    , m_arity(declaration->getParameters().size())
+    , m_maxArity(m_arity)
+    , m_isNative(false)
+    , m_declaration(declaration)
+    , m_closure(closure)
+    , m_nativeFunction(nullptr)
+    , m_fastNative(nullptr)
+    , m_userData(nullptr)
+{}
+
+Function::Function(const String& name, usize arity, NativeFunction fn)
+    : m_name(name)
+    , m_arity(arity)
+    , m_maxArity(arity)
+    , m_isNative(true)
+    , m_declaration(nullptr)
+    , m_closure(nullptr)
+    , m_nativeFunction(std::move(fn))
+    , m_fastNative(nullptr)
+    , m_userData(nullptr)
+{}
+
+Function::Function(const String& name, usize minArity, usize maxArity, NativeFn fn, void* userData)
+    : m_name(name)
+    , m_arity(minArity)
+    , m_maxArity(maxArity)
+    , m_isNative(true)
+    , m_declaration(nullptr)
+    , m_closure(nullptr)
+    , m_nativeFunction(nullptr)
+    , m_fastNative(fn)
+    , m_userData(userData)
+{}
+
+Value Function::call(const std::vector<Value>& arguments, Environment* globals) {
+    (void)globals;
+
+    if (!m_isNative) {
+        throw std::runtime_error("Cannot call script function '" + m_name +
+                                 "' outside its interpreter; use callFunction");
+    }
+    if (!acceptsArgCount(arguments.size())) {
+        throw std::runtime_error(arityError(arguments.size()));
+    }
+    if (m_fastNative) {
+        return m_fastNative(m_userData, NativeArgs(arguments.data(), arguments.size()));
+    }
+    return m_nativeFunction(arguments);
+}
+
+String Function::arityError(usize count) const {
+    String expected = std::to_string(m_arity);
+    if (m_maxArity != m_arity) {
+        expected += " to " + std::to_string(m_maxArity);
+    }
+    return "Expected " + expected + " arguments but got " + std::to_string(count);
+}
+
+Value Function::callNative(NativeArgs args) const {
+    if (m_fastNative) {
+        return m_fastNative(m_userData, args);
+    }
+    return m_nativeFunction(std::vector<Value>(args.begin(), args.end()));
+}
+
+// ===== Shape =====
+
+const Shape* Shape::root() {
+    static const Shape s_root;
+    return &s_root;
+}
+
+const Shape* Shape::withKey(Symbol key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& next = m_transitions[key];
+    if (!next) {
+        next.reset(new Shape());
+        next->m_keys.reserve(m_keys.size() + 1);
+        next->m_keys = m_keys;
+        next->m_keys.push_back(key);
+    }
+    return next.get();
+}
+
+i32 Shape::find(Symbol key) const {
+    for (usize i = 0; i < m_keys.size(); ++i) {
+        if (m_keys[i] == key) {
+            return static_cast<i32>(i);
+        }
+    }
+    return -1;
+}
+
+// ===== Map =====
+
+Map::Map(const Shape* shape, std::vector<Value>&& slots)
+    : m_shape(shape)
+    , m_storage(makeRef<Storage>())
+{
+    m_storage->slots = std::move(slots);
+}
+
+const Value* Map::find(Symbol key) const {
+    if (!m_storage) {
+        return nullptr;
+    }
+    if (m_shape) {
+        i32 slot = m_shape->find(key);
+        return slot >= 0 ? &m_storage->slots[static_cast<usize>(slot)] : nullptr;
+    }
+    auto it = m_storage->index.find(key);
+    return it != m_storage->index.end() ? &m_storage->slots[it->second] : nullptr;
+}
+
+Map::Storage::Storage(const Storage& other)
+    : slots(other.slots)
+    , keys(other.keys)
+    , index(other.index)
+    , hasRuntimeKeys(other.hasRuntimeKeys)
+{
+    if (hasRuntimeKeys) {
+        for (const Symbol& key : keys) key.retain();
+    }
+}
+
+Map::Storage::~Storage() {
+    if (hasRuntimeKeys) {
+        for (const Symbol& key : keys) key.release();
+    }
+}
+
+void Map::set(Symbol key, Value value) {
+    Storage& storage = makeWritable();
+    usize capacity = storage.slots.capacity();
+    // Shapes live forever, so a runtime key must not enter one
+    if (m_shape && key.isRuntime()) {
+        convertToDictionary();
+    }
+    if (m_shape) {
+        i32 slot = m_shape->find(key);
+        if (slot >= 0) {
+            storage.slots[static_cast<usize>(slot)] = std::move(value);
+            return;
+        }
+        if (storage.slots.size() < MAX_SHAPED_KEYS) {
+            m_shape = m_shape->withKey(key);
+            storage.slots.push_back(std::move(value));
+            if (storage.slots.capacity() != capacity) {
+                resized();
+            }
+            return;
+        }
+        convertToDictionary();
+    }
+
+    auto inserted = storage.index.emplace(key, static_cast<u32>(storage.slots.size()));
+    if (inserted.second) {
+        if (key.isRuntime()) {
+            key.retain();
+            storage.hasRuntimeKeys = true;
+        }
+        storage.keys.push_back(key);
+        storage.slots.push_back(std::move(value));
+        if (storage.slots.capacity() != capacity) {
+            resized();
+        }
+    } else {
+        storage.slots[inserted.first->second] = std::move(value);
+    }
+}
+
+bool Map::erase(Symbol key) {
+    if (!find(key)) {
+        return false;
+    }
+    Storage& storage = makeWritable();
+    if (m_shape) {
+        convertToDictionary();
+    }
+
+    // Move the last entry into the hole so slots stay dense
+    u32 slot = storage.index[key];
+    u32 last = static_cast<u32>(storage.slots.size() - 1);
+    if (slot != last) {
+        storage.slots[slot] = std::move(storage.slots[last]);
+        storage.keys[slot] = storage.keys[last];
+        storage.index[storage.keys[slot]] = slot;
+    }
+    storage.slots.pop_back();
+    storage.keys.pop_back();
+    storage.index.erase(key);
+    if (storage.hasRuntimeKeys) {
+        key.release();
+    }
+    return true;
+}
+
+Map::Storage& Map::makeWritable() {
+    if (!m_storage) {
+        m_storage = makeRef<Storage>();
+    } else if (m_storage.useCount() > 1) {
+        m_storage = makeRef<Storage>(*m_storage);
+        resized();
+    }
+    return *m_storage;
+}
+
+void Map::convertToDictionary() {
+    Storage& storage = *m_storage;
+    storage.keys.reserve(storage.slots.size() + 1);
+    storage.index.reserve(storage.slots.size() + 1);
+    for (usize i = 0; i < m_shape->size(); ++i) {
+        storage.keys.push_back(m_shape->keyAt(i));
+        storage.index.emplace(storage.keys.back(), static_cast<u32>(i));
+    }
+    m_shape = nullptr;
+}
+
+// ===== Array =====
+
+Array::Array(std::vector<Value>&& values)
+    : m_buffer(makeRef<std::vector<Value>>(std::move(values)))
+    , m_offset(0)
+    , m_size(m_buffer->size())
+{
+}
+
+void Array::set(usize index, Value value) {
+    makeWritable();
+    (*m_buffer)[index] = std::move(value);
+}
+
+void Array::push_back(Value value) {
+    makeWritable();
+    usize capacity = m_buffer->capacity();
+    m_buffer->push_back(std::move(value));
+    ++m_size;
+    if (m_buffer->capacity() != capacity) {
+        resized();
+    }
+}
+
+Value Array::pop() {
+    makeWritable();
+    Value result = std::move(m_buffer->back());
+    m_buffer->pop_back();
+    --m_size;
+    return result;
+}
+
+void Array::reserve(usize capacity) {
+    makeWritable();
+    m_buffer->reserve(capacity);
+    resized();
+}
+
+Array Array::slice(usize start, usize end) const {
+    Array result;
+    if (start < end) {
+        result.m_buffer = m_buffer;
+        result.m_offset = m_offset + start;
+        result.m_size = end - start;
+    }
+    return result;
+}
+
+void Array::makeWritable() {
+    if (!m_buffer) {
+        m_buffer = makeRef<std::vector<Value>>();
+        return;
+    }
+    bool exact = m_offset == 0 && m_size == m_buffer->size();
+    if (m_buffer.useCount() == 1) {
+        // Sole owner of a buffer a dropped parent left behind: trim it in place
+        if (!exact) {
+            m_buffer->erase(m_buffer->begin() + static_cast<std::ptrdiff_t>(m_offset + m_size), m_buffer->end());
+            m_buffer->erase(m_buffer->begin(), m_buffer->begin() + static_cast<std::ptrdiff_t>(m_offset));
+            m_offset = 0;
+        }
+        return;
+    }
+    m_buffer = makeRef<std::vector<Value>>(begin(), end());
+    m_offset = 0;
+    resized();
+}
+
+// ===== Value =====
+
+namespace {
+
+// Number formatting without a stream; the same text as operator<< gives
+void appendNumber(String& out, i64 value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void appendNumber(String& out, f64 value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    out.append(buffer, result.ptr);
+}
+
+} // namespace
+
+Value Value::createArray() {
+    return Value(makeRef<Array>());
+}
+
+Value Value::createArray(const std::vector<Value>& values) {
+    return Value(makeRef<Array>(std::vector<Value>(values)));
+}
+
+Value Value::createArray(std::vector<Value>&& values) {
+    return Value(makeRef<Array>(std::move(values)));
+}
+
+Value Value::createMap() {
+    return Value(makeRef<Map>());
+}
+
+String Value::toString() const {
+    // Scalars never pay for constructing a stream
+    switch (m_type) {
+        case ValueType::Nil:
+            return "nil";
+        case ValueType::Boolean:
+            return m_bool ? "true" : "false";
+        case ValueType::Integer:
+        case ValueType::Float: {
+            String text;
+            appendTo(text);
+            return text;
+        }
+        case ValueType::String:
+            return *m_string;
+        case ValueType::Array: {
+            std::ostringstream oss;
+            oss << "[";
+            for (usize i = 0; i < m_array->size(); ++i) {
+                if (i > 0) oss << ", ";
+                oss << (*m_array)[i].toString();
+            }
+            oss << "]";
+            return oss.str();
+        }
+        case ValueType::Float64Array: {
+            std::ostringstream oss;
+            oss << "Float64Array[";
+            for (usize i = 0; i < m_f64Array->size(); ++i) {
+                if (i > 0) oss << ", ";
+                oss << (*m_f64Array)[i];
+            }
+            oss << "]";
+            return oss.str();
+        }
+        case ValueType::Int64Array: {
+            std::ostringstream oss;
+            oss << "Int64Array[";
+            for (usize i = 0; i < m_i64Array->size(); ++i) {
+                if (i > 0) oss << ", ";
+                oss << (*m_i64Array)[i];
+            }
+            oss << "]";
+            return oss.str();
+        }
+        case ValueType::Map: {
+            std::ostringstream oss;
+            oss << "{";
+            bool first = true;
+            for (usize i = 0; i < m_map->size(); ++i) {
+                if (!first) oss << ", ";
+                oss << m_map->keyAt(i).str() << ": " << m_map->slot(i).toString();
+                first = false;
+            }
+            oss << "}";
+            return oss.str();
+        }
+        case ValueType::Function:
+            return "<function " + m_function->name() + ">";
+    }
+    return "unknown";
+}
+
+bool Value::asBool() const {
+    switch (m_type) {
+        case ValueType::Nil: return false;
+        case ValueType::Boolean: return m_bool;
+        case ValueType::Integer: return m_int != 0;
+        case ValueType::Float: return m_float != 0.0;
+        case ValueType::String: return !m_string->empty();
+        case ValueType::Array: return !m_array->empty();
+        case ValueType::Float64Array: return !m_f64Array->empty();
+        case ValueType::Int64Array: return !m_i64Array->empty();
+        case ValueType::Map: return !m_map->empty();
+        case ValueType::Function: return true;
+    }
+    return false;
+}
+
+i64 Value::asInteger() const {
+    if (isInteger()) return m_int;
+    if (isFloat()) return static_cast<i64>(m_float);
+    if (isBool()) return m_bool ? 1 : 0;
+    return 0;
+}
+
+f64 Value::asFloat() const {
+    if (isFloat()) return m_float;
+    if (isInteger()) return static_cast<f64>(m_int);
+    if (isBool()) return m_bool ? 1.0 : 0.0;
+    return 0.0;
+}
+
+void Value::appendTo(String& out) const {
+    switch (m_type) {
+        case ValueType::Nil: out += "nil"; break;
+        case ValueType::Boolean: out += m_bool ? "true" : "false"; break;
+        case ValueType::Integer: appendNumber(out, m_int); break;
+        case ValueType::Float: appendNumber(out, m_float); break;
+        case ValueType::String: out += *m_string; break;
+        default: out += toString(); break;
+    }
+}
+
+void Value::concat(const Value& a, const Value& b, Value& target) {
+    if (&target == &a && &b != &a && a.isString() && a.m_string.useCount() == 1) {
+        // Growth is charged like a new string's buffer
+        String& text = *a.m_string.get();
+        usize capacity = text.capacity();
+        b.appendTo(text);
+        if (text.capacity() > capacity) {
+            Heap::noteCurrent(text.capacity() - capacity);
+        }
+        return;
+    }
+
+    String text;
+    a.appendTo(text);
+    b.appendTo(text);
+    target = Value(std::move(text));
+}
+
+String Value::asString() const {
+    if (isString()) return *m_string;
+    return toString();
+}
+
+// ===== Arrays =====
+
+usize Value::arraySize() const {
+    if (!isArray()) return 0;
+    return m_array->size();
+}
+
+Value Value::arrayGet(usize index) const {
+    if (!isArray() || index >= m_array->size()) {
+        return Value();
+    }
+    return (*m_array)[index];
+}
+
+void Value::arraySet(usize index, const Value& value) {
+    if (isArray() && index < m_array->size()) {
+        m_array->set(index, value);
+    }
+}
+
+void Value::arrayPush(const Value& value) {
+    if (isArray()) {
+        m_array->push_back(value);
+    }
+}
+
+Value Value::arrayPop() {
+    if (!isArray() || m_array->empty()) {
+        return Value();
+    }
+    return m_array->pop();
+}
+
+Value Value::arraySlice(usize start, usize end) const {
+    if (!isArray()) return Value();
+    usize size = m_array->size();
+    if (end > size) end = size;
+    if (start > end) start = end;
+    return Value(makeRef<Array>(m_array->slice(start, end)));
+}
+
+Value Value::snapshot() const {
+    if (isArray()) return Value(makeRef<Array>(*m_array));
+    if (isMap()) return Value(makeRef<Map>(*m_map));
+    if (isTypedArray()) {
+        return m_type == ValueType::Float64Array ? Value(makeRef<std::vector<f64>>(*m_f64Array))
+                                                 : Value(makeRef<std::vector<i64>>(*m_i64Array));
+    }
+    return *this;
+}
+
+// ===== Maps =====
+
+usize Value::mapSize() const {
+    if (!isMap()) return 0;
+    return m_map->size();
+}
+
+Value Value::mapGet(const String& key) const {
+    // A key that is neither interned nor held cannot be in any map
+    return mapGet(Symbol::find(key));
+}
+
+void Value::mapSet(const String& key, const Value& value) {
+    // The map takes its own hold; ours only covers the insert
+    Symbol symbol = Symbol::acquire(key);
+    mapSet(symbol, value);
+    symbol.release();
+}
+
+bool Value::mapHas(const String& key) const {
+    return isMap() && m_map->find(Symbol::find(key)) != nullptr;
+}
+
+void Value::mapDelete(const String& key) {
+    if (isMap()) {
+        m_map->erase(Symbol::find(key));
+    }
+}
+
+Value Value::mapGet(Symbol key) const {
+    if (!isMap()) return Value();
+    const Value* value = m_map->find(key);
+    return value ? *value : Value();
+}
+
+void Value::mapSet(Symbol key, const Value& value) {
+    if (isMap()) {
+        m_map->set(key, value);
+    }
+}
+
+FunctionType Value::asFunction() const {
+    return isFunction() ? m_function : FunctionType();
+}
+
+} // namespace lang
+} // namespace oracon
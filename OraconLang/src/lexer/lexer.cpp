@@ -0,0 +1,256 @@
+#include "oracon/lang/lexer/lexer.h"
+
+namespace oracon {
+namespace lang {
+
+Lexer::Lexer(std::string_view source, std::string_view filename)
+    : m_source(source)
+    , m_filename(Symbol::intern(filename))
+    , m_start(0)
+    , m_current(0)
+    , m_line(1)
+    , m_column(1)
+    , m_startColumn(1)
+    , m_hasError(false)
+{}
+
+std::vector<Token> Lexer::tokenize() {
+    std::vector<Token> tokens;
+    // Most tokens are a few characters long; avoids regrowing on long scripts
+    tokens.reserve(m_source.size() / 4 + 1);
+
+    for (;;) {
+        Token token = nextToken();
+        bool done = token.is(TokenType::EOF_TOKEN);
+        tokens.push_back(token);
+        if (done) break;
+    }
+    return tokens;
+}
+
+Token Lexer::nextToken() {
+    skipWhitespace();
+
+    m_start = m_current;
+    m_startColumn = m_column;
+
+    if (isAtEnd()) {
+        return makeToken(TokenType::EOF_TOKEN);
+    }
+
+    char c = advance();
+
+    if (isAlpha(c)) return scanIdentifier();
+    if (isDigit(c)) return scanNumber();
+
+    switch (c) {
+        case '"': return scanString();
+
+        case '(': return makeToken(TokenType::LPAREN);
+        case ')': return makeToken(TokenType::RPAREN);
+        case '{': return makeToken(TokenType::LBRACE);
+        case '}': return makeToken(TokenType::RBRACE);
+        case '[': return makeToken(TokenType::LBRACKET);
+        case ']': return makeToken(TokenType::RBRACKET);
+        case ',': return makeToken(TokenType::COMMA);
+        case ':': return makeToken(TokenType::COLON);
+        case ';': return makeToken(TokenType::SEMICOLON);
+        case '?': return makeToken(TokenType::QUESTION);
+
+        case '.':
+            if (match('.')) {
+                return makeToken(match('.') ? TokenType::SPREAD : TokenType::RANGE);
+            }
+            return makeToken(TokenType::DOT);
+
+        case '+': return makeToken(match('=') ? TokenType::PLUS_ASSIGN : TokenType::PLUS);
+        case '-': return makeToken(match('=') ? TokenType::MINUS_ASSIGN : TokenType::MINUS);
+        case '/': return makeToken(match('=') ? TokenType::SLASH_ASSIGN : TokenType::SLASH);
+        case '%': return makeToken(match('=') ? TokenType::PERCENT_ASSIGN : TokenType::PERCENT);
+
+        case '*':
+            if (match('*')) return makeToken(TokenType::POWER);
+            return makeToken(match('=') ? TokenType::STAR_ASSIGN : TokenType::STAR);
+
+        case '=':
+            if (match('=')) return makeToken(TokenType::EQUAL);
+            return makeToken(match('>') ? TokenType::ARROW : TokenType::ASSIGN);
+
+        case '!': return makeToken(match('=') ? TokenType::NOT_EQUAL : TokenType::NOT);
+        case '<': return makeToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS);
+        case '>': return makeToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER);
+
+        case '&':
+            if (match('&')) return makeToken(TokenType::AND);
+            return errorToken("Expected '&&'");
+
+        case '|':
+            if (match('|')) return makeToken(TokenType::OR);
+            return errorToken("Expected '||'");
+
+        default:
+            return errorToken("Unexpected character '" + String(1, c) + "'");
+    }
+}
+
+// ===== Character navigation =====
+
+char Lexer::peek(i32 offset) const {
+    usize index = m_current + static_cast<usize>(offset);
+    return index < m_source.size() ? m_source[index] : '\0';
+}
+
+char Lexer::advance() {
+    char c = m_source[m_current++];
+    if (c == '\n') {
+        m_line++;
+        m_column = 1;
+    } else {
+        m_column++;
+    }
+    return c;
+}
+
+bool Lexer::match(char expected) {
+    if (isAtEnd() || m_source[m_current] != expected) {
+        return false;
+    }
+    advance();
+    return true;
+}
+
+bool Lexer::isAtEnd() const {
+    return m_current >= m_source.size();
+}
+
+void Lexer::skipWhitespace() {
+    for (;;) {
+        switch (peek()) {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                advance();
+                break;
+            case '/':
+                if (peek(1) != '/' && peek(1) != '*') return;
+                skipComment();
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+void Lexer::skipComment() {
+    if (peek(1) == '/') {
+        while (!isAtEnd() && peek() != '\n') {
+            advance();
+        }
+        return;
+    }
+
+    u32 line = m_line;
+    u32 column = m_column;
+    advance();
+    advance();
+    while (!isAtEnd() && !(peek() == '*' && peek(1) == '/')) {
+        advance();
+    }
+    if (isAtEnd()) {
+        m_hasError = true;
+        m_errors.push_back("Lex error at line " + std::to_string(line) + ", column " +
+                           std::to_string(column) + ": Unterminated comment");
+        return;
+    }
+    advance();
+    advance();
+}
+
+// ===== Tokens =====
+
+Token Lexer::makeToken(TokenType type) {
+    return Token(type, m_source.substr(m_start, m_current - m_start),
+                 SourceLocation(m_filename, m_line, m_startColumn));
+}
+
+Token Lexer::errorToken(const String& message) {
+    addError(message);
+    return makeToken(TokenType::INVALID);
+}
+
+Token Lexer::scanString() {
+    u32 line = m_line;
+    while (!isAtEnd() && peek() != '"') {
+        if (advance() == '\\' && !isAtEnd()) {
+            advance();
+        }
+    }
+
+    if (isAtEnd()) {
+        return errorToken("Unterminated string");
+    }
+    advance();
+
+    // The token's text is the literal between the quotes, escapes unresolved
+    std::string_view text = m_source.substr(m_start + 1, m_current - m_start - 2);
+    return Token(TokenType::STRING, text, SourceLocation(m_filename, line, m_startColumn));
+}
+
+Token Lexer::scanNumber() {
+    while (isDigit(peek())) advance();
+
+    // A '.' needs a digit after it; 0..10 is a range, not a float
+    bool isFloat = false;
+    if (peek() == '.' && isDigit(peek(1))) {
+        isFloat = true;
+        advance();
+        while (isDigit(peek())) advance();
+    }
+
+    char sign = peek(1);
+    if ((peek() == 'e' || peek() == 'E') &&
+        (isDigit(sign) || ((sign == '+' || sign == '-') && isDigit(peek(2))))) {
+        isFloat = true;
+        advance();
+        if (!isDigit(peek())) advance();
+        while (isDigit(peek())) advance();
+    }
+
+    if (isAlpha(peek())) {
+        while (isAlphaNumeric(peek())) advance();
+        return errorToken("Invalid number literal");
+    }
+
+    return makeToken(isFloat ? TokenType::FLOAT : TokenType::INTEGER);
+}
+
+Token Lexer::scanIdentifier() {
+    while (isAlphaNumeric(peek())) advance();
+    return makeToken(identifierType());
+}
+
+bool Lexer::isDigit(char c) const {
+    return c >= '0' && c <= '9';
+}
+
+bool Lexer::isAlpha(char c) const {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool Lexer::isAlphaNumeric(char c) const {
+    return isAlpha(c) || isDigit(c);
+}
+
+TokenType Lexer::identifierType() const {
+    return lookupKeyword(m_source.substr(m_start, m_current - m_start));
+}
+
+void Lexer::addError(const String& message) {
+    m_hasError = true;
+    m_errors.push_back("Lex error at line " + std::to_string(m_line) + ", column " +
+                       std::to_string(m_startColumn) + ": " + message);
+}
+
+} // namespace lang
+} // namespace oracon
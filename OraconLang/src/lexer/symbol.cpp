@@ -0,0 +1,132 @@
+#include "oracon/lang/lexer/symbol.h"
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// Keys view the text owned by their entry, which never moves while it lives,
+// and carry its hash so a lookup hashes the text once
+struct Key {
+    std::string_view text;
+    usize hash;
+
+    bool operator==(const Key& other) const { return text == other.text; }
+};
+
+struct KeyHash {
+    usize operator()(const Key& key) const { return key.hash; }
+};
+
+// The table is split by hash so threads interning different names do not
+// contend, and lookups share their shard's lock
+constexpr usize SHARD_COUNT = 16;
+
+struct Shard {
+    std::shared_mutex mutex;
+    std::unordered_map<Key, std::unique_ptr<Symbol::Entry>, KeyHash> entries;
+};
+
+Shard& shardFor(usize hash) {
+    static Shard s_shards[SHARD_COUNT];
+    return s_shards[hash % SHARD_COUNT];
+}
+
+Symbol::Entry* findEntry(Shard& shard, const Key& key) {
+    auto it = shard.entries.find(key);
+    return it != shard.entries.end() ? it->second.get() : nullptr;
+}
+
+// Adds a new entry; the caller holds the shard's lock exclusively
+Symbol::Entry* addEntry(Shard& shard, const Key& key, bool permanent) {
+    auto entry = std::make_unique<Symbol::Entry>();
+    entry->text = String(key.text);
+    entry->hash = key.hash;
+    entry->permanent.store(permanent, std::memory_order_relaxed);
+    entry->holds = 0;
+    Symbol::Entry* result = entry.get();
+    shard.entries.emplace(Key{std::string_view(result->text), key.hash}, std::move(entry));
+    return result;
+}
+
+} // namespace
+
+const String Symbol::s_empty;
+
+Symbol Symbol::intern(std::string_view text) {
+    Key key{text, std::hash<std::string_view>()(text)};
+    Shard& shard = shardFor(key.hash);
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        const Entry* entry = findEntry(shard, key);
+        if (entry && entry->permanent.load(std::memory_order_acquire)) {
+            return Symbol(entry);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    Entry* entry = findEntry(shard, key);
+    if (entry) {
+        entry->permanent.store(true, std::memory_order_release);
+        return Symbol(entry);
+    }
+    return Symbol(addEntry(shard, key, true));
+}
+
+Symbol Symbol::acquire(std::string_view text) {
+    Key key{text, std::hash<std::string_view>()(text)};
+    Shard& shard = shardFor(key.hash);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    Entry* entry = findEntry(shard, key);
+    if (!entry) {
+        entry = addEntry(shard, key, false);
+    }
+    if (!entry->permanent.load(std::memory_order_relaxed)) {
+        entry->holds++;
+    }
+    return Symbol(entry);
+}
+
+Symbol Symbol::find(std::string_view text) {
+    Key key{text, std::hash<std::string_view>()(text)};
+    Shard& shard = shardFor(key.hash);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return Symbol(findEntry(shard, key));
+}
+
+void Symbol::retain() const {
+    if (!isRuntime()) return;
+    Shard& shard = shardFor(m_entry->hash);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (!m_entry->permanent.load(std::memory_order_relaxed)) {
+        m_entry->holds++;
+    }
+}
+
+void Symbol::release() const {
+    if (!isRuntime()) return;
+    Shard& shard = shardFor(m_entry->hash);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (!m_entry->permanent.load(std::memory_order_relaxed) && --m_entry->holds == 0) {
+        // The key views the entry's own text, so find before freeing it
+        auto it = shard.entries.find(Key{std::string_view(m_entry->text), m_entry->hash});
+        shard.entries.erase(it);
+    }
+}
+
+usize Symbol::getInternedCount() {
+    usize count = 0;
+    for (usize i = 0; i < SHARD_COUNT; ++i) {
+        Shard& shard = shardFor(i);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        count += shard.entries.size();
+    }
+    return count;
+}
+
+} // namespace lang
+} // namespace oracon
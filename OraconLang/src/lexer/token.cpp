@@ -4,6 +4,97 @@
 namespace oracon {
 namespace lang {
 
+namespace {
+
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword KEYWORDS[] = {
+    {"let", TokenType::LET},
+    {"const", TokenType::CONST},
+    {"func", TokenType::FUNC},
+    {"class", TokenType::CLASS},
+    {"static", TokenType::STATIC},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"while", TokenType::WHILE},
+    {"for", TokenType::FOR},
+    {"in", TokenType::IN},
+    {"return", TokenType::RETURN},
+    {"break", TokenType::BREAK},
+    {"continue", TokenType::CONTINUE},
+    {"try", TokenType::TRY},
+    {"catch", TokenType::CATCH},
+    {"finally", TokenType::FINALLY},
+    {"throw", TokenType::THROW},
+    {"import", TokenType::IMPORT},
+    {"export", TokenType::EXPORT},
+    {"from", TokenType::FROM},
+    {"as", TokenType::AS},
+    {"self", TokenType::SELF},
+    {"super", TokenType::SUPER},
+    {"match", TokenType::MATCH},
+    {"extends", TokenType::EXTENDS},
+    {"init", TokenType::INIT},
+    {"true", TokenType::TRUE},
+    {"false", TokenType::FALSE},
+    {"nil", TokenType::NIL},
+    {"and", TokenType::AND},
+    {"or", TokenType::OR},
+    {"not", TokenType::NOT},
+};
+
+constexpr usize KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+constexpr usize KEYWORD_MIN_LENGTH = 2;
+constexpr usize KEYWORD_MAX_LENGTH = 8;
+constexpr usize KEYWORD_SLOTS = 64;
+
+// Multipliers chosen so every keyword lands in its own slot
+constexpr usize keywordHash(std::string_view text) {
+    return (static_cast<u8>(text[0]) * 3u + static_cast<u8>(text[1]) * 23u + text.size() * 2u) &
+           (KEYWORD_SLOTS - 1);
+}
+
+struct KeywordTable {
+    i8 slots[KEYWORD_SLOTS];
+    bool perfect;
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table{};
+    for (usize i = 0; i < KEYWORD_SLOTS; ++i) {
+        table.slots[i] = -1;
+    }
+    table.perfect = true;
+    for (usize i = 0; i < KEYWORD_COUNT; ++i) {
+        usize slot = keywordHash(KEYWORDS[i].text);
+        if (table.slots[slot] >= 0) {
+            table.perfect = false;
+        }
+        table.slots[slot] = static_cast<i8>(i);
+    }
+    return table;
+}
+
+constexpr KeywordTable KEYWORD_TABLE = buildKeywordTable();
+static_assert(KEYWORD_TABLE.perfect, "Keyword hash collides; adjust keywordHash multipliers");
+
+} // namespace
+
+TokenType lookupKeyword(std::string_view text) {
+    if (text.size() < KEYWORD_MIN_LENGTH || text.size() > KEYWORD_MAX_LENGTH) {
+        return TokenType::IDENTIFIER;
+    }
+
+    i8 index = KEYWORD_TABLE.slots[keywordHash(text)];
+    if (index >= 0 && KEYWORDS[index].text == text) {
+        return KEYWORDS[index].type;
+    }
+    return TokenType::IDENTIFIER;
+}
+
 const char* tokenTypeToString(TokenType type) {
     switch (type) {
         case TokenType::INTEGER: return "INTEGER";
@@ -81,10 +172,30 @@ const char* tokenTypeToString(TokenType type) {
     }
 }
 
+String unescapeString(std::string_view text) {
+    String result;
+    result.reserve(text.size());
+    for (usize i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c != '\\' || i + 1 == text.size()) {
+            result += c;
+            continue;
+        }
+        switch (text[++i]) {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 'r': result += '\r'; break;
+            case '0': result += '\0'; break;
+            default: result += text[i]; break;
+        }
+    }
+    return result;
+}
+
 String Token::toString() const {
     std::ostringstream oss;
-    oss << tokenTypeToString(m_type) << " '" << m_lexeme << "' at "
-        << m_location.filename << ":" << m_location.line << ":" << m_location.column;
+    oss << tokenTypeToString(m_type) << " '" << getLexeme() << "' at "
+        << m_location.filename.str() << ":" << m_location.line << ":" << m_location.column;
     return oss.str();
 }
 
@@ -0,0 +1,545 @@
+#include "oracon/lang/parser/parser.h"
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// Unwinds to the enclosing declaration, which resynchronizes; the message
+// has already been recorded
+struct ParseError {};
+
+const usize MAX_ARGUMENTS = 255;
+
+// The binary operator a compound assignment applies
+TokenType compoundOperator(TokenType type, std::string_view& lexeme) {
+    switch (type) {
+        case TokenType::PLUS_ASSIGN:    lexeme = "+"; return TokenType::PLUS;
+        case TokenType::MINUS_ASSIGN:   lexeme = "-"; return TokenType::MINUS;
+        case TokenType::STAR_ASSIGN:    lexeme = "*"; return TokenType::STAR;
+        case TokenType::SLASH_ASSIGN:   lexeme = "/"; return TokenType::SLASH;
+        default:                        lexeme = "%"; return TokenType::PERCENT;
+    }
+}
+
+} // namespace
+
+Parser::Parser(const std::vector<Token>& tokens)
+    : m_tokens(tokens)
+    , m_current(0)
+    , m_program(nullptr)
+    , m_hasError(false)
+{}
+
+UniquePtr<Program> Parser::parse() {
+    auto program = makeUnique<Program>();
+    m_program = program.get();
+
+    while (!isAtEnd()) {
+        NodePtr<Stmt> stmt = declaration();
+        if (stmt) {
+            program->addStatement(std::move(stmt));
+        }
+    }
+
+    m_program = nullptr;
+    return program;
+}
+
+// ===== Error handling =====
+
+void Parser::addError(const String& message) {
+    addError(peek(), message);
+}
+
+void Parser::addError(const Token& token, const String& message) {
+    m_hasError = true;
+    String where = token.is(TokenType::EOF_TOKEN) ? " at end" : " at '" + String(token.getLexeme()) + "'";
+    m_errors.push_back("Parse error at line " + std::to_string(token.getLocation().line) +
+                       where + ": " + message);
+}
+
+void Parser::synchronize() {
+    advance();
+
+    while (!isAtEnd()) {
+        if (previous().is(TokenType::SEMICOLON)) return;
+
+        switch (peek().getType()) {
+            case TokenType::LET:
+            case TokenType::CONST:
+            case TokenType::FUNC:
+            case TokenType::CLASS:
+            case TokenType::IF:
+            case TokenType::WHILE:
+            case TokenType::FOR:
+            case TokenType::RETURN:
+                return;
+            default:
+                advance();
+        }
+    }
+}
+
+// ===== Token navigation =====
+
+Token Parser::peek() const {
+    return m_tokens[m_current];
+}
+
+Token Parser::previous() const {
+    return m_tokens[m_current - 1];
+}
+
+bool Parser::isAtEnd() const {
+    return m_tokens[m_current].is(TokenType::EOF_TOKEN);
+}
+
+Token Parser::advance() {
+    if (!isAtEnd()) m_current++;
+    return previous();
+}
+
+bool Parser::check(TokenType type) const {
+    return m_tokens[m_current].is(type);
+}
+
+bool Parser::match(TokenType type) {
+    if (!check(type)) return false;
+    advance();
+    return true;
+}
+
+bool Parser::match(const std::vector<TokenType>& types) {
+    for (TokenType type : types) {
+        if (check(type)) {
+            advance();
+            return true;
+        }
+    }
+    return false;
+}
+
+Token Parser::consume(TokenType type, const String& message) {
+    if (check(type)) return advance();
+    addError(message);
+    throw ParseError();
+}
+
+// ===== Statements =====
+// Semicolons end statements but may be left out at the end of a line
+
+NodePtr<Stmt> Parser::declaration() {
+    try {
+        if (match(TokenType::LET)) return varDeclaration();
+        if (match(TokenType::CONST)) return varDeclaration();
+        if (match(TokenType::FUNC)) return functionDeclaration("function");
+        if (match(TokenType::CLASS)) return classDeclaration();
+        return statement();
+    } catch (const ParseError&) {
+        synchronize();
+        return nullptr;
+    }
+}
+
+NodePtr<Stmt> Parser::varDeclaration() {
+    bool isConst = previous().is(TokenType::CONST);
+    Token name = consume(TokenType::IDENTIFIER, "Expected variable name");
+
+    NodePtr<Expr> initializer;
+    if (match(TokenType::ASSIGN)) {
+        initializer = expression();
+    } else if (isConst) {
+        addError("Constant '" + String(name.getLexeme()) + "' must be initialized");
+        throw ParseError();
+    }
+
+    match(TokenType::SEMICOLON);
+    return make<VarDeclStmt>(name, std::move(initializer), isConst);
+}
+
+NodePtr<Stmt> Parser::functionDeclaration(const String& kind) {
+    // Methods may be named init
+    Token name = check(TokenType::INIT) && kind == "method"
+        ? advance()
+        : consume(TokenType::IDENTIFIER, "Expected " + kind + " name");
+
+    consume(TokenType::LPAREN, "Expected '(' after " + kind + " name");
+    std::vector<Token> params;
+    if (!check(TokenType::RPAREN)) {
+        do {
+            if (params.size() >= MAX_ARGUMENTS) {
+                addError("Cannot have more than 255 parameters");
+                throw ParseError();
+            }
+            params.push_back(consume(TokenType::IDENTIFIER, "Expected parameter name"));
+        } while (match(TokenType::COMMA));
+    }
+    consume(TokenType::RPAREN, "Expected ')' after parameters");
+
+    consume(TokenType::LBRACE, "Expected '{' before " + kind + " body");
+    NodePtr<BlockStmt> body = blockStatement();
+    return make<FunctionStmt>(name, std::move(params), std::move(body));
+}
+
+NodePtr<Stmt> Parser::classDeclaration() {
+    Token name = consume(TokenType::IDENTIFIER, "Expected class name");
+    consume(TokenType::LBRACE, "Expected '{' before class body");
+
+    std::vector<NodePtr<FunctionStmt>> methods;
+    while (!check(TokenType::RBRACE) && !isAtEnd()) {
+        NodePtr<Stmt> method = functionDeclaration("method");
+        methods.push_back(NodePtr<FunctionStmt>(static_cast<FunctionStmt*>(method.release())));
+    }
+
+    consume(TokenType::RBRACE, "Expected '}' after class body");
+    return make<ClassStmt>(name, std::move(methods));
+}
+
+NodePtr<Stmt> Parser::statement() {
+    if (match(TokenType::IF)) return ifStatement();
+    if (match(TokenType::WHILE)) return whileStatement();
+    if (match(TokenType::FOR)) return forStatement();
+    if (match(TokenType::RETURN)) return returnStatement();
+    if (match(TokenType::BREAK)) return breakStatement();
+    if (match(TokenType::CONTINUE)) return continueStatement();
+    if (match(TokenType::LBRACE)) return blockStatement();
+    return exprStatement();
+}
+
+NodePtr<Stmt> Parser::exprStatement() {
+    NodePtr<Expr> expr = expression();
+    match(TokenType::SEMICOLON);
+    return make<ExprStmt>(std::move(expr));
+}
+
+// Conditions may be written with or without parentheses; without them the
+// body must be a block
+NodePtr<Stmt> Parser::ifStatement() {
+    NodePtr<Expr> condition = expression();
+    NodePtr<Stmt> thenBranch = statement();
+
+    NodePtr<Stmt> elseBranch;
+    if (match(TokenType::ELSE)) {
+        elseBranch = statement();
+    }
+
+    return make<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+}
+
+NodePtr<Stmt> Parser::whileStatement() {
+    NodePtr<Expr> condition = expression();
+    NodePtr<Stmt> body = statement();
+    return make<WhileStmt>(std::move(condition), std::move(body));
+}
+
+// for (init; condition; increment) body, or for i in start..end body, which
+// is the same loop counting i up from start while i < end
+NodePtr<Stmt> Parser::forStatement() {
+    if (check(TokenType::IDENTIFIER)) {
+        Token name = advance();
+        consume(TokenType::IN, "Expected 'in' after loop variable");
+        NodePtr<Expr> start = expression();
+        Token range = consume(TokenType::RANGE, "Expected '..' in range");
+        NodePtr<Expr> end = expression();
+        NodePtr<Stmt> body = statement();
+
+        const SourceLocation& loc = range.getLocation();
+        NodePtr<Stmt> init = make<VarDeclStmt>(name, std::move(start), false);
+        NodePtr<Expr> condition = make<BinaryExpr>(
+            make<VariableExpr>(name), Token(TokenType::LESS, "<", loc), std::move(end));
+        Token one(TokenType::INTEGER, "1", loc);
+        NodePtr<Expr> step = make<BinaryExpr>(
+            make<VariableExpr>(name), Token(TokenType::PLUS, "+", loc), make<LiteralExpr>(one, Value(i64(1))));
+        NodePtr<Expr> increment = make<AssignmentExpr>(name, std::move(step));
+        return make<ForStmt>(std::move(init), std::move(condition), std::move(increment),
+                             std::move(body));
+    }
+
+    consume(TokenType::LPAREN, "Expected '(' after 'for'");
+
+    NodePtr<Stmt> initializer;
+    if (match(TokenType::SEMICOLON)) {
+        // No initializer
+    } else if (match(TokenType::LET)) {
+        initializer = varDeclaration();
+    } else {
+        initializer = exprStatement();
+    }
+    if (!previous().is(TokenType::SEMICOLON)) {
+        consume(TokenType::SEMICOLON, "Expected ';' after loop initializer");
+    }
+
+    NodePtr<Expr> condition;
+    if (!check(TokenType::SEMICOLON)) {
+        condition = expression();
+    }
+    consume(TokenType::SEMICOLON, "Expected ';' after loop condition");
+
+    NodePtr<Expr> increment;
+    if (!check(TokenType::RPAREN)) {
+        increment = expression();
+    }
+    consume(TokenType::RPAREN, "Expected ')' after for clauses");
+
+    NodePtr<Stmt> body = statement();
+    return make<ForStmt>(std::move(initializer), std::move(condition), std::move(increment),
+                         std::move(body));
+}
+
+NodePtr<Stmt> Parser::returnStatement() {
+    Token keyword = previous();
+    NodePtr<Expr> value;
+    if (!check(TokenType::SEMICOLON) && !check(TokenType::RBRACE) && !isAtEnd()) {
+        value = expression();
+    }
+    match(TokenType::SEMICOLON);
+    return make<ReturnStmt>(keyword, std::move(value));
+}
+
+NodePtr<Stmt> Parser::breakStatement() {
+    Token keyword = previous();
+    match(TokenType::SEMICOLON);
+    return make<BreakStmt>(keyword);
+}
+
+NodePtr<Stmt> Parser::continueStatement() {
+    Token keyword = previous();
+    match(TokenType::SEMICOLON);
+    return make<ContinueStmt>(keyword);
+}
+
+NodePtr<BlockStmt> Parser::blockStatement() {
+    std::vector<NodePtr<Stmt>> statements;
+    while (!check(TokenType::RBRACE) && !isAtEnd()) {
+        NodePtr<Stmt> stmt = declaration();
+        if (stmt) {
+            statements.push_back(std::move(stmt));
+        }
+    }
+
+    consume(TokenType::RBRACE, "Expected '}' after block");
+    return make<BlockStmt>(std::move(statements));
+}
+
+// ===== Expressions =====
+
+NodePtr<Expr> Parser::expression() {
+    return assignment();
+}
+
+// x op= v is parsed as x = x op v
+NodePtr<Expr> Parser::assignment() {
+    NodePtr<Expr> expr = logicalOr();
+
+    if (match({TokenType::ASSIGN, TokenType::PLUS_ASSIGN, TokenType::MINUS_ASSIGN,
+               TokenType::STAR_ASSIGN, TokenType::SLASH_ASSIGN, TokenType::PERCENT_ASSIGN})) {
+        Token op = previous();
+        NodePtr<Expr> value = assignment();
+
+        auto* target = dynamic_cast<VariableExpr*>(expr.get());
+        if (!target) {
+            addError(op, "Invalid assignment target");
+            throw ParseError();
+        }
+
+        Token name = target->getName();
+        if (!op.is(TokenType::ASSIGN)) {
+            std::string_view lexeme;
+            TokenType type = compoundOperator(op.getType(), lexeme);
+            value = make<BinaryExpr>(std::move(expr), Token(type, lexeme, op.getLocation()),
+                                     std::move(value));
+        }
+        return make<AssignmentExpr>(name, std::move(value));
+    }
+
+    return expr;
+}
+
+NodePtr<Expr> Parser::logicalOr() {
+    NodePtr<Expr> expr = logicalAnd();
+    while (match(TokenType::OR)) {
+        Token op = previous();
+        NodePtr<Expr> right = logicalAnd();
+        expr = make<LogicalExpr>(std::move(expr), op, std::move(right));
+    }
+    return expr;
+}
+
+NodePtr<Expr> Parser::logicalAnd() {
+    NodePtr<Expr> expr = equality();
+    while (match(TokenType::AND)) {
+        Token op = previous();
+        NodePtr<Expr> right = equality();
+        expr = make<LogicalExpr>(std::move(expr), op, std::move(right));
+    }
+    return expr;
+}
+
+NodePtr<Expr> Parser::equality() {
+    NodePtr<Expr> expr = comparison();
+    while (match({TokenType::EQUAL, TokenType::NOT_EQUAL})) {
+        Token op = previous();
+        NodePtr<Expr> right = comparison();
+        expr = make<BinaryExpr>(std::move(expr), op, std::move(right));
+    }
+    return expr;
+}
+
+NodePtr<Expr> Parser::comparison() {
+    NodePtr<Expr> expr = term();
+    while (match({TokenType::LESS, TokenType::LESS_EQUAL,
+                  TokenType::GREATER, TokenType::GREATER_EQUAL})) {
+        Token op = previous();
+        NodePtr<Expr> right = term();
+        expr = make<BinaryExpr>(std::move(expr), op, std::move(right));
+    }
+    return expr;
+}
+
+NodePtr<Expr> Parser::term() {
+    NodePtr<Expr> expr = factor();
+    while (match({TokenType::PLUS, TokenType::MINUS})) {
+        Token op = previous();
+        NodePtr<Expr> right = factor();
+        expr = make<BinaryExpr>(std::move(expr), op, std::move(right));
+    }
+    return expr;
+}
+
+NodePtr<Expr> Parser::factor() {
+    NodePtr<Expr> expr = unary();
+    while (match({TokenType::STAR, TokenType::SLASH, TokenType::PERCENT})) {
+        Token op = previous();
+        NodePtr<Expr> right = unary();
+        expr = make<BinaryExpr>(std::move(expr), op, std::move(right));
+    }
+    return expr;
+}
+
+NodePtr<Expr> Parser::unary() {
+    if (match({TokenType::NOT, TokenType::MINUS, TokenType::PLUS})) {
+        Token op = previous();
+        NodePtr<Expr> operand = unary();
+        return make<UnaryExpr>(op, std::move(operand));
+    }
+    return power();
+}
+
+// ** binds tighter than unary minus on its left and is right-associative:
+// -2 ** 2 is -(2 ** 2), 2 ** 3 ** 2 is 2 ** (3 ** 2)
+NodePtr<Expr> Parser::power() {
+    NodePtr<Expr> expr = postfix();
+    if (match(TokenType::POWER)) {
+        Token op = previous();
+        NodePtr<Expr> right = unary();
+        expr = make<BinaryExpr>(std::move(expr), op, std::move(right));
+    }
+    return expr;
+}
+
+NodePtr<Expr> Parser::postfix() {
+    NodePtr<Expr> expr = primary();
+
+    for (;;) {
+        if (match(TokenType::LPAREN)) {
+            std::vector<NodePtr<Expr>> args;
+            if (!check(TokenType::RPAREN)) {
+                do {
+                    if (args.size() >= MAX_ARGUMENTS) {
+                        addError("Cannot have more than 255 arguments");
+                        throw ParseError();
+                    }
+                    args.push_back(expression());
+                } while (match(TokenType::COMMA));
+            }
+            Token paren = consume(TokenType::RPAREN, "Expected ')' after arguments");
+            expr = make<CallExpr>(std::move(expr), paren, std::move(args));
+        } else if (match(TokenType::LBRACKET)) {
+            NodePtr<Expr> index = expression();
+            consume(TokenType::RBRACKET, "Expected ']' after index");
+            expr = make<IndexExpr>(std::move(expr), std::move(index));
+        } else if (match(TokenType::DOT)) {
+            Token member = consume(TokenType::IDENTIFIER, "Expected member name after '.'");
+            expr = make<MemberExpr>(std::move(expr), member);
+        } else {
+            break;
+        }
+    }
+
+    return expr;
+}
+
+NodePtr<Expr> Parser::primary() {
+    if (match({TokenType::TRUE, TokenType::FALSE, TokenType::NIL,
+               TokenType::INTEGER, TokenType::FLOAT, TokenType::STRING})) {
+        return literal(previous());
+    }
+
+    if (match({TokenType::IDENTIFIER, TokenType::SELF})) {
+        return make<VariableExpr>(previous());
+    }
+
+    if (match(TokenType::LPAREN)) {
+        NodePtr<Expr> expr = expression();
+        consume(TokenType::RPAREN, "Expected ')' after expression");
+        return make<GroupingExpr>(std::move(expr));
+    }
+
+    if (match(TokenType::LBRACKET)) {
+        std::vector<NodePtr<Expr>> elements;
+        while (!check(TokenType::RBRACKET)) {
+            elements.push_back(expression());
+            if (!match(TokenType::COMMA)) break;
+        }
+        consume(TokenType::RBRACKET, "Expected ']' after array elements");
+        return make<ArrayExpr>(std::move(elements));
+    }
+
+    // Keys are bare identifiers or string literals
+    if (match(TokenType::LBRACE)) {
+        std::vector<MapExpr::KeyValuePair> pairs;
+        while (!check(TokenType::RBRACE)) {
+            String key;
+            if (match(TokenType::IDENTIFIER)) {
+                key = String(previous().getLexeme());
+            } else if (match(TokenType::STRING)) {
+                key = unescapeString(previous().getLexeme());
+            } else {
+                addError("Expected map key");
+                throw ParseError();
+            }
+            consume(TokenType::COLON, "Expected ':' after map key");
+            pairs.emplace_back(std::move(key), expression());
+            if (!match(TokenType::COMMA)) break;
+        }
+        consume(TokenType::RBRACE, "Expected '}' after map entries");
+        return make<MapExpr>(std::move(pairs));
+    }
+
+    addError("Expected expression");
+    throw ParseError();
+}
+
+NodePtr<Expr> Parser::literal(const Token& token) {
+    String text(token.getLexeme());
+    try {
+        switch (token.getType()) {
+            case TokenType::INTEGER: return make<LiteralExpr>(token, Value(static_cast<i64>(std::stoll(text))));
+            case TokenType::FLOAT: return make<LiteralExpr>(token, Value(static_cast<f64>(std::stod(text))));
+            case TokenType::STRING: return make<LiteralExpr>(token, Value(unescapeString(token.getLexeme())));
+            case TokenType::TRUE: return make<LiteralExpr>(token, Value(true));
+            case TokenType::FALSE: return make<LiteralExpr>(token, Value(false));
+            default: return make<LiteralExpr>(token, Value());
+        }
+    } catch (const std::logic_error&) {
+        // stoll and stod reject values out of range
+        addError(token, String(token.is(TokenType::INTEGER) ? "Invalid integer" : "Invalid float") +
+                            " literal '" + text + "'");
+        throw ParseError();
+    }
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,98 @@
+#include "oracon/lang/runtime/builtins.h"
+#include <iostream>
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// print(values...) - writes the values separated by spaces, then a newline
+Value builtinPrint(void* userData, NativeArgs args) {
+    (void)userData;
+    String line;
+    for (usize i = 0; i < args.size(); ++i) {
+        if (i > 0) line += ' ';
+        args[i].appendTo(line);
+    }
+    line += '\n';
+    std::cout << line;
+    return Value();
+}
+
+// len(value) - characters in a string, elements in an array, entries in a map
+Value builtinLen(void* userData, NativeArgs args) {
+    (void)userData;
+    const Value& value = args[0];
+    switch (value.getType()) {
+        case ValueType::String: return Value(static_cast<i64>(value.getStringRef()->size()));
+        case ValueType::Array: return Value(static_cast<i64>(value.arraySize()));
+        case ValueType::Map: return Value(static_cast<i64>(value.mapSize()));
+        default:
+            throw std::runtime_error("len: expected a string, array or map (use vlen for typed arrays)");
+    }
+}
+
+// type(value) - the name of the value's type, as the language spec spells it
+Value builtinType(void* userData, NativeArgs args) {
+    (void)userData;
+    switch (args[0].getType()) {
+        case ValueType::Nil: return Value(String("nil"));
+        case ValueType::Boolean: return Value(String("bool"));
+        case ValueType::Integer: return Value(String("int"));
+        case ValueType::Float: return Value(String("float"));
+        case ValueType::String: return Value(String("string"));
+        case ValueType::Array: return Value(String("array"));
+        case ValueType::Float64Array: return Value(String("Float64Array"));
+        case ValueType::Int64Array: return Value(String("Int64Array"));
+        case ValueType::Map: return Value(String("dict"));
+        case ValueType::Function: return Value(String("func"));
+    }
+    return Value(String("nil"));
+}
+
+// str(value) - the value as print would write it
+Value builtinStr(void* userData, NativeArgs args) {
+    (void)userData;
+    if (args[0].isString()) return args[0];
+    return Value(args[0].toString());
+}
+
+// push(array, value) - appends to the array in place
+Value builtinPush(void* userData, NativeArgs args) {
+    (void)userData;
+    if (!args[0].isArray()) {
+        throw std::runtime_error("push: expected an array");
+    }
+    Value array = args[0];
+    array.arrayPush(args[1]);
+    return Value();
+}
+
+// pop(array) - removes and returns the last element; nil when empty
+Value builtinPop(void* userData, NativeArgs args) {
+    (void)userData;
+    if (!args[0].isArray()) {
+        throw std::runtime_error("pop: expected an array");
+    }
+    Value array = args[0];
+    return array.arrayPop();
+}
+
+} // namespace
+
+void registerBuiltins(Environment& env) {
+    auto define = [&env](const char* name, usize minArity, usize maxArity, NativeFn fn) {
+        env.define(name, Value(makeRef<Function>(name, minArity, maxArity, fn, nullptr)));
+    };
+
+    define("print", 0, 255, builtinPrint);
+    define("len", 1, 1, builtinLen);
+    define("type", 1, 1, builtinType);
+    define("str", 1, 1, builtinStr);
+    define("push", 2, 2, builtinPush);
+    define("pop", 1, 1, builtinPop);
+}
+
+} // namespace lang
+} // namespace oracon
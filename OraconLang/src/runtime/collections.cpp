@@ -0,0 +1,53 @@
+#include "oracon/lang/runtime/builtins.h"
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// Position for a slice bound; negative values count from the end.
+// Out-of-range bounds are clamped, as an empty or shorter slice is never an error.
+usize sliceBound(const Value& value, usize size) {
+    if (!value.isInteger()) {
+        throw std::runtime_error("slice: bounds must be integers");
+    }
+    i64 bound = value.get<i64>();
+    i64 length = static_cast<i64>(size);
+    if (bound < 0) bound += length;
+    if (bound < 0) bound = 0;
+    if (bound > length) bound = length;
+    return static_cast<usize>(bound);
+}
+
+// slice(array, start [, end]) - view of [start, end) sharing the array's storage
+Value builtinSlice(void* userData, NativeArgs args) {
+    (void)userData;
+    if (!args[0].isArray()) {
+        throw std::runtime_error("slice: expected an array");
+    }
+    usize size = args[0].arraySize();
+    usize start = sliceBound(args[1], size);
+    usize end = args.size() > 2 ? sliceBound(args[2], size) : size;
+    return args[0].arraySlice(start, end);
+}
+
+// snapshot(value) - the current contents of an array or map, unaffected by later writes
+Value builtinSnapshot(void* userData, NativeArgs args) {
+    (void)userData;
+    return args[0].snapshot();
+}
+
+} // namespace
+
+void registerCollectionBuiltins(Environment& env) {
+    auto define = [&env](const char* name, usize minArity, usize maxArity, NativeFn fn) {
+        env.define(name, Value(makeRef<Function>(name, minArity, maxArity, fn, nullptr)));
+    };
+
+    define("slice", 2, 3, builtinSlice);
+    define("snapshot", 1, 1, builtinSnapshot);
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,524 @@
+#include "oracon/lang/runtime/builtins.h"
+#include "oracon/lang/vm/operators.h"
+#include "oracon/core/common.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#ifdef ORACON_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// ===== Kernels =====
+//
+// Each kernel has an SSE2 body for two lanes at a time and a scalar tail that
+// also serves as the whole loop on other targets. out may alias an input.
+// Integer kernels return false on overflow, as scalar integer arithmetic
+// fails; an element-wise kernel has written out by then. Integer sums and dot
+// products only fail if the total does not fit, whatever the order. Sums and
+// dot products of floats are accumulated in several lanes, so the last bits
+// can differ from a strict left-to-right sum.
+
+void addF64(const f64* a, const f64* b, f64* out, usize n) {
+    usize i = 0;
+#ifdef ORACON_SIMD_SSE2
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+void scaleF64(const f64* a, f64 factor, f64* out, usize n) {
+    usize i = 0;
+#ifdef ORACON_SIMD_SSE2
+    __m128d f = _mm_set1_pd(factor);
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), f));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = a[i] * factor;
+    }
+}
+
+f64 dotF64(const f64* a, const f64* b, usize n) {
+    usize i = 0;
+    f64 result = 0.0;
+#ifdef ORACON_SIMD_SSE2
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    f64 lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    result = lanes[0] + lanes[1];
+#endif
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+f64 sumF64(const f64* a, usize n) {
+    usize i = 0;
+    f64 result = 0.0;
+#ifdef ORACON_SIMD_SSE2
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(a + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(a + i + 2));
+    }
+    f64 lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    result = lanes[0] + lanes[1];
+#endif
+    for (; i < n; ++i) {
+        result += a[i];
+    }
+    return result;
+}
+
+// n must be at least 1. A NaN anywhere makes the result NaN on both paths;
+// _mm_min_pd and _mm_max_pd alone return whichever operand is second, so the
+// SSE2 body tracks NaN lanes separately.
+f64 minF64(const f64* a, usize n) {
+    usize i = 1;
+    f64 result = a[0];
+#ifdef ORACON_SIMD_SSE2
+    if (n >= 4) {
+        __m128d acc = _mm_loadu_pd(a);
+        __m128d nan = _mm_cmpunord_pd(acc, acc);
+        for (i = 2; i + 2 <= n; i += 2) {
+            __m128d v = _mm_loadu_pd(a + i);
+            nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+            acc = _mm_min_pd(acc, v);
+        }
+        if (_mm_movemask_pd(nan) != 0) {
+            return std::numeric_limits<f64>::quiet_NaN();
+        }
+        f64 lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        result = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    }
+#endif
+    if (std::isnan(result)) return result;
+    for (; i < n; ++i) {
+        if (std::isnan(a[i])) return a[i];
+        if (a[i] < result) result = a[i];
+    }
+    return result;
+}
+
+f64 maxF64(const f64* a, usize n) {
+    usize i = 1;
+    f64 result = a[0];
+#ifdef ORACON_SIMD_SSE2
+    if (n >= 4) {
+        __m128d acc = _mm_loadu_pd(a);
+        __m128d nan = _mm_cmpunord_pd(acc, acc);
+        for (i = 2; i + 2 <= n; i += 2) {
+            __m128d v = _mm_loadu_pd(a + i);
+            nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+            acc = _mm_max_pd(acc, v);
+        }
+        if (_mm_movemask_pd(nan) != 0) {
+            return std::numeric_limits<f64>::quiet_NaN();
+        }
+        f64 lanes[2];
+        _mm_storeu_pd(lanes, acc);
+        result = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    }
+#endif
+    if (std::isnan(result)) return result;
+    for (; i < n; ++i) {
+        if (std::isnan(a[i])) return a[i];
+        if (a[i] > result) result = a[i];
+    }
+    return result;
+}
+
+// A sum of i64 values kept in 128 bits, so only the total has to fit
+struct WideSum {
+    u64 low = 0;
+    i64 high = 0;
+
+    void add(i64 value) {
+        u64 before = low;
+        low += static_cast<u64>(value);
+        high += (value < 0 ? -1 : 0) + (low < before ? 1 : 0);
+    }
+    bool fits() const { return high == (static_cast<i64>(low) < 0 ? -1 : 0); }
+    i64 value() const { return static_cast<i64>(low); }
+};
+
+#ifdef ORACON_SIMD_SSE2
+// Adds two lanes at a time, marking the sign bit of overflow in a lane
+inline __m128i addTracked(__m128i x, __m128i y, __m128i& overflow) {
+    __m128i sum = _mm_add_epi64(x, y);
+    overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(x, sum), _mm_xor_si128(y, sum)));
+    return sum;
+}
+
+inline bool anyOverflow(__m128i overflow) {
+    return _mm_movemask_pd(_mm_castsi128_pd(overflow)) != 0;
+}
+#endif
+
+bool addI64(const i64* a, const i64* b, i64* out, usize n) {
+    usize i = 0;
+    bool overflowed = false;
+#ifdef ORACON_SIMD_SSE2
+    __m128i overflow = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), addTracked(x, y, overflow));
+    }
+    overflowed = anyOverflow(overflow);
+#endif
+    for (; i < n; ++i) {
+        overflowed = overflowed || ops::addOverflows(a[i], b[i]);
+        out[i] = static_cast<i64>(static_cast<u64>(a[i]) + static_cast<u64>(b[i]));
+    }
+    return !overflowed;
+}
+
+// The lanes add in a different order than left to right. When no partial
+// sum overflowed, the result is exact; otherwise the total is recounted in
+// 128 bits, since it may still fit.
+bool sumI64(const i64* a, usize n, i64& result) {
+    usize i = 0;
+    bool overflowed = false;
+    result = 0;
+#ifdef ORACON_SIMD_SSE2
+    __m128i overflow = _mm_setzero_si128();
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = addTracked(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), overflow);
+        acc1 = addTracked(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 2)), overflow);
+    }
+    i64 lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), addTracked(acc0, acc1, overflow));
+    overflowed = anyOverflow(overflow) || ops::addOverflows(lanes[0], lanes[1]);
+    result = static_cast<i64>(static_cast<u64>(lanes[0]) + static_cast<u64>(lanes[1]));
+#endif
+    for (; i < n && !overflowed; ++i) {
+        overflowed = ops::addOverflows(result, a[i]);
+        result += overflowed ? 0 : a[i];
+    }
+    if (!overflowed) return true;
+
+    WideSum total;
+    for (usize k = 0; k < n; ++k) {
+        total.add(a[k]);
+    }
+    result = total.value();
+    return total.fits();
+}
+
+// SSE2 has no 64-bit integer multiply or compare; these stay scalar
+bool scaleI64(const i64* a, i64 factor, i64* out, usize n) {
+    bool overflowed = false;
+    for (usize i = 0; i < n; ++i) {
+        overflowed = overflowed || ops::multiplyOverflows(a[i], factor);
+        out[i] = static_cast<i64>(static_cast<u64>(a[i]) * static_cast<u64>(factor));
+    }
+    return !overflowed;
+}
+
+// Fails if a product does not fit, or the total of the products does not
+bool dotI64(const i64* a, const i64* b, usize n, i64& result) {
+    WideSum total;
+    for (usize i = 0; i < n; ++i) {
+        if (ops::multiplyOverflows(a[i], b[i])) return false;
+        total.add(a[i] * b[i]);
+    }
+    result = total.value();
+    return total.fits();
+}
+
+i64 minI64(const i64* a, usize n) {
+    i64 result = a[0];
+    for (usize i = 1; i < n; ++i) {
+        if (a[i] < result) result = a[i];
+    }
+    return result;
+}
+
+i64 maxI64(const i64* a, usize n) {
+    i64 result = a[0];
+    for (usize i = 1; i < n; ++i) {
+        if (a[i] > result) result = a[i];
+    }
+    return result;
+}
+
+// ===== Argument helpers =====
+
+[[noreturn]] void fail(const char* function, const String& message) {
+    throw std::runtime_error(String(function) + ": " + message);
+}
+
+usize sizeArgument(const char* function, const Value& value) {
+    if (!value.isInteger() || value.get<i64>() < 0) {
+        fail(function, "size must be a non-negative integer");
+    }
+    return static_cast<usize>(value.get<i64>());
+}
+
+void requireTypedArray(const char* function, const Value& value) {
+    if (!value.isTypedArray()) {
+        fail(function, "expected a Float64Array or Int64Array");
+    }
+}
+
+usize typedSize(const Value& value) {
+    return value.isFloat64Array() ? value.get<Float64ArrayType>()->size()
+                                  : value.get<Int64ArrayType>()->size();
+}
+
+// Two operands of one kind and length, as element-wise operations need
+void requireMatching(const char* function, const Value& a, const Value& b) {
+    requireTypedArray(function, a);
+    if (a.getType() != b.getType()) {
+        fail(function, "arrays must be of the same kind");
+    }
+    if (typedSize(a) != typedSize(b)) {
+        fail(function, "arrays must have the same length");
+    }
+}
+
+// The optional out argument at index, or a new array shaped like a. Passing
+// out reuses its storage, so per-frame math allocates nothing.
+Value outputFor(const char* function, NativeArgs args, usize index, const Value& a) {
+    if (args.size() > index && !args[index].isNil()) {
+        requireMatching(function, a, args[index]);
+        return args[index];
+    }
+    if (a.isFloat64Array()) {
+        return Value(makeRef<std::vector<f64>>(a.get<Float64ArrayType>()->size()));
+    }
+    return Value(makeRef<std::vector<i64>>(a.get<Int64ArrayType>()->size()));
+}
+
+// Element storage; typed arrays are shared buffers that scripts mutate in place
+f64* f64Data(const Value& value) { return value.get<Float64ArrayType>()->data(); }
+i64* i64Data(const Value& value) { return value.get<Int64ArrayType>()->data(); }
+
+// ===== Builtins =====
+
+// float64Array(size [, fill]) or float64Array(array)
+Value builtinFloat64Array(void* userData, NativeArgs args) {
+    (void)userData;
+    if (args[0].isArray()) {
+        const auto& source = args[0].get<ArrayType>();
+        auto result = makeRef<std::vector<f64>>(source->size());
+        for (usize i = 0; i < source->size(); ++i) {
+            const Value& element = (*source)[i];
+            if (!element.isNumber()) fail("float64Array", "elements must be numbers");
+            (*result)[i] = element.asFloat();
+        }
+        return Value(result);
+    }
+
+    f64 fill = 0.0;
+    if (args.size() > 1) {
+        if (!args[1].isNumber()) fail("float64Array", "fill must be a number");
+        fill = args[1].asFloat();
+    }
+    return Value(makeRef<std::vector<f64>>(sizeArgument("float64Array", args[0]), fill));
+}
+
+// int64Array(size [, fill]) or int64Array(array)
+Value builtinInt64Array(void* userData, NativeArgs args) {
+    (void)userData;
+    if (args[0].isArray()) {
+        const auto& source = args[0].get<ArrayType>();
+        auto result = makeRef<std::vector<i64>>(source->size());
+        for (usize i = 0; i < source->size(); ++i) {
+            const Value& element = (*source)[i];
+            if (!element.isInteger()) fail("int64Array", "elements must be integers");
+            (*result)[i] = element.get<i64>();
+        }
+        return Value(result);
+    }
+
+    i64 fill = 0;
+    if (args.size() > 1) {
+        if (!args[1].isInteger()) fail("int64Array", "fill must be an integer");
+        fill = args[1].get<i64>();
+    }
+    return Value(makeRef<std::vector<i64>>(sizeArgument("int64Array", args[0]), fill));
+}
+
+// toArray(typed) - copies a typed array into a plain array
+Value builtinToArray(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("toArray", args[0]);
+    usize n = typedSize(args[0]);
+    std::vector<Value> result;
+    result.reserve(n);
+    for (usize i = 0; i < n; ++i) {
+        result.push_back(args[0].isFloat64Array() ? Value(f64Data(args[0])[i]) : Value(i64Data(args[0])[i]));
+    }
+    return Value::createArray(std::move(result));
+}
+
+// vlen(typed)
+Value builtinVlen(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("vlen", args[0]);
+    return Value(static_cast<i64>(typedSize(args[0])));
+}
+
+// vset(typed, index, value) - typed arrays have no index assignment syntax
+Value builtinVset(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("vset", args[0]);
+    if (!args[1].isInteger()) fail("vset", "index must be an integer");
+    i64 index = args[1].get<i64>();
+    if (index < 0 || static_cast<usize>(index) >= typedSize(args[0])) fail("vset", "index out of bounds");
+
+    usize at = static_cast<usize>(index);
+    if (args[0].isFloat64Array()) {
+        if (!args[2].isNumber()) fail("vset", "value must be a number");
+        f64Data(args[0])[at] = args[2].asFloat();
+    } else {
+        if (!args[2].isInteger()) fail("vset", "value must be an integer");
+        i64Data(args[0])[at] = args[2].get<i64>();
+    }
+    return Value();
+}
+
+// vfill(typed, value)
+Value builtinVfill(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("vfill", args[0]);
+    if (args[0].isFloat64Array()) {
+        if (!args[1].isNumber()) fail("vfill", "value must be a number");
+        const auto& data = args[0].get<Float64ArrayType>();
+        std::fill(data->begin(), data->end(), args[1].asFloat());
+    } else {
+        if (!args[1].isInteger()) fail("vfill", "value must be an integer");
+        const auto& data = args[0].get<Int64ArrayType>();
+        std::fill(data->begin(), data->end(), args[1].get<i64>());
+    }
+    return Value();
+}
+
+// vadd(a, b [, out]) - element-wise sum
+Value builtinVadd(void* userData, NativeArgs args) {
+    (void)userData;
+    requireMatching("vadd", args[0], args[1]);
+    Value out = outputFor("vadd", args, 2, args[0]);
+    usize n = typedSize(args[0]);
+    if (args[0].isFloat64Array()) {
+        addF64(f64Data(args[0]), f64Data(args[1]), f64Data(out), n);
+    } else {
+        if (!addI64(i64Data(args[0]), i64Data(args[1]), i64Data(out), n)) fail("vadd", "Integer overflow");
+    }
+    return out;
+}
+
+// vscale(a, factor [, out]) - element-wise product with a number
+Value builtinVscale(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("vscale", args[0]);
+    Value out = outputFor("vscale", args, 2, args[0]);
+    usize n = typedSize(args[0]);
+    if (args[0].isFloat64Array()) {
+        if (!args[1].isNumber()) fail("vscale", "factor must be a number");
+        scaleF64(f64Data(args[0]), args[1].asFloat(), f64Data(out), n);
+    } else {
+        if (!args[1].isInteger()) fail("vscale", "an Int64Array can only be scaled by an integer");
+        if (!scaleI64(i64Data(args[0]), args[1].get<i64>(), i64Data(out), n)) fail("vscale", "Integer overflow");
+    }
+    return out;
+}
+
+// vdot(a, b)
+Value builtinVdot(void* userData, NativeArgs args) {
+    (void)userData;
+    requireMatching("vdot", args[0], args[1]);
+    usize n = typedSize(args[0]);
+    if (args[0].isFloat64Array()) {
+        return Value(dotF64(f64Data(args[0]), f64Data(args[1]), n));
+    }
+    i64 result;
+    if (!dotI64(i64Data(args[0]), i64Data(args[1]), n, result)) fail("vdot", "Integer overflow");
+    return Value(result);
+}
+
+// vsum(a)
+Value builtinVsum(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("vsum", args[0]);
+    usize n = typedSize(args[0]);
+    if (args[0].isFloat64Array()) {
+        return Value(sumF64(f64Data(args[0]), n));
+    }
+    i64 result;
+    if (!sumI64(i64Data(args[0]), n, result)) fail("vsum", "Integer overflow");
+    return Value(result);
+}
+
+// vmin(a) - nil for an empty array, NaN if any element is NaN
+Value builtinVmin(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("vmin", args[0]);
+    usize n = typedSize(args[0]);
+    if (n == 0) return Value();
+    if (args[0].isFloat64Array()) {
+        return Value(minF64(f64Data(args[0]), n));
+    }
+    return Value(minI64(i64Data(args[0]), n));
+}
+
+// vmax(a) - nil for an empty array, NaN if any element is NaN
+Value builtinVmax(void* userData, NativeArgs args) {
+    (void)userData;
+    requireTypedArray("vmax", args[0]);
+    usize n = typedSize(args[0]);
+    if (n == 0) return Value();
+    if (args[0].isFloat64Array()) {
+        return Value(maxF64(f64Data(args[0]), n));
+    }
+    return Value(maxI64(i64Data(args[0]), n));
+}
+
+} // namespace
+
+void registerTypedArrayBuiltins(Environment& env) {
+    auto define = [&env](const char* name, usize minArity, usize maxArity, NativeFn fn) {
+        env.define(name, Value(makeRef<Function>(name, minArity, maxArity, fn, nullptr)));
+    };
+
+    define("float64Array", 1, 2, builtinFloat64Array);
+    define("int64Array", 1, 2, builtinInt64Array);
+    define("toArray", 1, 1, builtinToArray);
+    define("vlen", 1, 1, builtinVlen);
+    define("vset", 3, 3, builtinVset);
+    define("vfill", 2, 2, builtinVfill);
+    define("vadd", 2, 3, builtinVadd);
+    define("vscale", 2, 3, builtinVscale);
+    define("vdot", 2, 2, builtinVdot);
+    define("vsum", 1, 1, builtinVsum);
+    define("vmin", 1, 1, builtinVmin);
+    define("vmax", 1, 1, builtinVmax);
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,1000 @@
+#include "oracon/lang/vm/closure_tier.h"
+#include "oracon/lang/vm/operators.h"
+#include "oracon/lang/vm/vm.h"
+#include <iterator>
+
+namespace oracon {
+namespace lang {
+
+namespace {
+
+// Where a step finds an operand
+enum class Src : u8 {
+    Stack,   // on the value stack, in push order
+    Local,   // a frame slot, read when the step runs
+    Fixed    // a constant, literal or bound global, read when the step runs
+};
+
+const Value s_nil;
+const Value s_true(true);
+const Value s_false(false);
+
+u16 readShort(const u8* at) {
+    return static_cast<u16>((at[0] << 8) | at[1]);
+}
+
+} // namespace
+
+// Translates a FunctionProto's bytecode into ClosureSteps and holds the step
+// handlers. Translation simulates the value stack: loads of locals,
+// constants and globals are not pushed but kept pending and handed to the
+// step that consumes them, so `i < n` or `total = total + x` become a single
+// step reading its operands where they live. Pending loads are pushed
+// (materialized) before anything that could change what they read, and at
+// every jump and jump target, where the stack must look as the bytecode
+// left it.
+class ClosureCompiler {
+public:
+    static std::unique_ptr<ClosureCode> compile(VM& vm, const FunctionProto& proto) {
+        ClosureCompiler compiler(vm, proto);
+        return compiler.translate();
+    }
+
+private:
+    using Fn = ClosureStep::Fn;
+
+    struct Pending {
+        Src src;
+        ClosureStep::Operand operand;
+    };
+
+    // The last step emitted, while it is a binary step whose result is the
+    // top of the stack and could be fused with what follows
+    struct LastBinary {
+        usize step;
+        OpCode op;
+        Src a;
+        Src b;
+    };
+
+    static constexpr i64 UNKNOWN_DEPTH = -1;
+    static constexpr usize NO_STEP = static_cast<usize>(-1);
+
+    VM& m_vm;
+    const FunctionProto& m_proto;
+    const u8* m_code;
+    usize m_codeSize;
+
+    std::vector<ClosureStep> m_steps;
+    std::vector<Pending> m_pending;   // always above every value on the real stack
+    usize m_depth;                    // values on the real stack, from the frame's slot 0
+
+    std::vector<bool> m_isTarget;
+    std::vector<i64> m_targetDepth;
+    std::vector<usize> m_stepAt;      // first step at a target offset
+    std::vector<std::pair<usize, usize>> m_fixups;   // step, target offset
+
+    bool m_lastValid;
+    LastBinary m_last;
+
+    ClosureCompiler(VM& vm, const FunctionProto& proto)
+        : m_vm(vm)
+        , m_proto(proto)
+        , m_code(proto.chunk.getCode())
+        , m_codeSize(proto.chunk.size())
+        , m_depth(proto.arity + 1)
+        , m_lastValid(false)
+        , m_last{0, OpCode::ADD, Src::Stack, Src::Stack}
+    {}
+
+    // ===== Step handlers =====
+
+    template<Src S>
+    static const Value& operand(VM& vm, ClosureStep::Operand operand, const Value* stack) {
+        if constexpr (S == Src::Local) {
+            return vm.m_stepSlots[operand.slot];
+        } else if constexpr (S == Src::Fixed) {
+            return *operand.value;
+        } else {
+            return *stack;
+        }
+    }
+
+    static const ClosureStep* fail(VM& vm, const ClosureStep* step, const String& message) {
+        vm.m_frames.back().ip = step->ip;
+        vm.runtimeError(message);
+        vm.m_stepFailed = true;
+        return nullptr;
+    }
+
+    // The error was already reported
+    static const ClosureStep* failed(VM& vm) {
+        vm.m_stepFailed = true;
+        return nullptr;
+    }
+
+    // Hands the top frame back to run(), to continue in the tier it runs in
+    static const ClosureStep* leave(VM& vm, bool switchTier) {
+        vm.m_switchTier = switchTier;
+        return nullptr;
+    }
+
+    static void popStack(VM& vm, usize count) {
+        for (usize i = 0; i < count; ++i) {
+            *--vm.m_stackTop = Value();
+        }
+    }
+
+    template<Src A>
+    static const ClosureStep* push(VM& vm, const ClosureStep* step) {
+        *vm.m_stackTop++ = operand<A>(vm, step->a, nullptr);
+        return step + 1;
+    }
+
+    static const ClosureStep* pop(VM& vm, const ClosureStep* step) {
+        popStack(vm, step->count);
+        return step + 1;
+    }
+
+    template<typename Op, Src A, Src B, bool ToLocal>
+    static const ClosureStep* binary(VM& vm, const ClosureStep* step) {
+        constexpr usize stacked = (A == Src::Stack ? 1 : 0) + (B == Src::Stack ? 1 : 0);
+        Value* base = vm.m_stackTop - stacked;
+        const Value& a = operand<A>(vm, step->a, base);
+        const Value& b = operand<B>(vm, step->b, A == Src::Stack ? base + 1 : base);
+        Value& out = ToLocal ? vm.m_stepSlots[step->dest] : base[0];
+        if (const char* error = Op::apply(a, b, out)) {
+            return fail(vm, step, error);
+        }
+        constexpr usize kept = ToLocal ? 0 : 1;
+        for (usize i = kept; i < stacked; ++i) {
+            base[i] = Value();
+        }
+        vm.m_stackTop = base + kept;
+        return step + 1;
+    }
+
+    template<typename Op, Src A, Src B>
+    static const ClosureStep* branch(VM& vm, const ClosureStep* step) {
+        constexpr usize stacked = (A == Src::Stack ? 1 : 0) + (B == Src::Stack ? 1 : 0);
+        Value* base = vm.m_stackTop - stacked;
+        bool result;
+        if (const char* error = Op::test(operand<A>(vm, step->a, base),
+                                         operand<B>(vm, step->b, A == Src::Stack ? base + 1 : base), result)) {
+            return fail(vm, step, error);
+        }
+        popStack(vm, stacked);
+        return result ? step + 1 : step->target;
+    }
+
+    template<Src A>
+    static const ClosureStep* branchIfFalse(VM& vm, const ClosureStep* step) {
+        bool truthy = operand<A>(vm, step->a, vm.m_stackTop - 1).asBool();
+        if (A == Src::Stack) {
+            popStack(vm, 1);
+        }
+        return truthy ? step + 1 : step->target;
+    }
+
+    // JUMP_IF_FALSE that leaves the condition, for `and` and `or`
+    static const ClosureStep* jumpIfFalse(VM& vm, const ClosureStep* step) {
+        return vm.m_stackTop[-1].asBool() ? step + 1 : step->target;
+    }
+
+    static const ClosureStep* jump(VM& vm, const ClosureStep* step) {
+        (void)vm;
+        return step->target;
+    }
+
+    static const ClosureStep* loop(VM& vm, const ClosureStep* step) {
+        if (--vm.m_fuelTick == 0) {
+            vm.m_frames.back().ip = step->ip;
+            if (!vm.checkBudget()) return failed(vm);
+        }
+        return step->target;
+    }
+
+    // SET_LOCAL then POP
+    template<Src A>
+    static const ClosureStep* store(VM& vm, const ClosureStep* step) {
+        if constexpr (A == Src::Stack) {
+            vm.m_stepSlots[step->dest] = std::move(*--vm.m_stackTop);
+        } else {
+            vm.m_stepSlots[step->dest] = operand<A>(vm, step->a, nullptr);
+        }
+        return step + 1;
+    }
+
+    static const ClosureStep* setLocal(VM& vm, const ClosureStep* step) {
+        vm.m_stepSlots[step->dest] = vm.m_stackTop[-1];
+        return step + 1;
+    }
+
+    static Value* bindGlobal(VM& vm, const ClosureStep* step) {
+        if (!step->global) {
+            step->global = vm.m_globalEnv.lookup(step->name);
+        }
+        return step->global;
+    }
+
+    static const ClosureStep* getGlobal(VM& vm, const ClosureStep* step) {
+        Value* global = bindGlobal(vm, step);
+        if (!global) return fail(vm, step, "Undefined variable: " + step->name.str());
+        *vm.m_stackTop++ = *global;
+        return step + 1;
+    }
+
+    // SET_GLOBAL then POP
+    template<Src A>
+    static const ClosureStep* storeGlobal(VM& vm, const ClosureStep* step) {
+        Value* global = bindGlobal(vm, step);
+        if (!global) return fail(vm, step, "Undefined variable: " + step->name.str());
+        if constexpr (A == Src::Stack) {
+            *global = std::move(*--vm.m_stackTop);
+        } else {
+            *global = operand<A>(vm, step->a, nullptr);
+        }
+        return step + 1;
+    }
+
+    static const ClosureStep* setGlobal(VM& vm, const ClosureStep* step) {
+        Value* global = bindGlobal(vm, step);
+        if (!global) return fail(vm, step, "Undefined variable: " + step->name.str());
+        *global = vm.m_stackTop[-1];
+        return step + 1;
+    }
+
+    static const ClosureStep* defineGlobal(VM& vm, const ClosureStep* step) {
+        vm.m_globalEnv.define(step->name, vm.m_stackTop[-1]);
+        popStack(vm, 1);
+        return step + 1;
+    }
+
+    static const ClosureStep* getScoped(VM& vm, const ClosureStep* step) {
+        *vm.m_stackTop++ = vm.m_frames.back().env->slotAt(step->count, step->index);
+        return step + 1;
+    }
+
+    static const ClosureStep* setScoped(VM& vm, const ClosureStep* step) {
+        vm.m_frames.back().env->slotAt(step->count, step->index) = vm.m_stackTop[-1];
+        return step + 1;
+    }
+
+    static const ClosureStep* defineScoped(VM& vm, const ClosureStep* step) {
+        vm.m_frames.back().env->slot(step->index) = std::move(*--vm.m_stackTop);
+        return step + 1;
+    }
+
+    static const ClosureStep* pushScope(VM& vm, const ClosureStep* step) {
+        VM::CallFrame& frame = vm.m_frames.back();
+        frame.env = vm.pushScope(frame.env, step->count);
+        return step + 1;
+    }
+
+    static const ClosureStep* popScope(VM& vm, const ClosureStep* step) {
+        VM::CallFrame& frame = vm.m_frames.back();
+        Environment* env = frame.env;
+        frame.env = env->getParent();
+        if (vm.m_scopes.size() > vm.m_escapedMark && vm.m_scopes.back().get() == env) {
+            vm.popScope();
+        }
+        return step + 1;
+    }
+
+    static const ClosureStep* power(VM& vm, const ClosureStep* step) {
+        Value& a = vm.m_stackTop[-2];
+        if (const char* error = ops::Power::apply(a, vm.m_stackTop[-1], a)) return fail(vm, step, error);
+        popStack(vm, 1);
+        return step + 1;
+    }
+
+    static const ClosureStep* negate(VM& vm, const ClosureStep* step) {
+        Value& a = vm.m_stackTop[-1];
+        if (const char* error = ops::Negate::apply(a, a)) return fail(vm, step, error);
+        return step + 1;
+    }
+
+    static const ClosureStep* positive(VM& vm, const ClosureStep* step) {
+        if (!vm.m_stackTop[-1].isNumber()) return fail(vm, step, "Operand must be a number");
+        return step + 1;
+    }
+
+    static const ClosureStep* logicalNot(VM& vm, const ClosureStep* step) {
+        Value& a = vm.m_stackTop[-1];
+        a = Value(!a.asBool());
+        return step + 1;
+    }
+
+    static const ClosureStep* call(VM& vm, const ClosureStep* step) {
+        usize depth = vm.m_frames.size();
+        VM::CallFrame& frame = vm.m_frames.back();
+        frame.ip = step->ip;
+        frame.resume = step + 1;
+        if (--vm.m_fuelTick == 0 && !vm.checkBudget()) {
+            return failed(vm);
+        }
+        u8 argCount = static_cast<u8>(step->count);
+        VM::InlineCache* cache = vm.inlineCache(step->site);
+        if (!vm.callValue(vm.peek(argCount), argCount, cache)) {
+            return failed(vm);
+        }
+        if (vm.m_suspendRequested) {
+            // frame.resume already points past this call
+            return leave(vm, false);
+        }
+        if (vm.m_frames.size() == depth) {
+            return step + 1;
+        }
+        const VM::CallFrame& callee = vm.m_frames.back();
+        if (!callee.resume) {
+            return leave(vm, true);
+        }
+        vm.m_stepSlots = callee.slots;
+        return callee.resume;
+    }
+
+    template<Src A>
+    static const ClosureStep* ret(VM& vm, const ClosureStep* step) {
+        VM::CallFrame& frame = vm.m_frames.back();
+        Value result;
+        if constexpr (A == Src::Fixed) {
+            result = *step->a.value;
+        } else {
+            // The frame's slots are about to be cleared
+            result = std::move(const_cast<Value&>(operand<A>(vm, step->a, vm.m_stackTop - 1)));
+        }
+        vm.releaseScopes(frame.scopeBase);
+        Value* slots = frame.slots;
+        while (vm.m_stackTop > slots) {
+            *--vm.m_stackTop = Value();
+        }
+        vm.m_frames.pop_back();
+        vm.push(std::move(result));
+
+        if (vm.m_frames.size() == vm.m_stepExitDepth) {
+            return leave(vm, false);
+        }
+        const VM::CallFrame& caller = vm.m_frames.back();
+        if (!caller.resume) {
+            return leave(vm, true);
+        }
+        vm.m_stepSlots = caller.slots;
+        return caller.resume;
+    }
+
+    static const ClosureStep* buildArray(VM& vm, const ClosureStep* step) {
+        Value* values = vm.m_stackTop - step->count;
+        auto array = makeRef<Array>(std::vector<Value>(
+            std::make_move_iterator(values), std::make_move_iterator(vm.m_stackTop)));
+        vm.m_stackTop = values;
+        vm.push(Value(array));
+        return step + 1;
+    }
+
+    static const ClosureStep* buildMap(VM& vm, const ClosureStep* step) {
+        VM::InlineCache* cache = vm.inlineCache(step->site);
+        Value* values = vm.m_stackTop - step->count;
+        MapType map;
+        if (cache && cache->shape) {
+            map = makeRef<Map>(cache->shape, std::vector<Value>(
+                std::make_move_iterator(values), std::make_move_iterator(vm.m_stackTop)));
+        } else {
+            const std::vector<Symbol>& names = vm.m_frames.back().proto->chunk.getNames();
+            const u8* key = step->keys;
+            map = makeRef<Map>();
+            for (Value* value = values; value < vm.m_stackTop; ++value, key += 2) {
+                map->set(names[readShort(key)], std::move(*value));
+            }
+            if (cache && map->getShape() && map->size() == step->count) {
+                cache->shape = map->getShape();
+            }
+        }
+        vm.m_stackTop = values;
+        vm.push(Value(map));
+        return step + 1;
+    }
+
+    template<Src A, Src B>
+    static const ClosureStep* indexGet(VM& vm, const ClosureStep* step) {
+        constexpr usize stacked = (A == Src::Stack ? 1 : 0) + (B == Src::Stack ? 1 : 0);
+        Value* base = vm.m_stackTop - stacked;
+        const Value& object = operand<A>(vm, step->a, base);
+        const Value& index = operand<B>(vm, step->b, A == Src::Stack ? base + 1 : base);
+        // The result is written last, so it may replace either operand
+        if (const char* error = vm.indexValue(object, index, vm.inlineCache(step->site), base[0])) {
+            return fail(vm, step, error);
+        }
+        if (stacked == 2) {
+            base[1] = Value();
+        }
+        vm.m_stackTop = base + 1;
+        return step + 1;
+    }
+
+    template<Src A>
+    static const ClosureStep* memberGet(VM& vm, const ClosureStep* step) {
+        Value* base = vm.m_stackTop - (A == Src::Stack ? 1 : 0);
+        const Value& object = operand<A>(vm, step->a, base);
+        if (!object.isMap()) return fail(vm, step, "Only maps have members: '" + step->name.str() + "'");
+        const Value* value = vm.getMember(*object.get<MapType>(), step->name, vm.inlineCache(step->site));
+        base[0] = value ? Value(*value) : Value();
+        vm.m_stackTop = base + 1;
+        return step + 1;
+    }
+
+    static const ClosureStep* function(VM& vm, const ClosureStep* step) {
+        const FunctionProto* proto = vm.m_frames.back().proto->program->getFunction(step->index);
+        // As in runBytecode: the closure may reach any live scope
+        for (usize i = vm.m_escapedMark; i < vm.m_scopes.size(); ++i) {
+            vm.m_heap.noteAllocation(Heap::sizeOf(*vm.m_scopes[i]));
+        }
+        vm.m_escapedMark = vm.m_scopes.size();
+        vm.push(Value(makeRef<Function>(proto->declaration, vm.m_frames.back().env)));
+        return step + 1;
+    }
+
+    // ===== Handler selection by operand source =====
+
+    template<typename Op, bool ToLocal>
+    struct BinaryFamily {
+        template<Src A, Src B> static Fn get() { return &binary<Op, A, B, ToLocal>; }
+    };
+    template<typename Op>
+    struct BranchFamily {
+        template<Src A, Src B> static Fn get() { return &branch<Op, A, B>; }
+    };
+    struct IndexFamily {
+        template<Src A, Src B> static Fn get() { return &indexGet<A, B>; }
+    };
+
+    template<typename Family, Src A>
+    static Fn select(Src b) {
+        switch (b) {
+            case Src::Stack: return Family::template get<A, Src::Stack>();
+            case Src::Local: return Family::template get<A, Src::Local>();
+            case Src::Fixed: break;
+        }
+        return Family::template get<A, Src::Fixed>();
+    }
+
+    template<typename Family>
+    static Fn select(Src a, Src b) {
+        switch (a) {
+            case Src::Stack: return select<Family, Src::Stack>(b);
+            case Src::Local: return select<Family, Src::Local>(b);
+            case Src::Fixed: break;
+        }
+        return select<Family, Src::Fixed>(b);
+    }
+
+    // Handlers with one operand, indexed by Src
+    using Table = Fn[3];
+    static constexpr Table s_push = {nullptr, &push<Src::Local>, &push<Src::Fixed>};
+    static constexpr Table s_store = {&store<Src::Stack>, &store<Src::Local>, &store<Src::Fixed>};
+    static constexpr Table s_storeGlobal = {&storeGlobal<Src::Stack>, &storeGlobal<Src::Local>,
+                                            &storeGlobal<Src::Fixed>};
+    static constexpr Table s_branchIfFalse = {&branchIfFalse<Src::Stack>, &branchIfFalse<Src::Local>,
+                                              &branchIfFalse<Src::Fixed>};
+    static constexpr Table s_return = {&ret<Src::Stack>, &ret<Src::Local>, &ret<Src::Fixed>};
+    static constexpr Table s_memberGet = {&memberGet<Src::Stack>, &memberGet<Src::Local>, &memberGet<Src::Fixed>};
+
+    static Fn pick(const Table& table, Src src) { return table[static_cast<usize>(src)]; }
+
+    template<typename Op>
+    static Fn binaryOf(Src a, Src b, bool toLocal) {
+        return toLocal ? select<BinaryFamily<Op, true>>(a, b) : select<BinaryFamily<Op, false>>(a, b);
+    }
+
+    // nullptr for an opcode that is not a binary operator
+    static Fn binaryFor(OpCode op, Src a, Src b, bool toLocal) {
+        switch (op) {
+            case OpCode::ADD: return binaryOf<ops::Add>(a, b, toLocal);
+            case OpCode::SUBTRACT: return binaryOf<ops::Subtract>(a, b, toLocal);
+            case OpCode::MULTIPLY: return binaryOf<ops::Multiply>(a, b, toLocal);
+            case OpCode::DIVIDE: return binaryOf<ops::Divide>(a, b, toLocal);
+            case OpCode::MODULO: return binaryOf<ops::Modulo>(a, b, toLocal);
+            case OpCode::EQUAL: return binaryOf<ops::Equality<true>>(a, b, toLocal);
+            case OpCode::NOT_EQUAL: return binaryOf<ops::Equality<false>>(a, b, toLocal);
+            case OpCode::LESS: return binaryOf<ops::Comparison<ops::LessThan>>(a, b, toLocal);
+            case OpCode::LESS_EQUAL: return binaryOf<ops::Comparison<ops::LessEqual>>(a, b, toLocal);
+            case OpCode::GREATER: return binaryOf<ops::Comparison<ops::GreaterThan>>(a, b, toLocal);
+            case OpCode::GREATER_EQUAL: return binaryOf<ops::Comparison<ops::GreaterEqual>>(a, b, toLocal);
+            default: return nullptr;
+        }
+    }
+
+    // nullptr for an operator that does not produce a condition
+    static Fn branchFor(OpCode op, Src a, Src b) {
+        switch (op) {
+            case OpCode::EQUAL: return select<BranchFamily<ops::Equality<true>>>(a, b);
+            case OpCode::NOT_EQUAL: return select<BranchFamily<ops::Equality<false>>>(a, b);
+            case OpCode::LESS: return select<BranchFamily<ops::Comparison<ops::LessThan>>>(a, b);
+            case OpCode::LESS_EQUAL: return select<BranchFamily<ops::Comparison<ops::LessEqual>>>(a, b);
+            case OpCode::GREATER: return select<BranchFamily<ops::Comparison<ops::GreaterThan>>>(a, b);
+            case OpCode::GREATER_EQUAL: return select<BranchFamily<ops::Comparison<ops::GreaterEqual>>>(a, b);
+            default: return nullptr;
+        }
+    }
+
+    // ===== Translation =====
+
+    // JUMP_IF_FALSE; POP whose target is a POP as well, the shape of every
+    // if and while: the branch pops the condition and skips the target's POP
+    bool isFusedBranch(usize offset) const {
+        usize target = offset + 3 + readShort(&m_code[offset + 1]);
+        return offset + 3 < m_codeSize && static_cast<OpCode>(m_code[offset + 3]) == OpCode::POP &&
+               target < m_codeSize && static_cast<OpCode>(m_code[target]) == OpCode::POP;
+    }
+
+    bool findTargets() {
+        m_isTarget.assign(m_codeSize + 1, false);
+        for (usize offset = 0; offset < m_codeSize;) {
+            usize length = m_proto.chunk.instructionLength(offset);
+            if (length == 0 || offset + length > m_codeSize) {
+                return false;
+            }
+            OpCode op = static_cast<OpCode>(m_code[offset]);
+            usize jump = length == 3 ? readShort(&m_code[offset + 1]) : 0;
+            if (op == OpCode::JUMP) {
+                m_isTarget[offset + 3 + jump] = true;
+            } else if (op == OpCode::JUMP_IF_FALSE) {
+                m_isTarget[offset + 3 + jump + (isFusedBranch(offset) ? 1 : 0)] = true;
+            } else if (op == OpCode::LOOP) {
+                if (jump > offset + 3) return false;
+                m_isTarget[offset + 3 - jump] = true;
+            }
+            offset += length;
+        }
+        return true;
+    }
+
+    // The stack depth every path into target must agree on
+    bool reach(usize target) {
+        if (target >= m_codeSize) return false;
+        i64 depth = static_cast<i64>(m_depth);
+        if (m_targetDepth[target] == UNKNOWN_DEPTH) {
+            m_targetDepth[target] = depth;
+        }
+        return m_targetDepth[target] == depth;
+    }
+
+    ClosureStep& emit(Fn fn, usize next) {
+        m_steps.emplace_back();
+        ClosureStep& step = m_steps.back();
+        step.fn = fn;
+        step.ip = m_code + next;
+        return step;
+    }
+
+    void emitJump(Fn fn, usize next, usize target) {
+        m_fixups.emplace_back(m_steps.size(), target);
+        emit(fn, next);
+    }
+
+    // Puts every pending operand on the real stack
+    void materialize() {
+        for (const Pending& pending : m_pending) {
+            emit(pick(s_push, pending.src), 0).a = pending.operand;
+            ++m_depth;
+        }
+        m_pending.clear();
+    }
+
+    // The top operand: pending, or on the real stack
+    bool take(Pending& result) {
+        if (!m_pending.empty()) {
+            result = m_pending.back();
+            m_pending.pop_back();
+            return true;
+        }
+        if (m_depth == 0) return false;
+        --m_depth;
+        result.src = Src::Stack;
+        result.operand.slot = 0;
+        return true;
+    }
+
+    void defer(Src src, ClosureStep::Operand operand) {
+        m_pending.push_back({src, operand});
+    }
+
+    std::unique_ptr<ClosureCode> translate() {
+        if (!m_proto.declaration || !findTargets()) {
+            return nullptr;
+        }
+        m_targetDepth.assign(m_codeSize + 1, UNKNOWN_DEPTH);
+        m_stepAt.assign(m_codeSize + 1, NO_STEP);
+
+        const std::vector<Value>& constants = m_proto.chunk.getConstants();
+        const std::vector<Symbol>& names = m_proto.chunk.getNames();
+        bool live = true;
+        usize offset = 0;
+
+        while (offset < m_codeSize) {
+            usize length = m_proto.chunk.instructionLength(offset);
+            if (m_isTarget[offset]) {
+                if (live) {
+                    materialize();
+                    if (!reach(offset)) return nullptr;
+                } else if (m_targetDepth[offset] != UNKNOWN_DEPTH) {
+                    m_depth = static_cast<usize>(m_targetDepth[offset]);
+                    live = true;
+                }
+                m_stepAt[offset] = m_steps.size();
+                m_lastValid = false;
+            }
+            if (!live) {
+                // Unreachable, or reached only by a jump not seen yet, which
+                // cannot happen for the compiler's forward jumps
+                offset += length;
+                continue;
+            }
+
+            OpCode op = static_cast<OpCode>(m_code[offset]);
+            usize next = offset + length;
+            u16 operand = length >= 3 ? readShort(&m_code[offset + 1]) : 0;
+            bool lastValid = m_lastValid;
+            m_lastValid = false;
+            bool popsNext = next < m_codeSize && static_cast<OpCode>(m_code[next]) == OpCode::POP &&
+                            !m_isTarget[next];
+            Pending a;
+            Pending b;
+
+            switch (op) {
+                case OpCode::CONSTANT: {
+                    ClosureStep::Operand value;
+                    value.value = &constants[operand];
+                    defer(Src::Fixed, value);
+                    break;
+                }
+                case OpCode::NIL:
+                case OpCode::TRUE:
+                case OpCode::FALSE: {
+                    ClosureStep::Operand value;
+                    value.value = op == OpCode::NIL ? &s_nil : op == OpCode::TRUE ? &s_true : &s_false;
+                    defer(Src::Fixed, value);
+                    break;
+                }
+                case OpCode::POP: {
+                    // A run of POPs, as at the end of a block, is one step
+                    u16 count = 0;
+                    for (;;) {
+                        if (!m_pending.empty()) {
+                            m_pending.pop_back();
+                        } else {
+                            if (m_depth == 0) return nullptr;
+                            --m_depth;
+                            ++count;
+                        }
+                        if (next >= m_codeSize || static_cast<OpCode>(m_code[next]) != OpCode::POP ||
+                            m_isTarget[next]) {
+                            break;
+                        }
+                        ++next;
+                    }
+                    if (count > 0) {
+                        emit(&pop, next).count = count;
+                    }
+                    break;
+                }
+
+                case OpCode::GET_LOCAL: {
+                    if (operand >= m_depth) {
+                        // The local is itself still pending
+                        materialize();
+                        if (operand >= m_depth) return nullptr;
+                    }
+                    ClosureStep::Operand slot;
+                    slot.slot = operand;
+                    defer(Src::Local, slot);
+                    break;
+                }
+                case OpCode::SET_LOCAL: {
+                    if (operand >= m_depth + m_pending.size()) return nullptr;
+                    if (!popsNext) {
+                        materialize();
+                        emit(&setLocal, next).dest = operand;
+                        break;
+                    }
+                    next += 1;
+                    if (lastValid && m_pending.empty()) {
+                        // The value was just computed: write it to the local directly
+                        ClosureStep& step = m_steps[m_last.step];
+                        step.fn = binaryFor(m_last.op, m_last.a, m_last.b, true);
+                        step.dest = operand;
+                        --m_depth;
+                        break;
+                    }
+                    if (!take(a)) return nullptr;
+                    // Pending loads of the old value go first
+                    materialize();
+                    ClosureStep& step = emit(pick(s_store, a.src), next);
+                    step.a = a.operand;
+                    step.dest = operand;
+                    break;
+                }
+
+                case OpCode::GET_GLOBAL: {
+                    Symbol name = names[operand];
+                    if (Value* global = m_vm.m_globalEnv.lookup(name)) {
+                        // Globals are never removed, so the address stays valid
+                        ClosureStep::Operand value;
+                        value.value = global;
+                        defer(Src::Fixed, value);
+                        break;
+                    }
+                    materialize();
+                    emit(&getGlobal, next).name = name;
+                    ++m_depth;
+                    break;
+                }
+                case OpCode::SET_GLOBAL: {
+                    Symbol name = names[operand];
+                    Value* global = m_vm.m_globalEnv.lookup(name);
+                    if (!popsNext) {
+                        materialize();
+                        ClosureStep& step = emit(&setGlobal, next);
+                        step.name = name;
+                        step.global = global;
+                        break;
+                    }
+                    next += 1;
+                    if (!take(a)) return nullptr;
+                    materialize();
+                    ClosureStep& step = emit(pick(s_storeGlobal, a.src), next);
+                    step.a = a.operand;
+                    step.name = name;
+                    step.global = global;
+                    break;
+                }
+                case OpCode::DEFINE_GLOBAL:
+                    materialize();
+                    if (m_depth == 0) return nullptr;
+                    emit(&defineGlobal, next).name = names[operand];
+                    --m_depth;
+                    break;
+
+                case OpCode::GET_SCOPED:
+                case OpCode::SET_SCOPED: {
+                    materialize();
+                    ClosureStep& step = emit(op == OpCode::GET_SCOPED ? &getScoped : &setScoped, next);
+                    step.count = operand;
+                    step.index = readShort(&m_code[offset + 3]);
+                    if (op == OpCode::GET_SCOPED) ++m_depth;
+                    break;
+                }
+                case OpCode::DEFINE_SCOPED:
+                    materialize();
+                    if (m_depth == 0) return nullptr;
+                    emit(&defineScoped, next).index = operand;
+                    --m_depth;
+                    break;
+                case OpCode::PUSH_SCOPE:
+                    materialize();
+                    emit(&pushScope, next).count = operand;
+                    break;
+                case OpCode::POP_SCOPE:
+                    materialize();
+                    emit(&popScope, next);
+                    break;
+
+                case OpCode::ADD:
+                case OpCode::SUBTRACT:
+                case OpCode::MULTIPLY:
+                case OpCode::DIVIDE:
+                case OpCode::MODULO:
+                case OpCode::EQUAL:
+                case OpCode::NOT_EQUAL:
+                case OpCode::LESS:
+                case OpCode::LESS_EQUAL:
+                case OpCode::GREATER:
+                case OpCode::GREATER_EQUAL: {
+                    if (!take(b) || !take(a)) return nullptr;
+                    materialize();
+                    m_last = {m_steps.size(), op, a.src, b.src};
+                    ClosureStep& step = emit(binaryFor(op, a.src, b.src, false), next);
+                    step.a = a.operand;
+                    step.b = b.operand;
+                    ++m_depth;
+                    m_lastValid = true;
+                    break;
+                }
+                case OpCode::POWER:
+                    materialize();
+                    if (m_depth < 2) return nullptr;
+                    emit(&power, next);
+                    --m_depth;
+                    break;
+                case OpCode::NEGATE:
+                case OpCode::POSITIVE:
+                case OpCode::NOT:
+                    materialize();
+                    if (m_depth == 0) return nullptr;
+                    emit(op == OpCode::NEGATE ? &negate : op == OpCode::POSITIVE ? &positive : &logicalNot, next);
+                    break;
+
+                case OpCode::JUMP:
+                    materialize();
+                    if (!reach(next + operand)) return nullptr;
+                    emitJump(&jump, next, next + operand);
+                    live = false;
+                    break;
+                case OpCode::JUMP_IF_FALSE: {
+                    usize target = next + operand;
+                    if (!isFusedBranch(offset)) {
+                        materialize();
+                        if (m_depth == 0 || !reach(target)) return nullptr;
+                        emitJump(&jumpIfFalse, next, target);
+                        break;
+                    }
+                    // Both paths pop the condition: skip this POP here and the target's
+                    next += 1;
+                    target += 1;
+                    if (lastValid && m_pending.empty() && branchFor(m_last.op, m_last.a, m_last.b)) {
+                        // Branch on the comparison itself, without making a boolean
+                        ClosureStep& step = m_steps[m_last.step];
+                        step.fn = branchFor(m_last.op, m_last.a, m_last.b);
+                        m_fixups.emplace_back(m_last.step, target);
+                        --m_depth;
+                    } else {
+                        if (!take(a)) return nullptr;
+                        materialize();
+                        m_fixups.emplace_back(m_steps.size(), target);
+                        emit(pick(s_branchIfFalse, a.src), next).a = a.operand;
+                    }
+                    if (!reach(target)) return nullptr;
+                    break;
+                }
+                case OpCode::LOOP:
+                    materialize();
+                    if (!reach(next - operand)) return nullptr;
+                    emitJump(&loop, next, next - operand);
+                    live = false;
+                    break;
+
+                case OpCode::CALL: {
+                    u8 argCount = m_code[offset + 1];
+                    materialize();
+                    if (m_depth < static_cast<usize>(argCount) + 1) return nullptr;
+                    ClosureStep& step = emit(&call, next);
+                    step.count = argCount;
+                    step.site = readShort(&m_code[offset + 2]);
+                    m_depth -= argCount;
+                    break;
+                }
+                case OpCode::RETURN:
+                    if (!take(a)) return nullptr;
+                    // Anything still pending dies with the frame
+                    m_pending.clear();
+                    emit(pick(s_return, a.src), next).a = a.operand;
+                    live = false;
+                    break;
+
+                case OpCode::BUILD_ARRAY:
+                    materialize();
+                    if (m_depth < operand) return nullptr;
+                    emit(&buildArray, next).count = operand;
+                    m_depth = m_depth - operand + 1;
+                    break;
+                case OpCode::BUILD_MAP: {
+                    materialize();
+                    if (m_depth < operand) return nullptr;
+                    ClosureStep& step = emit(&buildMap, next);
+                    step.count = operand;
+                    step.site = readShort(&m_code[offset + 3]);
+                    step.keys = m_code + offset + 5;
+                    m_depth = m_depth - operand + 1;
+                    break;
+                }
+                case OpCode::INDEX_GET: {
+                    if (!take(b) || !take(a)) return nullptr;
+                    materialize();
+                    ClosureStep& step = emit(select<IndexFamily>(a.src, b.src), next);
+                    step.a = a.operand;
+                    step.b = b.operand;
+                    step.site = operand;
+                    ++m_depth;
+                    break;
+                }
+                case OpCode::MEMBER_GET: {
+                    if (!take(a)) return nullptr;
+                    materialize();
+                    ClosureStep& step = emit(pick(s_memberGet, a.src), next);
+                    step.a = a.operand;
+                    step.name = names[operand];
+                    step.site = readShort(&m_code[offset + 3]);
+                    ++m_depth;
+                    break;
+                }
+
+                case OpCode::FUNCTION:
+                    materialize();
+                    emit(&function, next).index = operand;
+                    ++m_depth;
+                    break;
+
+                default:
+                    return nullptr;
+            }
+            offset = next;
+        }
+
+        // The compiler ends every function with a return
+        if (live || m_steps.empty()) {
+            return nullptr;
+        }
+        for (const auto& fixup : m_fixups) {
+            usize target = m_stepAt[fixup.second];
+            if (target == NO_STEP || target >= m_steps.size()) {
+                return nullptr;
+            }
+            m_steps[fixup.first].target = &m_steps[target];
+        }
+        // Moving the vector keeps its buffer, so the targets stay valid
+        return std::make_unique<ClosureCode>(std::move(m_steps));
+    }
+};
+
+const ClosureStep* VM::tierUp(const FunctionProto* proto, TierState& tier) {
+    tier.code = ClosureCompiler::compile(*this, *proto);
+    if (!tier.code) {
+        tier.failed = true;
+        return nullptr;
+    }
+    return tier.code->entry();
+}
+
+void VM::resetTiers() {
+    // Suspended coroutines, or a host call in progress, may be running steps
+    // of the old program
+    if (!m_frames.empty() || !m_coroutines.empty()) {
+        for (auto& entry : m_tiers) {
+            if (entry.second.code) {
+                m_retiredCode.push_back(std::move(entry.second.code));
+            }
+        }
+    } else {
+        m_retiredCode.clear();
+    }
+    m_tiers.clear();
+
+    // Call sites of every program point into m_tiers, and a reload may have
+    // redirected the functions they saw
+    for (auto& entry : m_inlineCaches) {
+        for (InlineCache& cache : entry.second) {
+            cache.callee = nullptr;
+            cache.proto = nullptr;
+            cache.tier = nullptr;
+        }
+    }
+}
+
+usize VM::getTieredFunctionCount() const {
+    usize count = 0;
+    for (const auto& entry : m_tiers) {
+        if (entry.second.code) ++count;
+    }
+    return count;
+}
+
+bool VM::runSteps(usize exitDepth) {
+    // Natives may call back into the VM, so this can be re-entered
+    Value* savedSlots = m_stepSlots;
+    usize savedExitDepth = m_stepExitDepth;
+    m_stepSlots = m_frames.back().slots;
+    m_stepExitDepth = exitDepth;
+    m_stepFailed = false;
+
+    const ClosureStep* step = m_frames.back().resume;
+    while (step) {
+        step = step->fn(*this, step);
+    }
+
+    bool ok = !m_stepFailed;
+    m_stepSlots = savedSlots;
+    m_stepExitDepth = savedExitDepth;
+    return ok;
+}
+
+} // namespace lang
+} // namespace oracon
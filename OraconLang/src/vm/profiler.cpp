@@ -0,0 +1,169 @@
+#include "oracon/lang/vm/profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace oracon {
+namespace lang {
+
+Profiler::Profiler(f64 sampleIntervalMs)
+    : m_sampleIntervalMs(sampleIntervalMs > 0.0 ? sampleIntervalMs : 1.0)
+    , m_sampleIntervalNs(static_cast<u64>(m_sampleIntervalMs * 1e6))
+    , m_samples(0)
+    , m_sampledNs(0)
+{
+}
+
+Profiler::FunctionStats& Profiler::statsNamed(const String& name) {
+    auto it = m_nameIndex.find(name);
+    if (it != m_nameIndex.end()) {
+        return m_functions[it->second];
+    }
+
+    m_nameIndex.emplace(name, m_functions.size());
+    m_functions.push_back(FunctionStats());
+    m_functions.back().name = name;
+    return m_functions.back();
+}
+
+Profiler::FunctionStats& Profiler::statsFor(const FunctionProto* proto) {
+    auto it = m_protoIndex.find(proto);
+    if (it != m_protoIndex.end()) {
+        return m_functions[it->second];
+    }
+
+    FunctionStats& stats = statsNamed(proto->name);
+    m_protoIndex.emplace(proto, static_cast<usize>(&stats - m_functions.data()));
+    return stats;
+}
+
+void Profiler::recordCall(const FunctionProto* proto) {
+    statsFor(proto).calls++;
+}
+
+void Profiler::recordSample(const std::vector<Frame>& stack, u64 weightNs) {
+    if (stack.empty()) return;
+
+    m_samples++;
+    m_sampledNs += weightNs;
+
+    // Recursive functions appear on the stack more than once but only count once
+    m_seen.clear();
+    m_key.clear();
+    for (const Frame& frame : stack) {
+        FunctionStats& stats = statsFor(frame.proto);
+        usize index = static_cast<usize>(&stats - m_functions.data());
+        if (std::find(m_seen.begin(), m_seen.end(), index) == m_seen.end()) {
+            m_seen.push_back(index);
+            stats.totalNs += weightNs;
+        }
+
+        if (!m_key.empty()) m_key += ';';
+        m_key += frame.proto->name;
+    }
+
+    const Frame& leaf = stack.back();
+    statsFor(leaf.proto).selfNs += weightNs;
+    m_lines[std::make_pair(leaf.proto->name, leaf.line)] += weightNs;
+    m_stacks[m_key] += weightNs;
+}
+
+void Profiler::merge(const Profiler& other) {
+    for (const auto& function : other.m_functions) {
+        FunctionStats& stats = statsNamed(function.name);
+        stats.calls += function.calls;
+        stats.selfNs += function.selfNs;
+        stats.totalNs += function.totalNs;
+    }
+    for (const auto& entry : other.m_lines) {
+        m_lines[entry.first] += entry.second;
+    }
+    for (const auto& entry : other.m_stacks) {
+        m_stacks[entry.first] += entry.second;
+    }
+    m_samples += other.m_samples;
+    m_sampledNs += other.m_sampledNs;
+}
+
+void Profiler::reset() {
+    m_protoIndex.clear();
+    m_nameIndex.clear();
+    m_functions.clear();
+    m_lines.clear();
+    m_stacks.clear();
+    m_samples = 0;
+    m_sampledNs = 0;
+}
+
+std::vector<Profiler::FunctionStats> Profiler::getFunctions() const {
+    std::vector<FunctionStats> functions = m_functions;
+    std::stable_sort(functions.begin(), functions.end(), [](const FunctionStats& a, const FunctionStats& b) {
+        return a.selfNs > b.selfNs;
+    });
+    return functions;
+}
+
+std::vector<Profiler::LineStats> Profiler::getLines() const {
+    std::vector<LineStats> lines;
+    lines.reserve(m_lines.size());
+    for (const auto& entry : m_lines) {
+        LineStats stats;
+        stats.function = entry.first.first;
+        stats.line = entry.first.second;
+        stats.selfNs = entry.second;
+        lines.push_back(stats);
+    }
+    std::stable_sort(lines.begin(), lines.end(), [](const LineStats& a, const LineStats& b) {
+        return a.selfNs > b.selfNs;
+    });
+    return lines;
+}
+
+String Profiler::toFoldedStacks() const {
+    std::ostringstream out;
+    for (const auto& entry : m_stacks) {
+        u64 us = entry.second / 1000;
+        if (us > 0) {
+            out << entry.first << ' ' << us << '\n';
+        }
+    }
+    return out.str();
+}
+
+String Profiler::report(usize maxRows) const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+
+    f64 totalMs = static_cast<f64>(m_sampledNs) / 1e6;
+    out << "Script profile: " << m_samples << " samples, " << totalMs << " ms\n";
+
+    auto percent = [this](u64 ns) {
+        return m_sampledNs > 0 ? 100.0 * static_cast<f64>(ns) / static_cast<f64>(m_sampledNs) : 0.0;
+    };
+
+    out << "\n  self ms   self %  total ms       calls  function\n";
+    std::vector<FunctionStats> functions = getFunctions();
+    for (usize i = 0; i < functions.size() && i < maxRows; ++i) {
+        const FunctionStats& f = functions[i];
+        out << std::setw(9) << static_cast<f64>(f.selfNs) / 1e6
+            << std::setw(8) << std::setprecision(1) << percent(f.selfNs) << "%"
+            << std::setw(10) << std::setprecision(3) << static_cast<f64>(f.totalNs) / 1e6
+            << std::setw(12) << f.calls
+            << "  " << f.name << '\n';
+    }
+
+    out << "\n  self ms   self %  line\n";
+    std::vector<LineStats> lines = getLines();
+    for (usize i = 0; i < lines.size() && i < maxRows; ++i) {
+        const LineStats& l = lines[i];
+        out << std::setw(9) << static_cast<f64>(l.selfNs) / 1e6
+            << std::setw(8) << std::setprecision(1) << percent(l.selfNs) << "%"
+            << std::setprecision(3)
+            << "  " << l.function << ":" << l.line << '\n';
+    }
+
+    return out.str();
+}
+
+} // namespace lang
+} // namespace oracon
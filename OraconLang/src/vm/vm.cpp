@@ -0,0 +1,1110 @@
+#include "oracon/lang/vm/vm.h"
+#include "oracon/lang/vm/operators.h"
+#include "oracon/lang/runtime/builtins.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace oracon {
+namespace lang {
+
+VM::VM()
+    : m_program(nullptr)
+    , m_stack(new Value[STACK_MAX])
+    , m_stackTop(m_stack.get())
+    , m_stackCapacity(STACK_MAX)
+    , m_programCaches(nullptr)
+    , m_escapedMark(0)
+    , m_running(nullptr)
+    , m_suspendRequested(false)
+    , m_time(0.0)
+    , m_nextWake(0.0)
+    , m_hasError(false)
+    , m_tierUpCalls(TIER_UP_CALLS)
+    , m_stepSlots(nullptr)
+    , m_stepExitDepth(0)
+    , m_stepFailed(false)
+    , m_switchTier(false)
+    , m_fuelUsed(0)
+    , m_fuelWindow(0)
+    , m_fuelTick(0)
+    , m_profiler(nullptr)
+    , m_profileElapsedNs(0)
+{
+    m_frames.reserve(FRAMES_MAX);
+    registerBuiltins(m_globalEnv);
+    registerTypedArrayBuiltins(m_globalEnv);
+    registerCollectionBuiltins(m_globalEnv);
+    registerCoroutineBuiltins();
+}
+
+VM::~VM() {
+    // Everything the VM holds is about to go; collecting with no roots frees
+    // the cycles among it that refcounting would leak. Values the host still
+    // holds count as referenced from outside and survive.
+    unwind(0, m_stack.get());
+    m_coroutines.clear();
+
+    std::vector<Environment*> scopes;
+    scopes.push_back(&m_globalEnv);
+    for (const auto& scope : m_scopes) scopes.push_back(scope.get());
+    for (const auto& scope : m_retiredScopes) scopes.push_back(scope.get());
+    std::vector<Environment*> dead;
+    m_heap.collect({}, scopes, dead);
+}
+
+void VM::execute(const CompiledProgram* program) {
+    if (!program) return;
+    if (program != m_program) {
+        m_redirects.clear();
+    }
+    runScript(program, program->getScript());
+}
+
+void VM::runScript(const CompiledProgram* program, const FunctionProto* script) {
+    if (m_frames.size() >= FRAMES_MAX ||
+        static_cast<usize>(m_stackTop - m_stack.get()) + script->maxStack > m_stackCapacity) {
+        runtimeError("Stack overflow");
+        return;
+    }
+
+    Heap::Scope heapScope(m_heap);
+    if (m_program && program != m_program &&
+        std::find(m_retiredPrograms.begin(), m_retiredPrograms.end(), m_program) == m_retiredPrograms.end()) {
+        m_retiredPrograms.push_back(m_program);
+    }
+    m_program = program;
+    m_programCaches = inlineCachesOf(program);
+    resetTiers();
+    startBudget();
+
+    usize frameDepth = m_frames.size();
+    Value* stackTop = m_stackTop;
+
+    push(Value());
+    if (m_profiler) {
+        m_profiler->recordCall(script);
+    }
+    m_frames.push_back({script, script->chunk.getCode(), stackTop, &m_globalEnv, m_scopes.size(), nullptr,
+                        m_programCaches});
+
+    bool ok = run(frameDepth);
+    if (ok) {
+        pop();
+    } else {
+        unwind(frameDepth, stackTop);
+    }
+    pauseProfile();
+    if (ok) {
+        checkHeap();
+    }
+}
+
+namespace {
+
+// Types a reloaded global may switch between without being reinitialized
+ValueType reloadKind(ValueType type) {
+    switch (type) {
+        case ValueType::Integer: return ValueType::Float;
+        case ValueType::Float64Array:
+        case ValueType::Int64Array: return ValueType::Array;
+        default: return type;
+    }
+}
+
+// Whether reload() leaves an existing global alone: it does unless the new
+// version initializes it to a different type of value
+bool keepsValue(const Value* current, ValueType declared) {
+    if (!current) return false;
+    return declared == ValueType::Nil || reloadKind(current->getType()) == reloadKind(declared);
+}
+
+} // namespace
+
+bool VM::reload(const CompiledProgram* program) {
+    if (!program) return false;
+    if (!m_frames.empty()) {
+        runtimeError("Cannot reload a script while it is running");
+        return false;
+    }
+
+    if (m_program && program != m_program) {
+        // Pair up the functions of both versions by name and arity; a name
+        // declared more than once pairs in declaration order
+        std::unordered_map<String, std::vector<const FunctionProto*>> incoming;
+        for (usize i = 1; i < program->getFunctionCount(); ++i) {
+            const FunctionProto* proto = program->getFunction(i);
+            incoming[proto->name].push_back(proto);
+        }
+
+        std::unordered_map<const FunctionProto*, const FunctionProto*> successors;
+        std::unordered_map<String, usize> seen;
+        for (usize i = 1; i < m_program->getFunctionCount(); ++i) {
+            const FunctionProto* proto = m_program->getFunction(i);
+            usize ordinal = seen[proto->name]++;
+            auto it = incoming.find(proto->name);
+            if (it != incoming.end() && ordinal < it->second.size() &&
+                it->second[ordinal]->arity == proto->arity) {
+                successors.emplace(proto, it->second[ordinal]);
+            }
+        }
+
+        // Values from versions before the last one follow the same chain
+        std::unordered_map<const FunctionStmt*, const FunctionProto*> redirects;
+        for (const auto& entry : m_redirects) {
+            auto it = successors.find(entry.second);
+            if (it != successors.end()) redirects.emplace(entry.first, it->second);
+        }
+        for (const auto& entry : successors) {
+            redirects.emplace(entry.first->declaration, entry.second);
+        }
+        m_redirects = std::move(redirects);
+    }
+
+    // Copy out the declarations to run. The copies keep the script's pools,
+    // and jumps are relative, so their operands stay valid.
+    const Chunk& source = program->getScript()->chunk;
+    auto script = std::make_unique<FunctionProto>();
+    script->name = "<reload>";
+    script->program = program;
+    script->chunk = source;
+    script->chunk.clearCode();
+    for (const GlobalDeclaration& global : program->getGlobalDeclarations()) {
+        if (!global.isFunction && keepsValue(m_globalEnv.lookup(global.name), global.type)) continue;
+        for (u32 offset = global.start; offset < global.end; ++offset) {
+            script->chunk.write(source.getCode()[offset], source.getLine(offset));
+        }
+    }
+    u32 line = source.size() > 0 ? source.getLine(source.size() - 1) : 0;
+    script->chunk.write(OpCode::NIL, line);
+    script->chunk.write(OpCode::RETURN, line);
+    script->maxStack = script->chunk.computeMaxStack(1);
+    m_reloadScripts.push_back(std::move(script));
+
+    usize errorCount = m_errors.size();
+    runScript(program, m_reloadScripts.back().get());
+    return m_errors.size() == errorCount;
+}
+
+Value VM::callFunction(const String& name, const std::vector<Value>& arguments) {
+    Symbol symbol = Symbol::find(name);
+    if (symbol.isEmpty()) {
+        runtimeError("Undefined variable: " + name);
+        return Value();
+    }
+    return callFunction(symbol, arguments);
+}
+
+Value VM::callFunction(Symbol name, const std::vector<Value>& arguments) {
+    const Value* slot = m_globalEnv.lookup(name);
+    if (!slot) {
+        runtimeError("Undefined variable: " + name.str());
+        return Value();
+    }
+    // A copy: the call may redefine the global
+    Value callee = *slot;
+
+    Heap::Scope heapScope(m_heap);
+    startBudget();
+    usize errorCount = m_errors.size();
+    Value result = invoke(callee, arguments);
+    pauseProfile();
+    if (m_errors.size() == errorCount) {
+        checkHeap();
+    }
+    return result;
+}
+
+Value VM::invoke(const Value& callee, const std::vector<Value>& arguments) {
+    if (arguments.size() > 255) {
+        runtimeError("Cannot have more than 255 arguments");
+        return Value();
+    }
+
+    if (static_cast<usize>(m_stackTop - m_stack.get()) + arguments.size() + 1 > m_stackCapacity) {
+        runtimeError("Stack overflow");
+        return Value();
+    }
+
+    usize frameDepth = m_frames.size();
+    Value* stackTop = m_stackTop;
+
+    push(callee);
+    for (const auto& arg : arguments) {
+        push(arg);
+    }
+
+    if (!callValue(callee, static_cast<u8>(arguments.size()))) {
+        unwind(frameDepth, stackTop);
+        return Value();
+    }
+
+    // Natives complete inside callValue; only bytecode functions need the loop
+    if (m_frames.size() > frameDepth && !run(frameDepth)) {
+        unwind(frameDepth, stackTop);
+        return Value();
+    }
+
+    return pop();
+}
+
+bool VM::callValue(const Value& callee, u8 argCount, InlineCache* cache) {
+    if (!callee.isFunction()) {
+        runtimeError("Can only call functions");
+        return false;
+    }
+
+    const FunctionType& function = callee.get<FunctionType>();
+    if (!function->acceptsArgCount(argCount)) {
+        runtimeError(function->arityError(argCount));
+        return false;
+    }
+
+    if (function->isNative()) {
+        return callNative(function, argCount);
+    }
+
+    const FunctionProto* proto;
+    TierState* tier;
+    if (cache && cache->callee == function->getDeclaration()) {
+        proto = cache->proto;
+        tier = cache->tier;
+    } else {
+        proto = findProto(*function);
+        if (!proto) {
+            runtimeError("Invalid function");
+            return false;
+        }
+        tier = &m_tiers[proto];
+        if (cache) {
+            cache->callee = function->getDeclaration();
+            cache->proto = proto;
+            cache->tier = tier;
+        }
+    }
+
+    // The frame starts at the callee; the compiler bounded how far it can grow
+    if (m_frames.size() >= FRAMES_MAX ||
+        static_cast<usize>(m_stackTop - argCount - 1 - m_stack.get()) + proto->maxStack > m_stackCapacity) {
+        runtimeError("Stack overflow");
+        return false;
+    }
+
+    if (m_profiler) {
+        m_profiler->recordCall(proto);
+    }
+
+    const ClosureStep* entry = nullptr;
+    if (tier->code) {
+        entry = tier->code->entry();
+    } else if (m_tierUpCalls > 0 && !tier->failed && ++tier->calls >= m_tierUpCalls) {
+        entry = tierUp(proto, *tier);
+    }
+
+    InlineCache* caches = proto->program == m_program ? m_programCaches : inlineCachesOf(proto->program);
+    m_frames.push_back({proto, proto->chunk.getCode(), m_stackTop - argCount - 1,
+                        function->getClosure(), m_scopes.size(), entry, caches});
+    return true;
+}
+
+const FunctionProto* VM::findProto(const Function& function) const {
+    const FunctionStmt* declaration = function.getDeclaration();
+    const FunctionProto* proto = m_program ? m_program->findFunction(declaration) : nullptr;
+    if (proto) {
+        return proto;
+    }
+
+    // A function of a version replaced by reload(). Top-level ones run the
+    // new body; nested ones keep the old one, since the scopes they captured
+    // may not match the new code.
+    if (function.getClosure() == &m_globalEnv) {
+        auto it = m_redirects.find(declaration);
+        if (it != m_redirects.end()) return it->second;
+    }
+    for (auto it = m_retiredPrograms.rbegin(); it != m_retiredPrograms.rend(); ++it) {
+        if ((proto = (*it)->findFunction(declaration))) return proto;
+    }
+    return nullptr;
+}
+
+VM::InlineCache* VM::inlineCachesOf(const CompiledProgram* program) {
+    std::vector<InlineCache>& caches = m_inlineCaches[program];
+    if (caches.empty()) {
+        caches.resize(program->getInlineCacheCount());
+    }
+    return caches.data();
+}
+
+bool VM::callNative(const FunctionType& function, u8 argCount) {
+    // Arguments are read straight off the stack
+    Value result;
+    try {
+        result = function->callNative(NativeArgs(m_stackTop - argCount, argCount));
+    } catch (const std::exception& e) {
+        runtimeError(e.what());
+        return false;
+    }
+
+    m_stackTop -= argCount + 1;
+    push(std::move(result));
+    return true;
+}
+
+void VM::unwind(usize frameDepth, Value* stackTop) {
+    if (m_frames.size() > frameDepth) {
+        releaseScopes(m_frames[frameDepth].scopeBase);
+    }
+    m_frames.resize(frameDepth);
+    while (m_stackTop > stackTop) {
+        *--m_stackTop = Value();
+    }
+}
+
+Environment* VM::pushScope(Environment* parent, usize slotCount) {
+    if (m_freeScopes.empty()) {
+        m_scopes.push_back(std::make_unique<Environment>(parent, slotCount));
+    } else {
+        m_scopes.push_back(std::move(m_freeScopes.back()));
+        m_freeScopes.pop_back();
+        m_scopes.back()->reset(parent, slotCount);
+    }
+    return m_scopes.back().get();
+}
+
+void VM::popScope() {
+    std::unique_ptr<Environment> scope = std::move(m_scopes.back());
+    m_scopes.pop_back();
+    if (m_freeScopes.size() < FREE_SCOPES_MAX) {
+        // Drop what it holds now rather than when it is reused
+        scope->reset(nullptr, 0);
+        m_freeScopes.push_back(std::move(scope));
+    }
+}
+
+void VM::releaseScopes(usize base) {
+    usize keep = base > m_escapedMark ? base : m_escapedMark;
+    while (m_scopes.size() > keep) {
+        popScope();
+    }
+}
+
+void VM::removeScopes(std::vector<std::unique_ptr<Environment>>& scopes, usize& escapedMark,
+                      std::vector<CallFrame>& frames, const std::vector<Environment*>& dead) {
+    // removedBefore[i] is how many scopes below index i are removed
+    std::vector<usize> removedBefore(scopes.size() + 1);
+    usize kept = 0;
+    for (usize i = 0; i < scopes.size(); ++i) {
+        removedBefore[i] = i - kept;
+        if (!std::binary_search(dead.begin(), dead.end(), scopes[i].get())) {
+            if (kept != i) scopes[kept] = std::move(scopes[i]);
+            ++kept;
+        }
+    }
+    removedBefore[scopes.size()] = scopes.size() - kept;
+    if (kept == scopes.size()) return;
+
+    escapedMark -= removedBefore[std::min(escapedMark, scopes.size())];
+    for (CallFrame& frame : frames) {
+        frame.scopeBase -= removedBefore[std::min(frame.scopeBase, scopes.size())];
+    }
+    scopes.resize(kept);
+}
+
+void VM::collectGarbage() {
+    // Roots are the globals, the scopes of every frame on every stack, and
+    // the scopes above each stack's escaped mark, which are still in use.
+    // Escaped scopes are kept only while a closure can reach them.
+    std::vector<Environment*> roots;
+    std::vector<Environment*> scopes;
+    auto addStack = [&](const std::vector<CallFrame>& frames,
+                        const std::vector<std::unique_ptr<Environment>>& stackScopes, usize escapedMark) {
+        for (const CallFrame& frame : frames) {
+            roots.push_back(frame.env);
+        }
+        for (usize i = 0; i < stackScopes.size(); ++i) {
+            (i < escapedMark ? scopes : roots).push_back(stackScopes[i].get());
+        }
+    };
+
+    roots.push_back(&m_globalEnv);
+    addStack(m_frames, m_scopes, m_escapedMark);
+    for (const auto& coroutine : m_coroutines) {
+        if (coroutine) addStack(coroutine->frames, coroutine->scopes, coroutine->escapedMark);
+    }
+    for (const auto& scope : m_retiredScopes) {
+        scopes.push_back(scope.get());
+    }
+
+    std::vector<Environment*> dead;
+    m_heap.collect(roots, scopes, dead);
+    if (dead.empty()) return;
+
+    std::sort(dead.begin(), dead.end());
+    removeScopes(m_scopes, m_escapedMark, m_frames, dead);
+    for (const auto& coroutine : m_coroutines) {
+        if (coroutine) removeScopes(coroutine->scopes, coroutine->escapedMark, coroutine->frames, dead);
+    }
+    m_retiredScopes.erase(std::remove_if(m_retiredScopes.begin(), m_retiredScopes.end(),
+        [&dead](const std::unique_ptr<Environment>& scope) {
+            return std::binary_search(dead.begin(), dead.end(), scope.get());
+        }), m_retiredScopes.end());
+}
+
+HeapStats VM::getHeapStats() const {
+    HeapStats stats = m_heap.getStats();
+    stats.scopes = m_escapedMark + m_retiredScopes.size();
+    for (const auto& coroutine : m_coroutines) {
+        if (coroutine) stats.scopes += coroutine->escapedMark;
+    }
+    return stats;
+}
+
+bool VM::checkHeap() {
+    usize limit = m_budget.heapLimitBytes;
+    if (!m_heap.shouldCollect() && (limit == 0 || m_heap.getBytes() <= limit)) {
+        return true;
+    }
+
+    collectGarbage();
+    if (limit > 0 && m_heap.getBytes() > limit) {
+        runtimeError("Heap limit exceeded: " + std::to_string(m_heap.getBytes()) +
+                     " bytes in use, limit of " + std::to_string(limit));
+        return false;
+    }
+    return true;
+}
+
+void VM::startBudget() {
+    u64 interval = m_profiler ? PROFILE_CHECK_INTERVAL : FUEL_CHECK_INTERVAL;
+    m_fuelUsed = 0;
+    m_fuelWindow = m_budget.fuel > 0 && m_budget.fuel < interval ? m_budget.fuel : interval;
+    m_fuelTick = m_fuelWindow;
+    if (m_profiler) {
+        m_profileClock = std::chrono::steady_clock::now();
+    }
+    if (m_budget.timeLimitMs > 0.0) {
+        m_deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<f64, std::milli>(m_budget.timeLimitMs));
+    }
+}
+
+bool VM::checkBudget() {
+    m_fuelUsed += m_fuelWindow;
+    m_fuelWindow = 0;
+    m_fuelTick = 0;
+
+    if (m_budget.fuel > 0 && m_fuelUsed >= m_budget.fuel) {
+        runtimeError("Execution budget exceeded: fuel limit of " + std::to_string(m_budget.fuel));
+        return false;
+    }
+    if (m_budget.timeLimitMs > 0.0 && std::chrono::steady_clock::now() >= m_deadline) {
+        std::ostringstream limit;
+        limit << m_budget.timeLimitMs;
+        runtimeError("Execution budget exceeded: time limit of " + limit.str() + " ms");
+        return false;
+    }
+
+    if (!checkHeap()) {
+        return false;
+    }
+
+    if (m_profiler) {
+        profileSafepoint();
+    }
+
+    m_fuelWindow = m_profiler ? PROFILE_CHECK_INTERVAL : FUEL_CHECK_INTERVAL;
+    if (m_budget.fuel > 0 && m_budget.fuel - m_fuelUsed < m_fuelWindow) {
+        m_fuelWindow = m_budget.fuel - m_fuelUsed;
+    }
+    m_fuelTick = m_fuelWindow;
+    return true;
+}
+
+// ===== Profiling =====
+
+void VM::setProfiler(Profiler* profiler) {
+    m_profiler = profiler;
+    m_profileClock = std::chrono::steady_clock::now();
+    m_profileElapsedNs = 0;
+}
+
+void VM::profileSafepoint() {
+    auto now = std::chrono::steady_clock::now();
+    m_profileElapsedNs += static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_profileClock).count());
+    m_profileClock = now;
+
+    if (m_profileElapsedNs < m_profiler->getSampleIntervalNs()) {
+        return;
+    }
+
+    m_profileStack.clear();
+    for (const CallFrame& frame : m_frames) {
+        usize offset = static_cast<usize>(frame.ip - frame.proto->chunk.getCode());
+        m_profileStack.push_back({frame.proto, frame.proto->chunk.getLine(offset > 0 ? offset - 1 : 0)});
+    }
+    m_profiler->recordSample(m_profileStack, m_profileElapsedNs);
+    m_profileElapsedNs = 0;
+}
+
+void VM::pauseProfile() {
+    if (!m_profiler) return;
+
+    // Time since the last safepoint goes to the next sample
+    auto now = std::chrono::steady_clock::now();
+    m_profileElapsedNs += static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_profileClock).count());
+    m_profileClock = now;
+}
+
+// ===== Coroutines =====
+
+void VM::startCoroutine(const Value& function, const std::vector<Value>& arguments) {
+    if (!function.isFunction()) {
+        runtimeError("Can only start a coroutine from a function");
+        return;
+    }
+    if (arguments.size() > 255) {
+        runtimeError("Cannot have more than 255 arguments");
+        return;
+    }
+
+    auto coroutine = std::make_unique<Coroutine>();
+    coroutine->stack.reset(new Value[COROUTINE_STACK_SIZE]);
+    coroutine->stackTop = coroutine->stack.get();
+    coroutine->stackCapacity = COROUTINE_STACK_SIZE;
+    coroutine->escapedMark = 0;
+    coroutine->started = false;
+    coroutine->argCount = static_cast<u8>(arguments.size());
+    coroutine->wakeTime = m_time;
+
+    *coroutine->stackTop++ = function;
+    for (const auto& arg : arguments) {
+        *coroutine->stackTop++ = arg;
+    }
+
+    m_coroutines.push_back(std::move(coroutine));
+    m_nextWake = std::min(m_nextWake, m_time);
+}
+
+void VM::updateCoroutines(f64 deltaTime) {
+    m_time += deltaTime;
+    if (m_coroutines.empty() || m_time < m_nextWake) {
+        return;
+    }
+
+    Heap::Scope heapScope(m_heap);
+    startBudget();
+    m_nextWake = std::numeric_limits<f64>::infinity();
+
+    // Coroutines started during this pass first run on the next one
+    usize count = m_coroutines.size();
+    for (usize i = 0; i < count; ++i) {
+        Coroutine& coroutine = *m_coroutines[i];
+
+        bool due;
+        if (coroutine.condition.isNil()) {
+            due = coroutine.wakeTime <= m_time;
+        } else {
+            usize errorCount = m_errors.size();
+            due = invoke(coroutine.condition, {}).asBool();
+            if (m_errors.size() > errorCount) {
+                m_coroutines[i].reset();
+                continue;
+            }
+        }
+
+        if (due && !resume(coroutine)) {
+            m_coroutines[i].reset();
+            continue;
+        }
+
+        // Conditions are polled on every update
+        f64 wake = coroutine.condition.isNil() ? coroutine.wakeTime : m_time;
+        m_nextWake = std::min(m_nextWake, wake);
+    }
+
+    m_coroutines.erase(std::remove(m_coroutines.begin(), m_coroutines.end(), nullptr), m_coroutines.end());
+    if (m_coroutines.empty() && m_frames.empty()) {
+        m_retiredCode.clear();
+    }
+    pauseProfile();
+    checkHeap();
+}
+
+void VM::switchStacks(Coroutine& coroutine) {
+    std::swap(m_stack, coroutine.stack);
+    std::swap(m_stackTop, coroutine.stackTop);
+    std::swap(m_stackCapacity, coroutine.stackCapacity);
+    std::swap(m_frames, coroutine.frames);
+    std::swap(m_scopes, coroutine.scopes);
+    std::swap(m_escapedMark, coroutine.escapedMark);
+}
+
+bool VM::resume(Coroutine& coroutine) {
+    switchStacks(coroutine);
+    m_running = &coroutine;
+    m_suspendRequested = false;
+    coroutine.condition = Value();
+
+    bool ok = true;
+    if (!coroutine.started) {
+        coroutine.started = true;
+        ok = callValue(peek(coroutine.argCount), coroutine.argCount);
+    }
+    if (ok && !m_frames.empty() && !m_suspendRequested) {
+        ok = run(0);
+    }
+    bool alive = ok && m_suspendRequested && !m_frames.empty();
+
+    m_running = nullptr;
+    m_suspendRequested = false;
+    if (!alive) {
+        // The coroutine is gone, but a closure it created may still use these
+        for (usize i = 0; i < m_escapedMark && i < m_scopes.size(); ++i) {
+            m_retiredScopes.push_back(std::move(m_scopes[i]));
+        }
+    }
+    switchStacks(coroutine);
+    return alive;
+}
+
+void VM::suspend(f64 wakeTime, const Value& condition) {
+    if (!m_running) {
+        throw std::runtime_error("yield, wait and waitUntil can only be used inside a coroutine");
+    }
+    m_running->wakeTime = wakeTime;
+    m_running->condition = condition;
+    m_suspendRequested = true;
+}
+
+void VM::registerCoroutineBuiltins() {
+    auto define = [this](const char* name, usize minArity, usize maxArity, NativeFn fn) {
+        m_globalEnv.define(name, Value(makeRef<Function>(name, minArity, maxArity, fn, this)));
+    };
+
+    define("startCoroutine", 1, 255, nativeStartCoroutine);
+    define("yield", 0, 0, nativeYield);
+    define("wait", 1, 1, nativeWait);
+    define("waitUntil", 1, 1, nativeWaitUntil);
+}
+
+// startCoroutine(fn, args...)
+Value VM::nativeStartCoroutine(void* userData, NativeArgs args) {
+    if (!args[0].isFunction()) {
+        throw std::runtime_error("startCoroutine expects a function");
+    }
+    std::vector<Value> arguments(args.begin() + 1, args.end());
+    static_cast<VM*>(userData)->startCoroutine(args[0], arguments);
+    return Value();
+}
+
+// yield() - resume on the next update
+Value VM::nativeYield(void* userData, NativeArgs args) {
+    (void)args;
+    VM* vm = static_cast<VM*>(userData);
+    vm->suspend(vm->m_time, Value());
+    return Value();
+}
+
+// wait(seconds)
+Value VM::nativeWait(void* userData, NativeArgs args) {
+    if (!args[0].isNumber()) {
+        throw std::runtime_error("wait expects a number of seconds");
+    }
+    VM* vm = static_cast<VM*>(userData);
+    vm->suspend(vm->m_time + args[0].asFloat(), Value());
+    return Value();
+}
+
+// waitUntil(fn) - resume once fn() is truthy, checked every update
+Value VM::nativeWaitUntil(void* userData, NativeArgs args) {
+    if (!args[0].isFunction()) {
+        throw std::runtime_error("waitUntil expects a function");
+    }
+    VM* vm = static_cast<VM*>(userData);
+    vm->suspend(vm->m_time, args[0]);
+    return Value();
+}
+
+void VM::runtimeError(const String& message) {
+    m_hasError = true;
+
+    String location;
+    if (!m_frames.empty()) {
+        const CallFrame& frame = m_frames.back();
+        usize offset = static_cast<usize>(frame.ip - frame.proto->chunk.getCode());
+        location = " [line " + std::to_string(frame.proto->chunk.getLine(offset > 0 ? offset - 1 : 0)) +
+                   " in " + frame.proto->name + "]";
+    }
+    m_errors.push_back("Runtime error: " + message + location);
+}
+
+const Value* VM::getMember(const Map& map, Symbol key, InlineCache* cache) {
+    const Shape* shape = map.getShape();
+    if (!cache || !shape) {
+        return map.find(key);
+    }
+
+    if (cache->shape != shape) {
+        i32 slot = shape->find(key);
+        if (slot < 0) {
+            return nullptr;
+        }
+        cache->shape = shape;
+        cache->slot = static_cast<u32>(slot);
+    }
+    return &map.slot(cache->slot);
+}
+
+const Value* VM::getIndex(const Map& map, const Value& key, InlineCache* cache) {
+    if (!cache) {
+        // A key that is neither interned nor held cannot be in any map
+        return map.find(Symbol::find(key.get<String>()));
+    }
+
+    // The same string buffer as last time (usually a constant) needs no hashing
+    if (!cache->key.isString() || cache->key.getStringRef() != key.getStringRef()) {
+        Symbol symbol = Symbol::find(key.get<String>());
+        if (symbol.isEmpty()) {
+            // Not cached: the string may be interned by a later insert
+            return nullptr;
+        }
+        if (symbol.isRuntime()) {
+            // Not cached either: the entry goes away with the maps holding it
+            return map.find(symbol);
+        }
+        cache->key = key;
+        cache->symbol = symbol;
+        cache->shape = nullptr;
+    }
+
+    const Shape* shape = map.getShape();
+    if (!shape) {
+        return map.find(cache->symbol);
+    }
+    if (cache->shape != shape) {
+        i32 slot = shape->find(cache->symbol);
+        if (slot < 0) {
+            return nullptr;
+        }
+        cache->shape = shape;
+        cache->slot = static_cast<u32>(slot);
+    }
+    return &map.slot(cache->slot);
+}
+
+const char* VM::indexValue(const Value& object, const Value& index, InlineCache* cache, Value& result) {
+    if (object.isArray() || object.isTypedArray()) {
+        if (!index.isInteger()) return "Array index must be an integer";
+        i64 i = index.get<i64>();
+        if (i < 0) return "Array index cannot be negative";
+        usize at = static_cast<usize>(i);
+        if (object.isArray()) {
+            const auto& array = object.get<ArrayType>();
+            if (at >= array->size()) return "Array index out of bounds";
+            result = Value((*array)[at]);
+        } else if (object.isFloat64Array()) {
+            const auto& array = object.get<Float64ArrayType>();
+            if (at >= array->size()) return "Array index out of bounds";
+            result = Value((*array)[at]);
+        } else {
+            const auto& array = object.get<Int64ArrayType>();
+            if (at >= array->size()) return "Array index out of bounds";
+            result = Value((*array)[at]);
+        }
+    } else if (object.isMap()) {
+        if (!index.isString()) return "Map key must be a string";
+        const Value* value = getIndex(*object.get<MapType>(), index, cache);
+        result = value ? Value(*value) : Value();
+    } else {
+        return "Can only index arrays and maps";
+    }
+    return nullptr;
+}
+
+bool VM::run(usize exitDepth) {
+    // A call or return can move the top frame into the other tier, which
+    // ends the current loop with m_switchTier set
+    for (;;) {
+        m_switchTier = false;
+        bool ok = m_frames.back().resume ? runSteps(exitDepth) : runBytecode(exitDepth);
+        if (!ok || !m_switchTier) {
+            return ok;
+        }
+    }
+}
+
+bool VM::runBytecode(usize exitDepth) {
+    CallFrame* frame = &m_frames.back();
+    const u8* ip = frame->ip;
+    const Chunk* chunk = &frame->proto->chunk;
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<u16>((ip[-2] << 8) | ip[-1]))
+#define RUNTIME_ERROR(msg) do { frame->ip = ip; runtimeError(msg); return false; } while (false)
+
+    for (;;) {
+        OpCode op = static_cast<OpCode>(READ_BYTE());
+        switch (op) {
+            case OpCode::CONSTANT:
+                push(chunk->getConstants()[READ_SHORT()]);
+                break;
+            case OpCode::NIL: push(Value()); break;
+            case OpCode::TRUE: push(Value(true)); break;
+            case OpCode::FALSE: push(Value(false)); break;
+            case OpCode::POP: pop(); break;
+
+            case OpCode::GET_LOCAL:
+                push(frame->slots[READ_SHORT()]);
+                break;
+            case OpCode::SET_LOCAL:
+                frame->slots[READ_SHORT()] = peek(0);
+                break;
+
+            case OpCode::GET_GLOBAL: {
+                Symbol name = chunk->getNames()[READ_SHORT()];
+                Value* global = m_globalEnv.lookup(name);
+                if (!global) RUNTIME_ERROR("Undefined variable: " + name.str());
+                push(*global);
+                break;
+            }
+            case OpCode::SET_GLOBAL: {
+                Symbol name = chunk->getNames()[READ_SHORT()];
+                Value* global = m_globalEnv.lookup(name);
+                if (!global) RUNTIME_ERROR("Undefined variable: " + name.str());
+                *global = peek(0);
+                break;
+            }
+            case OpCode::DEFINE_GLOBAL:
+                m_globalEnv.define(chunk->getNames()[READ_SHORT()], peek(0));
+                pop();
+                break;
+
+            case OpCode::GET_SCOPED: {
+                u16 depth = READ_SHORT();
+                push(frame->env->slotAt(depth, READ_SHORT()));
+                break;
+            }
+            case OpCode::SET_SCOPED: {
+                u16 depth = READ_SHORT();
+                frame->env->slotAt(depth, READ_SHORT()) = peek(0);
+                break;
+            }
+            case OpCode::DEFINE_SCOPED:
+                frame->env->slot(READ_SHORT()) = pop();
+                break;
+            case OpCode::PUSH_SCOPE:
+                frame->env = pushScope(frame->env, READ_SHORT());
+                break;
+            case OpCode::POP_SCOPE: {
+                Environment* env = frame->env;
+                frame->env = env->getParent();
+                if (m_scopes.size() > m_escapedMark && m_scopes.back().get() == env) {
+                    popScope();
+                }
+                break;
+            }
+
+            case OpCode::ADD:
+                if (const char* error = ops::Add::apply(peek(1), peek(0), peek(1))) RUNTIME_ERROR(error);
+                pop();
+                break;
+            case OpCode::SUBTRACT:
+                if (const char* error = ops::Subtract::apply(peek(1), peek(0), peek(1))) RUNTIME_ERROR(error);
+                pop();
+                break;
+            case OpCode::MULTIPLY:
+                if (const char* error = ops::Multiply::apply(peek(1), peek(0), peek(1))) RUNTIME_ERROR(error);
+                pop();
+                break;
+            case OpCode::DIVIDE:
+                if (const char* error = ops::Divide::apply(peek(1), peek(0), peek(1))) RUNTIME_ERROR(error);
+                pop();
+                break;
+            case OpCode::MODULO:
+                if (const char* error = ops::Modulo::apply(peek(1), peek(0), peek(1))) RUNTIME_ERROR(error);
+                pop();
+                break;
+            case OpCode::POWER:
+                if (const char* error = ops::Power::apply(peek(1), peek(0), peek(1))) RUNTIME_ERROR(error);
+                pop();
+                break;
+            case OpCode::NEGATE:
+                if (const char* error = ops::Negate::apply(peek(0), peek(0))) RUNTIME_ERROR(error);
+                break;
+            case OpCode::POSITIVE:
+                if (!peek(0).isNumber()) RUNTIME_ERROR("Operand must be a number");
+                break;
+            case OpCode::NOT:
+                peek(0) = Value(!peek(0).asBool());
+                break;
+
+            case OpCode::EQUAL:
+            case OpCode::NOT_EQUAL: {
+                bool equal = ops::valuesEqual(peek(1), peek(0));
+                pop();
+                peek(0) = Value(op == OpCode::EQUAL ? equal : !equal);
+                break;
+            }
+            case OpCode::LESS:
+            case OpCode::LESS_EQUAL:
+            case OpCode::GREATER:
+            case OpCode::GREATER_EQUAL: {
+                bool result;
+                const char* error =
+                    op == OpCode::LESS ? ops::Comparison<ops::LessThan>::test(peek(1), peek(0), result)
+                    : op == OpCode::LESS_EQUAL ? ops::Comparison<ops::LessEqual>::test(peek(1), peek(0), result)
+                    : op == OpCode::GREATER ? ops::Comparison<ops::GreaterThan>::test(peek(1), peek(0), result)
+                    : ops::Comparison<ops::GreaterEqual>::test(peek(1), peek(0), result);
+                if (error) RUNTIME_ERROR(error);
+                pop();
+                peek(0) = Value(result);
+                break;
+            }
+
+            case OpCode::JUMP: {
+                u16 offset = READ_SHORT();
+                ip += offset;
+                break;
+            }
+            case OpCode::JUMP_IF_FALSE: {
+                u16 offset = READ_SHORT();
+                if (!peek(0).asBool()) ip += offset;
+                break;
+            }
+            case OpCode::LOOP: {
+                u16 offset = READ_SHORT();
+                if (--m_fuelTick == 0) {
+                    frame->ip = ip;
+                    if (!checkBudget()) return false;
+                }
+                ip -= offset;
+                break;
+            }
+
+            case OpCode::CALL: {
+                u8 argCount = READ_BYTE();
+                u16 site = READ_SHORT();
+                frame->ip = ip;
+                if (--m_fuelTick == 0 && !checkBudget()) {
+                    return false;
+                }
+                InlineCache* cache = inlineCache(site);
+                if (!callValue(peek(argCount), argCount, cache)) {
+                    return false;
+                }
+                if (m_suspendRequested) {
+                    // frame->ip already points past this CALL, where resume continues
+                    return true;
+                }
+                frame = &m_frames.back();
+                if (frame->resume) {
+                    m_switchTier = true;
+                    return true;
+                }
+                ip = frame->ip;
+                chunk = &frame->proto->chunk;
+                break;
+            }
+            case OpCode::RETURN: {
+                Value result = pop();
+                releaseScopes(frame->scopeBase);
+                Value* slots = frame->slots;
+                while (m_stackTop > slots) {
+                    *--m_stackTop = Value();
+                }
+                m_frames.pop_back();
+                push(std::move(result));
+
+                if (m_frames.size() == exitDepth) {
+                    return true;
+                }
+                frame = &m_frames.back();
+                if (frame->resume) {
+                    m_switchTier = true;
+                    return true;
+                }
+                ip = frame->ip;
+                chunk = &frame->proto->chunk;
+                break;
+            }
+
+            case OpCode::BUILD_ARRAY: {
+                u16 count = READ_SHORT();
+                auto array = makeRef<Array>(std::vector<Value>(
+                    std::make_move_iterator(m_stackTop - count), std::make_move_iterator(m_stackTop)));
+                m_stackTop -= count;
+                push(Value(array));
+                break;
+            }
+            case OpCode::BUILD_MAP: {
+                u16 count = READ_SHORT();
+                u16 site = READ_SHORT();
+                InlineCache* cache = inlineCache(site);
+                Value* values = m_stackTop - count;
+                MapType map;
+                if (cache && cache->shape) {
+                    // A literal always lists the same keys, so the shape it built last time applies
+                    ip += count * 2;
+                    map = makeRef<Map>(cache->shape, std::vector<Value>(
+                        std::make_move_iterator(values), std::make_move_iterator(m_stackTop)));
+                } else {
+                    map = makeRef<Map>();
+                    for (Value* value = values; value < m_stackTop; ++value) {
+                        map->set(chunk->getNames()[READ_SHORT()], std::move(*value));
+                    }
+                    // Repeated keys or too many for a shape leave the site uncached
+                    if (cache && map->getShape() && map->size() == count) {
+                        cache->shape = map->getShape();
+                    }
+                }
+                m_stackTop = values;
+                push(Value(map));
+                break;
+            }
+            case OpCode::INDEX_GET: {
+                u16 site = READ_SHORT();
+                Value& object = peek(1);
+                if (const char* error = indexValue(object, peek(0), inlineCache(site), object)) RUNTIME_ERROR(error);
+                pop();
+                break;
+            }
+            case OpCode::MEMBER_GET: {
+                Symbol name = chunk->getNames()[READ_SHORT()];
+                u16 site = READ_SHORT();
+                Value& object = peek(0);
+                if (!object.isMap()) RUNTIME_ERROR("Only maps have members: '" + name.str() + "'");
+                const Value* value = getMember(*object.get<MapType>(), name, inlineCache(site));
+                object = value ? Value(*value) : Value();
+                break;
+            }
+
+            case OpCode::FUNCTION: {
+                // The frame's own program: a suspended coroutine may outlive a reload
+                const FunctionProto* proto = frame->proto->program->getFunction(READ_SHORT());
+                // The new closure may reach any live scope, so none of them can be freed early;
+                // they stay until the collector finds them unreachable
+                for (usize i = m_escapedMark; i < m_scopes.size(); ++i) {
+                    m_heap.noteAllocation(Heap::sizeOf(*m_scopes[i]));
+                }
+                m_escapedMark = m_scopes.size();
+                push(Value(makeRef<Function>(proto->declaration, frame->env)));
+                break;
+            }
+
+            default:
+                RUNTIME_ERROR("Unknown opcode " + std::to_string(static_cast<u32>(op)));
+        }
+    }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef RUNTIME_ERROR
+}
+
+} // namespace lang
+} // namespace oracon
@@ -0,0 +1,39 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+// A tree larger than the Program's first arena block: nodes in earlier
+// blocks must stay where they are as the arena grows
+void testArenaGrowth() {
+    String source;
+    for (int i = 0; i < 500; ++i) {
+        String n = std::to_string(i);
+        source += "func f" + n + "(x) { return x + " + n + "; }\n";
+    }
+    source += "let total = f0(1) + f250(1) + f499(1);\n";
+
+    VM vm;
+    auto script = run(vm, source);
+    if (!script) return;
+    CHECK(script->ast->getStatements().size() == 501);
+    CHECK(script->ast->getNodeBytes() > 16 * 1024);
+    CHECK(!vm.hasError());
+    CHECK(isInteger(vm.getGlobalEnv().get("total"), 752));
+
+    std::string_view first = script->ast->makeText("first");
+    for (int i = 0; i < 1000; ++i) {
+        script->ast->makeText("padding padding padding padding");
+    }
+    CHECK(first == "first");
+}
+
+} // namespace
+
+int main() {
+    testArenaGrowth();
+    return finish("ast");
+}
@@ -0,0 +1,209 @@
+#include "test_util.h"
+#include "oracon/lang/compiler/bundle.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+const char* BUNDLE_PATH = "lang_test_bundle.orb";
+
+bool writeFile(const String& path, const std::vector<u8>& data) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+void testRoundTrip() {
+    auto script = compile(R"(
+        let greeting = "hello";
+        let ratio = 0.25;
+        let flags = [true, false, nil];
+        func scale(x, y) { return [x * 2, y * 2]; }
+        let scaled = scale(3, 4);
+        let line = 0;
+        func fail() { return 1 / 0; }
+    )", true);
+    CHECK(script != nullptr);
+    if (!script) return;
+
+    BundleWriter writer;
+    CHECK(writer.add("game/main.ora", *script->program));
+    CHECK(writer.write(BUNDLE_PATH));
+
+    ScriptBundle bundle;
+    CHECK(bundle.open(BUNDLE_PATH));
+    CHECK(bundle.contains("game/main.ora"));
+    CHECK(bundle.find("missing.ora") == nullptr);
+
+    const CompiledProgram* loaded = bundle.find("game/main.ora");
+    CHECK(loaded != nullptr);
+    if (!loaded) return;
+    CHECK(loaded->getFunctionCount() == script->program->getFunctionCount());
+    for (usize i = 0; i < loaded->getFunctionCount(); ++i) {
+        const FunctionProto* original = script->program->getFunction(i);
+        const FunctionProto* decoded = loaded->getFunction(i);
+        CHECK(decoded->name == original->name);
+        CHECK(decoded->arity == original->arity);
+        CHECK(decoded->maxStack == original->maxStack);
+        CHECK(decoded->chunk.size() == original->chunk.size());
+        CHECK(decoded->chunk.getLineRuns().size() == original->chunk.getLineRuns().size());
+        for (usize offset = 0; offset < original->chunk.size(); ++offset) {
+            CHECK(decoded->chunk.getLine(offset) == original->chunk.getLine(offset));
+        }
+    }
+    const auto& globals = script->program->getGlobalDeclarations();
+    CHECK(loaded->getGlobalDeclarations().size() == globals.size());
+    for (usize i = 0; i < globals.size() && i < loaded->getGlobalDeclarations().size(); ++i) {
+        const GlobalDeclaration& decoded = loaded->getGlobalDeclarations()[i];
+        CHECK(decoded.name == globals[i].name && decoded.isFunction == globals[i].isFunction);
+        CHECK(decoded.start == globals[i].start && decoded.end == globals[i].end);
+    }
+
+    VM vm;
+    vm.execute(loaded);
+    CHECK(!vm.hasError());
+    CHECK(vm.getGlobalEnv().get("greeting").toString() == "hello");
+    CHECK(vm.getGlobalEnv().get("ratio").asFloat() == 0.25);
+    CHECK(vm.getGlobalEnv().get("scaled").toString() == "[6, 8]");
+
+    vm.callFunction("fail", {});
+    CHECK(hasErrorContaining(vm, "Division by zero"));
+
+    bundle.close();
+    std::remove(BUNDLE_PATH);
+}
+
+void testRejectsBadFiles() {
+    {
+        ScriptBundle bundle;
+        CHECK(writeFile(BUNDLE_PATH, {'N', 'O', 'P', 'E', 1, 0, 0, 0}));
+        CHECK(!bundle.open(BUNDLE_PATH));
+        CHECK(bundle.hasError());
+    }
+
+    auto script = compile("func f(a) { return a + 1; } let x = f(1);");
+    CHECK(script != nullptr);
+    if (!script) return;
+
+    BundleWriter writer;
+    CHECK(writer.add("f.ora", *script->program));
+    std::vector<u8> data = writer.serialize();
+
+    // Every truncation either fails to open or fails to decode; none crash
+    for (usize size = 0; size < data.size(); ++size) {
+        CHECK(writeFile(BUNDLE_PATH, std::vector<u8>(data.begin(), data.begin() + size)));
+        ScriptBundle bundle;
+        if (bundle.open(BUNDLE_PATH)) {
+            CHECK(bundle.find("f.ora") == nullptr);
+        }
+    }
+    std::remove(BUNDLE_PATH);
+}
+
+// An operand naming a constant, name, slot, cache or function that does not
+// exist makes the whole program fail to decode, rather than reaching the VM
+void testRejectsBadOperands() {
+    auto script = compile(R"(
+        let base = 10;
+        func make(a) {
+            let local = a + base;
+            func inner() { return local; }
+            return {x: local, y: inner}.x;
+        }
+        let total = make(1);
+        let pair = [total, base];
+        let first = pair[0];
+    )");
+    CHECK(script != nullptr);
+    if (!script) return;
+
+    BundleWriter writer;
+    CHECK(writer.add("ops.ora", *script->program));
+    const std::vector<u8> data = writer.serialize();
+
+    usize corrupted = 0;
+    for (usize f = 0; f < script->program->getFunctionCount(); ++f) {
+        const Chunk& chunk = script->program->getFunction(f)->chunk;
+        const u8* code = chunk.getCode();
+        auto at = std::search(data.begin(), data.end(), code, code + chunk.size());
+        CHECK(at != data.end());
+        if (at == data.end()) continue;
+        usize codeStart = static_cast<usize>(at - data.begin());
+
+        for (usize offset = 0; offset < chunk.size(); offset += chunk.instructionLength(offset)) {
+            // Where the operand to break sits, and what to put there
+            usize operand = 1;
+            u16 value = 0xFFFE;
+            switch (static_cast<OpCode>(code[offset])) {
+                case OpCode::CONSTANT:
+                case OpCode::GET_LOCAL:
+                case OpCode::SET_LOCAL:
+                case OpCode::GET_GLOBAL:
+                case OpCode::SET_GLOBAL:
+                case OpCode::DEFINE_GLOBAL:
+                case OpCode::MEMBER_GET:
+                case OpCode::INDEX_GET:
+                    break;
+                case OpCode::CALL: operand = 2; break;
+                case OpCode::BUILD_MAP: operand = 5; break;
+                case OpCode::FUNCTION: value = 0; break;
+                default: continue;
+            }
+
+            std::vector<u8> bad = data;
+            bad[codeStart + offset + operand] = static_cast<u8>(value >> 8);
+            bad[codeStart + offset + operand + 1] = static_cast<u8>(value);
+            CHECK(writeFile(BUNDLE_PATH, bad));
+
+            ScriptBundle bundle;
+            CHECK(bundle.open(BUNDLE_PATH));
+            CHECK(bundle.find("ops.ora") == nullptr);
+            CHECK(!bundle.getErrors().empty() &&
+                  bundle.getErrors().back().find("out of range") != String::npos);
+            ++corrupted;
+        }
+    }
+    CHECK(corrupted >= 10);
+
+    // So does a global declaration that does not end by binding its name;
+    // the last one's end offset sits just before its function flag
+    std::vector<u8> bad = data;
+    bad[bad.size() - 5] = static_cast<u8>(bad[bad.size() - 5] - 1);
+    CHECK(writeFile(BUNDLE_PATH, bad));
+    {
+        ScriptBundle bundle;
+        CHECK(bundle.open(BUNDLE_PATH));
+        CHECK(bundle.find("ops.ora") == nullptr);
+        CHECK(!bundle.getErrors().empty() &&
+              bundle.getErrors().back().find("bad global declaration first") != String::npos);
+    }
+
+    // The untouched bundle still loads and runs
+    CHECK(writeFile(BUNDLE_PATH, data));
+    ScriptBundle bundle;
+    CHECK(bundle.open(BUNDLE_PATH));
+    const CompiledProgram* loaded = bundle.find("ops.ora");
+    CHECK(loaded != nullptr);
+    if (loaded) {
+        VM vm;
+        vm.execute(loaded);
+        CHECK(!vm.hasError());
+        CHECK(isInteger(vm.getGlobalEnv().get("first"), 11));
+    }
+    bundle.close();
+    std::remove(BUNDLE_PATH);
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testRejectsBadFiles();
+    testRejectsBadOperands();
+    return finish("bundle");
+}
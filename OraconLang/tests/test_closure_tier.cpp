@@ -0,0 +1,88 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+// Exercises every step family: locals, globals, scoped variables, fused
+// compare-and-branch, calls, literals and member/index reads
+const char* PROGRAM = R"(
+    let scale = 3;
+    func fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+    func sum(n) {
+        let total = 0;
+        for (let i = 0; i < n; i = i + 1) {
+            if (i % 3 == 0) { continue; }
+            total = total + i * scale;
+        }
+        return total;
+    }
+    func counter() {
+        let count = 0;
+        func next() { count = count + 1; return count; }
+        next(); next();
+        return next();
+    }
+    func shapes(n) {
+        let out = 0;
+        for (let i = 0; i < n; i = i + 1) {
+            let p = {x: i, y: i * 2, tag: "p" + i};
+            let list = [p.x, p.y, 7];
+            out = out + list[1] - p.x;
+        }
+        return out;
+    }
+    func mixed(a, b) { return a * 0.5 + b; }
+    let results = [fib(18), sum(500), counter(), shapes(200), mixed(3, 4)];
+)";
+
+Value resultsWithThreshold(u32 threshold) {
+    VM vm;
+    vm.setTierUpThreshold(threshold);
+    auto script = run(vm, PROGRAM);
+    CHECK(!vm.hasError());
+    if (threshold > 0) {
+        CHECK(vm.getTieredFunctionCount() > 0);
+    }
+    return vm.getGlobalEnv().get("results");
+}
+
+void testMatchesBytecode() {
+    String bytecode = resultsWithThreshold(0).toString();
+    CHECK(resultsWithThreshold(1).toString() == bytecode);
+    CHECK(resultsWithThreshold(5).toString() == bytecode);
+}
+
+// Errors raised inside tiered code are the same as on bytecode
+void testErrors() {
+    const char* cases[][2] = {
+        {"func f(a, b) { return a / b; } for (let i = 0; i < 3; i = i + 1) { f(i, 1); } f(-9223372036854775807 - 1, -1);",
+         "Integer overflow"},
+        {"func f(a, b) { return a % b; } for (let i = 0; i < 3; i = i + 1) { f(i, 1); } f(1, 0);",
+         "Modulo by zero"},
+        {"func f(a) { return -a; } for (let i = 0; i < 3; i = i + 1) { f(i); } f(-9223372036854775807 - 1);",
+         "Integer overflow"},
+        {"func f(a, b) { return a + b; } for (let i = 0; i < 3; i = i + 1) { f(i, i); } f(9223372036854775807, 1);",
+         "Integer overflow"},
+        {"func f(a) { return a < 1; } for (let i = 0; i < 3; i = i + 1) { f(i); } f(\"x\");",
+         "Operands must be numbers"},
+    };
+
+    for (const auto& entry : cases) {
+        VM vm;
+        vm.setTierUpThreshold(1);
+        auto script = run(vm, entry[0]);
+        CHECK(hasErrorContaining(vm, entry[1]));
+        CHECK(vm.getTieredFunctionCount() == 1);
+    }
+}
+
+} // namespace
+
+int main() {
+    testMatchesBytecode();
+    testErrors();
+    return finish("closure_tier");
+}
@@ -0,0 +1,208 @@
+#include "test_util.h"
+#include <cmath>
+#include <limits>
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+Value numbers(i64 count) {
+    Value array = Value::createArray();
+    for (i64 i = 0; i < count; ++i) {
+        array.arrayPush(Value(i));
+    }
+    return array;
+}
+
+void testArrayAliasing() {
+    Value a = numbers(6);
+    Value alias = a;
+    alias.arraySet(5, Value(i64(50)));
+    CHECK(isInteger(a.arrayGet(5), 50));
+}
+
+void testSlices() {
+    Value a = numbers(6);
+    Value slice = a.arraySlice(1, 4);
+    CHECK(slice.toString() == "[1, 2, 3]");
+
+    // Writes to a slice copy it first
+    slice.arraySet(0, Value(i64(100)));
+    CHECK(slice.toString() == "[100, 2, 3]");
+    CHECK(a.toString() == "[0, 1, 2, 3, 4, 5]");
+
+    slice.arrayPush(Value(i64(9)));
+    CHECK(slice.arraySize() == 4);
+    CHECK(a.arraySize() == 6);
+
+    // A slice outlives the array it was taken from
+    Value survivor;
+    {
+        Value temporary = numbers(5);
+        survivor = temporary.arraySlice(1, 3);
+    }
+    survivor.arrayPush(Value(i64(8)));
+    CHECK(survivor.toString() == "[1, 2, 8]");
+}
+
+void testSnapshots() {
+    Value a = numbers(4);
+    Value snapshot = a.snapshot();
+    a.arraySet(0, Value(i64(-1)));
+    a.arrayPush(Value(i64(4)));
+    CHECK(snapshot.toString() == "[0, 1, 2, 3]");
+    CHECK(a.toString() == "[-1, 1, 2, 3, 4]");
+
+    Value m = Value::createMap();
+    m.mapSet("x", Value(i64(1)));
+    Value mapSnapshot = m.snapshot();
+    m.mapSet("x", Value(i64(2)));
+    m.mapSet("y", Value(i64(3)));
+    CHECK(isInteger(mapSnapshot.mapGet("x"), 1));
+    CHECK(!mapSnapshot.mapHas("y"));
+
+    // Writing to the snapshot leaves the original alone too
+    mapSnapshot.mapDelete("x");
+    CHECK(isInteger(m.mapGet("x"), 2));
+}
+
+void testTypedArraySnapshots() {
+    VM vm;
+    auto script = run(vm, R"(
+        let f = float64Array(3);
+        let i = int64Array(3);
+        let fs = snapshot(f);
+        let is = snapshot(i);
+        vset(f, 0, 1.5);
+        vset(is, 2, 7);
+    )");
+    CHECK(!vm.hasError());
+    CHECK(vm.getGlobalEnv().get("f").toString() == "Float64Array[1.5, 0, 0]");
+    CHECK(vm.getGlobalEnv().get("fs").toString() == "Float64Array[0, 0, 0]");
+    CHECK(vm.getGlobalEnv().get("i").toString() == "Int64Array[0, 0, 0]");
+    CHECK(vm.getGlobalEnv().get("is").toString() == "Int64Array[0, 0, 7]");
+}
+
+// A NaN in any position, in the SSE2 body or the scalar tail, gives NaN
+void testTypedArrayMinMaxNaN() {
+    VM vm;
+    const f64 nan = std::numeric_limits<f64>::quiet_NaN();
+    for (usize n = 1; n <= 9; ++n) {
+        for (usize at = 0; at < n; ++at) {
+            auto data = makeRef<std::vector<f64>>(n, 1.0);
+            Value array(data);
+            (*data)[at] = nan;
+            CHECK(std::isnan(vm.callFunction("vmin", {array}).asFloat()));
+            CHECK(std::isnan(vm.callFunction("vmax", {array}).asFloat()));
+
+            (*data)[at] = -2.0;
+            CHECK(vm.callFunction("vmin", {array}).asFloat() == -2.0);
+            (*data)[at] = 3.0;
+            CHECK(vm.callFunction("vmax", {array}).asFloat() == 3.0);
+        }
+    }
+    CHECK(!vm.hasError());
+}
+
+void testScriptBuiltins() {
+    VM vm;
+    auto script = run(vm, R"(
+        let a = [0, 1, 2, 3, 4];
+        let s = slice(a, 1, -1);
+        let tail = slice(a, 3);
+        let frozen = snapshot(a);
+    )");
+    CHECK(!vm.hasError());
+    CHECK(vm.getGlobalEnv().get("s").toString() == "[1, 2, 3]");
+    CHECK(vm.getGlobalEnv().get("tail").toString() == "[3, 4]");
+    CHECK(vm.getGlobalEnv().get("frozen").toString() == "[0, 1, 2, 3, 4]");
+}
+
+// Int64Array arithmetic fails on overflow like scalar integers do; sums
+// only fail when the total does not fit
+void testInt64ArrayOverflow() {
+    VM vm;
+    auto script = run(vm, R"(
+        let big = int64Array([9223372036854775807, 0, 0, 0, 1, 0, 0, 0, -2, 0, 0, 0]);
+        let total = vsum(big);
+        let dot = vdot(int64Array([3037000499, 2]), int64Array([3037000499, -7]));
+        let sums = vadd(int64Array([1, 2, 3]), int64Array([4, 5, 6]));
+    )");
+    CHECK(script && !vm.hasError());
+    CHECK(isInteger(vm.getGlobalEnv().get("total"), 9223372036854775806));
+    CHECK(isInteger(vm.getGlobalEnv().get("dot"), 9223372030926248987));
+    CHECK(vm.getGlobalEnv().get("sums").toString() == "Int64Array[5, 7, 9]");
+
+    const char* cases[][2] = {
+        {"vadd(int64Array([0, 0, 9223372036854775807]), int64Array([0, 0, 1]));", "vadd: Integer overflow"},
+        {"vadd(int64Array([-9223372036854775807 - 1, 0]), int64Array([-1, 0]));", "vadd: Integer overflow"},
+        {"vscale(int64Array([1, 4611686018427387904]), 2);", "vscale: Integer overflow"},
+        {"vsum(int64Array([9223372036854775807, 1]));", "vsum: Integer overflow"},
+        {"vsum(int64Array([9223372036854775807, 0, 0, 0, 1, 0]));", "vsum: Integer overflow"},
+        {"vdot(int64Array([4294967296]), int64Array([4294967296]));", "vdot: Integer overflow"},
+        {"vdot(int64Array([9223372036854775807, 1]), int64Array([1, 1]));", "vdot: Integer overflow"},
+    };
+    for (const auto& entry : cases) {
+        VM failing;
+        auto bad = run(failing, entry[0]);
+        CHECK(bad && hasErrorContaining(failing, entry[1]));
+    }
+}
+
+// Keys set from host strings live only as long as a map holds them, unless
+// a script names them too
+void testRuntimeMapKeys() {
+    usize before = Symbol::getInternedCount();
+    {
+        Value map = Value::createMap();
+        for (i64 i = 0; i < 40; ++i) {
+            map.mapSet("runtime key " + std::to_string(i), Value(i));
+        }
+        map.mapSet("promotedKey", Value(static_cast<i64>(99)));
+        CHECK(Symbol::getInternedCount() == before + 41);
+        CHECK(map.get<MapType>()->getShape() == nullptr);
+
+        // A snapshot keeps the keys after the original drops them
+        Value snapshot = map.snapshot();
+        map.mapDelete("runtime key 0");
+        CHECK(!map.mapHas("runtime key 0") && snapshot.mapHas("runtime key 0"));
+        map = Value();
+        CHECK(!Symbol::find("runtime key 0").isEmpty());
+
+        // Scripts read them by string, and naming one makes it permanent
+        VM vm;
+        vm.getGlobalEnv().define("data", snapshot);
+        snapshot = Value();
+        auto script = run(vm, R"(
+            let byIndex = data["runtime key 3"];
+            let again = data["runtime key 3"];
+            let promoted = data.promotedKey;
+        )");
+        CHECK(script && !vm.hasError());
+        CHECK(isInteger(vm.getGlobalEnv().get("byIndex"), 3));
+        CHECK(isInteger(vm.getGlobalEnv().get("again"), 3));
+        CHECK(isInteger(vm.getGlobalEnv().get("promoted"), 99));
+    }
+    CHECK(Symbol::find("runtime key 3").isEmpty());
+    CHECK(!Symbol::find("promotedKey").isEmpty());
+
+    Value late = Value::createMap();
+    late.mapSet("promotedKey", Value(static_cast<i64>(1)));
+    CHECK(late.get<MapType>()->getShape() != nullptr);
+}
+
+} // namespace
+
+int main() {
+    testArrayAliasing();
+    testSlices();
+    testSnapshots();
+    testTypedArraySnapshots();
+    testTypedArrayMinMaxNaN();
+    testScriptBuiltins();
+    testInt64ArrayOverflow();
+    testRuntimeMapKeys();
+    return finish("collections");
+}
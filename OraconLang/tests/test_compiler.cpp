@@ -0,0 +1,109 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+const FunctionProto* findProto(const CompiledProgram& program, const String& name) {
+    for (usize i = 0; i < program.getFunctionCount(); ++i) {
+        if (program.getFunction(i)->name == name) return program.getFunction(i);
+    }
+    return nullptr;
+}
+
+void testMaxStack() {
+    auto script = compile(R"(
+        func pair(a, b) { return [a, b]; }
+        func wide() { return [1, 2, 3, 4, 5, 6, 7, 8]; }
+        func branches(x) {
+            if (x > 0 and x < 10) { return pair(x, x); }
+            let total = 0;
+            while (total < x) { total = total + 1; }
+            return total;
+        }
+        let r = branches(3);
+    )");
+    CHECK(script != nullptr);
+    if (!script) return;
+
+    const CompiledProgram& program = *script->program;
+    for (usize i = 0; i < program.getFunctionCount(); ++i) {
+        const FunctionProto* proto = program.getFunction(i);
+        CHECK(proto->maxStack > proto->arity);
+        CHECK(proto->maxStack == proto->chunk.computeMaxStack(proto->arity + 1));
+    }
+
+    // Callee and two arguments, then both pushed again for the literal
+    CHECK(findProto(program, "pair")->maxStack == 5);
+    // Callee, then eight elements
+    CHECK(findProto(program, "wide")->maxStack == 9);
+}
+
+void testMalformedStack() {
+    // POP on an empty frame
+    Chunk underflow;
+    underflow.write(OpCode::POP, 1);
+    underflow.write(OpCode::RETURN, 1);
+    CHECK(underflow.computeMaxStack(0) == 0);
+
+    // A jump past the end of the code
+    Chunk badJump;
+    badJump.write(OpCode::JUMP, 1);
+    badJump.write(0x00, 1);
+    badJump.write(0x10, 1);
+    CHECK(badJump.computeMaxStack(1) == 0);
+
+    // A loop body that pushes on every pass reaches its start at two depths
+    Chunk growing;
+    growing.write(OpCode::NIL, 1);
+    growing.write(OpCode::LOOP, 1);
+    growing.write(0x00, 1);
+    growing.write(0x04, 1);
+    CHECK(growing.computeMaxStack(1) == 0);
+
+    Chunk ok;
+    ok.write(OpCode::NIL, 1);
+    ok.write(OpCode::NIL, 1);
+    ok.write(OpCode::ADD, 1);
+    ok.write(OpCode::RETURN, 1);
+    CHECK(ok.computeMaxStack(1) == 3);
+}
+
+void testDisassemble() {
+    auto script = compile("func f(x) { return x + 1; } let y = f(2);");
+    CHECK(script != nullptr);
+    if (!script) return;
+
+    String listing = script->program->disassemble();
+    CHECK(listing.find("== f ==") != String::npos);
+    CHECK(listing.find("ADD") != String::npos);
+    CHECK(listing.find("CALL") != String::npos);
+}
+
+} // namespace
+
+// Only identifiers enter the global symbol table; literal text stays a view
+// into the source
+void testInterning() {
+    VM vm;
+    auto script = run(vm, R"(
+        let lexerInternProbe = "literal that is never interned";
+        let escaped = "tab\there\nquote\" slash\\";
+        let big = 987654321012;
+    )");
+    CHECK(!vm.hasError());
+    CHECK(!Symbol::find("lexerInternProbe").isEmpty());
+    CHECK(Symbol::find("literal that is never interned").isEmpty());
+    CHECK(Symbol::find("987654321012").isEmpty());
+    CHECK(vm.getGlobalEnv().get("escaped").toString() == "tab\there\nquote\" slash\\");
+}
+
+int main() {
+    testMaxStack();
+    testMalformedStack();
+    testDisassemble();
+    testInterning();
+    return finish("compiler");
+}
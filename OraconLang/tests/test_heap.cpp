@@ -0,0 +1,98 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+// A nested function that refers to itself lives in the scope it captures,
+// a cycle reference counting alone never frees
+const char* CYCLES = R"(
+    func makeCycle(i) {
+        func again() { return again; }
+        return i;
+    }
+    func churn(n) {
+        let total = 0;
+        for (let i = 0; i < n; i = i + 1) { total = total + makeCycle(i); }
+        return total;
+    }
+    let kept = makeCycle;
+)";
+
+void testCollectsCycles() {
+    VM vm;
+    auto script = run(vm, CYCLES);
+    CHECK(isInteger(vm.callFunction("churn", {Value(i64(1000))}), 499500));
+    CHECK(!vm.hasError());
+
+    vm.collectGarbage();
+    HeapStats stats = vm.getHeapStats();
+    CHECK(stats.collections >= 1);
+    CHECK(stats.freedObjects >= 1000);
+    CHECK(stats.freedScopes >= 1000);
+    CHECK(stats.objects < 10);
+
+    // Reachable values survive
+    CHECK(vm.getGlobalEnv().get("kept").isFunction());
+    CHECK(isInteger(vm.callFunction("makeCycle", {Value(i64(7))}), 7));
+}
+
+void testHeapLimit() {
+    VM vm;
+    auto script = run(vm, CYCLES);
+
+    // Garbage alone never trips the limit: the collector runs first
+    ExecutionBudget budget;
+    budget.heapLimitBytes = 1 << 20;
+    vm.setBudget(budget);
+    vm.callFunction("churn", {Value(i64(20000))});
+    CHECK(!vm.hasError());
+    CHECK(vm.getHeapStats().peakBytes <= budget.heapLimitBytes * 2);
+}
+
+// Strings and typed arrays are charged when created, before any collection
+// has measured them, so one large buffer trips the limit on its own
+void testChargesBuffers() {
+    VM vm;
+    auto script = run(vm, "let big = float64Array(200000);");
+    HeapStats stats = vm.getHeapStats();
+    CHECK(stats.collections == 0);
+    CHECK(stats.bytes >= 200000 * sizeof(f64));
+
+    Heap heap;
+    {
+        Heap::Scope scope(heap);
+        Value text(String(100000, 'x'));
+        CHECK(heap.getBytes() >= 100000);
+    }
+
+    // So is a string grown in place by +
+    Value piece(String(100000, 'y'));
+    Heap grownHeap;
+    {
+        Heap::Scope scope(grownHeap);
+        Value grown(String("a"));
+        CHECK(grownHeap.getBytes() < 1000);
+        Value::concat(grown, piece, grown);
+        CHECK(grown.asString().size() == 100001);
+        CHECK(grownHeap.getBytes() >= 100000);
+    }
+
+    VM limited;
+    ExecutionBudget budget;
+    budget.heapLimitBytes = 1 << 20;
+    limited.setBudget(budget);
+    auto held = run(limited, "let big = int64Array(300000);");
+    CHECK(hasErrorContaining(limited, "Heap limit exceeded"));
+}
+
+} // namespace
+
+int main() {
+    testCollectsCycles();
+    testHeapLimit();
+    testChargesBuffers();
+    return finish("heap");
+}
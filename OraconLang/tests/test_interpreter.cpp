@@ -0,0 +1,169 @@
+#include "test_util.h"
+#include "oracon/lang/interpreter/interpreter.h"
+#include "oracon/lang/vm/operators.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+UniquePtr<Script> interpret(Interpreter& interpreter, const String& source) {
+    auto script = compile(source);
+    if (script) {
+        interpreter.execute(script->ast.get());
+    }
+    return script;
+}
+
+// return, break and continue reach the right statement through nested
+// blocks and loops, and the tree-walker agrees with the VM
+void testControlFlow() {
+    const char* source = R"(
+        func find(limit) {
+            for (let i = 0; i < 10; i = i + 1) {
+                let j = 0;
+                while (true) {
+                    j = j + 1;
+                    if (j > 3) { break; }
+                    if (j == 2) { continue; }
+                    if (i * j >= limit) { return i * 10 + j; }
+                }
+            }
+            return -1;
+        }
+        func fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+        let found = find(7);
+        let missing = find(100);
+        let f = fib(15);
+        let total = 0;
+        for i in 0..5 { total += i; }
+    )";
+
+    Interpreter interpreter;
+    auto tree = interpret(interpreter, source);
+    VM vm;
+    auto bytecode = run(vm, source);
+    if (!tree || !bytecode) return;
+
+    CHECK(!interpreter.hasError());
+    const Environment& globals = interpreter.getGlobalEnv();
+    CHECK(isInteger(globals.get("found"), 33));
+    CHECK(isInteger(globals.get("missing"), -1));
+    CHECK(isInteger(globals.get("f"), 610));
+    CHECK(isInteger(globals.get("total"), 10));
+    for (const char* name : {"found", "missing", "f", "total"}) {
+        CHECK(ops::valuesEqual(globals.get(name), vm.getGlobalEnv().get(name)));
+    }
+
+    Value result = interpreter.callFunction("fib", {Value(static_cast<i64>(10))});
+    CHECK(isInteger(result, 55));
+}
+
+// A nested function keeps the scope it was declared in after the call returns
+void testClosures() {
+    Interpreter interpreter;
+    auto script = interpret(interpreter, R"(
+        func counter() {
+            let count = 0;
+            func next() { count = count + 1; return count; }
+            return next;
+        }
+        let a = counter();
+        let b = counter();
+        a(); a();
+        let fromA = a();
+        let fromB = b();
+    )");
+    if (!script) return;
+    CHECK(!interpreter.hasError());
+    CHECK(isInteger(interpreter.getGlobalEnv().get("fromA"), 3));
+    CHECK(isInteger(interpreter.getGlobalEnv().get("fromB"), 1));
+}
+
+// Scopes closures kept are freed once no closure reaches them; a closure
+// the script still holds keeps its own
+void testCollectsScopes() {
+    Interpreter interpreter;
+    auto script = interpret(interpreter, R"(
+        func counter() {
+            let count = 0;
+            func next() { count = count + 1; return count; }
+            return next;
+        }
+        func churn(n) {
+            for (let i = 0; i < n; i = i + 1) { counter(); }
+        }
+        let held = counter();
+        held();
+    )");
+    if (!script) return;
+    interpreter.callFunction("churn", {Value(i64(1000))});
+    CHECK(!interpreter.hasError());
+
+    interpreter.collectGarbage();
+    HeapStats stats = interpreter.getHeapStats();
+    CHECK(stats.freedScopes >= 1000);
+    CHECK(stats.scopes < 10);
+    CHECK(isInteger(interpreter.callFunction("held", {}), 2));
+}
+
+// Call and block scopes are reused once they end, but never one a closure
+// captured, and nested calls each get their own arguments
+void testScopeReuse() {
+    Interpreter interpreter;
+    auto script = interpret(interpreter, R"(
+        let kept = [];
+        func fill(n) {
+            for (let i = 0; i < n; i = i + 1) {
+                let v = i * 2;
+                if (i % 4 == 0) {
+                    func get() { return v; }
+                    push(kept, get);
+                }
+            }
+        }
+        func add(a, b) { return a + b; }
+        fill(10);
+        fill(3);
+        let total = 0;
+        for (let j = 0; j < len(kept); j = j + 1) {
+            let f = kept[j];
+            total = add(total, f());
+        }
+        let nested = add(add(1, 2), add(add(3, 4), 5));
+    )");
+    if (!script) return;
+    CHECK(!interpreter.hasError());
+    CHECK(isInteger(interpreter.getGlobalEnv().get("total"), 24));
+    CHECK(isInteger(interpreter.getGlobalEnv().get("nested"), 15));
+}
+
+void testErrors() {
+    Interpreter interpreter;
+    auto script = interpret(interpreter, "func down(n) { return down(n + 1); } let after = 1; down(0);");
+    if (!script) return;
+    CHECK(interpreter.hasError());
+    CHECK(interpreter.getErrors()[0].find("Stack overflow") != String::npos);
+
+    // The interpreter is usable again after an error
+    interpreter.callFunction("down", {});
+    CHECK(interpreter.getErrors().back().find("Expected 1 arguments but got 0") != String::npos);
+    auto next = interpret(interpreter, "let ok = 1 + 1;");
+    CHECK(next && isInteger(interpreter.getGlobalEnv().get("ok"), 2));
+
+    Interpreter other;
+    auto overflow = interpret(other, "let x = 9223372036854775807 + 1;");
+    CHECK(other.getErrors().size() == 1 && other.getErrors()[0].find("Integer overflow") != String::npos);
+}
+
+} // namespace
+
+int main() {
+    testControlFlow();
+    testClosures();
+    testCollectsScopes();
+    testScopeReuse();
+    testErrors();
+    return finish("interpreter");
+}
@@ -0,0 +1,83 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+std::vector<TokenType> typesOf(const std::vector<Token>& tokens) {
+    std::vector<TokenType> types;
+    for (const Token& token : tokens) types.push_back(token.getType());
+    return types;
+}
+
+void testTokenTypes() {
+    Lexer lexer("let x = a.b ** 2 >= 1.5 && !done; // comment\n/* block\n */ for i in 0..10 ...");
+    std::vector<Token> tokens = lexer.tokenize();
+    CHECK(!lexer.hasError());
+
+    std::vector<TokenType> expected = {
+        TokenType::LET, TokenType::IDENTIFIER, TokenType::ASSIGN, TokenType::IDENTIFIER,
+        TokenType::DOT, TokenType::IDENTIFIER, TokenType::POWER, TokenType::INTEGER,
+        TokenType::GREATER_EQUAL, TokenType::FLOAT, TokenType::AND, TokenType::NOT,
+        TokenType::IDENTIFIER, TokenType::SEMICOLON, TokenType::FOR, TokenType::IDENTIFIER,
+        TokenType::IN, TokenType::INTEGER, TokenType::RANGE, TokenType::INTEGER,
+        TokenType::SPREAD, TokenType::EOF_TOKEN,
+    };
+    CHECK(typesOf(tokens) == expected);
+    CHECK(tokens[14].getLocation().line == 3);
+
+    Lexer operators("+= -= *= /= %= == != <= => < > ? :");
+    expected = {
+        TokenType::PLUS_ASSIGN, TokenType::MINUS_ASSIGN, TokenType::STAR_ASSIGN,
+        TokenType::SLASH_ASSIGN, TokenType::PERCENT_ASSIGN, TokenType::EQUAL,
+        TokenType::NOT_EQUAL, TokenType::LESS_EQUAL, TokenType::ARROW, TokenType::LESS,
+        TokenType::GREATER, TokenType::QUESTION, TokenType::COLON, TokenType::EOF_TOKEN,
+    };
+    CHECK(typesOf(operators.tokenize()) == expected);
+}
+
+// Token text views the source; only identifiers are interned
+void testViews() {
+    const char* source = "let name = \"a\\\"b\" + 1e3;";
+    std::string_view view(source);
+    Lexer lexer(view);
+    std::vector<Token> tokens = lexer.tokenize();
+    CHECK(!lexer.hasError());
+
+    for (const Token& token : tokens) {
+        CHECK(token.getLexeme().data() >= view.data());
+        CHECK(token.getLexeme().data() + token.getLexeme().size() <= view.data() + view.size());
+    }
+    CHECK(tokens[1].getSymbol() == Symbol::intern("name"));
+    CHECK(tokens[3].is(TokenType::STRING));
+    CHECK(tokens[3].getLexeme() == "a\\\"b");
+    CHECK(unescapeString(tokens[3].getLexeme()) == "a\"b");
+    CHECK(tokens[3].getSymbol().isEmpty());
+    CHECK(tokens[5].is(TokenType::FLOAT));
+}
+
+void testErrors() {
+    const char* cases[] = {"\"open", "a & b", "x @ y", "12abc", "/* open"};
+    for (const char* source : cases) {
+        Lexer lexer(source);
+        lexer.tokenize();
+        CHECK(lexer.hasError());
+    }
+
+    Lexer lexer("let a = 1;\nlet b = #;");
+    std::vector<Token> tokens = lexer.tokenize();
+    CHECK(lexer.getErrors().size() == 1);
+    CHECK(lexer.getErrors()[0].find("line 2") != String::npos);
+    CHECK(tokens.back().is(TokenType::EOF_TOKEN));
+}
+
+} // namespace
+
+int main() {
+    testTokenTypes();
+    testViews();
+    testErrors();
+    return finish("lexer");
+}
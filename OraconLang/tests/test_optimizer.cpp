@@ -0,0 +1,77 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+usize rewritesOf(const String& source) {
+    Lexer lexer(source);
+    std::vector<Token> tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto ast = parser.parse();
+    CHECK(!parser.hasError());
+
+    Optimizer optimizer;
+    optimizer.optimize(ast.get());
+    return optimizer.getRewriteCount();
+}
+
+// Optimized and unoptimized code must leave the same globals behind
+void checkSameResult(const String& source, const char* global) {
+    auto plain = compile(source);
+    auto optimized = compile(source, true);
+    if (!plain || !optimized) return;
+
+    VM plainVM;
+    plainVM.execute(plain->program.get());
+    VM optimizedVM;
+    optimizedVM.execute(optimized->program.get());
+
+    CHECK(plainVM.hasError() == optimizedVM.hasError());
+    CHECK(plainVM.getGlobalEnv().get(global).toString() == optimizedVM.getGlobalEnv().get(global).toString());
+}
+
+void testFolding() {
+    CHECK(rewritesOf("let a = 2 * 3 + 1;") >= 2);
+    CHECK(rewritesOf("let b = \"hp: \" + 10;") == 1);
+    CHECK(rewritesOf("let c = not not not true;") >= 1);
+
+    checkSameResult("let a = 2 * 3 + 1;", "a");
+    checkSameResult("let b = \"hp: \" + 10 * 2;", "b");
+    checkSameResult("let c = (1 + 2) * (3 + 4) - 10 / 3;", "c");
+    checkSameResult("let d = 1 == 1.0;", "d");
+    checkSameResult("let e = 7 % 3 + -(-5);", "e");
+    checkSameResult("let f = \"a\\\\b\\n\" + \"\\t\" + 1;", "f");
+}
+
+// Anything the VM rejects must stay in the code and fail at runtime
+void testErrorsAreNotFolded() {
+    const char* cases[][2] = {
+        {"let r = 9223372036854775807 + 1;", "Integer overflow"},
+        {"let r = -9223372036854775807 - 2;", "Integer overflow"},
+        {"let r = 3037000500 * 3037000500;", "Integer overflow"},
+        {"let r = (-9223372036854775807 - 1) / -1;", "Integer overflow"},
+        {"let r = (-9223372036854775807 - 1) % -1;", "Integer overflow"},
+        {"let r = 5 / 0;", "Division by zero"},
+        {"let r = 5 % 0;", "Modulo by zero"},
+        {"let r = \"a\" - 1;", "Operands must be numbers"},
+    };
+
+    for (const auto& entry : cases) {
+        auto script = compile(entry[0], true);
+        if (!script) continue;
+        VM vm;
+        vm.execute(script->program.get());
+        CHECK(hasErrorContaining(vm, entry[1]));
+    }
+}
+
+} // namespace
+
+int main() {
+    testFolding();
+    testErrorsAreNotFolded();
+    return finish("optimizer");
+}
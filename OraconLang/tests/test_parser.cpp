@@ -0,0 +1,123 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+// Parses source and renders each top-level statement
+struct Parsed {
+    std::vector<Token> tokens;
+    UniquePtr<Program> program;
+    std::vector<String> errors;
+};
+
+Parsed parse(std::string_view source) {
+    Parsed parsed;
+    Lexer lexer(source);
+    parsed.tokens = lexer.tokenize();
+    Parser parser(parsed.tokens);
+    parsed.program = parser.parse();
+    parsed.errors = parser.getErrors();
+    return parsed;
+}
+
+String render(std::string_view source) {
+    Parsed parsed = parse(source);
+    String out;
+    for (const auto& stmt : parsed.program->getStatements()) {
+        if (!out.empty()) out += " ";
+        out += stmt->toString();
+    }
+    return out;
+}
+
+void testPrecedence() {
+    CHECK(render("x = 1 + 2 * 3 - 4;") == "x = 1 + 2 * 3 - 4;");
+    Parsed parsed = parse("1 + 2 * 3;");
+    auto* stmt = dynamic_cast<const ExprStmt*>(parsed.program->getStatements()[0].get());
+    auto* sum = dynamic_cast<const BinaryExpr*>(stmt->getExpression());
+    CHECK(sum && sum->getOperator().is(TokenType::PLUS));
+    CHECK(sum && dynamic_cast<const BinaryExpr*>(sum->getRight()));
+
+    // ** is right-associative and binds tighter than a leading minus
+    parsed = parse("-2 ** 3 ** 2;");
+    stmt = dynamic_cast<const ExprStmt*>(parsed.program->getStatements()[0].get());
+    auto* neg = dynamic_cast<const UnaryExpr*>(stmt->getExpression());
+    CHECK(neg != nullptr);
+    auto* pow = neg ? dynamic_cast<const BinaryExpr*>(neg->getOperand()) : nullptr;
+    CHECK(pow && dynamic_cast<const BinaryExpr*>(pow->getRight()));
+
+    CHECK(render("a or b and not c;") == "a or b and not c;");
+    CHECK(render("f(a, [1, 2], {k: 1, \"s p\": \"v\"}).m[0];") ==
+          "f(a, [1, 2], {k: 1, s p: \"v\"}).m[0];");
+}
+
+void testStatements() {
+    CHECK(render("let x = 1 const y = 2\nx += y") == "let x = 1; const y = 2; x = x + y;");
+    CHECK(render("func add(a, b) { return a + b }") == "func add(a, b)");
+    CHECK(render("class Point { init(x) { } length() { return 0; } }") == "class Point");
+
+    // Both if styles, and both for styles
+    Parsed parsed = parse("if x > 1 { y(); } else if (x) z(); for i in 0..10 { } "
+                          "for (let i = 0; i < 3; i += 1) { continue; }");
+    CHECK(parsed.errors.empty());
+    const auto& statements = parsed.program->getStatements();
+    CHECK(statements.size() == 3);
+    auto* branch = dynamic_cast<const IfStmt*>(statements[0].get());
+    CHECK(branch && dynamic_cast<const IfStmt*>(branch->getElseBranch()));
+
+    auto* range = dynamic_cast<const ForStmt*>(statements[1].get());
+    CHECK(range && range->getInitializer()->toString() == "let i = 0;");
+    CHECK(range && range->getCondition()->toString() == "i < 10");
+    CHECK(range && range->getIncrement()->toString() == "i = i + 1");
+}
+
+void testErrors() {
+    Parsed parsed = parse("let = 1;\nlet ok = 2;\n1 + ;\nf(1 = 2);\n");
+    CHECK(parsed.errors.size() == 3);
+    CHECK(parsed.errors[0].find("line 1") != String::npos);
+    CHECK(parsed.errors[1].find("line 3") != String::npos);
+    CHECK(parsed.errors[2].find("Invalid assignment target") != String::npos);
+
+    // Parsing resumes at the next declaration
+    bool found = false;
+    for (const auto& stmt : parsed.program->getStatements()) {
+        found = found || stmt->toString() == "let ok = 2;";
+    }
+    CHECK(found);
+
+    CHECK(parse("func f( {").errors.size() == 1);
+    CHECK(parse("{ let a = 1;").errors[0].find("at end") != String::npos);
+}
+
+const Value& literalValue(const Parsed& parsed) {
+    auto* stmt = dynamic_cast<const ExprStmt*>(parsed.program->getStatements()[0].get());
+    return dynamic_cast<const LiteralExpr*>(stmt->getExpression())->getValue();
+}
+
+void testLiterals() {
+    // Values are parsed once, here, for every backend to share
+    CHECK(isInteger(literalValue(parse("42;")), 42));
+    CHECK(literalValue(parse("2.5;")).asFloat() == 2.5);
+    CHECK(literalValue(parse("\"a\\tb\";")).asString() == "a\tb");
+    CHECK(literalValue(parse("true;")).isBool());
+    CHECK(literalValue(parse("nil;")).isNil());
+
+    Parsed parsed = parse("let big = 99999999999999999999;\nlet ok = 1;");
+    CHECK(parsed.errors.size() == 1);
+    CHECK(parsed.errors[0].find("line 1") != String::npos);
+    CHECK(parsed.errors[0].find("Invalid integer literal '99999999999999999999'") != String::npos);
+    CHECK(parsed.program->getStatements().size() == 1);
+}
+
+} // namespace
+
+int main() {
+    testPrecedence();
+    testStatements();
+    testErrors();
+    testLiterals();
+    return finish("parser");
+}
@@ -0,0 +1,138 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+// The old version leaves a nested callback in a global and a coroutine
+// suspended inside a loop whose member reads use the old program's caches
+const char* VERSION_1 = R"(
+    let total = 0;
+    func makeCounter(step) {
+        let n = 0;
+        func next() { n = n + step; return n; }
+        return next;
+    }
+    let callback = makeCounter(1);
+    func fire() { return callback(); }
+    func worker() {
+        let next = makeCounter(10);
+        let point = {x: 1, y: 2, z: 3};
+        let other = {z: 4, w: 5};
+        for (let i = 0; i < 4; i = i + 1) {
+            yield();
+            total = total + next() + point.z + other.w;
+        }
+    }
+    startCoroutine(worker);
+)";
+
+// Fewer cache sites than the old version, and different nested functions.
+// The top-level call must not run again on reload; only the new global is
+// initialized.
+const char* VERSION_2 = R"(
+    let total = 0;
+    let added = total + 7;
+    func makeCounter(step) { return step; }
+    func fire() { return callback() * 100; }
+    func worker() { total = -1; }
+    startCoroutine(worker);
+)";
+
+void testReloadWithLiveState(u32 tierThreshold) {
+    auto v1 = compile(VERSION_1);
+    auto v2 = compile(VERSION_2);
+    if (!v1 || !v2) return;
+
+    VM vm;
+    vm.setTierUpThreshold(tierThreshold);
+    vm.execute(v1->program.get());
+    CHECK(isInteger(vm.callFunction("fire", {}), 1));
+    vm.updateCoroutines(0.1);
+    vm.updateCoroutines(0.1);
+    CHECK(isInteger(vm.getGlobalEnv().get("total"), 18));
+
+    CHECK(vm.reload(v2->program.get()));
+    CHECK(!vm.hasError());
+    CHECK(vm.getCoroutineCount() == 1);
+    CHECK(isInteger(vm.getGlobalEnv().get("total"), 18));
+    CHECK(isInteger(vm.getGlobalEnv().get("added"), 25));
+
+    // The stored nested callback keeps its old body and captured scope;
+    // fire() takes the new definition
+    CHECK(isInteger(vm.callFunction("fire", {}), 200));
+    CHECK(isInteger(vm.callFunction("callback", {}), 3));
+
+    // The suspended coroutine finishes on the old code
+    for (int i = 0; i < 4; ++i) {
+        vm.updateCoroutines(0.1);
+    }
+    CHECK(!vm.hasError());
+    CHECK(vm.getCoroutineCount() == 0);
+    CHECK(isInteger(vm.getGlobalEnv().get("total"), 18 + 28 + 38 + 48));
+
+    // New coroutines start the new body
+    vm.startCoroutine(vm.getGlobalEnv().get("worker"), {});
+    vm.updateCoroutines(0.1);
+    CHECK(isInteger(vm.getGlobalEnv().get("total"), -1));
+
+    for (const auto& error : vm.getErrors()) std::cout << "  " << error << "\n";
+}
+
+} // namespace
+
+// A global keeps its value across a reload while its initializer keeps its
+// type, and is initialized again when the new version changes the type
+void testGlobalTypeChange() {
+    auto v1 = compile(R"(
+        let n = 0;
+        let speed = 2;
+        let name = "old";
+        let items = [1, 2];
+        let computed = n + 1;
+        func update() { n = n + 1; speed = speed * 1.5; push(items, n); }
+    )");
+    auto v2 = compile(R"(
+        let n = {mood: "calm"};
+        let speed = 0.5;
+        let name = 7;
+        let items = [];
+        let computed = name + "!";
+        func update() { return n.mood; }
+    )");
+    if (!v1 || !v2) return;
+
+    VM vm;
+    vm.execute(v1->program.get());
+    vm.callFunction("update", {});
+    CHECK(!vm.hasError());
+
+    CHECK(vm.reload(v2->program.get()));
+    CHECK(!vm.hasError());
+
+    // Same type: the running value stays; an integer may become a float
+    Value speed = vm.getGlobalEnv().get("speed");
+    CHECK(speed.isFloat() && speed.asFloat() == 3.0);
+    Value items = vm.getGlobalEnv().get("items");
+    CHECK(items.isArray() && items.arraySize() == 3);
+
+    // Different type: initialized again
+    CHECK(vm.getGlobalEnv().get("n").isMap());
+    CHECK(isInteger(vm.getGlobalEnv().get("name"), 7));
+    Value mood = vm.callFunction("update", {});
+    CHECK(!vm.hasError());
+    CHECK(mood.isString() && mood.asString() == "calm");
+
+    // Only the initializer's form is known before running it; a computed
+    // one keeps the old value whatever the new one would be
+    CHECK(isInteger(vm.getGlobalEnv().get("computed"), 1));
+}
+
+int main() {
+    testReloadWithLiveState(0);
+    testReloadWithLiveState(1);
+    testGlobalTypeChange();
+    return finish("reload");
+}
@@ -0,0 +1,96 @@
+#ifndef ORACON_LANG_TESTS_TEST_UTIL_H
+#define ORACON_LANG_TESTS_TEST_UTIL_H
+
+#include "oracon/lang/lexer/lexer.h"
+#include "oracon/lang/parser/parser.h"
+#include "oracon/lang/compiler/compiler.h"
+#include "oracon/lang/compiler/optimizer.h"
+#include "oracon/lang/vm/vm.h"
+#include <iostream>
+
+namespace oracon {
+namespace lang {
+namespace test {
+
+inline int failures = 0;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++::oracon::lang::test::failures;                                             \
+        }                                                                                 \
+    } while (false)
+
+// A compiled script and everything it refers to: function values point back
+// into the AST, which must outlive the program
+struct Script {
+    String source;
+    UniquePtr<Program> ast;
+    UniquePtr<CompiledProgram> program;
+};
+
+inline UniquePtr<Script> compile(const String& source, bool optimize = false) {
+    auto script = std::make_unique<Script>();
+    script->source = source;
+
+    Lexer lexer(script->source);
+    std::vector<Token> tokens = lexer.tokenize();
+    Parser parser(tokens);
+    script->ast = parser.parse();
+    if (parser.hasError()) {
+        for (const auto& error : parser.getErrors()) std::cout << "  parse: " << error << "\n";
+        ++failures;
+        return nullptr;
+    }
+
+    if (optimize) {
+        Optimizer optimizer;
+        optimizer.optimize(script->ast.get());
+    }
+
+    Compiler compiler;
+    script->program = compiler.compile(script->ast.get());
+    if (compiler.hasError()) {
+        for (const auto& error : compiler.getErrors()) std::cout << "  compile: " << error << "\n";
+        ++failures;
+        return nullptr;
+    }
+    return script;
+}
+
+// Compiles and executes source on vm; the Script must stay alive while vm
+// may still call into it
+inline UniquePtr<Script> run(VM& vm, const String& source) {
+    auto script = compile(source);
+    if (script) {
+        vm.execute(script->program.get());
+    }
+    return script;
+}
+
+inline bool isInteger(const Value& value, i64 expected) {
+    return value.isInteger() && value.get<i64>() == expected;
+}
+
+inline bool hasErrorContaining(const VM& vm, const String& text) {
+    for (const auto& error : vm.getErrors()) {
+        if (error.find(text) != String::npos) return true;
+    }
+    return false;
+}
+
+inline int finish(const char* name) {
+    if (failures > 0) {
+        std::cout << name << ": " << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << name << ": ok\n";
+    return 0;
+}
+
+} // namespace test
+} // namespace lang
+} // namespace oracon
+
+#endif // ORACON_LANG_TESTS_TEST_UTIL_H
@@ -0,0 +1,267 @@
+#include "test_util.h"
+
+using namespace oracon;
+using namespace oracon::lang;
+using namespace oracon::lang::test;
+
+namespace {
+
+void testArithmetic() {
+    VM vm;
+    auto script = run(vm, R"(
+        let a = 7 + 3 * 2;
+        let b = 17 % 5;
+        let c = 2 ** 10;
+        let d = -(4 - 9);
+        func fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+        let e = fib(15);
+        let s = "n=" + 3;
+    )");
+    CHECK(!vm.hasError());
+    CHECK(isInteger(vm.getGlobalEnv().get("a"), 13));
+    CHECK(isInteger(vm.getGlobalEnv().get("b"), 2));
+    CHECK(vm.getGlobalEnv().get("c").asFloat() == 1024.0);
+    CHECK(isInteger(vm.getGlobalEnv().get("d"), 5));
+    CHECK(isInteger(vm.getGlobalEnv().get("e"), 610));
+    CHECK(vm.getGlobalEnv().get("s").toString() == "n=3");
+}
+
+// An int equals the float with the same value, in both tiers and in
+// branches; other types never equal a number
+void testNumericEquality() {
+    for (u32 threshold : {0u, 1u}) {
+        VM vm;
+        vm.setTierUpThreshold(threshold);
+        auto script = run(vm, R"(
+            func same(x, y) { return x == y; }
+            func differ(x, y) { if (x != y) { return true; } return false; }
+            let a = same(1, 1.0);
+            let b = differ(2.0, 2);
+            let c = same(1, 1.5);
+            let d = same(0.5 + 0.5, 1);
+            let e = same(1, "1");
+            let f = same(true, 1);
+        )");
+        CHECK(!vm.hasError());
+        const Environment& globals = vm.getGlobalEnv();
+        auto is = [&globals](const char* name, bool expected) {
+            Value value = globals.get(name);
+            return value.isBool() && value.get<bool>() == expected;
+        };
+        CHECK(is("a", true));
+        CHECK(is("b", false));
+        CHECK(is("c", false));
+        CHECK(is("d", true));
+        CHECK(is("e", false));
+        CHECK(is("f", false));
+    }
+}
+
+// Each of these used to trap (SIGFPE) or overflow silently
+void testIntegerOverflow() {
+    const char* cases[] = {
+        "let m = -9223372036854775807 - 1; let d = -1; let r = m / d;",
+        "let m = -9223372036854775807 - 1; let d = -1; let r = m % d;",
+        "let m = -9223372036854775807 - 1; let r = -m;",
+        "let m = -9223372036854775807 - 1; let r = m - 1;",
+        "let big = 9223372036854775807; let r = big + 1;",
+        "let x = 3037000500; let r = x * x;",
+    };
+    for (const char* source : cases) {
+        VM vm;
+        auto script = run(vm, source);
+        CHECK(hasErrorContaining(vm, "Integer overflow"));
+    }
+
+    VM vm;
+    auto script = run(vm, "let m = -9223372036854775807 - 1; let r = m / 1;");
+    CHECK(!vm.hasError());
+    CHECK(isInteger(vm.getGlobalEnv().get("r"), -9223372036854775807 - 1));
+}
+
+String arrayLiteral(usize count) {
+    String source = "[";
+    for (usize i = 0; i < count; ++i) {
+        source += i > 0 ? ", 1" : "1";
+    }
+    return source + "]";
+}
+
+void testStackBounds() {
+    // More elements than the VM stack holds
+    {
+        VM vm;
+        auto script = run(vm, "let big = " + arrayLiteral(20000) + ";");
+        CHECK(hasErrorContaining(vm, "Stack overflow"));
+    }
+
+    // Fits the main stack, but not a coroutine's
+    {
+        VM vm;
+        auto script = run(vm, "func build() { let a = " + arrayLiteral(3000) + "; return 0; }\n"
+                              "let direct = build();\n"
+                              "startCoroutine(build);");
+        CHECK(!vm.hasError());
+        vm.updateCoroutines(0.1);
+        CHECK(hasErrorContaining(vm, "Stack overflow"));
+    }
+
+    // Unbounded recursion stops at the frame limit
+    {
+        VM vm;
+        auto script = run(vm, "func down(n) { return down(n + 1); } down(0);");
+        CHECK(hasErrorContaining(vm, "Stack overflow"));
+    }
+}
+
+void testCallFunction() {
+    VM vm;
+    auto script = run(vm, "func add(a, b) { return a + b; }");
+    CHECK(isInteger(vm.callFunction("add", {Value(i64(2)), Value(i64(40))}), 42));
+    CHECK(isInteger(vm.callFunction(Symbol::intern("add"), {Value(i64(1)), Value(i64(2))}), 3));
+
+    vm.callFunction("add", {Value(i64(1))});
+    CHECK(hasErrorContaining(vm, "Expected 2 arguments but got 1"));
+
+    vm.callFunction("neverDeclaredAnywhere", {});
+    CHECK(hasErrorContaining(vm, "Undefined variable: neverDeclaredAnywhere"));
+    vm.callFunction(Symbol::intern("update"), {});
+    CHECK(hasErrorContaining(vm, "Undefined variable: update"));
+}
+
+Value secondArgument(void* userData, NativeArgs args) {
+    (void)userData;
+    return args[1];
+}
+
+// Natives index their arguments without checking; every way of calling one
+// checks the count first
+void testNativeArity() {
+    auto native = makeRef<Function>("second", 2, 3, secondArgument, nullptr);
+    CHECK(native->arity() == 2);
+    CHECK(native->maxArity() == 3);
+    CHECK(isInteger(native->call({Value(i64(1)), Value(i64(2))}, nullptr), 2));
+
+    String error;
+    try {
+        native->call({Value(i64(1))}, nullptr);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    CHECK(error == "Expected 2 to 3 arguments but got 1");
+
+    VM vm;
+    vm.getGlobalEnv().define("second", Value(native));
+    auto script = run(vm, "let r = second(1);");
+    CHECK(hasErrorContaining(vm, "Expected 2 to 3 arguments but got 1"));
+}
+
+// Script functions only run on their VM; calling one directly is an error
+// rather than a silent nil
+void testScriptFunctionValue() {
+    VM vm;
+    auto script = run(vm, "func add(a, b) { return a + b; }");
+    Value add = vm.getGlobalEnv().get("add");
+    CHECK(add.isFunction());
+    if (!add.isFunction()) return;
+    CHECK(add.asFunction()->arity() == 2);
+    CHECK(add.asFunction()->maxArity() == 2);
+
+    String error;
+    try {
+        add.asFunction()->call({Value(i64(1)), Value(i64(2))}, &vm.getGlobalEnv());
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    CHECK(error.find("Cannot call script function 'add'") != String::npos);
+}
+
+// + appends in place only to a string nothing else holds, in both tiers
+void testStringConcat() {
+    for (u32 threshold : {0u, 1u}) {
+        VM vm;
+        vm.setTierUpThreshold(threshold);
+        auto script = run(vm, R"(
+            let base = "hp";
+            func label(hp, max) { return "HP: " + hp + "/" + max + " " + 1.5; }
+            func grow(s) { s = s + "!"; return s; }
+            let first = label(3, 10);
+            let second = label(4, 10);
+            let grown = grow(base);
+            let again = grow(base);
+        )");
+        CHECK(!vm.hasError());
+        const Environment& globals = vm.getGlobalEnv();
+        CHECK(globals.get("first").toString() == "HP: 3/10 1.5");
+        CHECK(globals.get("second").toString() == "HP: 4/10 1.5");
+        CHECK(globals.get("base").toString() == "hp");
+        CHECK(globals.get("grown").toString() == "hp!");
+        CHECK(globals.get("again").toString() == "hp!");
+    }
+}
+
+// Block scopes are recycled once popped, but never one a closure captured
+void testScopeReuse() {
+    for (u32 threshold : {0u, 1u}) {
+        VM vm;
+        vm.setTierUpThreshold(threshold);
+        auto script = run(vm, R"(
+            let kept = [];
+            func fill(n) {
+                for (let i = 0; i < n; i = i + 1) {
+                    let v = i * 2;
+                    if (i % 4 == 0) {
+                        func get() { return v; }
+                        push(kept, get);
+                    }
+                }
+            }
+            fill(10);
+            fill(3);
+            let total = 0;
+            for (let j = 0; j < len(kept); j = j + 1) {
+                let f = kept[j];
+                total = total + f();
+            }
+        )");
+        CHECK(!vm.hasError());
+        CHECK(isInteger(vm.getGlobalEnv().get("total"), 24));
+    }
+}
+
+void testCoroutines() {
+    VM vm;
+    auto script = run(vm, R"(
+        let ticks = 0;
+        func counter() {
+            for (let i = 0; i < 3; i = i + 1) {
+                ticks = ticks + 1;
+                yield();
+            }
+        }
+        startCoroutine(counter);
+    )");
+    CHECK(vm.getCoroutineCount() == 1);
+    for (int i = 0; i < 5; ++i) {
+        vm.updateCoroutines(0.1);
+    }
+    CHECK(!vm.hasError());
+    CHECK(isInteger(vm.getGlobalEnv().get("ticks"), 3));
+    CHECK(!vm.hasCoroutines());
+}
+
+} // namespace
+
+int main() {
+    testArithmetic();
+    testNumericEquality();
+    testIntegerOverflow();
+    testStackBounds();
+    testCallFunction();
+    testNativeArity();
+    testScriptFunctionValue();
+    testStringConcat();
+    testScopeReuse();
+    testCoroutines();
+    return finish("vm");
+}
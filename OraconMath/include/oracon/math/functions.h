@@ -0,0 +1,34 @@
+#ifndef ORACON_MATH_FUNCTIONS_H
+#define ORACON_MATH_FUNCTIONS_H
+
+#include "oracon/math/constants.h"
+
+namespace oracon {
+namespace math {
+
+// value limited to [minValue, maxValue]
+template<typename T>
+constexpr T clamp(T value, T minValue, T maxValue) {
+    return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+}
+
+// a at t = 0, b at t = 1
+template<typename T>
+constexpr T lerp(T a, T b, T t) {
+    return a + (b - a) * t;
+}
+
+template<typename T>
+constexpr T toRadians(T degrees) {
+    return degrees * Constants<T>::DEG_TO_RAD;
+}
+
+template<typename T>
+constexpr T toDegrees(T radians) {
+    return radians * Constants<T>::RAD_TO_DEG;
+}
+
+} // namespace math
+} // namespace oracon
+
+#endif // ORACON_MATH_FUNCTIONS_H
@@ -0,0 +1,69 @@
+#ifndef ORACON_MATH_VECTOR_H
+#define ORACON_MATH_VECTOR_H
+
+#include "oracon/core/types.h"
+#include <cmath>
+
+namespace oracon {
+namespace math {
+
+using core::f32;
+using core::f64;
+using core::i32;
+
+// Two-component vector
+template<typename T>
+struct Vec2 {
+    T x;
+    T y;
+
+    constexpr Vec2() : x(0), y(0) {}
+    constexpr Vec2(T x, T y) : x(x), y(y) {}
+
+    constexpr Vec2 operator+(const Vec2& other) const { return Vec2(x + other.x, y + other.y); }
+    constexpr Vec2 operator-(const Vec2& other) const { return Vec2(x - other.x, y - other.y); }
+    constexpr Vec2 operator-() const { return Vec2(-x, -y); }
+    constexpr Vec2 operator*(T scalar) const { return Vec2(x * scalar, y * scalar); }
+    constexpr Vec2 operator/(T scalar) const { return Vec2(x / scalar, y / scalar); }
+
+    Vec2& operator+=(const Vec2& other) { x += other.x; y += other.y; return *this; }
+    Vec2& operator-=(const Vec2& other) { x -= other.x; y -= other.y; return *this; }
+    Vec2& operator*=(T scalar) { x *= scalar; y *= scalar; return *this; }
+    Vec2& operator/=(T scalar) { x /= scalar; y /= scalar; return *this; }
+
+    constexpr bool operator==(const Vec2& other) const { return x == other.x && y == other.y; }
+    constexpr bool operator!=(const Vec2& other) const { return !(*this == other); }
+
+    constexpr T dot(const Vec2& other) const { return x * other.x + y * other.y; }
+    // z component of the 3D cross product
+    constexpr T cross(const Vec2& other) const { return x * other.y - y * other.x; }
+
+    constexpr T lengthSquared() const { return x * x + y * y; }
+    T length() const { return static_cast<T>(std::sqrt(lengthSquared())); }
+
+    T distance(const Vec2& other) const { return (*this - other).length(); }
+    constexpr T distanceSquared(const Vec2& other) const { return (*this - other).lengthSquared(); }
+
+    // Unit vector in the same direction; the zero vector stays zero
+    Vec2 normalized() const {
+        T len = length();
+        return len > T(0) ? *this / len : Vec2();
+    }
+    void normalize() { *this = normalized(); }
+
+    static constexpr Vec2 zero() { return Vec2(); }
+    static constexpr Vec2 one() { return Vec2(T(1), T(1)); }
+};
+
+template<typename T>
+constexpr Vec2<T> operator*(T scalar, const Vec2<T>& v) { return v * scalar; }
+
+// Common type aliases
+using Vec2f = Vec2<f32>;
+using Vec2d = Vec2<f64>;
+using Vec2i = Vec2<i32>;
+
+} // namespace math
+} // namespace oracon
+
+#endif // ORACON_MATH_VECTOR_H
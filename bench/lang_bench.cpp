@@ -0,0 +1,760 @@
+#include "oracon/lang/compiler/compiler.h"
+#include "oracon/lang/interpreter/interpreter.h"
+#include "oracon/lang/lexer/lexer.h"
+#include "oracon/lang/parser/parser.h"
+#include "oracon/lang/vm/vm.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <new>
+#include <sstream>
+#include <thread>
+
+#ifdef LANG_BENCH_ENGINE
+#include "oracon/engine/component.h"
+#include "oracon/engine/entity.h"
+#include "oracon/engine/script.h"
+#include "oracon/engine/world.h"
+#endif
+
+using namespace oracon;
+using namespace lang;
+
+// Benchmark suite for the scripting language.
+//
+//   lang_bench [--json out.json] [--baseline base.json] [--tolerance 0.15]
+//              [--filter name] [--mode vm|tree] [--min-time ms] [--scripts dir]
+//
+// Each script in bench/scripts defines bench(); one call of it is one
+// operation, and its top level is untimed setup. Built with
+// LANG_BENCH_ENGINE, as engine_bench, the suite is the engine's instead:
+// engine_api defines update(dt) and runs as a ScriptComponent on an entity,
+// one onUpdate per operation. scheduler runs update(dt) on
+// SCHEDULER_ENTITIES entities through a ScriptScheduler, one update of all
+// of them per operation, once per thread count in SCHEDULER_THREADS up to
+// the hardware's; a summary line gives each count's speedup over one thread.
+// Every script runs on the VM and on the tree-walking interpreter, which the
+// scheduler keeps on one thread. Results are ns/op and allocations/op,
+// counted as calls to operator new.
+//
+// --json writes the results for a later --baseline run. With --baseline, an
+// entry slower than the baseline's by more than the tolerance, or making more
+// allocations per op by more than the tolerance and at least half an
+// allocation, fails the run with exit status 1, as does any script error or
+// any result the baseline has no timing for. A baseline that is not valid
+// JSON or has no results exits with status 2.
+
+#ifndef LANG_BENCH_SCRIPT_DIR
+#define LANG_BENCH_SCRIPT_DIR "bench/scripts"
+#endif
+
+#ifdef LANG_BENCH_ENGINE
+#define LANG_BENCH_NAME "engine_bench"
+#else
+#define LANG_BENCH_NAME "lang_bench"
+#endif
+
+namespace {
+
+std::atomic<u64> s_allocations{0};
+
+} // namespace
+
+// Every allocation in the process comes through here
+void* operator new(std::size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Runner {
+    Script,     // calls bench()
+    Engine,     // runs update(dt) through one ScriptComponent
+    Scheduler   // runs update(dt) on many entities through ScriptScheduler
+};
+
+struct Benchmark {
+    const char* name;
+    const char* file;
+    Runner runner;
+};
+
+#ifdef LANG_BENCH_ENGINE
+const Benchmark SUITE[] = {
+    {"engine_api", "engine_api.ora", Runner::Engine},
+    {"scheduler", "scheduler.ora", Runner::Scheduler},
+};
+#else
+const Benchmark SUITE[] = {
+    {"fib", "fib.ora", Runner::Script},
+    {"returns", "returns.ora", Runner::Script},
+    {"loops", "loops.ora", Runner::Script},
+    {"maps", "maps.ora", Runner::Script},
+    {"arrays", "arrays.ora", Runner::Script},
+    {"strings", "strings.ora", Runner::Script},
+    {"closures", "closures.ora", Runner::Script},
+};
+#endif
+
+const usize SCHEDULER_ENTITIES = 256;
+// Threads updating scripts, the calling thread included
+const usize SCHEDULER_THREADS[] = {1, 2, 4, 8, 16};
+
+const char* const MODES[] = {"vm", "tree"};
+
+struct Options {
+    String jsonPath;
+    String baselinePath;
+    String filter;
+    String mode;
+    String scriptDir = LANG_BENCH_SCRIPT_DIR;
+    f64 tolerance = 0.15;
+    f64 minTimeMs = 500.0;
+};
+
+struct Result {
+    String name;
+    String mode;
+    u64 ops = 0;
+    f64 nsPerOp = 0.0;
+    f64 allocsPerOp = 0.0;
+    String error;
+};
+
+// One operation; false once the script has failed
+using Operation = std::function<bool()>;
+
+bool readFile(const String& path, String& contents) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// Warms up for a fifth of the time, then runs batches of doubling size until
+// minTimeMs of operations have been timed
+void measure(const Operation& op, f64 minTimeMs, Result& result) {
+    auto warmupEnd = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<f64, std::milli>(minTimeMs / 5.0));
+    do {
+        if (!op()) return;
+    } while (Clock::now() < warmupEnd);
+
+    u64 ops = 0;
+    u64 batch = 1;
+    f64 elapsedNs = 0.0;
+    u64 allocations = s_allocations.load(std::memory_order_relaxed);
+    while (elapsedNs < minTimeMs * 1e6) {
+        auto start = Clock::now();
+        for (u64 i = 0; i < batch; ++i) {
+            if (!op()) return;
+        }
+        elapsedNs += std::chrono::duration<f64, std::nano>(Clock::now() - start).count();
+        ops += batch;
+        batch *= 2;
+    }
+    allocations = s_allocations.load(std::memory_order_relaxed) - allocations;
+
+    result.ops = ops;
+    result.nsPerOp = elapsedNs / static_cast<f64>(ops);
+    result.allocsPerOp = static_cast<f64>(allocations) / static_cast<f64>(ops);
+}
+
+void runScript(const String& source, const String& mode, f64 minTimeMs, Result& result) {
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto program = parser.parse();
+    if (parser.hasError()) {
+        result.error = "parse: " + parser.getErrors().front();
+        return;
+    }
+
+    const String entry = "bench";
+    const std::vector<Value> arguments;
+
+    if (mode == "vm") {
+        Compiler compiler;
+        auto compiled = compiler.compile(program.get());
+        if (compiler.hasError()) {
+            result.error = "compile: " + compiler.getErrors().front();
+            return;
+        }
+
+        VM vm;
+        vm.execute(compiled.get());
+        if (!vm.hasError()) {
+            measure([&]() {
+                vm.callFunction(entry, arguments);
+                return !vm.hasError();
+            }, minTimeMs, result);
+        }
+        if (vm.hasError()) {
+            result.error = vm.getErrors().front();
+        }
+    } else {
+        Interpreter interpreter;
+        interpreter.execute(program.get());
+        if (!interpreter.hasError()) {
+            measure([&]() {
+                interpreter.callFunction(entry, arguments);
+                return !interpreter.hasError();
+            }, minTimeMs, result);
+        }
+        if (interpreter.hasError()) {
+            result.error = interpreter.getErrors().front();
+        }
+    }
+}
+
+#ifdef LANG_BENCH_ENGINE
+void runEngineScript(const String& source, const String& mode, f64 minTimeMs, Result& result) {
+    engine::World world;
+    engine::Entity* player = world.createEntity("Player");
+    player->addComponent<engine::Transform>();
+    player->addComponent<engine::Rigidbody>()->velocity = engine::Vec2f(30.0f, -12.0f);
+    world.createEntity("Target")->addComponent<engine::Transform>();
+
+    auto* script = player->addComponent<engine::ScriptComponent>(source);
+    script->setExecutionMode(mode == "vm" ? ExecutionMode::Bytecode : ExecutionMode::TreeWalk);
+    script->onStart(player, &world);
+    if (!script->hasErrors()) {
+        measure([&]() {
+            script->onUpdate(player, &world, 1.0f / 60.0f);
+            return !script->hasErrors();
+        }, minTimeMs, result);
+    }
+    if (script->hasErrors()) {
+        result.error = script->getErrors();
+    }
+}
+
+void runScheduler(const String& source, const String& mode, usize threads, f64 minTimeMs, Result& result) {
+    engine::World world;
+    world.createEntity("Target")->addComponent<engine::Transform>();
+
+    std::vector<engine::ScriptComponent*> scripts;
+    for (usize i = 0; i < SCHEDULER_ENTITIES; ++i) {
+        engine::Entity* unit = world.createEntity("Unit" + std::to_string(i));
+        unit->addComponent<engine::Transform>()->position = engine::Vec2f(static_cast<float>(i), 0.0f);
+        unit->addComponent<engine::Rigidbody>()->velocity = engine::Vec2f(1.0f, -1.0f);
+
+        auto* script = unit->addComponent<engine::ScriptComponent>(source);
+        script->setExecutionMode(mode == "vm" ? ExecutionMode::Bytecode : ExecutionMode::TreeWalk);
+        script->onStart(unit, &world);
+        scripts.push_back(script);
+    }
+
+    auto firstError = [&scripts]() {
+        for (auto* script : scripts) {
+            if (script->hasErrors()) return script->getErrors();
+        }
+        return String();
+    };
+
+    result.error = firstError();
+    if (result.error.empty()) {
+        engine::ScriptScheduler scheduler(threads - 1);
+        measure([&]() {
+            scheduler.update(&world, 1.0f / 60.0f);
+            return std::none_of(scripts.begin(), scripts.end(),
+                                [](const engine::ScriptComponent* script) { return script->hasErrors(); });
+        }, minTimeMs, result);
+        result.error = firstError();
+    }
+}
+#endif
+
+String jsonEscape(const String& text) {
+    String escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (static_cast<unsigned char>(c) >= 0x20) {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+bool writeJson(const String& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+    out << "{\n  \"suite\": \"" LANG_BENCH_NAME "\",\n  \"results\": [\n";
+    for (usize i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"mode\": \"" << result.mode
+            << "\", \"ops\": " << result.ops << std::fixed
+            << ", \"ns_per_op\": " << std::setprecision(1) << result.nsPerOp
+            << ", \"allocs_per_op\": " << std::setprecision(3) << result.allocsPerOp;
+        if (!result.error.empty()) {
+            out << ", \"error\": \"" << jsonEscape(result.error) << "\"";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+// Minimal JSON document, enough to read a baseline back
+struct JsonValue {
+    enum class Kind { Null, Bool, Number, String, Array, Object };
+
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    f64 number = 0.0;
+    String string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<String, JsonValue>> members;
+
+    // Member named key of an object; nullptr if absent
+    const JsonValue* find(const String& key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+// Recursive-descent parser for RFC 8259 JSON. The whole text must be one
+// value; on failure getError() says what was wrong and where.
+class JsonReader {
+public:
+    explicit JsonReader(const String& text) : m_text(text), m_pos(0) {}
+
+    bool parse(JsonValue& out) {
+        skipSpace();
+        if (!value(out, 0)) return false;
+        skipSpace();
+        return m_pos == m_text.size() || fail("trailing characters");
+    }
+
+    const String& getError() const { return m_error; }
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+
+    const String& m_text;
+    usize m_pos;
+    String m_error;
+
+    bool fail(const String& message) {
+        if (m_error.empty()) {
+            m_error = message + " at offset " + std::to_string(m_pos);
+        }
+        return false;
+    }
+
+    void skipSpace() {
+        while (m_pos < m_text.size() &&
+               (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\n' || m_text[m_pos] == '\r')) {
+            ++m_pos;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool value(JsonValue& out, int depth) {
+        if (depth > MAX_DEPTH) return fail("nesting too deep");
+        skipSpace();
+        if (m_pos >= m_text.size()) return fail("unexpected end");
+
+        char c = m_text[m_pos];
+        if (c == '{') return object(out, depth);
+        if (c == '[') return array(out, depth);
+        if (c == '"') {
+            out.kind = JsonValue::Kind::String;
+            return string(out.string);
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            out.kind = JsonValue::Kind::Number;
+            return number(out.number);
+        }
+        if (word("true")) {
+            out.kind = JsonValue::Kind::Bool;
+            out.boolean = true;
+            return true;
+        }
+        if (word("false")) {
+            out.kind = JsonValue::Kind::Bool;
+            return true;
+        }
+        if (word("null")) {
+            return true;
+        }
+        return fail("unexpected character");
+    }
+
+    bool object(JsonValue& out, int depth) {
+        out.kind = JsonValue::Kind::Object;
+        ++m_pos;
+        if (consume('}')) return true;
+        do {
+            skipSpace();
+            String key;
+            if (m_pos >= m_text.size() || m_text[m_pos] != '"' || !string(key)) return fail("expected a member name");
+            if (!consume(':')) return fail("expected ':'");
+            JsonValue member;
+            if (!value(member, depth + 1)) return false;
+            out.members.emplace_back(std::move(key), std::move(member));
+        } while (consume(','));
+        return consume('}') || fail("expected ',' or '}'");
+    }
+
+    bool array(JsonValue& out, int depth) {
+        out.kind = JsonValue::Kind::Array;
+        ++m_pos;
+        if (consume(']')) return true;
+        do {
+            JsonValue item;
+            if (!value(item, depth + 1)) return false;
+            out.items.push_back(std::move(item));
+        } while (consume(','));
+        return consume(']') || fail("expected ',' or ']'");
+    }
+
+    bool string(String& out) {
+        ++m_pos;
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return fail("control character in string");
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) break;
+            switch (m_text[m_pos++]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    if (m_pos + 4 > m_text.size()) return fail("truncated \\u escape");
+                    u32 code = 0;
+                    for (int k = 0; k < 4; ++k) {
+                        char h = m_text[m_pos++];
+                        code <<= 4;
+                        if (h >= '0' && h <= '9') code |= static_cast<u32>(h - '0');
+                        else if (h >= 'a' && h <= 'f') code |= static_cast<u32>(h - 'a' + 10);
+                        else if (h >= 'A' && h <= 'F') code |= static_cast<u32>(h - 'A' + 10);
+                        else return fail("bad \\u escape");
+                    }
+                    // UTF-8; a surrogate half is kept as its own code unit
+                    if (code < 0x80) {
+                        out += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        out += static_cast<char>(0xC0 | (code >> 6));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    } else {
+                        out += static_cast<char>(0xE0 | (code >> 12));
+                        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default:
+                    return fail("bad escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool number(f64& out) {
+        usize start = m_pos;
+        auto digits = [this]() {
+            usize first = m_pos;
+            while (m_pos < m_text.size() && m_text[m_pos] >= '0' && m_text[m_pos] <= '9') ++m_pos;
+            return m_pos > first;
+        };
+
+        if (m_text[m_pos] == '-') ++m_pos;
+        if (m_pos < m_text.size() && m_text[m_pos] == '0') {
+            ++m_pos;
+        } else if (!digits()) {
+            return fail("bad number");
+        }
+        if (m_pos < m_text.size() && m_text[m_pos] == '.') {
+            ++m_pos;
+            if (!digits()) return fail("bad number");
+        }
+        if (m_pos < m_text.size() && (m_text[m_pos] == 'e' || m_text[m_pos] == 'E')) {
+            ++m_pos;
+            if (m_pos < m_text.size() && (m_text[m_pos] == '+' || m_text[m_pos] == '-')) ++m_pos;
+            if (!digits()) return fail("bad number");
+        }
+
+        std::istringstream in(m_text.substr(start, m_pos - start));
+        in.imbue(std::locale::classic());
+        in >> out;
+        return static_cast<bool>(in) || fail("bad number");
+    }
+
+    bool word(const char* text) {
+        usize length = std::char_traits<char>::length(text);
+        if (m_text.compare(m_pos, length, text) != 0) return false;
+        m_pos += length;
+        return true;
+    }
+};
+
+// Reads a file written by writeJson. Fails with a reason if the file is not
+// JSON of that shape or has no results.
+bool readBaseline(const String& path, std::vector<Result>& baseline, String& error) {
+    String text;
+    if (!readFile(path, text)) {
+        error = "cannot open file";
+        return false;
+    }
+
+    JsonValue document;
+    JsonReader reader(text);
+    if (!reader.parse(document)) {
+        error = reader.getError();
+        return false;
+    }
+
+    const JsonValue* results = document.kind == JsonValue::Kind::Object ? document.find("results") : nullptr;
+    if (!results || results->kind != JsonValue::Kind::Array) {
+        error = "no \"results\" array";
+        return false;
+    }
+    if (results->items.empty()) {
+        error = "no results";
+        return false;
+    }
+
+    for (usize i = 0; i < results->items.size(); ++i) {
+        const JsonValue& item = results->items[i];
+        const JsonValue* name = item.find("name");
+        const JsonValue* mode = item.find("mode");
+        const JsonValue* ns = item.find("ns_per_op");
+        const JsonValue* allocs = item.find("allocs_per_op");
+        const JsonValue* entryError = item.find("error");
+        if (!name || name->kind != JsonValue::Kind::String || !mode || mode->kind != JsonValue::Kind::String ||
+            !ns || ns->kind != JsonValue::Kind::Number || !allocs || allocs->kind != JsonValue::Kind::Number ||
+            (entryError && entryError->kind != JsonValue::Kind::String)) {
+            error = "result " + std::to_string(i) + " lacks name, mode, ns_per_op or allocs_per_op";
+            return false;
+        }
+
+        Result entry;
+        entry.name = name->string;
+        entry.mode = mode->string;
+        entry.nsPerOp = ns->number;
+        entry.allocsPerOp = allocs->number;
+        entry.error = entryError ? entryError->string : String();
+        baseline.push_back(entry);
+    }
+    return true;
+}
+
+// Prints each regression against baseline, and each result the baseline has
+// no timing for; the number found
+usize compareToBaseline(const std::vector<Result>& results, const std::vector<Result>& baseline, f64 tolerance) {
+    usize regressions = 0;
+    for (const Result& result : results) {
+        if (!result.error.empty()) continue;
+
+        const Result* base = nullptr;
+        for (const Result& candidate : baseline) {
+            if (candidate.name == result.name && candidate.mode == result.mode) {
+                base = &candidate;
+                break;
+            }
+        }
+        if (!base || !base->error.empty()) {
+            std::cout << "MISSING " << result.name << " (" << result.mode << "): no baseline timing\n";
+            ++regressions;
+            continue;
+        }
+
+        if (result.nsPerOp > base->nsPerOp * (1.0 + tolerance)) {
+            std::cout << "REGRESSION " << result.name << " (" << result.mode << "): "
+                      << base->nsPerOp << " -> " << result.nsPerOp << " ns/op\n";
+            ++regressions;
+        }
+        if (result.allocsPerOp > base->allocsPerOp * (1.0 + tolerance) + 0.5) {
+            std::cout << "REGRESSION " << result.name << " (" << result.mode << "): "
+                      << base->allocsPerOp << " -> " << result.allocsPerOp << " allocs/op\n";
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        String arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            options.tolerance = std::atof(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--mode" && hasValue) {
+            options.mode = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            options.minTimeMs = std::atof(argv[++i]);
+        } else if (arg == "--scripts" && hasValue) {
+            options.scriptDir = argv[++i];
+        } else {
+            std::cerr << "usage: " LANG_BENCH_NAME " [--json out.json] [--baseline base.json] [--tolerance 0.15]\n"
+                         "       [--filter name] [--mode vm|tree] [--min-time ms] [--scripts dir]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    std::vector<Result> results;
+    bool failed = false;
+
+    std::cout << std::left << std::setw(14) << "benchmark" << std::setw(6) << "mode"
+              << std::right << std::setw(14) << "ns/op" << std::setw(14) << "allocs/op"
+              << std::setw(12) << "ops" << "\n";
+
+    for (const Benchmark& benchmark : SUITE) {
+        if (!options.filter.empty() && String(benchmark.name).find(options.filter) == String::npos) {
+            continue;
+        }
+
+        String source;
+        String path = options.scriptDir + "/" + benchmark.file;
+        if (!readFile(path, source)) {
+            std::cerr << "Failed to open " << path << "\n";
+            return 2;
+        }
+
+        for (const char* mode : MODES) {
+            if (!options.mode.empty() && options.mode != mode) continue;
+
+            // Only the scheduler runs more than once, at each thread count
+            std::vector<usize> threadCounts{1};
+            if (benchmark.runner == Runner::Scheduler && String(mode) == "vm") {
+                usize hardware = std::max<usize>(std::thread::hardware_concurrency(), 1);
+                for (usize threads : SCHEDULER_THREADS) {
+                    if (threads > 1 && threads <= hardware) threadCounts.push_back(threads);
+                }
+            }
+
+            f64 singleThreadNs = 0.0;
+            String scaling;
+            for (usize threads : threadCounts) {
+                Result result;
+                result.name = benchmark.name;
+                result.mode = mode;
+                switch (benchmark.runner) {
+                    case Runner::Script:
+                        runScript(source, mode, options.minTimeMs, result);
+                        break;
+#ifdef LANG_BENCH_ENGINE
+                    case Runner::Engine:
+                        runEngineScript(source, mode, options.minTimeMs, result);
+                        break;
+                    case Runner::Scheduler:
+                        result.name += "/" + std::to_string(threads);
+                        runScheduler(source, mode, threads, options.minTimeMs, result);
+                        break;
+#else
+                    case Runner::Engine:
+                    case Runner::Scheduler:
+                        break;
+#endif
+                }
+
+                std::cout << std::left << std::setw(14) << result.name << std::setw(6) << result.mode
+                          << std::right << std::fixed;
+                if (result.error.empty()) {
+                    std::cout << std::setprecision(1) << std::setw(14) << result.nsPerOp
+                              << std::setprecision(3) << std::setw(14) << result.allocsPerOp
+                              << std::setw(12) << result.ops << "\n";
+                    if (threads == 1) {
+                        singleThreadNs = result.nsPerOp;
+                    } else if (singleThreadNs > 0.0) {
+                        std::ostringstream speedup;
+                        speedup << std::fixed << std::setprecision(2) << singleThreadNs / result.nsPerOp;
+                        scaling += "  " + std::to_string(threads) + " threads " + speedup.str() + "x";
+                    }
+                } else {
+                    std::cout << "  error: " << result.error << "\n";
+                    failed = true;
+                }
+                results.push_back(result);
+            }
+            if (!scaling.empty()) {
+                std::cout << "  " << benchmark.name << " speedup over 1 thread:" << scaling << "\n";
+            }
+        }
+    }
+
+    if (!options.jsonPath.empty() && !writeJson(options.jsonPath, results)) {
+        std::cerr << "Failed to write " << options.jsonPath << "\n";
+        return 2;
+    }
+
+    if (!options.baselinePath.empty()) {
+        std::vector<Result> baseline;
+        String error;
+        if (!readBaseline(options.baselinePath, baseline, error)) {
+            std::cerr << "Invalid baseline " << options.baselinePath << ": " << error << "\n";
+            return 2;
+        }
+        if (compareToBaseline(results, baseline, options.tolerance) > 0) {
+            failed = true;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
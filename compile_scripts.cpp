@@ -0,0 +1,99 @@
+#include "oracon/lang/lexer/lexer.h"
+#include "oracon/lang/parser/parser.h"
+#include "oracon/lang/compiler/bundle.h"
+#include "oracon/lang/compiler/compiler.h"
+#include "oracon/lang/compiler/optimizer.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace oracon;
+using namespace lang;
+
+// Offline compile step for shipping scripts.
+//
+//   compile_scripts -o scripts.orb [--no-optimize] a.ora b.ora ...
+//
+// Each script is parsed, optimized and compiled to bytecode, then stored in
+// the bundle under its path exactly as given on the command line; that path
+// is the name to look it up by at runtime. Scripts the bytecode compiler
+// rejects are reported and the bundle is not written.
+
+int main(int argc, char** argv) {
+    String output;
+    bool optimize = true;
+    std::vector<String> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        String arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--no-optimize") {
+            optimize = false;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (output.empty() || inputs.empty()) {
+        std::cerr << "usage: compile_scripts -o bundle.orb [--no-optimize] script.ora...\n";
+        return 1;
+    }
+
+    BundleWriter writer;
+    bool failed = false;
+
+    for (const auto& path : inputs) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << path << "\n";
+            failed = true;
+            continue;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        String code = buffer.str();
+
+        Lexer lexer(code, path);
+        auto tokens = lexer.tokenize();
+
+        Parser parser(tokens);
+        auto program = parser.parse();
+        if (parser.hasError()) {
+            for (const auto& err : parser.getErrors()) {
+                std::cerr << path << ": " << err << "\n";
+            }
+            failed = true;
+            continue;
+        }
+
+        if (optimize) {
+            Optimizer optimizer;
+            optimizer.optimize(program.get());
+        }
+
+        Compiler compiler;
+        auto compiled = compiler.compile(program.get());
+        if (compiler.hasError()) {
+            for (const auto& err : compiler.getErrors()) {
+                std::cerr << path << ": " << err << "\n";
+            }
+            failed = true;
+            continue;
+        }
+
+        if (!writer.add(path, *compiled)) {
+            failed = true;
+        }
+    }
+
+    if (failed || !writer.write(output)) {
+        for (const auto& err : writer.getErrors()) {
+            std::cerr << err << "\n";
+        }
+        return 1;
+    }
+
+    std::cout << "Wrote " << writer.size() << " scripts to " << output << "\n";
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "oracon/lang/lexer/lexer.h"
+#include "oracon/lang/parser/parser.h"
+#include "oracon/lang/compiler/compiler.h"
+#include "oracon/lang/compiler/optimizer.h"
+#include "oracon/lang/vm/vm.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace oracon;
+using namespace lang;
+
+// Debug dump of what the script pipeline does to a file.
+//
+//   dump_script [--dump-optimized] [--dump-bytecode] [--no-optimize] [--profile] script.ora
+//
+// --dump-optimized lists every rewrite the AST optimizer made;
+// --dump-bytecode prints the compiled program (after optimization unless
+// --no-optimize is given); --profile runs it on the VM and prints the
+// hottest functions and lines, followed by folded stacks for flamegraph.pl.
+
+int main(int argc, char** argv) {
+    bool dumpOptimized = false;
+    bool dumpBytecode = false;
+    bool optimize = true;
+    bool profile = false;
+    String path;
+
+    for (int i = 1; i < argc; ++i) {
+        String arg = argv[i];
+        if (arg == "--dump-optimized") {
+            dumpOptimized = true;
+        } else if (arg == "--dump-bytecode") {
+            dumpBytecode = true;
+        } else if (arg == "--no-optimize") {
+            optimize = false;
+        } else if (arg == "--profile") {
+            profile = true;
+        } else {
+            path = arg;
+        }
+    }
+
+    if (path.empty()) {
+        std::cerr << "usage: dump_script [--dump-optimized] [--dump-bytecode] [--no-optimize] [--profile] script.ora\n";
+        return 1;
+    }
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << path << "\n";
+        return 1;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    String code = buffer.str();
+
+    Lexer lexer(code, path);
+    auto tokens = lexer.tokenize();
+
+    Parser parser(tokens);
+    auto program = parser.parse();
+
+    if (parser.hasError()) {
+        std::cout << "Parse errors:\n";
+        for (const auto& err : parser.getErrors()) {
+            std::cout << "  " << err << "\n";
+        }
+        return 1;
+    }
+
+    if (optimize) {
+        Optimizer optimizer(dumpOptimized);
+        optimizer.optimize(program.get());
+
+        if (dumpOptimized) {
+            std::cout << "=== Optimizer: " << optimizer.getRewriteCount() << " rewrites ===\n";
+            for (const auto& line : optimizer.getLog()) {
+                std::cout << line << "\n";
+            }
+        }
+    }
+
+    if (dumpBytecode || profile) {
+        Compiler compiler;
+        auto compiled = compiler.compile(program.get());
+        if (compiler.hasError()) {
+            for (const auto& err : compiler.getErrors()) {
+                std::cout << err << "\n";
+            }
+            return 1;
+        }
+
+        if (dumpBytecode) {
+            std::cout << compiled->disassemble();
+        }
+
+        if (profile) {
+            Profiler profiler;
+            VM vm;
+            vm.setProfiler(&profiler);
+            vm.execute(compiled.get());
+            for (const auto& err : vm.getErrors()) {
+                std::cout << err << "\n";
+            }
+
+            std::cout << profiler.report();
+            std::cout << "=== Folded stacks ===\n" << profiler.toFoldedStacks();
+        }
+    }
+
+    return 0;
+}
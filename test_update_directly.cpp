@@ -66,7 +66,7 @@ int main() {
                 args.push_back(Value(0.016)); // ~60 FPS
 
                 std::cout << "Calling update, iteration " << (i+1) << "\n";
-                fn->call(args, &interp.getGlobalEnv());
+                interp.callFunction("update", args);
 
                 if (interp.hasError()) {
                     std::cout << "Error during call:\n";